@@ -0,0 +1,23 @@
+#!/usr/bin/env bash
+# Time the router's receive path with debug logging compiled in (env:native) and compiled out (env:native-log-info), by
+# replaying the same frame capture through both builds.  Record a capture with Logging: FrameCaptureFile in config.yaml.
+#
+# Usage: bin/bench-log-levels.sh CAPTURE
+
+set -e
+
+CAPTURE=${1:?usage: $0 CAPTURE}
+OUTDIR=$(mktemp -d)
+trap 'rm -rf "$OUTDIR"' EXIT
+
+pio run --environment native
+pio run --environment native-log-info
+
+# Log output goes to /dev/null, so what we measure is building the messages rather than the terminal drawing them
+echo "Debug logging compiled in:"
+.pio/build/native/program --replay "$CAPTURE" --replay-outcome "$OUTDIR/native.outcome" >"$OUTDIR/native.log"
+grep "Replay:" "$OUTDIR/native.log"
+
+echo "Debug logging compiled out:"
+.pio/build/native-log-info/program --replay "$CAPTURE" --replay-baseline "$OUTDIR/native.outcome" >"$OUTDIR/native-log-info.log"
+grep "Replay:" "$OUTDIR/native-log-info.log"
@@ -36,23 +36,44 @@
 
 #define DEBUG_PORT (*console) // Serial debug port
 
+// Severities, lowest first, for LOG_MIN_SEVERITY and RedirectablePrint::wants()
+#define LOG_SEVERITY_TRACE 0
+#define LOG_SEVERITY_DEBUG 1
+#define LOG_SEVERITY_INFO 2
+#define LOG_SEVERITY_WARN 3
+#define LOG_SEVERITY_ERROR 4
+#define LOG_SEVERITY_CRIT 5
+
+// Log calls below this severity are compiled out along with their arguments, e.g. -DLOG_MIN_SEVERITY=LOG_SEVERITY_INFO
+// (which also leaves the meshtasticd trace file empty)
+#ifndef LOG_MIN_SEVERITY
+#define LOG_MIN_SEVERITY LOG_SEVERITY_TRACE
+#endif
+
 #ifdef USE_SEGGER
 // #undef DEBUG_PORT
-#define LOG_DEBUG(...) SEGGER_RTT_printf(0, __VA_ARGS__)
-#define LOG_INFO(...) SEGGER_RTT_printf(0, __VA_ARGS__)
-#define LOG_WARN(...) SEGGER_RTT_printf(0, __VA_ARGS__)
-#define LOG_ERROR(...) SEGGER_RTT_printf(0, __VA_ARGS__)
-#define LOG_CRIT(...) SEGGER_RTT_printf(0, __VA_ARGS__)
-#define LOG_TRACE(...) SEGGER_RTT_printf(0, __VA_ARGS__)
+#define LOG_ENABLED(severity) ((severity) >= LOG_MIN_SEVERITY)
+#define LOG_AT(severity, ...) (LOG_ENABLED(severity) ? (void)SEGGER_RTT_printf(0, __VA_ARGS__) : (void)0)
+#define LOG_DEBUG(...) LOG_AT(LOG_SEVERITY_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_SEVERITY_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_SEVERITY_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_SEVERITY_ERROR, __VA_ARGS__)
+#define LOG_CRIT(...) LOG_AT(LOG_SEVERITY_CRIT, __VA_ARGS__)
+#define LOG_TRACE(...) LOG_AT(LOG_SEVERITY_TRACE, __VA_ARGS__)
 #else
 #if defined(DEBUG_PORT) && !defined(DEBUG_MUTE)
-#define LOG_DEBUG(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__)
-#define LOG_INFO(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_INFO, __VA_ARGS__)
-#define LOG_WARN(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_WARN, __VA_ARGS__)
-#define LOG_ERROR(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_ERROR, __VA_ARGS__)
-#define LOG_CRIT(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_CRIT, __VA_ARGS__)
-#define LOG_TRACE(...) DEBUG_PORT.log(MESHTASTIC_LOG_LEVEL_TRACE, __VA_ARGS__)
+// True if a message of this severity would be written anywhere.  Checked before the arguments are evaluated, so wrap any
+// work done only to build a log message in it too.
+#define LOG_ENABLED(severity) ((severity) >= LOG_MIN_SEVERITY && DEBUG_PORT.wants(severity))
+#define LOG_AT(severity, level, ...) (LOG_ENABLED(severity) ? DEBUG_PORT.log(level, __VA_ARGS__) : (void)0)
+#define LOG_DEBUG(...) LOG_AT(LOG_SEVERITY_DEBUG, MESHTASTIC_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_SEVERITY_INFO, MESHTASTIC_LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_SEVERITY_WARN, MESHTASTIC_LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_SEVERITY_ERROR, MESHTASTIC_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_CRIT(...) LOG_AT(LOG_SEVERITY_CRIT, MESHTASTIC_LOG_LEVEL_CRIT, __VA_ARGS__)
+#define LOG_TRACE(...) LOG_AT(LOG_SEVERITY_TRACE, MESHTASTIC_LOG_LEVEL_TRACE, __VA_ARGS__)
 #else
+#define LOG_ENABLED(severity) false
 #define LOG_DEBUG(...)
 #define LOG_INFO(...)
 #define LOG_WARN(...)
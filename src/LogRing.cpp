@@ -0,0 +1,400 @@
+#include "LogRing.h"
+#include "RTC.h"
+#include "concurrency/OSThread.h"
+#include "configuration.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace
+{
+
+enum ArgKind : uint8_t { ARG_LITERAL, ARG_SIGNED, ARG_UNSIGNED, ARG_CHAR, ARG_DOUBLE, ARG_STRING, ARG_POINTER };
+
+/// One printf conversion: spec[0, lengthStart) is the % with its flags, width and precision, conv is the conversion character
+struct Conversion {
+    ArgKind kind;
+    char length; // 0, 'H' (hh), 'h', 'l', 'q' (ll), 'j', 'z' or 't'
+    char conv;
+    uint8_t stars;      // '*' widths and precisions, each an int argument ahead of the value
+    bool precisionStar; // the last of those stars is the precision
+    int precision;      // from the digits after the '.', -1 if there are none (or it is a '*')
+    size_t lengthStart;
+    const char *end; // just past the conversion
+};
+
+/// Parse the conversion at p (which points at a '%').  Returns false for anything we don't know how to capture.
+bool parseConversion(const char *p, Conversion &c)
+{
+    const char *q = p + 1;
+    c.stars = 0;
+    c.length = 0;
+    c.precisionStar = false;
+    c.precision = -1;
+    if (*q == '%') {
+        c.kind = ARG_LITERAL;
+        c.conv = '%';
+        c.end = q + 1;
+        return true;
+    }
+    while (*q && strchr("-+ #0", *q))
+        q++;
+    if (*q == '*') {
+        c.stars++;
+        q++;
+    } else {
+        while (isdigit((unsigned char)*q))
+            q++;
+    }
+    if (*q == '.') {
+        q++;
+        if (*q == '*') {
+            c.stars++;
+            c.precisionStar = true;
+            q++;
+        } else {
+            c.precision = 0;
+            while (isdigit((unsigned char)*q))
+                c.precision = c.precision * 10 + (*q++ - '0');
+        }
+    }
+    c.lengthStart = q - p;
+    switch (*q) {
+    case 'h':
+        c.length = q[1] == 'h' ? 'H' : 'h';
+        q += c.length == 'H' ? 2 : 1;
+        break;
+    case 'l':
+        c.length = q[1] == 'l' ? 'q' : 'l';
+        q += c.length == 'q' ? 2 : 1;
+        break;
+    case 'j':
+    case 'z':
+    case 't':
+        c.length = *q++;
+        break;
+    }
+    c.conv = *q;
+    c.end = q + 1;
+    switch (c.conv) {
+    case 'd':
+    case 'i':
+        c.kind = ARG_SIGNED;
+        return true;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        c.kind = ARG_UNSIGNED;
+        return true;
+    case 'c':
+        c.kind = ARG_CHAR;
+        return c.length == 0;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        c.kind = ARG_DOUBLE;
+        return c.length == 0 || c.length == 'l';
+    case 's':
+        c.kind = ARG_STRING;
+        return c.length == 0;
+    case 'p':
+        c.kind = ARG_POINTER;
+        return c.length == 0;
+    default: // %n, %ls, %Lf, or the format ends in the middle of a conversion
+        return false;
+    }
+}
+
+/// Writes arguments into a slot, refusing to run past its end
+struct SlotWriter {
+    uint8_t *pos;
+    uint8_t *end;
+
+    bool put(const void *v, size_t n)
+    {
+        if ((size_t)(end - pos) < n)
+            return false;
+        memcpy(pos, v, n);
+        pos += n;
+        return true;
+    }
+};
+
+template <typename T> T take(const uint8_t *&pos)
+{
+    T v;
+    memcpy(&v, pos, sizeof(v));
+    pos += sizeof(v);
+    return v;
+}
+
+template <typename T> int formatOne(char *out, size_t n, const char *spec, const int *stars, uint8_t nStars, T v)
+{
+    switch (nStars) {
+    case 0:
+        return snprintf(out, n, spec, v);
+    case 1:
+        return snprintf(out, n, spec, stars[0], v);
+    default:
+        return snprintf(out, n, spec, stars[0], stars[1], v);
+    }
+}
+
+} // namespace
+
+LogRing::LogRing()
+{
+    for (uint32_t i = 0; i < LOG_RING_SLOTS; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool LogRing::push(const char *level, uint8_t flags, const char *format, va_list arg)
+{
+    // Claim a slot
+    Slot *slot;
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &slots[pos & (LOG_RING_SLOTS - 1)];
+        int32_t diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->flags = flags;
+    slot->millis = millis();
+    slot->rtcSec = getValidTime(RTCQuality::RTCQualityDevice, true);
+    auto thread = concurrency::OSThread::currentThread;
+    if (thread) {
+        strncpy(slot->thread, thread->ThreadName.c_str(), sizeof(slot->thread) - 1);
+        slot->thread[sizeof(slot->thread) - 1] = '\0';
+    } else {
+        slot->thread[0] = '\0';
+    }
+
+    // Some callers pass a temporary as the format (route.c_str()), so it is copied rather than pointed to
+    SlotWriter w = {slot->data, slot->data + sizeof(slot->data)};
+    bool ok = w.put(format, strlen(format) + 1);
+    va_list ap;
+    va_copy(ap, arg);
+    for (const char *p = format; ok && (p = strchr(p, '%')) != NULL;) {
+        Conversion c;
+        if (!parseConversion(p, c)) {
+            ok = false;
+            break;
+        }
+        p = c.end;
+        int precision = c.precision;
+        for (uint8_t i = 0; ok && i < c.stars; i++) {
+            int star = va_arg(ap, int);
+            ok = w.put(&star, sizeof(star));
+            if (c.precisionStar && i == c.stars - 1)
+                precision = star; // a negative one counts as none
+        }
+        switch (c.kind) {
+        case ARG_LITERAL:
+            break;
+        case ARG_SIGNED: {
+            long long v;
+            switch (c.length) {
+            case 'l':
+                v = va_arg(ap, long);
+                break;
+            case 'q':
+                v = va_arg(ap, long long);
+                break;
+            case 'j':
+                v = va_arg(ap, intmax_t);
+                break;
+            case 'z':
+            case 't':
+                v = va_arg(ap, ptrdiff_t);
+                break;
+            case 'H': // char and short arrive promoted to int
+                v = (signed char)va_arg(ap, int);
+                break;
+            case 'h':
+                v = (short)va_arg(ap, int);
+                break;
+            default:
+                v = va_arg(ap, int);
+            }
+            ok = ok && w.put(&v, sizeof(v));
+            break;
+        }
+        case ARG_UNSIGNED: {
+            unsigned long long v;
+            switch (c.length) {
+            case 'l':
+                v = va_arg(ap, unsigned long);
+                break;
+            case 'q':
+                v = va_arg(ap, unsigned long long);
+                break;
+            case 'j':
+                v = va_arg(ap, uintmax_t);
+                break;
+            case 'z':
+            case 't':
+                v = va_arg(ap, size_t);
+                break;
+            case 'H':
+                v = (unsigned char)va_arg(ap, unsigned int);
+                break;
+            case 'h':
+                v = (unsigned short)va_arg(ap, unsigned int);
+                break;
+            default:
+                v = va_arg(ap, unsigned int);
+            }
+            ok = ok && w.put(&v, sizeof(v));
+            break;
+        }
+        case ARG_CHAR: {
+            int v = va_arg(ap, int);
+            ok = ok && w.put(&v, sizeof(v));
+            break;
+        }
+        case ARG_DOUBLE: {
+            double v = va_arg(ap, double);
+            ok = ok && w.put(&v, sizeof(v));
+            break;
+        }
+        case ARG_STRING: {
+            const char *v = va_arg(ap, const char *);
+            if (!v)
+                v = "(null)";
+            // With a precision the caller may pass bytes that aren't NUL terminated (%.*s of a payload), so don't read further
+            size_t len = precision >= 0 ? strnlen(v, precision) : strlen(v);
+            const char nul = '\0';
+            ok = ok && w.put(v, len) && w.put(&nul, 1);
+            break;
+        }
+        case ARG_POINTER: {
+            void *v = va_arg(ap, void *);
+            ok = ok && w.put(&v, sizeof(v));
+            break;
+        }
+        }
+    }
+    va_end(ap);
+
+    slot->skip = !ok;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return ok;
+}
+
+bool LogRing::isEmpty() const
+{
+    const Slot &slot = slots[dequeuePos & (LOG_RING_SLOTS - 1)];
+    return slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1;
+}
+
+bool LogRing::pop(LogMessage &m)
+{
+    for (;;) {
+        Slot &slot = slots[dequeuePos & (LOG_RING_SLOTS - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+            return false;
+
+        bool skip = slot.skip;
+        if (!skip) {
+            m.level = slot.level;
+            m.flags = slot.flags;
+            m.millis = slot.millis;
+            m.rtcSec = slot.rtcSec;
+            memcpy(m.thread, slot.thread, sizeof(m.thread));
+
+            // Replay the format one conversion at a time, leaving room for the newline and the NUL
+            const char *format = (const char *)slot.data;
+            const uint8_t *args = slot.data + strlen(format) + 1;
+            const size_t room = sizeof(m.text) - 2;
+            size_t len = 0;
+            const char *p = format;
+            while (*p && len < room) {
+                const char *percent = strchr(p, '%');
+                size_t literal = percent ? (size_t)(percent - p) : strlen(p);
+                if (literal > room - len)
+                    literal = room - len;
+                memcpy(m.text + len, p, literal);
+                len += literal;
+                if (!percent || len >= room)
+                    break;
+
+                Conversion c;
+                parseConversion(percent, c); // push() already checked it
+                p = c.end;
+                if (c.kind == ARG_LITERAL) {
+                    m.text[len++] = '%';
+                    continue;
+                }
+                int stars[2] = {0, 0};
+                for (uint8_t i = 0; i < c.stars; i++)
+                    stars[i] = take<int>(args);
+
+                // The flags, width and precision as written, with the length changed to the type we stored
+                char spec[32];
+                size_t specLen = c.lengthStart < sizeof(spec) - 4 ? c.lengthStart : sizeof(spec) - 4;
+                memcpy(spec, percent, specLen);
+                if (c.kind == ARG_SIGNED || c.kind == ARG_UNSIGNED) {
+                    spec[specLen++] = 'l';
+                    spec[specLen++] = 'l';
+                }
+                spec[specLen++] = c.conv;
+                spec[specLen] = '\0';
+
+                char *out = m.text + len;
+                size_t n = room - len + 1; // snprintf's NUL may use the newline's place, it is overwritten below
+                int written = 0;
+                switch (c.kind) {
+                case ARG_SIGNED:
+                    written = formatOne(out, n, spec, stars, c.stars, take<long long>(args));
+                    break;
+                case ARG_UNSIGNED:
+                    written = formatOne(out, n, spec, stars, c.stars, take<unsigned long long>(args));
+                    break;
+                case ARG_CHAR:
+                    written = formatOne(out, n, spec, stars, c.stars, take<int>(args));
+                    break;
+                case ARG_DOUBLE:
+                    written = formatOne(out, n, spec, stars, c.stars, take<double>(args));
+                    break;
+                case ARG_STRING: {
+                    const char *s = (const char *)args;
+                    args += strlen(s) + 1;
+                    written = formatOne(out, n, spec, stars, c.stars, s);
+                    break;
+                }
+                case ARG_POINTER:
+                    written = formatOne(out, n, spec, stars, c.stars, take<void *>(args));
+                    break;
+                case ARG_LITERAL:
+                    break;
+                }
+                if (written > 0)
+                    len += (size_t)written < room - len ? (size_t)written : room - len;
+            }
+            m.text[len++] = '\n';
+            m.text[len] = '\0';
+            m.length = len;
+        }
+
+        slot.sequence.store(dequeuePos + LOG_RING_SLOTS, std::memory_order_release);
+        dequeuePos++;
+        if (!skip)
+            return true;
+    }
+}
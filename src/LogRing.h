@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef LOG_RING_SLOTS
+#define LOG_RING_SLOTS 64 // must be a power of two
+#endif
+#ifndef LOG_RING_SLOT_SIZE
+#define LOG_RING_SLOT_SIZE 384 // room for the format and the arguments of one message
+#endif
+
+/// The message goes to the log outputs (serial, syslog, BLE)
+#define LOG_FLAG_OUTPUT 0x01
+/// The message goes to the trace file
+#define LOG_FLAG_TRACE_FILE 0x02
+
+/// A message taken out of a LogRing and formatted, along with who logged it and when
+struct LogMessage {
+    const char *level; // one of the MESHTASTIC_LOG_LEVEL_* strings
+    uint8_t flags;     // LOG_FLAG_*
+    uint32_t millis;
+    uint32_t rtcSec;
+    char thread[16]; // name of the OSThread that logged it, empty if none
+    size_t length;   // of text, which ends with a newline
+    char text[512];
+};
+
+/**
+ * Log messages waiting to be formatted.  The caller only copies the format and its arguments into a slot; the expensive part
+ * (vsnprintf and the writes) happens later when the consumer pops it.
+ *
+ * Any thread or task can push without taking a lock (a bounded queue after Dmitry Vyukov's, each slot carrying a sequence
+ * number), one consumer at a time pops.
+ */
+class LogRing
+{
+  public:
+    LogRing();
+
+    /**
+     * Queue a message.  Returns false if it can't be deferred, because it has a conversion we don't capture or too much to
+     * copy; the caller should write it itself.  A message dropped because the ring is full counts as queued.
+     */
+    bool push(const char *level, uint8_t flags, const char *format, va_list arg);
+
+    /// Take the oldest message, formatting it into m.  Only call while holding the consumer lock.
+    bool pop(LogMessage &m);
+
+    bool isEmpty() const;
+
+    /// Messages lost because the ring was full, since the last call
+    uint32_t takeDropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+
+    bool tryLockConsumer() { return !consuming.test_and_set(std::memory_order_acquire); }
+    void unlockConsumer() { consuming.clear(std::memory_order_release); }
+
+  private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        const char *level;
+        uint8_t flags;
+        bool skip; // claimed but couldn't be filled in, the consumer passes over it
+        uint32_t millis;
+        uint32_t rtcSec;
+        char thread[16];
+        uint8_t data[LOG_RING_SLOT_SIZE]; // the format, NUL terminated, then each argument
+    };
+    static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+    Slot slots[LOG_RING_SLOTS];
+    std::atomic<uint32_t> enqueuePos{0};
+    uint32_t dequeuePos = 0;
+    std::atomic<uint32_t> dropped{0};
+    std::atomic_flag consuming = ATOMIC_FLAG_INIT;
+};
@@ -1,4 +1,5 @@
 #include "RedirectablePrint.h"
+#include "LogRing.h"
 #include "NodeDB.h"
 #include "RTC.h"
 #include "concurrency/OSThread.h"
@@ -6,6 +7,7 @@
 #include "main.h"
 #include "mesh/generated/meshtastic/mesh.pb.h"
 #include <assert.h>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <stdexcept>
@@ -19,11 +21,55 @@
 #if HAS_NETWORKING
 extern Syslog syslog;
 #endif
+
+#if DEBUG_LOG_ASYNC
+#ifndef LOG_WRITER_BATCH
+#define LOG_WRITER_BATCH 16 // messages written per run, so a burst of logging can't hold up the main loop
+#endif
+
+namespace
+{
+/// Writes out queued log messages, in between the threads doing real work
+class LogWriter : public concurrency::OSThread
+{
+    RedirectablePrint &out;
+
+  public:
+    explicit LogWriter(RedirectablePrint &out) : concurrency::OSThread("LogWriter"), out(out) {}
+
+  protected:
+    virtual int32_t runOnce() override { return out.flushDeferred(LOG_WRITER_BATCH) ? 0 : 50; }
+};
+
+RedirectablePrint *deferredLogger;
+} // namespace
+#endif
+
 void RedirectablePrint::rpInit()
 {
 #ifdef HAS_FREE_RTOS
     inDebugPrint = xSemaphoreCreateMutexStatic(&this->_MutexStorageSpace);
 #endif
+    updateLogLevels();
+}
+
+void RedirectablePrint::updateLogLevels()
+{
+    uint8_t levels = 0x3f;
+#if ARCH_PORTDUINO
+    // The same choices log() makes, so nothing it would write is skipped
+    const int outputLevel = getSetting<logoutputlevel>();
+    levels = (1 << LOG_SEVERITY_ERROR) | (1 << LOG_SEVERITY_CRIT);
+    if (outputLevel >= level_warn)
+        levels |= 1 << LOG_SEVERITY_WARN;
+    if (outputLevel >= level_info)
+        levels |= 1 << LOG_SEVERITY_INFO;
+    if (outputLevel >= level_debug)
+        levels |= 1 << LOG_SEVERITY_DEBUG;
+    if (outputLevel >= level_trace || !getSettingString<traceFilename>().empty())
+        levels |= 1 << LOG_SEVERITY_TRACE;
+#endif
+    enabledLevels = levels;
 }
 
 void RedirectablePrint::setDestination(Print *_dest)
@@ -57,7 +103,7 @@ size_t RedirectablePrint::vprintf(const char *logLevel, const char *format, va_l
 #endif
 
 #ifdef ARCH_PORTDUINO
-    bool color = !settingsMap[ascii_logs];
+    bool color = !getSetting<ascii_logs>();
 #else
     bool color = true;
 #endif
@@ -99,7 +145,7 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
     size_t r = 0;
 
 #ifdef ARCH_PORTDUINO
-    bool color = !settingsMap[ascii_logs];
+    bool color = !getSetting<ascii_logs>();
 #else
     bool color = true;
 #endif
@@ -118,7 +164,7 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
             Print::write("\u001b[35m", 5);
     }
 
-    uint32_t rtc_sec = getValidTime(RTCQuality::RTCQualityDevice, true); // display local time on logfile
+    uint32_t rtc_sec = logTime(); // display local time on logfile
     if (rtc_sec > 0) {
         long hms = rtc_sec % SEC_PER_DAY;
         // hms += tz.tz_dsttime * SEC_PER_HOUR;
@@ -135,13 +181,13 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
         if (color) {
             ::printf("\u001b[0m");
         }
-        ::printf("| %02d:%02d:%02d %u ", hour, min, sec, millis() / 1000);
+        ::printf("| %02d:%02d:%02d %u ", hour, min, sec, logMillis() / 1000);
 #else
         printf("%s ", logLevel);
         if (color) {
             printf("\u001b[0m");
         }
-        printf("| %02d:%02d:%02d %u ", hour, min, sec, millis() / 1000);
+        printf("| %02d:%02d:%02d %u ", hour, min, sec, logMillis() / 1000);
 #endif
     } else {
 #ifdef ARCH_PORTDUINO
@@ -149,21 +195,19 @@ void RedirectablePrint::log_to_serial(const char *logLevel, const char *format,
         if (color) {
             ::printf("\u001b[0m");
         }
-        ::printf("| ??:??:?? %u ", millis() / 1000);
+        ::printf("| ??:??:?? %u ", logMillis() / 1000);
 #else
         printf("%s ", logLevel);
         if (color) {
             printf("\u001b[0m");
         }
-        printf("| ??:??:?? %u ", millis() / 1000);
+        printf("| ??:??:?? %u ", logMillis() / 1000);
 #endif
     }
-    auto thread = concurrency::OSThread::currentThread;
-    if (thread) {
+    const char *threadName = logThreadName();
+    if (threadName) {
         print("[");
-        // printf("%p ", thread);
-        // assert(thread->ThreadName.length());
-        print(thread->ThreadName);
+        print(threadName);
         print("] ");
     }
     r += vprintf(logLevel, format, arg);
@@ -194,9 +238,9 @@ void RedirectablePrint::log_to_syslog(const char *logLevel, const char *format,
         default:
             ll = 0;
         }
-        auto thread = concurrency::OSThread::currentThread;
-        if (thread) {
-            syslog.vlogf(ll, thread->ThreadName.c_str(), format, arg);
+        const char *threadName = logThreadName();
+        if (threadName) {
+            syslog.vlogf(ll, threadName, format, arg);
         } else {
             syslog.vlogf(ll, format, arg);
         }
@@ -226,13 +270,13 @@ void RedirectablePrint::log_to_ble(const char *logLevel, const char *format, va_
                 message = new char[len + 1];
                 vsnprintf(message, len + 1, format, arg);
             }
-            auto thread = concurrency::OSThread::currentThread;
+            const char *threadName = logThreadName();
             meshtastic_LogRecord logRecord = meshtastic_LogRecord_init_zero;
             logRecord.level = getLogLevel(logLevel);
             strcpy(logRecord.message, message);
-            if (thread)
-                strcpy(logRecord.source, thread->ThreadName.c_str());
-            logRecord.time = getValidTime(RTCQuality::RTCQualityDevice, true);
+            if (threadName)
+                strcpy(logRecord.source, threadName);
+            logRecord.time = logTime();
 
             uint8_t *buffer = new uint8_t[meshtastic_LogRecord_size];
             size_t size = pb_encode_to_bytes(buffer, meshtastic_LogRecord_size, meshtastic_LogRecord_fields, &logRecord);
@@ -275,75 +319,168 @@ meshtastic_LogRecord_Level RedirectablePrint::getLogLevel(const char *logLevel)
     return ll;
 }
 
-void RedirectablePrint::log(const char *logLevel, const char *format, ...)
+const char *RedirectablePrint::logThreadName() const
 {
+    if (deferred)
+        return deferred->thread[0] ? deferred->thread : nullptr;
+    auto thread = concurrency::OSThread::currentThread;
+    return thread ? thread->ThreadName.c_str() : nullptr;
+}
 
-    // append \n to format
-    size_t len = strlen(format);
-    char *newFormat = new char[len + 2];
-    strcpy(newFormat, format);
-    newFormat[len] = '\n';
-    newFormat[len + 1] = '\0';
+uint32_t RedirectablePrint::logTime() const
+{
+    return deferred ? deferred->rtcSec : getValidTime(RTCQuality::RTCQualityDevice, true);
+}
+
+uint32_t RedirectablePrint::logMillis() const
+{
+    return deferred ? deferred->millis : millis();
+}
 
+void RedirectablePrint::log(const char *logLevel, const char *format, ...)
+{
+    bool toOutputs = true;
+    bool toTraceFile = false;
 #if ARCH_PORTDUINO
     // level trace is special, two possible ways to handle it.
     if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
-        if (settingsStrings[traceFilename] != "") {
-            va_list arg;
-            va_start(arg, format);
-            try {
-                traceFile << va_arg(arg, char *) << std::endl;
-            } catch (const std::ios_base::failure &e) {
-            }
-            va_end(arg);
-        }
-        if (settingsMap[logoutputlevel] < level_trace && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_TRACE) == 0) {
-            delete[] newFormat;
+        toTraceFile = !getSettingString<traceFilename>().empty();
+        toOutputs = getSetting<logoutputlevel>() >= level_trace;
+        if (!toTraceFile && !toOutputs)
             return;
-        }
-    }
-    if (settingsMap[logoutputlevel] < level_debug && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
-        delete[] newFormat;
+    } else if (getSetting<logoutputlevel>() < level_debug && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
         return;
-    } else if (settingsMap[logoutputlevel] < level_info && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0) {
-        delete[] newFormat;
+    } else if (getSetting<logoutputlevel>() < level_info && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_INFO) == 0) {
         return;
-    } else if (settingsMap[logoutputlevel] < level_warn && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0) {
-        delete[] newFormat;
+    } else if (getSetting<logoutputlevel>() < level_warn && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_WARN) == 0) {
         return;
     }
 #endif
     if (moduleConfig.serial.override_console_serial_port && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_DEBUG) == 0) {
-        delete[] newFormat;
         return;
     }
 
+#if DEBUG_LOG_ASYNC
+    if (ring) {
+        // Errors are written at once, in case they are the last thing we get to say
+        if (strcmp(logLevel, MESHTASTIC_LOG_LEVEL_ERROR) != 0 && strcmp(logLevel, MESHTASTIC_LOG_LEVEL_CRIT) != 0) {
+            va_list arg;
+            va_start(arg, format);
+            bool queued =
+                ring->push(logLevel, (toOutputs ? LOG_FLAG_OUTPUT : 0) | (toTraceFile ? LOG_FLAG_TRACE_FILE : 0), format, arg);
+            va_end(arg);
+            if (queued)
+                return;
+        }
+        // What we write now must come after what is already queued
+        flushDeferred();
+    }
+#endif
+
+#if ARCH_PORTDUINO
+    if (toTraceFile) {
+        va_list arg;
+        va_start(arg, format);
+        try {
+            traceFile << va_arg(arg, char *) << std::endl;
+        } catch (const std::ios_base::failure &e) {
+        }
+        va_end(arg);
+    }
+#endif
+    if (!toOutputs)
+        return;
+
+    // append \n to format
+    size_t len = strlen(format);
+    char *newFormat = new char[len + 2];
+    strcpy(newFormat, format);
+    newFormat[len] = '\n';
+    newFormat[len + 1] = '\0';
+
+    va_list arg;
+    va_start(arg, format);
+    vlogToOutputs(nullptr, logLevel, newFormat, arg);
+    va_end(arg);
+
+    delete[] newFormat;
+}
+
+void RedirectablePrint::logToOutputs(const LogMessage *from, const char *logLevel, const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    vlogToOutputs(from, logLevel, format, arg);
+    va_end(arg);
+}
+
+void RedirectablePrint::vlogToOutputs(const LogMessage *from, const char *logLevel, const char *format, va_list arg)
+{
 #ifdef HAS_FREE_RTOS
     if (inDebugPrint != nullptr && xSemaphoreTake(inDebugPrint, portMAX_DELAY) == pdTRUE) {
 #else
     if (!inDebugPrint) {
         inDebugPrint = true;
 #endif
+        deferred = from;
 
-        va_list arg;
-        va_start(arg, format);
-
-        log_to_serial(logLevel, newFormat, arg);
-        log_to_syslog(logLevel, newFormat, arg);
-        log_to_ble(logLevel, newFormat, arg);
+        log_to_serial(logLevel, format, arg);
+        log_to_syslog(logLevel, format, arg);
+        log_to_ble(logLevel, format, arg);
 
-        va_end(arg);
+        deferred = nullptr;
 #ifdef HAS_FREE_RTOS
         xSemaphoreGive(inDebugPrint);
 #else
         inDebugPrint = false;
 #endif
     }
+}
 
-    delete[] newFormat;
-    return;
+#if DEBUG_LOG_ASYNC
+void RedirectablePrint::startDeferredLogging()
+{
+    if (ring)
+        return;
+    ring = new LogRing();
+    new LogWriter(*this);
+
+    // Don't lose what is still queued when meshtasticd exits
+    deferredLogger = this;
+    atexit([] { deferredLogger->flushDeferred(); });
 }
 
+bool RedirectablePrint::flushDeferred(uint32_t max)
+{
+    if (!ring)
+        return false;
+    if (!ring->tryLockConsumer())
+        return true; // someone else is writing them out
+
+    static LogMessage m; // only used by the holder of the consumer lock
+    for (uint32_t n = 0; n < max && ring->pop(m); n++) {
+#if ARCH_PORTDUINO
+        if (m.flags & LOG_FLAG_TRACE_FILE) {
+            try {
+                traceFile.write(m.text, m.length - 1) << std::endl;
+            } catch (const std::ios_base::failure &e) {
+            }
+        }
+#endif
+        if (m.flags & LOG_FLAG_OUTPUT)
+            logToOutputs(&m, m.level, "%s", m.text);
+    }
+
+    bool more = !ring->isEmpty();
+    uint32_t dropped = more ? 0 : ring->takeDropped();
+    ring->unlockConsumer();
+
+    if (dropped)
+        logToOutputs(nullptr, MESHTASTIC_LOG_LEVEL_WARN, "%u log messages dropped, the queue was full\n", dropped);
+    return more;
+}
+#endif
+
 void RedirectablePrint::hexDump(const char *logLevel, unsigned char *buf, uint16_t len)
 {
     const char alphabet[17] = "0123456789abcdef";
@@ -6,6 +6,19 @@
 #include <stdarg.h>
 #include <string>
 
+// Queue log messages for a low priority thread to format and write, rather than doing it in the caller.  On by default for
+// meshtasticd; other targets can opt in with -DDEBUG_LOG_ASYNC=1 (LOG_RING_SLOTS and LOG_RING_SLOT_SIZE set the memory used).
+#ifndef DEBUG_LOG_ASYNC
+#ifdef ARCH_PORTDUINO
+#define DEBUG_LOG_ASYNC 1
+#else
+#define DEBUG_LOG_ASYNC 0
+#endif
+#endif
+
+class LogRing;
+struct LogMessage;
+
 /**
  * A Printable that can be switched to squirt its bytes to a different sink.
  * This class is mostly useful to allow debug printing to be redirected away from Serial
@@ -48,12 +61,47 @@ class RedirectablePrint : public Print
 
     std::string mt_sprintf(const std::string fmt_str, ...);
 
+    /// Whether a message of this severity (LOG_SEVERITY_*) might be written, cheap enough to ask before building it.  log()
+    /// still has the final say.
+    bool wants(uint8_t severity) const { return enabledLevels & (1 << severity); }
+
+    /// Work out again which severities wants() lets through, after the log level settings change
+    void updateLogLevels();
+
+#if DEBUG_LOG_ASYNC
+    /// From now on queue messages, and start the thread that writes them
+    void startDeferredLogging();
+
+    /// Write up to max queued messages.  Returns true if more are waiting.
+    bool flushDeferred(uint32_t max = UINT32_MAX);
+#endif
+
   protected:
     /// Subclasses can override if they need to change how we format over the serial port
     virtual void log_to_serial(const char *logLevel, const char *format, va_list arg);
     meshtastic_LogRecord_Level getLogLevel(const char *logLevel);
 
+    /// Name of the thread that logged the message being written, or NULL
+    const char *logThreadName() const;
+
   private:
     void log_to_syslog(const char *logLevel, const char *format, va_list arg);
     void log_to_ble(const char *logLevel, const char *format, va_list arg);
+
+    /// Write a message to serial, syslog and BLE.  from is the queued message it came from, NULL if logged just now.
+    void logToOutputs(const LogMessage *from, const char *logLevel, const char *format, ...);
+    void vlogToOutputs(const LogMessage *from, const char *logLevel, const char *format, va_list arg);
+
+    /// When (RTC seconds, and millis()) the message being written was logged
+    uint32_t logTime() const;
+    uint32_t logMillis() const;
+
+    /// Bit per LOG_SEVERITY_*, everything until updateLogLevels() says otherwise
+    volatile uint8_t enabledLevels = 0x3f;
+
+    /// The queued message being written, while flushDeferred() writes it
+    const LogMessage *deferred = nullptr;
+#if DEBUG_LOG_ASYNC
+    LogRing *ring = nullptr;
+#endif
 };
\ No newline at end of file
@@ -108,8 +108,8 @@ void SerialConsole::log_to_serial(const char *logLevel, const char *format, va_l
 {
     if (usingProtobufs && config.security.debug_log_api_enabled) {
         meshtastic_LogRecord_Level ll = RedirectablePrint::getLogLevel(logLevel);
-        auto thread = concurrency::OSThread::currentThread;
-        emitLogRecord(ll, thread ? thread->ThreadName.c_str() : "", format, arg);
+        const char *threadName = logThreadName();
+        emitLogRecord(ll, threadName ? threadName : "", format, arg);
     } else
         RedirectablePrint::log_to_serial(logLevel, format, arg);
 }
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "StatsLogThread.h"
+#include "concurrency/ThreadProfiler.h"
+#include "configuration.h"
+#include "mesh/Channels.h"
+#ifdef ARCH_PORTDUINO
+#include "mesh/api/PortduinoServerAPI.h"
+#endif
+#if !MESHTASTIC_EXCLUDE_MQTT
+#include "mqtt/MQTT.h"
+#endif
+
+namespace concurrency
+{
+
+int32_t StatsLogThread::runOnce()
+{
+    // Don't bother sorting the profile if nobody will see it
+    if (!LOG_ENABLED(LOG_SEVERITY_INFO))
+        return STATS_LOG_INTERVAL_MSEC;
+
+    threadProfiler.log();
+    channels.logStats();
+#ifdef ARCH_PORTDUINO
+    if (portduinoApiPort)
+        portduinoApiPort->logStats();
+#endif
+#if !MESHTASTIC_EXCLUDE_MQTT
+    if (mqtt)
+        mqtt->logStats();
+#endif
+    return STATS_LOG_INTERVAL_MSEC;
+}
+
+} // namespace concurrency
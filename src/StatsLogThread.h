@@ -0,0 +1,24 @@
+#pragma once
+
+#include "concurrency/OSThread.h"
+
+#ifndef STATS_LOG_INTERVAL_MSEC
+#define STATS_LOG_INTERVAL_MSEC (15 * 60 * 1000) // 0 to never log them
+#endif
+
+namespace concurrency
+{
+/**
+ * Logs the thread profile, per-channel decode counts, the API server's clients and the MQTT queue every
+ * STATS_LOG_INTERVAL_MSEC, at info level.
+ */
+class StatsLogThread : public OSThread
+{
+  public:
+    StatsLogThread() : OSThread("StatsLog", STATS_LOG_INTERVAL_MSEC) {}
+
+  protected:
+    int32_t runOnce() override;
+};
+
+} // namespace concurrency
@@ -32,17 +32,24 @@ OSThread::OSThread(const char *_name, uint32_t period, ThreadController *_contro
     assertIsSetup();
 
     ThreadName = _name;
+    profileSlot = threadProfiler.allocate(this);
+    intervalSetMsec = millis();
 
     if (controller) {
         bool added = controller->add(this);
         assert(added);
     }
+    if (controller == &mainController)
+        mainScheduler.add(this);
 }
 
 OSThread::~OSThread()
 {
+    if (controller == &mainController)
+        mainScheduler.remove(this);
     if (controller)
         controller->remove(this);
+    threadProfiler.release(profileSlot);
 }
 
 /**
@@ -55,6 +62,16 @@ void OSThread::setIntervalFromNow(unsigned long _interval)
 
     // Cache the next run based on the last_run
     _cached_next_run = millis() + interval;
+
+    intervalSetMsec = millis();
+    mainScheduler.deadlineChanged(this);
+}
+
+IRAM_ATTR void OSThread::setInterval(unsigned long _interval)
+{
+    Thread::setInterval(_interval);
+    intervalSetMsec = millis();
+    mainScheduler.deadlineChanged(this);
 }
 
 bool OSThread::shouldRun(unsigned long time)
@@ -82,7 +99,17 @@ void OSThread::run()
     auto heap = memGet.getFreeHeap();
 #endif
     currentThread = this;
+
+    // We were due at our cached next run time, or when someone changed our interval if that was later (a wakeup)
+    uint32_t now = millis();
+    uint32_t due = _cached_next_run;
+    if ((int32_t)(intervalSetMsec - due) > 0)
+        due = intervalSetMsec;
+    int32_t late = (int32_t)(now - due);
+
+    uint32_t start = micros();
     auto newDelay = runOnce();
+    threadProfiler.record(profileSlot, micros() - start, late > 0 ? late : 0);
 #ifdef DEBUG_HEAP
     auto newHeap = memGet.getFreeHeap();
     if (newHeap < heap)
@@ -93,8 +120,11 @@ void OSThread::run()
 
     runned();
 
-    if (newDelay >= 0)
-        setInterval(newDelay);
+    // The scheduler re-keys us after we run anyway, no need to flag the change
+    if (newDelay >= 0) {
+        Thread::setInterval(newDelay);
+        intervalSetMsec = now;
+    }
 
     currentThread = NULL;
 }
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <stdint.h>
 
 #include "Thread.h"
 #include "ThreadController.h"
 #include "concurrency/InterruptableDelay.h"
+#include "concurrency/Scheduler.h"
+#include "concurrency/ThreadProfiler.h"
 
 namespace concurrency
 {
@@ -41,6 +44,28 @@ class OSThread : public Thread
     /// Show debugging info for threads we decide not to run;
     static bool showWaiting;
 
+    friend class Scheduler;
+
+    /// Our position in mainScheduler's heap (-1 if not in it) and the 64 bit deadline we are keyed by there
+    int32_t heapIndex = -1;
+    uint64_t deadline = 0;
+
+    /// Set while we are on mainScheduler's pending list, waiting to be re-keyed after our next run time changed
+    std::atomic<bool> needsReschedule{false};
+    OSThread *pendingNext = nullptr;
+
+    /// Set while mainScheduler is scheduling us (between add() and remove())
+    bool scheduled = false;
+
+    /// Our slot in threadProfiler (-1 if not profiled)
+    int8_t profileSlot = -1;
+
+    /// When our interval was last changed, so a wakeup of an idle thread doesn't count as it running late
+    volatile uint32_t intervalSetMsec = 0;
+
+    uint32_t nextRunMsec() const { return _cached_next_run; }
+    uint32_t intervalMsec() const { return interval; }
+
   public:
     /// For debug printing only (might be null)
     static const OSThread *currentThread;
@@ -60,6 +85,12 @@ class OSThread : public Thread
      */
     void setIntervalFromNow(unsigned long _interval);
 
+    /**
+     * Wait a specified number msecs starting from the last time we were run.  Hides Thread::setInterval() so the scheduler
+     * hears about the change; safe to call from an ISR.
+     */
+    void setInterval(unsigned long _interval);
+
   protected:
     /**
      * The method that will be called each time our thread gets a chance to run
@@ -0,0 +1,201 @@
+#include "Scheduler.h"
+#include "OSThread.h"
+#include "configuration.h"
+#include <algorithm>
+
+namespace concurrency
+{
+
+Scheduler mainScheduler;
+
+void Scheduler::updateClock()
+{
+    uint32_t ms = millis();
+    now += (uint32_t)(ms - lastMillis);
+    lastMillis = ms;
+}
+
+bool Scheduler::sortsBefore(const OSThread *a, const OSThread *b) const
+{
+    return a->deadline < b->deadline;
+}
+
+void Scheduler::place(size_t i, OSThread *t)
+{
+    heap[i] = t;
+    t->heapIndex = i;
+}
+
+void Scheduler::siftUp(size_t i)
+{
+    OSThread *t = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!sortsBefore(t, heap[parent]))
+            break;
+        place(i, heap[parent]);
+        i = parent;
+    }
+    place(i, t);
+}
+
+void Scheduler::siftDown(size_t i)
+{
+    OSThread *t = heap[i];
+    size_t n = heap.size();
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && sortsBefore(heap[child + 1], heap[child]))
+            child++;
+        if (!sortsBefore(heap[child], t))
+            break;
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, t);
+}
+
+/// (Re)insert a thread into the heap, keyed by its current next run time
+void Scheduler::schedule(OSThread *t)
+{
+    // The next run time is a 32 bit millis() value, turn it into an offset from now.  now starts at 2^32, so deadlines that
+    // are already in the past can never wrap below zero.
+    uint32_t ahead = (uint32_t)t->nextRunMsec() - lastMillis;
+    if (t->intervalMsec() >= (uint32_t)INT32_MAX / 2)
+        t->deadline = now + ahead; // "Never" (INT32_MAX) counted from a moment after lastMillis overflows int32_t, it isn't past
+    else
+        t->deadline = now + (int32_t)ahead;
+
+    if (t->heapIndex < 0) {
+        heap.push_back(t);
+        siftUp(heap.size() - 1);
+    } else {
+        siftUp(t->heapIndex);
+        siftDown(t->heapIndex);
+    }
+}
+
+void Scheduler::unschedule(OSThread *t)
+{
+    size_t i = t->heapIndex;
+    OSThread *last = heap.back();
+    heap.pop_back();
+    t->heapIndex = -1;
+    if (i < heap.size()) {
+        place(i, last);
+        siftUp(i);
+        siftDown(last->heapIndex);
+    }
+}
+
+void Scheduler::add(OSThread *t)
+{
+    updateClock();
+    t->scheduled = true;
+    schedule(t);
+}
+
+void Scheduler::remove(OSThread *t)
+{
+    t->scheduled = false;
+    if (t->needsReschedule)
+        takePending(t); // It can't stay linked in the list once it is gone
+    if (t->heapIndex >= 0)
+        unschedule(t);
+    parked.erase(std::remove(parked.begin(), parked.end(), t), parked.end());
+    // If it was about to run in this iteration (or is running right now), make sure we don't touch it again
+    std::replace(due.begin(), due.end(), t, (OSThread *)nullptr);
+}
+
+IRAM_ATTR void Scheduler::deadlineChanged(OSThread *t)
+{
+    if (!t->scheduled || t->needsReschedule.exchange(true))
+        return; // Not one of ours (timerController), or already on the list
+
+    OSThread *head = pending.load(std::memory_order_relaxed);
+    do {
+        t->pendingNext = head;
+    } while (!pending.compare_exchange_weak(head, t, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void Scheduler::takePending(OSThread *skip)
+{
+    // Take the whole list at once, producers only ever push so this can't race with them
+    OSThread *t = pending.exchange(nullptr, std::memory_order_acquire);
+    while (t) {
+        OSThread *next = t->pendingNext;
+        t->needsReschedule = false; // Cleared before reading the deadline, so a concurrent change queues it again
+        if (t != skip) {
+            if (t->heapIndex >= 0) {
+                schedule(t);
+            } else {
+                auto parkedAt = std::find(parked.begin(), parked.end(), t);
+                if (parkedAt != parked.end()) {
+                    parked.erase(parkedAt);
+                    schedule(t);
+                }
+                // Otherwise it is running (or about to) this iteration, and is re-keyed after that anyway
+            }
+        }
+        t = next;
+    }
+}
+
+long Scheduler::runOrDelay()
+{
+    updateClock();
+
+    // Re-key only the threads that were rescheduled by someone else since the last iteration
+    if (pending.load(std::memory_order_relaxed))
+        takePending();
+
+    // Disabled threads which are overdue run as soon as someone enables them, like they would with ThreadController
+    for (size_t i = 0; i < parked.size();) {
+        OSThread *t = parked[i];
+        if (t->enabled) {
+            parked.erase(parked.begin() + i);
+            schedule(t);
+        } else {
+            i++;
+        }
+    }
+
+    // Take everything that is due off the heap first, so a thread that asks to run again immediately waits for the next call
+    while (!heap.empty() && heap[0]->deadline <= now) {
+        OSThread *t = heap[0];
+        unschedule(t);
+        due.push_back(t);
+    }
+
+    for (size_t i = 0; i < due.size(); i++) {
+        OSThread *t = due[i];
+        if (!t)
+            continue; // Deleted by a thread that ran before it
+
+        if (t->shouldRun(lastMillis)) {
+            t->run();
+            if (!due[i])
+                continue; // Deleted itself
+            schedule(t);
+        } else if (t->enabled) {
+            schedule(t); // Its deadline moved since we took it off the heap
+        } else {
+            parked.push_back(t);
+        }
+    }
+    due.clear();
+
+    if (pending.load(std::memory_order_relaxed))
+        return 0; // Somebody was woken while we were running threads, come straight back
+
+    updateClock();
+    if (heap.empty())
+        return INT32_MAX;
+    if (heap[0]->deadline <= now)
+        return 0;
+    return (long)std::min<uint64_t>(heap[0]->deadline - now, INT32_MAX);
+}
+
+} // namespace concurrency
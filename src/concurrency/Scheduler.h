@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace concurrency
+{
+
+class OSThread;
+
+/**
+ * @brief Runs OSThreads in deadline order
+ *
+ * ThreadController::runOrDelay() asks every thread whether it wants to run and recomputes the shortest delay on each call,
+ * which is O(threads) per wakeup.  This keeps the threads in a min-heap keyed by their next run time instead, so a wakeup only
+ * touches the threads that are actually due and the delay until the next deadline is simply the top of the heap.
+ *
+ * A thread's deadline can be changed from another task or an ISR (TypedQueue / NotifiedWorkerThread wakeups), so those
+ * paths only push the thread onto a lock-free pending list, and the main loop re-keys just the threads on it.  Threads whose
+ * deadline passed while they were disabled are polled each loop, because `enabled` is a plain field that modules flip
+ * directly.
+ */
+class Scheduler
+{
+    /// Min-heap of threads ordered by OSThread::deadline
+    std::vector<OSThread *> heap;
+
+    /// Threads that came due while disabled, they rejoin the heap once enabled or rescheduled
+    std::vector<OSThread *> parked;
+
+    /// Threads taken off the heap to run this iteration
+    std::vector<OSThread *> due;
+
+    /// A 64 bit version of millis(), so deadlines order correctly across the 49 day rollover
+    uint64_t now = (uint64_t)1 << 32;
+    uint32_t lastMillis = 0;
+
+    /// Threads whose deadline changed outside of the scheduler (possibly from an ISR), linked through OSThread::pendingNext
+    std::atomic<OSThread *> pending{nullptr};
+
+    void updateClock();
+
+    /// Re-key every thread on the pending list, except skip
+    void takePending(OSThread *skip = nullptr);
+    void schedule(OSThread *t);
+    void unschedule(OSThread *t);
+
+    bool sortsBefore(const OSThread *a, const OSThread *b) const;
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+    void place(size_t i, OSThread *t);
+
+  public:
+    /// Start scheduling this thread
+    void add(OSThread *t);
+
+    /// Stop scheduling this thread, safe to call from inside its (or another thread's) runOnce()
+    void remove(OSThread *t);
+
+    /// Note that this thread's deadline changed, may be called from an ISR
+    void deadlineChanged(OSThread *t);
+
+    /**
+     * Run every thread that is due
+     *
+     * @return msecs until the next thread is due
+     */
+    long runOrDelay();
+
+    size_t size() const { return heap.size() + parked.size(); }
+};
+
+extern Scheduler mainScheduler;
+
+} // namespace concurrency
@@ -0,0 +1,47 @@
+#include "ThreadProfiler.h"
+#include "OSThread.h"
+#include "configuration.h"
+#include <algorithm>
+
+namespace concurrency
+{
+
+ThreadProfiler threadProfiler;
+
+int8_t ThreadProfiler::allocate(const OSThread *t)
+{
+    for (size_t i = 0; i < MAX_PROFILED_THREADS; i++) {
+        if (!profiles[i].thread) {
+            profiles[i] = {};
+            profiles[i].thread = t;
+            return i;
+        }
+    }
+    LOG_WARN("Thread profiler full, %s will not be profiled", t->ThreadName.c_str());
+    return -1;
+}
+
+void ThreadProfiler::release(int8_t slot)
+{
+    if (slot >= 0)
+        profiles[slot].thread = nullptr;
+}
+
+void ThreadProfiler::log() const
+{
+    uint8_t order[MAX_PROFILED_THREADS];
+    size_t n = 0;
+    for (size_t i = 0; i < MAX_PROFILED_THREADS; i++)
+        if (profiles[i].thread)
+            order[n++] = i;
+    std::sort(order, order + n, [this](uint8_t a, uint8_t b) { return profiles[a].totalUsec > profiles[b].totalUsec; });
+
+    LOG_INFO("Thread profile (%u threads): runs, cpu ms, max run us, avg/max late ms", (unsigned)n);
+    for (size_t i = 0; i < n; i++) {
+        const ThreadProfile &p = profiles[order[i]];
+        LOG_INFO("  %s: %u, %u, %u, %u/%u", p.thread->ThreadName.c_str(), p.runs, (uint32_t)(p.totalUsec / 1000), p.maxUsec,
+                 p.runs ? (uint32_t)(p.totalLateMsec / p.runs) : 0, p.maxLateMsec);
+    }
+}
+
+} // namespace concurrency
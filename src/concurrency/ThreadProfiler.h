@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace concurrency
+{
+
+class OSThread;
+
+#ifndef MAX_PROFILED_THREADS
+#define MAX_PROFILED_THREADS 40
+#endif
+
+/// What we know about how one OSThread has been using the CPU since boot
+struct ThreadProfile {
+    const OSThread *thread; // nullptr if this slot is free
+    uint32_t runs;          // number of runOnce() calls
+    uint32_t maxUsec;       // longest runOnce()
+    uint64_t totalUsec;     // time spent in runOnce()
+    uint32_t maxLateMsec;   // longest wait between being due and actually running
+    uint64_t totalLateMsec;
+};
+
+/**
+ * @brief Per OSThread run time and scheduling latency statistics
+ *
+ * Always compiled in: recording is a couple of additions per runOnce(), into a fixed table slot each thread claims when it is
+ * constructed.  Meant for finding the thread that hogs the main loop and makes others (e.g. the Router) run late.
+ */
+class ThreadProfiler
+{
+    ThreadProfile profiles[MAX_PROFILED_THREADS] = {};
+
+  public:
+    /// Claim a slot for this thread, or -1 if the table is full (the thread is then just not profiled)
+    int8_t allocate(const OSThread *t);
+
+    void release(int8_t slot);
+
+    void record(int8_t slot, uint32_t usec, uint32_t lateMsec)
+    {
+        if (slot < 0)
+            return;
+        ThreadProfile &p = profiles[slot];
+        p.runs++;
+        p.totalUsec += usec;
+        if (usec > p.maxUsec)
+            p.maxUsec = usec;
+        p.totalLateMsec += lateMsec;
+        if (lateMsec > p.maxLateMsec)
+            p.maxLateMsec = lateMsec;
+    }
+
+    /// Slots are only meaningful if their thread is non null
+    const ThreadProfile &get(size_t slot) const { return profiles[slot]; }
+    size_t size() const { return MAX_PROFILED_THREADS; }
+
+    /// Print a line per thread to the log, busiest first
+    void log() const;
+};
+
+extern ThreadProfiler threadProfiler;
+
+} // namespace concurrency
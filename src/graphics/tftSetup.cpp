@@ -41,78 +41,80 @@ void tftSetup(void)
     PacketAPI::create(PacketServer::init());
     deviceScreen->init(new PacketClient);
 #else
-    if (settingsMap[displayPanel] != no_screen) {
+    if (getSetting<displayPanel>() != no_screen) {
         DisplayDriverConfig displayConfig;
         static char *panels[] = {"NOSCREEN", "X11",     "FB",      "ST7789",  "ST7735",  "ST7735S",
                                  "ST7796",   "ILI9341", "ILI9342", "ILI9486", "ILI9488", "HX8357D"};
         static char *touch[] = {"NOTOUCH", "XPT2046", "STMPE610", "GT911", "FT5x06"};
 #if defined(USE_X11)
-        if (settingsMap[displayPanel] == x11) {
-            if (settingsMap[displayWidth] && settingsMap[displayHeight])
-                displayConfig = DisplayDriverConfig(DisplayDriverConfig::device_t::X11, (uint16_t)settingsMap[displayWidth],
-                                                    (uint16_t)settingsMap[displayHeight]);
+        if (getSetting<displayPanel>() == x11) {
+            if (getSetting<displayWidth>() && getSetting<displayHeight>())
+                displayConfig = DisplayDriverConfig(DisplayDriverConfig::device_t::X11, (uint16_t)getSetting<displayWidth>(),
+                                                    (uint16_t)getSetting<displayHeight>());
             else
                 displayConfig.device(DisplayDriverConfig::device_t::X11);
         } else
 #elif defined(USE_FRAMEBUFFER)
-        if (settingsMap[displayPanel] == fb) {
-            if (settingsMap[displayWidth] && settingsMap[displayHeight])
-                displayConfig = DisplayDriverConfig(DisplayDriverConfig::device_t::FB, (uint16_t)settingsMap[displayWidth],
-                                                    (uint16_t)settingsMap[displayHeight]);
+        if (getSetting<displayPanel>() == fb) {
+            if (getSetting<displayWidth>() && getSetting<displayHeight>())
+                displayConfig = DisplayDriverConfig(DisplayDriverConfig::device_t::FB, (uint16_t)getSetting<displayWidth>(),
+                                                    (uint16_t)getSetting<displayHeight>());
             else
                 displayConfig.device(DisplayDriverConfig::device_t::FB);
         } else
 #endif
         {
             displayConfig.device(DisplayDriverConfig::device_t::CUSTOM_TFT)
-                .panel(DisplayDriverConfig::panel_config_t{.type = panels[settingsMap[displayPanel]],
-                                                           .panel_width = (uint16_t)settingsMap[displayWidth],
-                                                           .panel_height = (uint16_t)settingsMap[displayHeight],
-                                                           .rotation = (bool)settingsMap[displayRotate],
-                                                           .pin_cs = (int16_t)settingsMap[displayCS],
-                                                           .pin_rst = (int16_t)settingsMap[displayReset],
-                                                           .offset_x = (uint16_t)settingsMap[displayOffsetX],
-                                                           .offset_y = (uint16_t)settingsMap[displayOffsetY],
-                                                           .offset_rotation = (uint8_t)settingsMap[displayOffsetRotate],
-                                                           .invert = settingsMap[displayInvert] ? true : false,
-                                                           .rgb_order = (bool)settingsMap[displayRGBOrder],
-                                                           .dlen_16bit = settingsMap[displayPanel] == ili9486 ||
-                                                                         settingsMap[displayPanel] == ili9488})
-                .bus(DisplayDriverConfig::bus_config_t{.freq_write = (uint32_t)settingsMap[displayBusFrequency],
+                .panel(DisplayDriverConfig::panel_config_t{.type = panels[getSetting<displayPanel>()],
+                                                           .panel_width = (uint16_t)getSetting<displayWidth>(),
+                                                           .panel_height = (uint16_t)getSetting<displayHeight>(),
+                                                           .rotation = (bool)getSetting<displayRotate>(),
+                                                           .pin_cs = (int16_t)getSetting<displayCS>(),
+                                                           .pin_rst = (int16_t)getSetting<displayReset>(),
+                                                           .offset_x = (uint16_t)getSetting<displayOffsetX>(),
+                                                           .offset_y = (uint16_t)getSetting<displayOffsetY>(),
+                                                           .offset_rotation = (uint8_t)getSetting<displayOffsetRotate>(),
+                                                           .invert = getSetting<displayInvert>() ? true : false,
+                                                           .rgb_order = (bool)getSetting<displayRGBOrder>(),
+                                                           .dlen_16bit = getSetting<displayPanel>() == ili9486 ||
+                                                                         getSetting<displayPanel>() == ili9488})
+                .bus(DisplayDriverConfig::bus_config_t{.freq_write = (uint32_t)getSetting<displayBusFrequency>(),
                                                        .freq_read = 16000000,
-                                                       .spi{.pin_dc = (int8_t)settingsMap[displayDC],
+                                                       .spi{.pin_dc = (int8_t)getSetting<displayDC>(),
                                                             .use_lock = true,
-                                                            .spi_host = (uint16_t)settingsMap[displayspidev]}})
-                .input(DisplayDriverConfig::input_config_t{.keyboardDevice = settingsStrings[keyboardDevice],
-                                                           .pointerDevice = settingsStrings[pointerDevice]})
-                .light(DisplayDriverConfig::light_config_t{.pin_bl = (int16_t)settingsMap[displayBacklight],
-                                                           .pwm_channel = (int8_t)settingsMap[displayBacklightPWMChannel],
-                                                           .invert = (bool)settingsMap[displayBacklightInvert]});
-            if (settingsMap[touchscreenI2CAddr] == -1) {
+                                                            .spi_host = (uint16_t)getSetting<displayspidev>()}})
+                .input(DisplayDriverConfig::input_config_t{.keyboardDevice = getSettingString<keyboardDevice>(),
+                                                           .pointerDevice = getSettingString<pointerDevice>()})
+                .light(DisplayDriverConfig::light_config_t{.pin_bl = (int16_t)getSetting<displayBacklight>(),
+                                                           .pwm_channel = (int8_t)getSetting<displayBacklightPWMChannel>(),
+                                                           .invert = (bool)getSetting<displayBacklightInvert>()});
+            if (getSetting<touchscreenI2CAddr>() == -1) {
                 displayConfig.touch(
-                    DisplayDriverConfig::touch_config_t{.type = touch[settingsMap[touchscreenModule]],
-                                                        .freq = (uint32_t)settingsMap[touchscreenBusFrequency],
-                                                        .pin_int = (int16_t)settingsMap[touchscreenIRQ],
-                                                        .offset_rotation = (uint8_t)settingsMap[touchscreenRotate],
+                    DisplayDriverConfig::touch_config_t{.type = touch[getSetting<touchscreenModule>()],
+                                                        .freq = (uint32_t)getSetting<touchscreenBusFrequency>(),
+                                                        .pin_int = (int16_t)getSetting<touchscreenIRQ>(),
+                                                        .offset_rotation = (uint8_t)getSetting<touchscreenRotate>(),
                                                         .spi{
-                                                            .spi_host = (int8_t)settingsMap[touchscreenspidev],
+                                                            .spi_host = (int8_t)getSetting<touchscreenspidev>(),
                                                         },
-                                                        .pin_cs = (int16_t)settingsMap[touchscreenCS]});
+                                                        .pin_cs = (int16_t)getSetting<touchscreenCS>()});
             } else {
                 displayConfig.touch(DisplayDriverConfig::touch_config_t{
-                    .type = touch[settingsMap[touchscreenModule]],
-                    .freq = (uint32_t)settingsMap[touchscreenBusFrequency],
+                    .type = touch[getSetting<touchscreenModule>()],
+                    .freq = (uint32_t)getSetting<touchscreenBusFrequency>(),
                     .x_min = 0,
                     .x_max =
-                        (int16_t)((settingsMap[touchscreenRotate] & 1 ? settingsMap[displayWidth] : settingsMap[displayHeight]) -
+                        (int16_t)((getSetting<touchscreenRotate>() & 1 ? getSetting<displayWidth>()
+                                                                        : getSetting<displayHeight>()) -
                                   1),
                     .y_min = 0,
                     .y_max =
-                        (int16_t)((settingsMap[touchscreenRotate] & 1 ? settingsMap[displayHeight] : settingsMap[displayWidth]) -
+                        (int16_t)((getSetting<touchscreenRotate>() & 1 ? getSetting<displayHeight>()
+                                                                        : getSetting<displayWidth>()) -
                                   1),
-                    .pin_int = (int16_t)settingsMap[touchscreenIRQ],
-                    .offset_rotation = (uint8_t)settingsMap[touchscreenRotate],
-                    .i2c{.i2c_addr = (uint8_t)settingsMap[touchscreenI2CAddr]}});
+                    .pin_int = (int16_t)getSetting<touchscreenIRQ>(),
+                    .offset_rotation = (uint8_t)getSetting<touchscreenRotate>(),
+                    .i2c{.i2c_addr = (uint8_t)getSetting<touchscreenI2CAddr>()}});
             }
         }
         deviceScreen = &DeviceScreen::create(&displayConfig);
@@ -33,9 +33,9 @@ int32_t LinuxInput::runOnce()
 {
 
     if (firstTime) {
-        if (settingsStrings[keyboardDevice] == "")
+        if (getSettingString<keyboardDevice>() == "")
             return disable();
-        fd = open(settingsStrings[keyboardDevice].c_str(), O_RDWR);
+        fd = open(getSettingString<keyboardDevice>().c_str(), O_RDWR);
         if (fd < 0)
             return disable();
         ret = ioctl(fd, EVIOCGRAB, (void *)1);
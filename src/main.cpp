@@ -93,6 +93,7 @@ NRF52Bluetooth *nrf52Bluetooth = nullptr;
 #ifdef ARCH_PORTDUINO
 #include "linux/LinuxHardwareI2C.h"
 #include "mesh/raspihttp/PiWebServer.h"
+#include "platform/portduino/FrameReplay.h"
 #include "platform/portduino/PortduinoGlue.h"
 #include "platform/portduino/USBHal.h"
 #include <cstdlib>
@@ -124,6 +125,7 @@ ButtonThread *CancelButtonThread = nullptr;
 
 #include "AmbientLightingThread.h"
 #include "PowerFSMThread.h"
+#include "StatsLogThread.h"
 
 #if !defined(ARCH_STM32WL) && !MESHTASTIC_EXCLUDE_I2C
 #include "motion/AccelerometerThread.h"
@@ -266,6 +268,9 @@ uint32_t timeLastPowered = 0;
 static Periodic *ledPeriodic;
 static OSThread *powerFSMthread;
 static OSThread *ambientLightingThread;
+#if STATS_LOG_INTERVAL_MSEC > 0
+static OSThread *statsLogThread;
+#endif
 
 RadioInterface *rIf = NULL;
 #ifdef ARCH_PORTDUINO
@@ -388,7 +393,7 @@ void setup()
 
     concurrency::hasBeenSetup = true;
 #if ARCH_PORTDUINO
-    SPISettings spiSettings(settingsMap[spiSpeed], MSBFIRST, SPI_MODE0);
+    SPISettings spiSettings(getSetting<spiSpeed>(), MSBFIRST, SPI_MODE0);
 #else
     SPISettings spiSettings(4000000, MSBFIRST, SPI_MODE0);
 #endif
@@ -409,6 +414,9 @@ void setup()
 
 #ifdef DEBUG_PORT
     consoleInit(); // Set serial baud rate and init our mesh console
+#if DEBUG_LOG_ASYNC
+    console->startDeferredLogging();
+#endif
 #endif
 
 #ifdef UNPHONE
@@ -533,9 +541,9 @@ void setup()
 #elif defined(I2C_SDA) && !defined(ARCH_RP2040)
     Wire.begin(I2C_SDA, I2C_SCL);
 #elif defined(ARCH_PORTDUINO)
-    if (settingsStrings[i2cdev] != "") {
-        LOG_INFO("Use %s as I2C device", settingsStrings[i2cdev].c_str());
-        Wire.begin(settingsStrings[i2cdev].c_str());
+    if (getSettingString<i2cdev>() != "") {
+        LOG_INFO("Use %s as I2C device", getSettingString<i2cdev>().c_str());
+        Wire.begin(getSettingString<i2cdev>().c_str());
     } else {
         LOG_INFO("No I2C device configured, Skip");
     }
@@ -581,7 +589,7 @@ void setup()
 #if defined(I2C_SDA)
     i2cScanner->scanPort(ScanI2C::I2CPort::WIRE);
 #elif defined(ARCH_PORTDUINO)
-    if (settingsStrings[i2cdev] != "") {
+    if (getSettingString<i2cdev>() != "") {
         LOG_INFO("Scan for i2c devices");
         i2cScanner->scanPort(ScanI2C::I2CPort::WIRE);
     }
@@ -853,7 +861,7 @@ void setup()
     SPI.begin(false);
 #endif // HW_SPI1_DEVICE
 #elif ARCH_PORTDUINO
-    if (settingsStrings[spidev] != "ch341") {
+    if (getSettingString<spidev>() != "ch341") {
         SPI.begin();
     }
 #elif !defined(ARCH_ESP32) // ARCH_RP2040
@@ -879,7 +887,7 @@ void setup()
     defined(ST7789_CS) || defined(HX8357_CS) || defined(USE_ST7789) || defined(ILI9488_CS) || defined(ST7796_CS)
         screen = new graphics::Screen(screen_found, screen_model, screen_geometry);
 #elif defined(ARCH_PORTDUINO)
-        if ((screen_found.port != ScanI2C::I2CPort::NO_I2C || settingsMap[displayPanel]) &&
+        if ((screen_found.port != ScanI2C::I2CPort::NO_I2C || getSetting<displayPanel>()) &&
             config.display.displaymode != meshtastic_Config_DisplayConfig_DisplayMode_COLOR) {
             screen = new graphics::Screen(screen_found, screen_model, screen_geometry);
         }
@@ -980,13 +988,13 @@ void setup()
 #endif
 #if defined(ARCH_PORTDUINO)
 
-    if (settingsMap.count(userButtonPin) != 0 && settingsMap[userButtonPin] != RADIOLIB_NC) {
+    if (getSetting<userButtonPin>() != RADIOLIB_NC) {
 
-        LOG_DEBUG("Use GPIO%02d for button", settingsMap[userButtonPin]);
+        LOG_DEBUG("Use GPIO%02d for button", getSetting<userButtonPin>());
         UserButtonThread = new ButtonThread("UserButton");
         if (screen) {
             ButtonConfig config;
-            config.pinNumber = (uint8_t)settingsMap[userButtonPin];
+            config.pinNumber = (uint8_t)getSetting<userButtonPin>();
             config.activeLow = true;
             config.activePullup = true;
             config.pullupSense = INPUT_PULLUP;
@@ -1143,7 +1151,7 @@ void setup()
     if (screen)
         screen->setup();
 #elif defined(ARCH_PORTDUINO)
-    if ((screen_found.port != ScanI2C::I2CPort::NO_I2C || settingsMap[displayPanel]) &&
+    if ((screen_found.port != ScanI2C::I2CPort::NO_I2C || getSetting<displayPanel>()) &&
         config.display.displaymode != meshtastic_Config_DisplayConfig_DisplayMode_COLOR) {
         screen->setup();
     }
@@ -1190,15 +1198,15 @@ void setup()
         }
     };
     for (auto &loraModule : loraModules) {
-        if (settingsMap[loraModule.cfgName] && !rIf) {
-            LOG_DEBUG("Activate %s radio on SPI port %s", loraModule.strName.c_str(), settingsStrings[spidev].c_str());
-            if (settingsStrings[spidev] == "ch341") {
+        if (getSetting(loraModule.cfgName) && !rIf) {
+            LOG_DEBUG("Activate %s radio on SPI port %s", loraModule.strName.c_str(), getSettingString<spidev>().c_str());
+            if (getSettingString<spidev>() == "ch341") {
                 RadioLibHAL = ch341Hal;
             } else {
                 RadioLibHAL = new LockingArduinoHal(SPI, spiSettings);
             }
-            rIf = loraModuleInterface(loraModule.cfgName, (LockingArduinoHal *)RadioLibHAL, settingsMap[cs_pin],
-                                      settingsMap[irq_pin], settingsMap[reset_pin], settingsMap[busy_pin]);
+            rIf = loraModuleInterface(loraModule.cfgName, (LockingArduinoHal *)RadioLibHAL, getSetting<cs_pin>(),
+                                      getSetting<irq_pin>(), getSetting<reset_pin>(), getSetting<busy_pin>());
             if (!rIf->init()) {
                 LOG_WARN("No %s radio", loraModule.strName.c_str());
                 delete rIf;
@@ -1454,7 +1462,7 @@ void setup()
 
 #ifdef ARCH_PORTDUINO
 #if __has_include(<ulfius.h>)
-    if (settingsMap[webserverport] != -1) {
+    if (getSetting<webserverport>() != -1) {
         piwebServerThread = new PiWebServerThread();
         std::atexit([] { delete piwebServerThread; });
     }
@@ -1476,9 +1484,18 @@ void setup()
                                                        1000);
     }
 
+#ifdef ARCH_PORTDUINO
+    if (!portduino_config.replay_file.empty())
+        new FrameReplay(portduino_config.replay_file, portduino_config.replay_realtime, portduino_config.replay_outcome_file,
+                        portduino_config.replay_baseline_file);
+#endif
+
     // This must be _after_ service.init because we need our preferences loaded from flash to have proper timeout values
     PowerFSM_setup(); // we will transition to ON in a couple of seconds, FIXME, only do this for cold boots, not waking from SDS
     powerFSMthread = new PowerFSMThread();
+#if STATS_LOG_INTERVAL_MSEC > 0
+    statsLogThread = new StatsLogThread();
+#endif
 
 #if !HAS_TFT
     setCPUFast(false); // 80MHz is fine for our slow peripherals
@@ -1604,7 +1621,7 @@ void loop()
             static_cast<TFTDisplay *>(dispdev)->sdlLoop();
     }
 #endif
-    long delayMsec = mainController.runOrDelay();
+    long delayMsec = mainScheduler.runOrDelay();
 
     // We want to sleep as long as possible here - because it saves power
     if (!runASAP && loopCanSleep()) {
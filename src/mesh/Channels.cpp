@@ -71,6 +71,7 @@ meshtastic_Channel &Channels::fixupChannel(ChannelIndex chIndex)
             *meshtastic_channelSettings.name = '\0';
     }
 
+    keys[chIndex] = getKey(chIndex);
     hashes[chIndex] = generateHash(chIndex);
 
     return ch;
@@ -257,7 +258,9 @@ CryptoKey Channels::getKey(ChannelIndex chIndex)
  */
 int16_t Channels::setCrypto(ChannelIndex chIndex)
 {
-    CryptoKey k = getKey(chIndex);
+    if (chIndex >= MAX_NUM_CHANNELS)
+        return -1;
+    const CryptoKey &k = keys[chIndex];
 
     if (k.length < 0)
         return -1;
@@ -293,6 +296,7 @@ void Channels::onConfigChanged()
         if (ch.role == meshtastic_Channel_Role_PRIMARY)
             primaryIndex = i;
     }
+    rebuildHashTable();
 #if !MESHTASTIC_EXCLUDE_MQTT
     if (channels.anyMqttEnabled() && mqtt && !mqtt->isEnabled()) {
         LOG_DEBUG("MQTT is enabled on at least one channel, so set MQTT thread to run immediately");
@@ -341,6 +345,15 @@ void Channels::setChannel(const meshtastic_Channel &c)
                 channelFile.channels[i].role = meshtastic_Channel_Role_SECONDARY;
 
     old = c; // slam in the new settings/role
+    if (c.role == meshtastic_Channel_Role_PRIMARY && c.index < getNumChannels())
+        primaryIndex = c.index;
+
+    // Secondaries without a PSK use the primary's key, so any channel's key may have changed
+    for (ChannelIndex i = 0; i < getNumChannels() && i < MAX_NUM_CHANNELS; i++) {
+        keys[i] = getKey(i);
+        hashes[i] = generateHash(i);
+    }
+    rebuildHashTable();
 }
 
 bool Channels::anyMqttEnabled()
@@ -404,6 +417,33 @@ bool Channels::hasDefaultChannel()
     return false;
 }
 
+void Channels::rebuildHashTable()
+{
+    memset(channelsByHash, 0, sizeof(channelsByHash));
+    for (ChannelIndex i = 0; i < getNumChannels() && i < MAX_NUM_CHANNELS; i++) {
+        if (hashes[i] >= 0) // -1 for disabled/invalid channels
+            channelsByHash[hashes[i]] |= (ChannelMask)(1 << i);
+    }
+}
+
+void Channels::recordDecode(ChannelIndex chIndex, bool success)
+{
+    if (chIndex >= MAX_NUM_CHANNELS)
+        return;
+    if (success)
+        decodeSuccesses[chIndex]++;
+    else
+        decodeFailures[chIndex]++;
+}
+
+void Channels::logStats()
+{
+    for (ChannelIndex i = 0; i < getNumChannels() && i < MAX_NUM_CHANNELS; i++) {
+        if (decodeSuccesses[i] || decodeFailures[i])
+            LOG_INFO("Channel %u (%s): %u decoded, %u failed to decode", i, getName(i), decodeSuccesses[i], decodeFailures[i]);
+    }
+}
+
 /** Given a channel hash setup crypto for decoding that channel (or the primary channel if that channel is unsecured)
  *
  * This method is called before decoding inbound packets
@@ -14,6 +14,9 @@ typedef uint8_t ChannelIndex;
  */
 typedef uint8_t ChannelHash;
 
+/** A set of channel indexes, bit n set means channel n is a member */
+typedef uint8_t ChannelMask;
+
 /** The container/on device API for working with channels */
 class Channels
 {
@@ -28,6 +31,18 @@ class Channels
     /// the precomputed hashes for each of our channels, or -1 for invalid
     int16_t hashes[MAX_NUM_CHANNELS] = {};
 
+    /// the precomputed (short PSKs expanded, padded) key for each of our channels, length -1 for invalid
+    CryptoKey keys[MAX_NUM_CHANNELS] = {};
+
+    /// for every possible channel hash, the channels that hash to it.  Rebuilt by onConfigChanged() and setChannel()
+    ChannelMask channelsByHash[256] = {};
+
+    /// how many inbound packets each channel did (or did not) manage to decode, for spotting hash collisions
+    uint32_t decodeSuccesses[MAX_NUM_CHANNELS] = {};
+    uint32_t decodeFailures[MAX_NUM_CHANNELS] = {};
+
+    static_assert(MAX_NUM_CHANNELS <= sizeof(ChannelMask) * 8, "ChannelMask too small for MAX_NUM_CHANNELS");
+
   public:
     Channels() {}
 
@@ -43,7 +58,7 @@ class Channels
     meshtastic_Channel &getByName(const char *chName);
 
     /** Using the index inside the channel, update the specified channel's settings and role.  If this channel is being promoted
-     * to be primary, force all other channels to be secondary.
+     * to be primary, force all other channels to be secondary.  The cached keys and hashes are refreshed to match.
      */
     void setChannel(const meshtastic_Channel &c);
 
@@ -75,6 +90,20 @@ class Channels
      */
     bool decryptForHash(ChannelIndex chIndex, ChannelHash channelHash);
 
+    /** Return the channels that could have been used to encrypt a packet with this channel hash, so inbound decoding only
+     * needs to try those
+     */
+    ChannelMask getChannelsForHash(ChannelHash channelHash) const { return channelsByHash[channelHash]; }
+
+    /** Note whether a packet decrypted with the key of this channel turned out to be valid */
+    void recordDecode(ChannelIndex chIndex, bool success);
+
+    uint32_t getDecodeSuccesses(ChannelIndex chIndex) const { return chIndex < MAX_NUM_CHANNELS ? decodeSuccesses[chIndex] : 0; }
+    uint32_t getDecodeFailures(ChannelIndex chIndex) const { return chIndex < MAX_NUM_CHANNELS ? decodeFailures[chIndex] : 0; }
+
+    /// Log how many packets each channel that has seen traffic decoded or failed to decode
+    void logStats();
+
     /** Given a channel index setup crypto for encoding that channel (or the primary channel if that channel is unsecured)
      *
      * This method is called before encoding outbound packets
@@ -113,6 +142,9 @@ class Channels
 
     int16_t getHash(ChannelIndex i) { return hashes[i]; }
 
+    /** Rebuild channelsByHash from the precomputed hashes */
+    void rebuildHashTable();
+
     /**
      * Validate a channel, fixing any errors as needed
      */
@@ -33,6 +33,7 @@ void CryptoEngine::generateKeyPair(uint8_t *pubKey, uint8_t *privKey)
 
     LOG_DEBUG("Generate Curve25519 keypair");
     Curve25519::dh1(public_key, private_key);
+    clearSharedKeyCache();
     memcpy(pubKey, public_key, sizeof(public_key));
     memcpy(privKey, private_key, sizeof(private_key));
 }
@@ -54,6 +55,7 @@ bool CryptoEngine::regeneratePublicKey(uint8_t *pubKey, uint8_t *privKey)
         }
         memcpy(private_key, privKey, sizeof(private_key));
         memcpy(public_key, pubKey, sizeof(public_key));
+        clearSharedKeyCache();
     } else {
         LOG_WARN("X25519 key generation failed due to blank private key");
         return false;
@@ -65,6 +67,7 @@ void CryptoEngine::clearKeys()
 {
     memset(public_key, 0, sizeof(public_key));
     memset(private_key, 0, sizeof(private_key));
+    clearSharedKeyCache();
 }
 
 /**
@@ -92,10 +95,9 @@ bool CryptoEngine::encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtas
         LOG_DEBUG("Node %d or their public_key not found", toNode);
         return false;
     }
-    if (!crypto->setDHPublicKey(remotePublic.bytes)) {
+    if (!setSharedKey(remotePublic.bytes)) {
         return false;
     }
-    crypto->hash(shared_key, 32);
     initNonce(fromNode, packetNum, extraNonceTmp);
 
     // Calculate the shared secret with the destination node and encrypt
@@ -134,10 +136,9 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
     }
 
     // Calculate the shared secret with the sending node and decrypt
-    if (!crypto->setDHPublicKey(remotePublic.bytes)) {
+    if (!setSharedKey(remotePublic.bytes)) {
         return false;
     }
-    crypto->hash(shared_key, 32);
 
     initNonce(fromNode, packetNum, extraNonce);
     printBytes("Attempt decrypt with nonce: ", nonce, 13);
@@ -148,6 +149,41 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
 void CryptoEngine::setDHPrivateKey(uint8_t *_private_key)
 {
     memcpy(private_key, _private_key, 32);
+    clearSharedKeyCache();
+}
+
+bool CryptoEngine::setSharedKey(const uint8_t *remotePublic)
+{
+    SharedKeyCacheEntry *victim = &sharedKeyCache[0];
+    for (auto &entry : sharedKeyCache) {
+        if (entry.lastUsed && memcmp(entry.remote_public, remotePublic, 32) == 0) {
+            entry.lastUsed = ++sharedKeyCacheClock;
+            memcpy(shared_key, entry.shared_key, 32);
+            sharedKeyCacheHits++;
+            return true;
+        }
+        if (entry.lastUsed < victim->lastUsed)
+            victim = &entry; // Empty entries (0) win over everything else
+    }
+    sharedKeyCacheMisses++;
+
+    uint8_t pubKey[32];
+    memcpy(pubKey, remotePublic, 32);
+    if (!setDHPublicKey(pubKey)) {
+        return false;
+    }
+    hash(shared_key, 32);
+
+    memcpy(victim->remote_public, remotePublic, 32);
+    memcpy(victim->shared_key, shared_key, 32);
+    victim->lastUsed = ++sharedKeyCacheClock;
+    return true;
+}
+
+void CryptoEngine::clearSharedKeyCache()
+{
+    memset(sharedKeyCache, 0, sizeof(sharedKeyCache));
+    sharedKeyCacheClock = 0;
 }
 
 /**
@@ -233,16 +269,50 @@ void CryptoEngine::decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes
     encryptPacket(fromNode, packetId, numBytes, bytes);
 }
 
+CTRCommon *CryptoEngine::getCipher(const CryptoKey &k)
+{
+    CipherContext *victim = &cipherContexts[0];
+    for (auto &c : cipherContexts) {
+        if (c.lastUsed && c.key.length == k.length && memcmp(c.key.bytes, k.bytes, k.length) == 0) {
+            c.lastUsed = ++cipherContextClock;
+            cipherCacheHits++;
+            return c.ctr;
+        }
+        if (c.lastUsed < victim->lastUsed)
+            victim = &c; // Empty contexts (0) win over everything else
+    }
+    cipherCacheMisses++;
+
+    // AES128 and AES256 are different types, so a context can only be rekeyed in place for the same key size
+    if (victim->ctr && victim->key.length != k.length) {
+        delete victim->ctr;
+        victim->ctr = nullptr;
+    }
+    if (!victim->ctr) {
+        if (k.length == 16)
+            victim->ctr = new CTR<AES128>();
+        else
+            victim->ctr = new CTR<AES256>();
+    }
+    victim->ctr->setKey(k.bytes, k.length);
+    victim->key = k;
+    victim->lastUsed = ++cipherContextClock;
+    return victim->ctr;
+}
+
+void CryptoEngine::clearCipherCache()
+{
+    for (auto &c : cipherContexts) {
+        delete c.ctr; // The cipher destructors wipe their key schedules
+        memset(&c, 0, sizeof(c));
+    }
+    cipherContextClock = 0;
+}
+
 // Generic implementation of AES-CTR encryption.
 void CryptoEngine::encryptAESCtr(CryptoKey _key, uint8_t *_nonce, size_t numBytes, uint8_t *bytes)
 {
-    delete ctr;
-    ctr = nullptr;
-    if (_key.length == 16)
-        ctr = new CTR<AES128>();
-    else
-        ctr = new CTR<AES256>();
-    ctr->setKey(_key.bytes, _key.length);
+    CTRCommon *ctr = getCipher(_key);
     static uint8_t scratch[MAX_BLOCKSIZE];
     memcpy(scratch, bytes, numBytes);
     memset(scratch + numBytes, 0,
@@ -21,6 +21,17 @@ struct CryptoKey {
  */
 
 #define MAX_BLOCKSIZE 256
+
+#ifndef PKI_SHARED_KEY_CACHE_SIZE
+#ifdef ARCH_PORTDUINO
+#define PKI_SHARED_KEY_CACHE_SIZE 64
+#else
+#define PKI_SHARED_KEY_CACHE_SIZE 8 // Number of peers whose derived PKI key we remember, 68 bytes each
+#endif
+#endif
+#ifndef AES_CONTEXT_CACHE_SIZE
+#define AES_CONTEXT_CACHE_SIZE (MAX_NUM_CHANNELS + 1) // One per channel, plus the admin key
+#endif
 #define TEST_CURVE25519_FIELD_OPS // Exposes Curve25519::isWeakPoint() for testing keys
 
 class CryptoEngine
@@ -30,7 +41,7 @@ class CryptoEngine
     uint8_t public_key[32] = {0};
 #endif
 
-    virtual ~CryptoEngine() {}
+    virtual ~CryptoEngine() { clearCipherCache(); }
 #if !(MESHTASTIC_EXCLUDE_PKI)
 #if !(MESHTASTIC_EXCLUDE_PKI_KEYGEN)
     virtual void generateKeyPair(uint8_t *pubKey, uint8_t *privKey);
@@ -46,6 +57,10 @@ class CryptoEngine
     virtual bool setDHPublicKey(uint8_t *publicKey);
     virtual void hash(uint8_t *bytes, size_t numBytes);
 
+    /// Number of PKI packets whose shared key was found in / missing from the cache
+    uint32_t sharedKeyCacheHits = 0;
+    uint32_t sharedKeyCacheMisses = 0;
+
     virtual void aesSetKey(const uint8_t *key, size_t key_len);
 
     virtual void aesEncrypt(uint8_t *in, uint8_t *out);
@@ -72,16 +87,57 @@ class CryptoEngine
     virtual void encryptPacket(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
     virtual void decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
     virtual void encryptAESCtr(CryptoKey key, uint8_t *nonce, size_t numBytes, uint8_t *bytes);
+
+    /// Forget every expanded AES key, they will be rebuilt on next use
+    void clearCipherCache();
+
+    /// Number of AES-CTR operations that found / had to build the key schedule for their key
+    uint32_t cipherCacheHits = 0;
+    uint32_t cipherCacheMisses = 0;
 #ifndef PIO_UNIT_TESTING
   protected:
 #endif
     /** Our per packet nonce */
     uint8_t nonce[16] = {0};
     CryptoKey key = {};
-    CTRCommon *ctr = NULL;
+
+    /**
+     * A ready to use AES-CTR cipher for one key.  Expanding the AES key schedule costs more than encrypting a whole packet, and
+     * we keep alternating between the same handful of channel keys, so keep one context per key.  Contexts are created on
+     * first use and the least recently used one is rekeyed when all are taken.
+     */
+    struct CipherContext {
+        CryptoKey key;
+        CTRCommon *ctr;
+        uint32_t lastUsed; // value of cipherContextClock when last used, 0 means empty
+    };
+    CipherContext cipherContexts[AES_CONTEXT_CACHE_SIZE] = {};
+    uint32_t cipherContextClock = 0;
+
+    /// Return an AES-CTR cipher keyed with k, from the cache if possible
+    CTRCommon *getCipher(const CryptoKey &k);
 #if !(MESHTASTIC_EXCLUDE_PKI)
     uint8_t shared_key[32] = {0};
     uint8_t private_key[32] = {0};
+
+    /**
+     * The X25519 + SHA256 derivation of a shared key is by far the most expensive part of a PKI packet, and most PKI traffic is
+     * to and from a handful of peers, so remember the derived key per remote public key.  Least recently used entries are
+     * replaced once the cache is full.  Only valid for our current private key, so flushed whenever that changes.
+     */
+    struct SharedKeyCacheEntry {
+        uint8_t remote_public[32];
+        uint8_t shared_key[32];
+        uint32_t lastUsed; // value of sharedKeyCacheClock when last used, 0 means empty
+    };
+    SharedKeyCacheEntry sharedKeyCache[PKI_SHARED_KEY_CACHE_SIZE] = {};
+    uint32_t sharedKeyCacheClock = 0;
+
+    /// Set shared_key to the key shared with the owner of remotePublic, from the cache if possible
+    bool setSharedKey(const uint8_t *remotePublic);
+
+    /// Forget (and wipe) every cached shared key
+    void clearSharedKeyCache();
 #endif
     /**
      * Init our 128 bit nonce for a new packet
@@ -0,0 +1,208 @@
+#include "configuration.h"
+
+#ifdef ARCH_PORTDUINO
+#include "FrameCapture.h"
+#include "RadioInterface.h"
+#include "mesh-pb-constants.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+FrameCapture *frameCapture;
+
+FrameCapture::~FrameCapture()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool FrameCapture::open()
+{
+    // Drop a last record cut short by a crash, so what we append stays aligned
+    size_t end = 0;
+    {
+        FrameCaptureReader reader;
+        struct stat st;
+        if (stat(filename.c_str(), &st) == 0 && (size_t)st.st_size >= sizeof(FrameCaptureHeader)) {
+            if (!reader.open(filename)) {
+                LOG_ERROR("Frame capture: %s is not a capture file, not appending to it", filename.c_str());
+                return false;
+            }
+            while (reader.next())
+                count++;
+            end = reader.position();
+        }
+    }
+
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Frame capture: can't open %s: %s", filename.c_str(), strerror(errno));
+        return false;
+    }
+    if (end == 0) {
+        FrameCaptureHeader header = {};
+        memcpy(header.magic, FRAME_CAPTURE_MAGIC, sizeof(header.magic));
+        header.version = FRAME_CAPTURE_VERSION;
+        if (::ftruncate(fd, 0) != 0 || ::write(fd, &header, sizeof(header)) != sizeof(header)) {
+            LOG_ERROR("Frame capture: can't write %s: %s", filename.c_str(), strerror(errno));
+            return false;
+        }
+        end = sizeof(header);
+    } else if (::ftruncate(fd, end) != 0) {
+        LOG_ERROR("Frame capture: can't truncate %s: %s", filename.c_str(), strerror(errno));
+        return false;
+    }
+    ::lseek(fd, end, SEEK_SET);
+    LOG_INFO("Frame capture: append to %s after %u frames", filename.c_str(), count);
+    return true;
+}
+
+void FrameCapture::write(const uint8_t *frame, size_t length, float snr, int32_t rssi, uint8_t flags)
+{
+    if (fd < 0 || length > MAX_LORA_PAYLOAD_LEN)
+        return;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    // Record, frame and padding go in with one write(), so a crash can only cut off the last record
+    uint8_t buf[sizeof(FrameRecord) + MAX_LORA_PAYLOAD_LEN + 8] __attribute__((__aligned__(8)));
+    FrameRecord *r = (FrameRecord *)buf;
+    memset(r, 0, sizeof(*r));
+    r->usec = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    r->rssi = (int16_t)rssi;
+    r->snrX4 = (int8_t)constrain(lroundf(snr * 4), INT8_MIN, INT8_MAX);
+    r->flags = flags;
+    r->length = (uint8_t)length;
+    memcpy(buf + sizeof(FrameRecord), frame, length);
+    memset(buf + sizeof(FrameRecord) + length, 0, r->stride() - sizeof(FrameRecord) - length);
+
+    if (::write(fd, buf, r->stride()) != (ssize_t)r->stride())
+        LOG_WARN("Frame capture: write to %s failed: %s", filename.c_str(), strerror(errno));
+    else
+        count++;
+}
+
+void FrameCapture::write(const meshtastic_MeshPacket &p)
+{
+    // The same header RadioInterface::beginSending() puts on the air
+    RadioBuffer buf;
+    buf.header.from = p.from;
+    buf.header.to = p.to;
+    buf.header.id = p.id;
+    buf.header.channel = p.channel;
+    buf.header.next_hop = p.next_hop;
+    buf.header.relay_node = p.relay_node;
+    buf.header.flags =
+        p.hop_limit | (p.want_ack ? PACKET_FLAGS_WANT_ACK_MASK : 0) | (p.via_mqtt ? PACKET_FLAGS_VIA_MQTT_MASK : 0);
+    buf.header.flags |= (p.hop_start << PACKET_FLAGS_HOP_START_SHIFT) & PACKET_FLAGS_HOP_START_MASK;
+
+    size_t payloadLen;
+    uint8_t flags = 0;
+    if (p.which_payload_variant == meshtastic_MeshPacket_encrypted_tag) {
+        payloadLen = std::min((size_t)p.encrypted.size, sizeof(buf.payload));
+        memcpy(buf.payload, p.encrypted.bytes, payloadLen);
+    } else {
+        payloadLen = pb_encode_to_bytes(buf.payload, sizeof(buf.payload), &meshtastic_Data_msg, &p.decoded);
+        if (!payloadLen) {
+            LOG_WARN("Frame capture: packet 0x%08x too big to capture", p.id);
+            return;
+        }
+        flags |= FRAME_FLAG_DECODED;
+    }
+    write((const uint8_t *)&buf, sizeof(PacketHeader) + payloadLen, p.rx_snr, p.rx_rssi, flags);
+}
+
+FrameCaptureReader::~FrameCaptureReader()
+{
+    if (data)
+        munmap((void *)data, length);
+}
+
+bool FrameCaptureReader::open(const std::string &filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Frame capture: can't open %s: %s", filename.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FrameCaptureHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        LOG_ERROR("Frame capture: can't map %s: %s", filename.c_str(), strerror(errno));
+        return false;
+    }
+    data = (const uint8_t *)m;
+    length = st.st_size;
+    madvise(m, length, MADV_SEQUENTIAL);
+
+    const FrameCaptureHeader *header = (const FrameCaptureHeader *)data;
+    if (memcmp(header->magic, FRAME_CAPTURE_MAGIC, sizeof(header->magic)) != 0 || header->version != FRAME_CAPTURE_VERSION) {
+        LOG_ERROR("Frame capture: %s is not a version %d capture", filename.c_str(), FRAME_CAPTURE_VERSION);
+        return false;
+    }
+    rewind();
+    return true;
+}
+
+const FrameRecord *FrameCaptureReader::next()
+{
+    if (offset + sizeof(FrameRecord) > length)
+        return NULL;
+    const FrameRecord *r = (const FrameRecord *)(data + offset);
+    if (offset + r->stride() > length)
+        return NULL;
+    offset += r->stride();
+    return r;
+}
+
+bool frameToPacket(const FrameRecord &r, meshtastic_MeshPacket &p)
+{
+    if (r.length < sizeof(PacketHeader))
+        return false;
+    PacketHeader header;
+    memcpy(&header, r.frame(), sizeof(header));
+    // RadioLibInterface drops these too
+    if (header.from == 0)
+        return false;
+
+    // Keep the assigned fields in sync with RadioLibInterface::handleReceiveInterrupt()
+    memset(&p, 0, sizeof(p));
+    p.from = header.from;
+    p.to = header.to;
+    p.id = header.id;
+    p.channel = header.channel;
+    p.hop_limit = header.flags & PACKET_FLAGS_HOP_LIMIT_MASK;
+    p.hop_start = (header.flags & PACKET_FLAGS_HOP_START_MASK) >> PACKET_FLAGS_HOP_START_SHIFT;
+    p.want_ack = !!(header.flags & PACKET_FLAGS_WANT_ACK_MASK);
+    p.via_mqtt = !!(header.flags & PACKET_FLAGS_VIA_MQTT_MASK);
+    p.next_hop = p.hop_start == 0 ? NO_NEXT_HOP_PREFERENCE : header.next_hop;
+    p.relay_node = p.hop_start == 0 ? NO_RELAY_NODE : header.relay_node;
+    p.rx_time = r.usec / 1000000;
+    p.rx_snr = r.snrX4 / 4.0f;
+    p.rx_rssi = r.rssi;
+
+    const uint8_t *payload = r.frame() + sizeof(PacketHeader);
+    const size_t payloadLen = r.length - sizeof(PacketHeader);
+    if (r.flags & FRAME_FLAG_DECODED) {
+        p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+        return pb_decode_from_bytes(payload, payloadLen, &meshtastic_Data_msg, &p.decoded);
+    }
+    p.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+    memcpy(p.encrypted.bytes, payload, payloadLen);
+    p.encrypted.size = payloadLen;
+    return true;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+
+#ifdef ARCH_PORTDUINO
+
+#include "MeshTypes.h"
+#include <string>
+
+#define FRAME_CAPTURE_MAGIC "MTFRAMES"
+#define FRAME_CAPTURE_VERSION 1
+
+/// The frame of this record holds an encoded meshtastic_Data instead of an encrypted payload (simulator packets)
+#define FRAME_FLAG_DECODED 0x01
+
+/// At the start of every capture file
+struct FrameCaptureHeader {
+    char magic[8]; // FRAME_CAPTURE_MAGIC, not NUL terminated
+    uint32_t version;
+    uint32_t reserved;
+};
+
+/**
+ * One received LoRa frame.  The frame itself (the PacketHeader, then the payload as it was on the air) follows the record,
+ * and is padded to a multiple of 8 bytes so the next record is aligned.  That way a capture can be mmap()ed and read in place.
+ */
+struct FrameRecord {
+    uint64_t usec;  // when it was received, microseconds since the epoch
+    int16_t rssi;   // dBm
+    int8_t snrX4;   // SNR in quarter dB
+    uint8_t flags;  // FRAME_FLAG_*
+    uint8_t length; // of the frame
+    uint8_t reserved[3];
+
+    const uint8_t *frame() const { return (const uint8_t *)(this + 1); }
+
+    /// Bytes from this record to the next
+    size_t stride() const { return sizeof(FrameRecord) + ((length + 7) & ~7); }
+};
+static_assert(sizeof(FrameRecord) == 16, "FrameRecord is part of the capture file format");
+
+/**
+ * Appends what the radio receives to a capture file (Logging: FrameCaptureFile in config.yaml), so it can be replayed later
+ * against another build with meshtasticd --replay.
+ */
+class FrameCapture
+{
+  public:
+    explicit FrameCapture(const std::string &filename) : filename(filename) {}
+    ~FrameCapture();
+
+    /// Open the file for appending, writing the file header if it is new.  Returns false if it can't be used.
+    bool open();
+
+    /// Record a frame as the radio read it
+    void write(const uint8_t *frame, size_t length, float snr, int32_t rssi, uint8_t flags = 0);
+
+    /// Record the frame p arrived in
+    void write(const meshtastic_MeshPacket &p);
+
+    uint32_t getCount() const { return count; }
+
+  private:
+    std::string filename;
+    int fd = -1;
+    uint32_t count = 0;
+};
+
+extern FrameCapture *frameCapture;
+
+/// A capture file mapped into memory, read from front to back
+class FrameCaptureReader
+{
+  public:
+    ~FrameCaptureReader();
+
+    /// Map filename, returns false if it isn't a capture we can read
+    bool open(const std::string &filename);
+
+    /// The next record, or NULL at the end (including a last record cut short by a crash)
+    const FrameRecord *next();
+
+    void rewind() { offset = sizeof(FrameCaptureHeader); }
+
+    /// Offset just past the last record returned
+    size_t position() const { return offset; }
+
+  private:
+    const uint8_t *data = nullptr;
+    size_t length = 0;
+    size_t offset = 0;
+};
+
+/// Build the packet a radio driver would have delivered for r.  Returns false if it isn't a frame the radio would accept.
+bool frameToPacket(const FrameRecord &r, meshtastic_MeshPacket &p);
+
+#endif
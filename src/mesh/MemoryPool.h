@@ -2,8 +2,10 @@
 
 #include <Arduino.h>
 #include <assert.h>
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <new>
 
 #include "PointerQueue.h"
 
@@ -96,3 +98,141 @@ template <class T> class MemoryDynamic : public Allocator<T>
         return p;
     }
 };
+
+/**
+ * A fixed capacity allocator backed by one preallocated slab of maxElements objects.
+ *
+ * Free slots are kept on a lock-free stack of slot indexes, so alloc() and release() are safe to call from ISRs and from other
+ * threads without taking a lock.  The stack head packs a 16 bit slot index with a 16 bit tag that is bumped on every update, so
+ * a pop racing against a pop/push pair on another core can't succeed with a stale next pointer (ABA).
+ *
+ * If the slab is exhausted (or begin() has not been called yet) we either fall back to malloc or return NULL, depending on
+ * heapFallback.  release() works out which of the two an object came from by its address.
+ */
+template <class T> class MemoryPool : public Allocator<T>
+{
+    static constexpr uint16_t NO_SLOT = 0xffff;
+
+    T *buf = NULL;                          // our large raw block of memory
+    std::atomic<uint16_t> *nextFree = NULL; // for each free slot, the index of the next free slot (or NO_SLOT)
+    size_t maxElements = 0;
+    bool heapFallback = true;
+
+    std::atomic<uint32_t> freeHead{NO_SLOT}; // (tag << 16) | index of the first free slot
+
+    std::atomic<uint32_t> numInUse{0};      // slab slots currently handed out
+    std::atomic<uint32_t> highWaterMark{0}; // max value numInUse has ever reached
+    std::atomic<uint32_t> numExhausted{0};  // allocations which found the slab empty
+    std::atomic<uint32_t> numHeapAllocs{0}; // allocations which were served by malloc instead
+
+  public:
+    /// Create an empty pool, every allocation goes to the heap until begin() is called
+    MemoryPool() {}
+
+    explicit MemoryPool(size_t _maxElements, bool _heapFallback = true) { begin(_maxElements, _heapFallback); }
+
+    ~MemoryPool()
+    {
+        free(buf);
+        delete[] nextFree;
+    }
+
+    /**
+     * Allocate the slab.  May only be called once, before any other thread could be using the pool - objects allocated before
+     * this point were malloced and will still be freed correctly.
+     * @return false if the slab could not be allocated, in which case we keep using the heap
+     */
+    bool begin(size_t _maxElements, bool _heapFallback = true)
+    {
+        assert(!buf);
+        assert(_maxElements < NO_SLOT);
+
+        heapFallback = _heapFallback;
+        if (_maxElements == 0)
+            return false;
+
+        buf = (T *)malloc(_maxElements * sizeof(T));
+        nextFree = new (std::nothrow) std::atomic<uint16_t>[_maxElements];
+        if (!buf || !nextFree) {
+            free(buf);
+            delete[] nextFree;
+            buf = NULL;
+            nextFree = NULL;
+            heapFallback = true;
+            return false;
+        }
+
+        // thread all slots into the free list, lowest address first
+        for (size_t i = 0; i < _maxElements; i++)
+            nextFree[i].store((i + 1 < _maxElements) ? i + 1 : NO_SLOT, std::memory_order_relaxed);
+        maxElements = _maxElements;
+        freeHead.store(0);
+        return true;
+    }
+
+    /// Return a buffer for use by others
+    virtual void release(T *p) override
+    {
+        assert(p);
+
+        if (!isFromSlab(p)) {
+            free(p);
+            return;
+        }
+
+        uint16_t index = (uint16_t)(p - buf);
+        assert(p == &buf[index]); // must point at the start of a slot
+
+        uint32_t head = freeHead.load(std::memory_order_relaxed), newHead;
+        do {
+            nextFree[index].store(head & 0xffff, std::memory_order_relaxed);
+            newHead = ((head + 0x10000) & 0xffff0000) | index;
+        } while (!freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+
+        numInUse--;
+    }
+
+    /// Number of objects in the slab
+    size_t getCapacity() const { return maxElements; }
+
+    /// Number of slab slots currently handed out
+    uint32_t getNumInUse() const { return numInUse.load(); }
+
+    /// Maximum number of slab slots that were ever in use at the same time
+    uint32_t getHighWaterMark() const { return highWaterMark.load(); }
+
+    /// Number of allocations that found the slab empty
+    uint32_t getNumExhausted() const { return numExhausted.load(); }
+
+    /// Number of allocations that were served from the heap, including those made before begin()
+    uint32_t getNumHeapAllocs() const { return numHeapAllocs.load(); }
+
+  protected:
+    // Alloc some storage
+    virtual T *alloc(TickType_t maxWait) override
+    {
+        uint32_t head = freeHead.load(std::memory_order_acquire), newHead;
+        while ((head & 0xffff) != NO_SLOT) {
+            uint16_t index = head & 0xffff;
+            newHead = ((head + 0x10000) & 0xffff0000) | nextFree[index].load(std::memory_order_relaxed);
+            if (freeHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire)) {
+                uint32_t used = ++numInUse;
+                uint32_t high = highWaterMark.load(std::memory_order_relaxed);
+                while (used > high && !highWaterMark.compare_exchange_weak(high, used, std::memory_order_relaxed))
+                    ;
+                return &buf[index];
+            }
+        }
+
+        if (buf)
+            numExhausted++;
+        if (!heapFallback)
+            return NULL;
+
+        numHeapAllocs++;
+        return (T *)malloc(sizeof(T));
+    }
+
+  private:
+    bool isFromSlab(const T *p) const { return buf && p >= buf && p < buf + maxElements; }
+};
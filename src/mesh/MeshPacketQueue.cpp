@@ -12,27 +12,147 @@ inline uint32_t getPriority(const meshtastic_MeshPacket *p)
     return pri;
 }
 
-/// @return "true" if "p1" is ordered before "p2"
-bool CompareMeshPacketFunc(const meshtastic_MeshPacket *p1, const meshtastic_MeshPacket *p2)
+/**
+ * @return the sort key of a packet, higher goes first.
+ *
+ * Packets in the late transmit window go after all others, then higher priority first, and for equal priorities we prefer
+ * packets already on mesh over our own.
+ */
+static uint16_t rankOf(const meshtastic_MeshPacket *p)
+{
+    return (p->tx_after ? 0 : 0x100) | ((getPriority(p) & 0x7f) << 1) | (isFromUs(p) ? 0 : 1);
+}
+
+MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen)
+{
+    assert(maxLen < NO_SLOT);
+    entries.resize(maxLen);
+    freeSlots.reserve(maxLen);
+    for (size_t i = maxLen; i > 0; i--)
+        freeSlots.push_back(i - 1);
+    frontHeap.reserve(maxLen);
+    backHeap.reserve(maxLen);
+
+    size_t numBuckets = 4;
+    while (numBuckets < 2 * maxLen)
+        numBuckets *= 2;
+    buckets.assign(numBuckets, NO_SLOT);
+}
+
+bool MeshPacketQueue::empty()
+{
+    return frontHeap.empty();
+}
+
+/// @return "true" if the packet in slot a is to be sent before the one in slot b
+bool MeshPacketQueue::sendsBefore(Slot a, Slot b) const
+{
+    const Entry &ea = entries[a], &eb = entries[b];
+    if (ea.rank != eb.rank)
+        return ea.rank > eb.rank;
+    return (int32_t)(ea.seq - eb.seq) < 0;
+}
+
+size_t MeshPacketQueue::bucketOf(NodeNum from, PacketId id) const
 {
-    assert(p1 && p2);
+    return ((from * 0x9E3779B1u) ^ id) & (buckets.size() - 1);
+}
 
-    // If one packet is in the late transmit window, prefer the other one
-    if ((bool)p1->tx_after != (bool)p2->tx_after) {
-        return !p1->tx_after;
+/// Both heaps share this code, worstFirst flips the order for the eviction heap
+void MeshPacketQueue::heapUp(std::vector<Slot> &heap, Slot Entry::*pos, bool worstFirst, size_t i)
+{
+    Slot s = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (worstFirst ? !sendsBefore(heap[parent], s) : !sendsBefore(s, heap[parent]))
+            break;
+        heap[i] = heap[parent];
+        entries[heap[i]].*pos = i;
+        i = parent;
     }
+    heap[i] = s;
+    entries[s].*pos = i;
+}
 
-    auto p1p = getPriority(p1), p2p = getPriority(p2);
-    // If priorities differ, use that
-    // for equal priorities, prefer packets already on mesh.
-    return (p1p != p2p) ? (p1p > p2p) : (!isFromUs(p1) && isFromUs(p2));
+void MeshPacketQueue::heapDown(std::vector<Slot> &heap, Slot Entry::*pos, bool worstFirst, size_t i)
+{
+    Slot s = heap[i];
+    size_t n = heap.size();
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n &&
+            (worstFirst ? sendsBefore(heap[child], heap[child + 1]) : sendsBefore(heap[child + 1], heap[child])))
+            child++;
+        if (worstFirst ? !sendsBefore(s, heap[child]) : !sendsBefore(heap[child], s))
+            break;
+        heap[i] = heap[child];
+        entries[heap[i]].*pos = i;
+        i = child;
+    }
+    heap[i] = s;
+    entries[s].*pos = i;
 }
 
-MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen) {}
+void MeshPacketQueue::heapRemove(std::vector<Slot> &heap, Slot Entry::*pos, bool worstFirst, Slot s)
+{
+    size_t i = entries[s].*pos;
+    Slot last = heap.back();
+    heap.pop_back();
+    entries[s].*pos = NO_SLOT;
+    if (i < heap.size()) {
+        heap[i] = last;
+        entries[last].*pos = i;
+        heapUp(heap, pos, worstFirst, i);
+        heapDown(heap, pos, worstFirst, entries[last].*pos);
+    }
+}
 
-bool MeshPacketQueue::empty()
+/// Put a packet into a free slot, the caller makes sure there is one
+void MeshPacketQueue::insert(meshtastic_MeshPacket *p)
 {
-    return queue.empty();
+    Slot s = freeSlots.back();
+    freeSlots.pop_back();
+
+    Entry &e = entries[s];
+    e.p = p;
+    e.seq = nextSeq++;
+    e.rank = rankOf(p);
+
+    size_t b = bucketOf(getFrom(p), p->id);
+    e.nextInBucket = buckets[b];
+    buckets[b] = s;
+
+    frontHeap.push_back(s);
+    heapUp(frontHeap, &Entry::frontPos, false, frontHeap.size() - 1);
+    e.backPos = NO_SLOT;
+    if (!p->tx_after) {
+        backHeap.push_back(s);
+        heapUp(backHeap, &Entry::backPos, true, backHeap.size() - 1);
+    }
+}
+
+/// Take the packet in slot s out of the queue and return it
+meshtastic_MeshPacket *MeshPacketQueue::erase(Slot s)
+{
+    Entry &e = entries[s];
+    meshtastic_MeshPacket *p = e.p;
+
+    for (Slot *link = &buckets[bucketOf(getFrom(p), p->id)]; *link != NO_SLOT; link = &entries[*link].nextInBucket) {
+        if (*link == s) {
+            *link = e.nextInBucket;
+            break;
+        }
+    }
+
+    heapRemove(frontHeap, &Entry::frontPos, false, s);
+    if (e.backPos != NO_SLOT)
+        heapRemove(backHeap, &Entry::backPos, true, s);
+
+    e.p = NULL;
+    freeSlots.push_back(s);
+    return p;
 }
 
 /**
@@ -68,7 +188,7 @@ void fixPriority(meshtastic_MeshPacket *p)
 bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p)
 {
     // no space - try to replace a lower priority packet in the queue
-    if (queue.size() >= maxLen) {
+    if (freeSlots.empty()) {
         bool replaced = replaceLowerPriorityPacket(p);
         if (!replaced) {
             LOG_WARN("TX queue is full, and there is no lower-priority packet available to evict in favour of 0x%08x", p->id);
@@ -76,9 +196,7 @@ bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p)
         return replaced;
     }
 
-    // Find the correct position using upper_bound to maintain a stable order
-    auto it = std::upper_bound(queue.begin(), queue.end(), p, CompareMeshPacketFunc);
-    queue.insert(it, p); // Insert packet at the found position
+    insert(p);
     return true;
 }
 
@@ -88,9 +206,7 @@ meshtastic_MeshPacket *MeshPacketQueue::dequeue()
         return NULL;
     }
 
-    auto *p = queue.front();
-    queue.erase(queue.begin()); // Remove the highest-priority packet
-    return p;
+    return erase(frontHeap[0]); // Remove the highest-priority packet
 }
 
 meshtastic_MeshPacket *MeshPacketQueue::getFront()
@@ -99,29 +215,29 @@ meshtastic_MeshPacket *MeshPacketQueue::getFront()
         return NULL;
     }
 
-    auto *p = queue.front();
-    return p;
+    return entries[frontHeap[0]].p;
 }
 
 /** Attempt to find and remove a packet from this queue.  Returns a pointer to the removed packet, or NULL if not found */
 meshtastic_MeshPacket *MeshPacketQueue::remove(NodeNum from, PacketId id, bool tx_normal, bool tx_late)
 {
-    for (auto it = queue.begin(); it != queue.end(); it++) {
-        auto p = (*it);
-        if (getFrom(p) == from && p->id == id && ((tx_normal && !p->tx_after) || (tx_late && p->tx_after))) {
-            queue.erase(it);
-            return p;
-        }
+    // If the same packet is queued more than once, remove the one that would have been sent first
+    Slot found = NO_SLOT;
+    for (Slot s = buckets[bucketOf(from, id)]; s != NO_SLOT; s = entries[s].nextInBucket) {
+        auto p = entries[s].p;
+        if (getFrom(p) == from && p->id == id && ((tx_normal && !p->tx_after) || (tx_late && p->tx_after)) &&
+            (found == NO_SLOT || sendsBefore(s, found)))
+            found = s;
     }
 
-    return NULL;
+    return found == NO_SLOT ? NULL : erase(found);
 }
 
 /* Attempt to find a packet from this queue. Return true if it was found. */
 bool MeshPacketQueue::find(const NodeNum from, const PacketId id)
 {
-    for (auto it = queue.begin(); it != queue.end(); it++) {
-        const auto *p = *it;
+    for (Slot s = buckets[bucketOf(from, id)]; s != NO_SLOT; s = entries[s].nextInBucket) {
+        const auto *p = entries[s].p;
         if (getFrom(p) == from && p->id == id) {
             return true;
         }
@@ -136,40 +252,22 @@ bool MeshPacketQueue::find(const NodeNum from, const PacketId id)
  */
 bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
 {
-
-    if (queue.empty()) {
+    // Packets in the late transmit window are never dropped, so the candidate is the worst on-time packet
+    if (backHeap.empty()) {
         return false; // No packets to replace
     }
 
-    // Check if the packet at the back has a lower priority than the new packet
-    auto *backPacket = queue.back();
-    if (!backPacket->tx_after && backPacket->priority < p->priority) {
-        LOG_WARN("Dropping packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x", backPacket->id, p->id);
-        // Remove the back packet
-        queue.pop_back();
-        packetPool.release(backPacket);
+    Slot worst = backHeap[0];
+    auto *refPacket = entries[worst].p;
+    if (refPacket->priority < p->priority) {
+        LOG_WARN("Dropping packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x", refPacket->id, p->id);
+        erase(worst);
+        packetPool.release(refPacket);
         // Insert the new packet in the correct order
-        enqueue(p);
+        insert(p);
         return true;
     }
 
-    if (backPacket->tx_after) {
-        // Check if there's a non-late packet with lower priority
-        auto it = queue.end();
-        auto refPacket = *--it;
-        for (; refPacket->tx_after && it != queue.begin(); refPacket = *--it)
-            ;
-        if (!refPacket->tx_after && refPacket->priority < p->priority) {
-            LOG_WARN("Dropping non-late packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x",
-                     refPacket->id, p->id);
-            queue.erase(it);
-            packetPool.release(refPacket);
-            // Insert the new packet in the correct order
-            enqueue(p);
-            return true;
-        }
-    }
-
-    // If the back packet's priority is not lower, no replacement occurs
+    // If the worst packet's priority is not lower, no replacement occurs
     return false;
-}
\ No newline at end of file
+}
@@ -2,20 +2,58 @@
 
 #include "MeshTypes.h"
 
-#include <queue>
+#include <vector>
 
 /**
  * A priority queue of packets
+ *
+ * Packets live in a fixed table of maxLen slots.  A binary heap over the slots gives the next packet to send, a second heap
+ * over the on-time packets gives the one to evict when we are full, and a small hash on (from, id) finds queued packets for
+ * cancellation without a scan.  All operations are O(log n).
  */
 class MeshPacketQueue
 {
+    typedef uint16_t Slot;
+    static constexpr Slot NO_SLOT = 0xffff;
+
+    struct Entry {
+        meshtastic_MeshPacket *p;
+        uint32_t seq;      // enqueue order, so packets of equal rank go out first come first served
+        uint16_t rank;     // higher goes first, see rankOf()
+        Slot frontPos;     // position in frontHeap
+        Slot backPos;      // position in backHeap, NO_SLOT for late packets (those are never evicted)
+        Slot nextInBucket; // next slot with the same (from, id) hash
+    };
+
     size_t maxLen;
-    std::vector<meshtastic_MeshPacket *> queue;
+    std::vector<Entry> entries;
+    std::vector<Slot> freeSlots;
+
+    /// Best packet (the one to send next) at the top
+    std::vector<Slot> frontHeap;
+
+    /// Worst on-time packet (the one to drop for a higher priority packet) at the top
+    std::vector<Slot> backHeap;
+
+    /// (from, id) hash -> first slot in that bucket
+    std::vector<Slot> buckets;
+
+    uint32_t nextSeq = 0;
 
     /** Replace a lower priority package in the queue with 'mp' (provided there are lower pri packages). Return true if replaced.
      */
     bool replaceLowerPriorityPacket(meshtastic_MeshPacket *mp);
 
+    bool sendsBefore(Slot a, Slot b) const;
+    size_t bucketOf(NodeNum from, PacketId id) const;
+
+    void heapUp(std::vector<Slot> &heap, Slot Entry::*pos, bool worstFirst, size_t i);
+    void heapDown(std::vector<Slot> &heap, Slot Entry::*pos, bool worstFirst, size_t i);
+    void heapRemove(std::vector<Slot> &heap, Slot Entry::*pos, bool worstFirst, Slot s);
+
+    void insert(meshtastic_MeshPacket *p);
+    meshtastic_MeshPacket *erase(Slot s);
+
   public:
     explicit MeshPacketQueue(size_t _maxLen);
 
@@ -26,7 +64,7 @@ class MeshPacketQueue
     bool empty();
 
     /** return amount of free packets in Queue */
-    size_t getFree() { return maxLen - queue.size(); }
+    size_t getFree() { return maxLen - frontHeap.size(); }
 
     /** return total size of the Queue */
     size_t getMaxLen() { return maxLen; }
@@ -40,4 +78,4 @@ class MeshPacketQueue
 
     /* Attempt to find a packet from this queue. Return true if it was found. */
     bool find(const NodeNum from, const PacketId id);
-};
\ No newline at end of file
+};
@@ -9,6 +9,7 @@
 #include "MeshRadio.h"
 #include "MeshTypes.h"
 #include "Observer.h"
+#include "PhonePacketRing.h"
 #include "PointerQueue.h"
 #if defined(ARCH_PORTDUINO)
 #include "../platform/portduino/SimRadio.h"
@@ -33,11 +34,9 @@ class MeshService
     CallbackObserver<MeshService, const meshtastic::GPSStatus *> gpsObserver =
         CallbackObserver<MeshService, const meshtastic::GPSStatus *>(this, &MeshService::onGPSChanged);
 #endif
-    /// received packets waiting for the phone to process them
-    /// FIXME, change to a DropOldestQueue and keep a count of the number of dropped packets to ensure
-    /// we never hang because android hasn't been there in a while
+    /// received packets waiting for the phone(s) to process them, every connected PhoneAPI gets each of them
     /// FIXME - save this to flash on deep sleep
-    PointerQueue<meshtastic_MeshPacket> toPhoneQueue;
+    PhonePacketRing toPhoneQueue;
 
     // keep list of QueueStatus packets to be send to the phone
     PointerQueue<meshtastic_QueueStatus> toPhoneQueueStatusQueue;
@@ -80,9 +79,21 @@ class MeshService
     /// Do idle processing (mostly processing messages which have been queued from the radio)
     void loop();
 
-    /// Return the next packet destined to the phone.  FIXME, somehow use fromNum to allow the phone to retry the
-    /// last few packets if needs to.
-    meshtastic_MeshPacket *getForPhone() { return toPhoneQueue.dequeuePtr(0); }
+    /// Start receiving the packets destined to the phone, returns the reader id for the calls below (-1 if there are too many)
+    int8_t attachPhone() { return toPhoneQueue.attach(); }
+
+    /// Stop receiving packets for this reader
+    void detachPhone(int8_t reader) { toPhoneQueue.detach(reader); }
+
+    /// Return the next packet destined to this phone, it stays valid until releaseForPhone().  FIXME, somehow use fromNum to
+    /// allow the phone to retry the last few packets if needs to.
+    const meshtastic_MeshPacket *getForPhone(int8_t reader) { return toPhoneQueue.take(reader); }
+
+    /// This phone is done with the packet getForPhone() returned
+    void releaseForPhone(int8_t reader) { toPhoneQueue.release(reader); }
+
+    /// Number of packets this phone missed because it didn't keep up
+    uint32_t getPhoneDrops(int8_t reader) { return toPhoneQueue.getDropped(reader); }
 
     /// Allows the bluetooth handler to free packets after they have been sent
     void releaseToPool(meshtastic_MeshPacket *p) { packetPool.release(p); }
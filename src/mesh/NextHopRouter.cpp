@@ -2,12 +2,6 @@
 
 NextHopRouter::NextHopRouter() {}
 
-PendingPacket::PendingPacket(meshtastic_MeshPacket *p, uint8_t numRetransmissions)
-{
-    packet = p;
-    this->numRetransmissions = numRetransmissions - 1; // We subtract one, because we assume the user just did the first send
-}
-
 /**
  * Send a packet
  */
@@ -139,29 +133,24 @@ uint8_t NextHopRouter::getNextHop(NodeNum to, uint8_t relay_node)
     return NO_NEXT_HOP_PREFERENCE;
 }
 
-PendingPacket *NextHopRouter::findPendingPacket(GlobalPacketId key)
-{
-    auto old = pending.find(key); // If we have an old record, someone messed up because id got reused
-    if (old != pending.end()) {
-        return &old->second;
-    } else
-        return NULL;
-}
-
 /**
  * Stop any retransmissions we are doing of the specified node/packet ID pair
  */
-bool NextHopRouter::stopRetransmission(NodeNum from, PacketId id)
+bool NextHopRouter::stopRetransmission(NodeNum from, PacketId id, RetransmissionEnd end)
 {
     auto key = GlobalPacketId(from, id);
-    return stopRetransmission(key);
+    return stopRetransmission(key, end);
 }
 
-bool NextHopRouter::stopRetransmission(GlobalPacketId key)
+bool NextHopRouter::stopRetransmission(GlobalPacketId key, RetransmissionEnd end)
 {
     auto old = findPendingPacket(key);
     if (old) {
         auto p = old->packet;
+        if (end == RetransmissionEnd::ACKED)
+            countRetransmission(p->to, &RetransmissionStats::acked);
+        else if (end == RetransmissionEnd::NAKED)
+            countRetransmission(p->to, &RetransmissionStats::naked);
         /* Only when we already transmitted a packet via LoRa, we will cancel the packet in the Tx queue
           to avoid canceling a transmission if it was ACKed super fast via MQTT */
         if (old->numRetransmissions < NUM_RELIABLE_RETX - 1) {
@@ -175,8 +164,8 @@ bool NextHopRouter::stopRetransmission(GlobalPacketId key)
                 packetPool.release(p);
             }
         }
-        auto numErased = pending.erase(key);
-        assert(numErased == 1);
+        bool erased = pending.remove(key);
+        assert(erased);
         return true;
     } else
         return false;
@@ -190,88 +179,103 @@ PendingPacket *NextHopRouter::startRetransmission(meshtastic_MeshPacket *p, uint
     auto id = GlobalPacketId(p);
     auto rec = PendingPacket(p, numReTx);
 
-    stopRetransmission(getFrom(p), p->id);
+    stopRetransmission(getFrom(p), p->id, RetransmissionEnd::REPLACED);
 
-    setNextTx(&rec);
-    pending[id] = rec;
+    auto added = pending.add(id, rec, millis());
+    setNextTx(added);
 
-    return &pending[id];
+    return added;
 }
 
 /**
- * Do any retransmissions that are scheduled (FIXME - for the time being called from loop)
+ * Do any retransmissions that are due
  */
 int32_t NextHopRouter::doRetransmissions()
 {
     uint32_t now = millis();
-    int32_t d = INT32_MAX;
-
-    // FIXME, we should use a better datastructure rather than walking through this map.
-    // for(auto el: pending) {
-    for (auto it = pending.begin(), nextIt = it; it != pending.end(); it = nextIt) {
-        ++nextIt; // we use this odd pattern because we might be deleting it...
-        auto &p = it->second;
-
-        bool stillValid = true; // assume we'll keep this record around
-
-        // FIXME, handle 51 day rolloever here!!!
-        if (p.nextTxMsec <= now) {
-            if (p.numRetransmissions == 0) {
-                if (isFromUs(p.packet)) {
-                    LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x", p.packet->from, p.packet->to,
-                              p.packet->id);
-                    sendAckNak(meshtastic_Routing_Error_MAX_RETRANSMIT, getFrom(p.packet), p.packet->id, p.packet->channel);
-                }
-                // Note: we don't stop retransmission here, instead the Nak packet gets processed in sniffReceived
-                stopRetransmission(it->first);
-                stillValid = false; // just deleted it
-            } else {
-                LOG_DEBUG("Sending retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d", p.packet->from, p.packet->to,
-                          p.packet->id, p.numRetransmissions);
-
-                if (!isBroadcast(p.packet->to)) {
-                    if (p.numRetransmissions == 1) {
-                        // Last retransmission, reset next_hop (fallback to FloodingRouter)
-                        p.packet->next_hop = NO_NEXT_HOP_PREFERENCE;
-                        // Also reset it in the nodeDB
-                        meshtastic_NodeInfoLite *sentTo = nodeDB->getMeshNode(p.packet->to);
-                        if (sentTo) {
-                            LOG_INFO("Resetting next hop for packet with dest 0x%x\n", p.packet->to);
-                            sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
-                        }
-                        FloodingRouter::send(packetPool.allocCopy(*p.packet));
-                    } else {
-                        NextHopRouter::send(packetPool.allocCopy(*p.packet));
+
+    // Each record we look at is either removed or rescheduled into the future, the budget only guards against a zero delay
+    PendingPacket *p;
+    for (size_t budget = pending.size(); budget > 0; budget--) {
+        p = pending.peek();
+        if (!p || (int32_t)(pending.getNextTxMsec(p) - now) > 0)
+            break; // Nothing (else) is due
+        auto key = GlobalPacketId(p->packet);
+        const uint32_t generation = p->generation;
+
+        if (p->numRetransmissions == 0) {
+            if (isFromUs(p->packet)) {
+                LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x", p->packet->from, p->packet->to,
+                          p->packet->id);
+                sendAckNak(meshtastic_Routing_Error_MAX_RETRANSMIT, getFrom(p->packet), p->packet->id, p->packet->channel);
+            }
+            // Note: we don't stop retransmission here, instead the Nak packet gets processed in sniffReceived
+            stopRetransmission(key, RetransmissionEnd::NAKED);
+        } else {
+            LOG_DEBUG("Sending retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d", p->packet->from, p->packet->to,
+                      p->packet->id, p->numRetransmissions);
+            countRetransmission(p->packet->to, &RetransmissionStats::sent);
+
+            if (!isBroadcast(p->packet->to)) {
+                if (p->numRetransmissions == 1) {
+                    // Last retransmission, reset next_hop (fallback to FloodingRouter)
+                    p->packet->next_hop = NO_NEXT_HOP_PREFERENCE;
+                    // Also reset it in the nodeDB
+                    meshtastic_NodeInfoLite *sentTo = nodeDB->getMeshNode(p->packet->to);
+                    if (sentTo) {
+                        LOG_INFO("Resetting next hop for packet with dest 0x%x\n", p->packet->to);
+                        sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
                     }
+                    FloodingRouter::send(packetPool.allocCopy(*p->packet));
                 } else {
-                    // Note: we call the superclass version because we don't want to have our version of send() add a new
-                    // retransmission record
-                    FloodingRouter::send(packetPool.allocCopy(*p.packet));
+                    NextHopRouter::send(packetPool.allocCopy(*p->packet));
                 }
-
-                // Queue again
-                --p.numRetransmissions;
-                setNextTx(&p);
+            } else {
+                // Note: we call the superclass version because we don't want to have our version of send() add a new
+                // retransmission record
+                FloodingRouter::send(packetPool.allocCopy(*p->packet));
             }
-        }
-
-        if (stillValid) {
-            // Update our desired sleep delay
-            int32_t t = p.nextTxMsec - now;
 
-            d = min(t, d);
+            // Sending might have replaced or removed our record, only queue again if it is still the same one
+            p = findPendingPacket(key);
+            if (p && p->generation == generation) {
+                --p->numRetransmissions;
+                setNextTx(p);
+            }
         }
     }
 
-    return d;
+    // Update our desired sleep delay
+    p = pending.peek();
+    if (!p)
+        return INT32_MAX;
+    int32_t d = pending.getNextTxMsec(p) - millis();
+    return d > 0 ? d : 0;
 }
 
 void NextHopRouter::setNextTx(PendingPacket *pending)
 {
     assert(iface);
     auto d = iface->getRetransmissionMsec(pending->packet);
-    pending->nextTxMsec = millis() + d;
+    this->pending.reschedule(pending, millis() + d);
     LOG_DEBUG("Setting next retransmission in %u msecs: ", d);
     printPacket("", pending->packet);
     setReceivedMessage(); // Run ASAP, so we can figure out our correct sleep time
-}
\ No newline at end of file
+}
+
+void NextHopRouter::countRetransmission(NodeNum dest, uint32_t RetransmissionStats::*counter)
+{
+    retransmissionTotals.*counter += 1;
+
+    auto it = retransmissionStatsByDest.find(dest);
+    if (it != retransmissionStatsByDest.end())
+        it->second.*counter += 1;
+    else if (retransmissionStatsByDest.size() < MAX_RETRANSMISSION_STATS_DESTS)
+        retransmissionStatsByDest[dest].*counter += 1;
+}
+
+RetransmissionStats NextHopRouter::getRetransmissionStats(NodeNum dest) const
+{
+    auto it = retransmissionStatsByDest.find(dest);
+    return it != retransmissionStatsByDest.end() ? it->second : RetransmissionStats();
+}
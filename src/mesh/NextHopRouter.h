@@ -1,51 +1,14 @@
 #pragma once
 
 #include "FloodingRouter.h"
+#include "RetransmissionSchedule.h"
 #include <unordered_map>
 
-/**
- * An identifier for a globally unique message - a pair of the sending nodenum and the packet id assigned
- * to that message
- */
-struct GlobalPacketId {
-    NodeNum node;
-    PacketId id;
-
-    bool operator==(const GlobalPacketId &p) const { return node == p.node && id == p.id; }
-
-    explicit GlobalPacketId(const meshtastic_MeshPacket *p)
-    {
-        node = getFrom(p);
-        id = p->id;
-    }
-
-    GlobalPacketId(NodeNum _from, PacketId _id)
-    {
-        node = _from;
-        id = _id;
-    }
-};
-
-/**
- * A packet queued for retransmission
- */
-struct PendingPacket {
-    meshtastic_MeshPacket *packet;
-
-    /** The next time we should try to retransmit this packet */
-    uint32_t nextTxMsec = 0;
-
-    /** Starts at NUM_RETRANSMISSIONS -1 and counts down.  Once zero it will be removed from the list */
-    uint8_t numRetransmissions = 0;
-
-    PendingPacket() {}
-    explicit PendingPacket(meshtastic_MeshPacket *p, uint8_t numRetransmissions);
-};
-
-class GlobalPacketIdHashFunction
-{
-  public:
-    size_t operator()(const GlobalPacketId &p) const { return (std::hash<NodeNum>()(p.node)) ^ (std::hash<PacketId>()(p.id)); }
+/// What happened to the packets we retransmitted towards one destination
+struct RetransmissionStats {
+    uint32_t sent = 0;  // retransmissions actually sent
+    uint32_t acked = 0; // stopped because of an (implicit) ACK or reply
+    uint32_t naked = 0; // stopped because of a NAK, or because we gave up and NAK'd ourselves
 };
 
 /*
@@ -67,6 +30,11 @@ class NextHopRouter : public FloodingRouter
      */
     NextHopRouter();
 
+    const RetransmissionStats &getRetransmissionTotals() const { return retransmissionTotals; }
+
+    /** Statistics for retransmissions towards one destination (all zero if we never retransmitted to it) */
+    RetransmissionStats getRetransmissionStats(NodeNum dest) const;
+
     /**
      * Send a packet
      * @return an error code
@@ -95,7 +63,18 @@ class NextHopRouter : public FloodingRouter
     /**
      * Pending retransmissions
      */
-    std::unordered_map<GlobalPacketId, PendingPacket, GlobalPacketIdHashFunction> pending;
+    RetransmissionSchedule pending;
+
+    /// Why we stopped retransmitting a packet, for the statistics
+    enum class RetransmissionEnd { REPLACED, ACKED, NAKED };
+
+    RetransmissionStats retransmissionTotals;
+    std::unordered_map<NodeNum, RetransmissionStats> retransmissionStatsByDest;
+
+    /// Max number of destinations we keep separate statistics for, the totals count everything
+    static constexpr size_t MAX_RETRANSMISSION_STATS_DESTS = 64;
+
+    void countRetransmission(NodeNum dest, uint32_t RetransmissionStats::*counter);
 
     /**
      * Should this incoming filter be dropped?
@@ -114,7 +93,7 @@ class NextHopRouter : public FloodingRouter
      * Try to find the pending packet record for this ID (or NULL if not found)
      */
     PendingPacket *findPendingPacket(NodeNum from, PacketId id) { return findPendingPacket(GlobalPacketId(from, id)); }
-    PendingPacket *findPendingPacket(GlobalPacketId p);
+    PendingPacket *findPendingPacket(GlobalPacketId p) { return pending.find(p); }
 
     /**
      * Add p to the list of packets to retransmit occasionally.  We will free it once we stop retransmitting.
@@ -126,11 +105,11 @@ class NextHopRouter : public FloodingRouter
      *
      * @return true if we found and removed a transmission with this ID
      */
-    bool stopRetransmission(NodeNum from, PacketId id);
-    bool stopRetransmission(GlobalPacketId p);
+    bool stopRetransmission(NodeNum from, PacketId id, RetransmissionEnd end = RetransmissionEnd::ACKED);
+    bool stopRetransmission(GlobalPacketId p, RetransmissionEnd end = RetransmissionEnd::ACKED);
 
     /**
-     * Do any retransmissions that are scheduled (FIXME - for the time being called from loop)
+     * Do any retransmissions that are due
      *
      * @return the number of msecs until our next retransmission or MAXINT if none scheduled
      */
@@ -24,6 +24,7 @@
 #include "modules/NeighborInfoModule.h"
 #include <ErriezCRC32.h>
 #include <algorithm>
+#include <numeric>
 #include <pb_decode.h>
 #include <pb_encode.h>
 #include <vector>
@@ -521,6 +522,8 @@ void NodeDB::installDefaultNodeDatabase()
     nodeDatabase.nodes = std::vector<meshtastic_NodeInfoLite>(MAX_NUM_NODES);
     numMeshNodes = 0;
     meshNodes = &nodeDatabase.nodes;
+    rebuildMeshNodeIndex();
+    sortMeshDB();
 }
 
 void NodeDB::installDefaultConfig(bool preserveKey = false)
@@ -673,7 +676,7 @@ void NodeDB::installDefaultConfig(bool preserveKey = false)
 #endif
 #elif ARCH_PORTDUINO
     bool hasScreen = false;
-    if (settingsMap[displayPanel])
+    if (getSetting<displayPanel>())
         hasScreen = true;
     else
         hasScreen = screen_found.port != ScanI2C::I2CPort::NO_I2C;
@@ -986,8 +989,13 @@ void NodeDB::resetNodes()
 {
     if (!config.position.fixed_position)
         clearLocalPosition();
+    meshtastic_NodeInfoLite *us = getMeshNode(getNodeNum());
+    if (us && us != &meshNodes->at(0))
+        std::swap(*us, meshNodes->at(0)); // Keep ourselves, in slot 0
     numMeshNodes = 1;
     std::fill(nodeDatabase.nodes.begin() + 1, nodeDatabase.nodes.end(), meshtastic_NodeInfoLite());
+    rebuildMeshNodeIndex();
+    sortMeshDB();
     devicestate.has_rx_text_message = false;
     devicestate.has_rx_waypoint = false;
     saveNodeDatabaseToDisk();
@@ -1008,6 +1016,8 @@ void NodeDB::removeNodeByNum(NodeNum nodeNum)
     numMeshNodes -= removed;
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + 1,
               meshtastic_NodeInfoLite());
+    rebuildMeshNodeIndex();
+    sortMeshDB();
     LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Save changes", removed);
     saveNodeDatabaseToDisk();
 }
@@ -1043,6 +1053,8 @@ void NodeDB::cleanupMeshDB()
     numMeshNodes -= removed;
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + removed,
               meshtastic_NodeInfoLite());
+    rebuildMeshNodeIndex();
+    sortMeshDB();
     LOG_DEBUG("cleanupMeshDB purged %d entries", removed);
 }
 
@@ -1176,22 +1188,22 @@ void NodeDB::loadFromDisk()
     }
 
 #endif
-    auto state = loadProto(nodeDatabaseFileName, getMaxNodesAllocatedSize(), sizeof(meshtastic_NodeDatabase),
-                           &meshtastic_NodeDatabase_msg, &nodeDatabase);
+    auto state = loadNodeDatabase();
     if (nodeDatabase.version < DEVICESTATE_MIN_VER) {
         LOG_WARN("NodeDatabase %d is old, discard", nodeDatabase.version);
         installDefaultNodeDatabase();
     } else {
+        if (state == LoadFileResult::LOAD_SUCCESS)
+            nodeJournal.replay(nodeDatabase.nodes);
         meshNodes = &nodeDatabase.nodes;
         numMeshNodes = nodeDatabase.nodes.size();
         LOG_INFO("Loaded saved nodedatabase version %d, with nodes count: %d", nodeDatabase.version, nodeDatabase.nodes.size());
     }
 
-    if (numMeshNodes > MAX_NUM_NODES) {
-        LOG_WARN("Node count %d exceeds MAX_NUM_NODES %d, truncating", numMeshNodes, MAX_NUM_NODES);
-        numMeshNodes = MAX_NUM_NODES;
-    }
+    evictExcessMeshNodes();
     meshNodes->resize(MAX_NUM_NODES);
+    rebuildMeshNodeIndex();
+    sortMeshDB();
 
     // static DeviceState scratch; We no longer read into a tempbuf because this structure is 15KB of valuable RAM
     state = loadProto(deviceStateFileName, meshtastic_DeviceState_size, sizeof(meshtastic_DeviceState),
@@ -1334,11 +1346,180 @@ void NodeDB::loadFromDisk()
     }
 #if ARCH_PORTDUINO
     // set any config overrides
-    if (settingsMap[has_configDisplayMode]) {
-        config.display.displaymode = (_meshtastic_Config_DisplayConfig_DisplayMode)settingsMap[configDisplayMode];
+    if (getSetting<has_configDisplayMode>()) {
+        config.display.displaymode = (_meshtastic_Config_DisplayConfig_DisplayMode)getSetting<configDisplayMode>();
+    }
+
+#endif
+}
+
+#ifdef FSCom
+/// A File read through a buffer, so decoding doesn't turn into a file read per varint
+struct ChunkedFile {
+    File &file;
+    uint8_t *buf;
+    size_t size, pos = 0, len = 0;
+};
+
+static bool chunkedReadcb(pb_istream_t *stream, uint8_t *buf, size_t count)
+{
+    auto *in = (ChunkedFile *)stream->state;
+    while (count) {
+        if (in->pos == in->len) {
+            int n = in->file.read(in->buf, in->size);
+            if (n <= 0)
+                return false;
+            in->pos = 0;
+            in->len = n;
+        }
+        size_t n = std::min(count, in->len - in->pos);
+        if (buf) {
+            memcpy(buf, in->buf + in->pos, n);
+            buf += n;
+        }
+        in->pos += n;
+        count -= n;
+    }
+    return true;
+}
+#endif
+
+/// How readily we drop a node when there are too many: boring ones first, then any other that isn't a favorite, ignored or
+/// verified.  UINT8_MAX for nodes we keep no matter what.  The same order getOrCreateMeshNode() evicts in.
+static uint8_t evictionClass(const meshtastic_NodeInfoLite &n)
+{
+    if (n.is_favorite || n.is_ignored)
+        return UINT8_MAX;
+    if (n.user.public_key.size == 0)
+        return 0;
+    if (n.bitfield & NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK)
+        return UINT8_MAX;
+    return 1;
+}
+
+static bool evictBefore(const meshtastic_NodeInfoLite &a, const meshtastic_NodeInfoLite &b)
+{
+    uint8_t ca = evictionClass(a), cb = evictionClass(b);
+    return ca != cb ? ca < cb : a.last_heard < b.last_heard;
+}
+
+void NodeDB::evictExcessMeshNodes()
+{
+    if (numMeshNodes <= MAX_NUM_NODES)
+        return;
+    LOG_WARN("Node count %d exceeds MAX_NUM_NODES %d, evict the rest", numMeshNodes, MAX_NUM_NODES);
+    std::nth_element(meshNodes->begin(), meshNodes->begin() + MAX_NUM_NODES, meshNodes->begin() + numMeshNodes,
+                     [](const meshtastic_NodeInfoLite &a, const meshtastic_NodeInfoLite &b) { return evictBefore(b, a); });
+    numMeshNodes = MAX_NUM_NODES;
+}
+
+/**
+ * Load nodes.proto one node at a time, straight into its slot in meshNodes.
+ *
+ * Unlike loadProto(), this reads the file in chunks, never grows the vector past MAX_NUM_NODES, and drops nodes we would
+ * purge anyway (no user info, see cleanupMeshDB()) before they take up a slot.  If the file has more nodes than we have room
+ * for, the ones getOrCreateMeshNode() would evict first are dropped.
+ */
+LoadFileResult NodeDB::loadNodeDatabase()
+{
+    nodeDatabase.version = 0;
+    nodeDatabase.nodes.clear();
+    nodeDatabase.nodes.reserve(MAX_NUM_NODES);
+    meshNodes = &nodeDatabase.nodes;
+    numMeshNodes = 0;
+    rebuildMeshNodeIndex();
+
+    LoadFileResult state = LoadFileResult::OTHER_FAILURE;
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+
+    uint32_t start = millis();
+    auto f = FSCom.open(nodeDatabaseFileName, FILE_O_READ);
+    if (!f) {
+        LOG_ERROR("Could not open / read %s", nodeDatabaseFileName);
+        return state;
+    }
+    LOG_INFO("Load %s", nodeDatabaseFileName);
+
+    uint8_t chunk[NODEDB_LOAD_CHUNK_SIZE];
+    ChunkedFile in = {f, chunk, sizeof(chunk)};
+    size_t fileSize = f.size();
+    pb_istream_t stream = {&chunkedReadcb, &in, fileSize};
+
+    uint32_t skipped = 0, evicted = 0;
+    // Once full, the slots as a heap with the node least worth keeping on top
+    std::vector<pb_size_t> evictionHeap;
+    auto keptBefore = [this](pb_size_t a, pb_size_t b) { return evictBefore(meshNodes->at(b), meshNodes->at(a)); };
+    state = LoadFileResult::LOAD_SUCCESS;
+    while (stream.bytes_left) {
+        pb_wire_type_t wireType;
+        uint32_t tag;
+        bool eof;
+        if (!pb_decode_tag(&stream, &wireType, &tag, &eof)) {
+            if (!eof)
+                state = LoadFileResult::DECODE_FAILED;
+            break;
+        }
+
+        if (tag == meshtastic_NodeDatabase_version_tag && wireType == PB_WT_VARINT) {
+            if (!pb_decode_varint32(&stream, &nodeDatabase.version)) {
+                state = LoadFileResult::DECODE_FAILED;
+                break;
+            }
+        } else if (tag == meshtastic_NodeDatabase_nodes_tag && wireType == PB_WT_STRING) {
+            meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_zero;
+            pb_istream_t sub;
+            if (!pb_make_string_substream(&stream, &sub)) {
+                state = LoadFileResult::DECODE_FAILED;
+                break;
+            }
+            bool ok = pb_decode(&sub, meshtastic_NodeInfoLite_fields, &node);
+            if (!pb_close_string_substream(&stream, &sub) || !ok) {
+                state = LoadFileResult::DECODE_FAILED;
+                break;
+            }
+
+            if (!node.has_user || node.num == 0 || getMeshNode(node.num)) {
+                skipped++; // Empty slots (which older firmware saved too), and duplicates
+            } else if (numMeshNodes < MAX_NUM_NODES) {
+                meshNodes->push_back(node);
+                indexMeshNode(numMeshNodes++);
+            } else {
+                // Full, replace the node least worth keeping if this one is better.  We don't know our own node num
+                // yet (devicestate is loaded later), the constructor puts us back if we are dropped here.
+                if (evictionHeap.empty()) {
+                    evictionHeap.resize(numMeshNodes);
+                    std::iota(evictionHeap.begin(), evictionHeap.end(), 0);
+                    std::make_heap(evictionHeap.begin(), evictionHeap.end(), keptBefore);
+                }
+                pb_size_t worst = evictionHeap.front();
+                evicted++;
+                if (evictionClass(meshNodes->at(worst)) != UINT8_MAX && evictBefore(meshNodes->at(worst), node)) {
+                    std::pop_heap(evictionHeap.begin(), evictionHeap.end(), keptBefore);
+                    unindexMeshNode(worst);
+                    meshNodes->at(worst) = node;
+                    indexMeshNode(worst);
+                    std::push_heap(evictionHeap.begin(), evictionHeap.end(), keptBefore);
+                }
+            }
+        } else if (!pb_skip_field(&stream, wireType)) {
+            state = LoadFileResult::DECODE_FAILED;
+            break;
+        }
     }
+    f.close();
 
+    uint32_t elapsed = millis() - start;
+    if (state == LoadFileResult::DECODE_FAILED)
+        LOG_ERROR("Error: can't decode protobuf %s", PB_GET_ERROR(&stream));
+    LOG_INFO("Loaded %u nodes from %s (%u bytes) in %u ms, %u KB/s, skipped %u, evicted %u", numMeshNodes,
+             nodeDatabaseFileName, (unsigned)(fileSize - stream.bytes_left), elapsed,
+             (unsigned)((fileSize - stream.bytes_left) / (elapsed ? elapsed : 1)), skipped, evicted);
+#else
+    LOG_ERROR("ERROR: Filesystem not implemented");
+    state = LoadFileResult::NO_FILESYSTEM;
 #endif
+    return state;
 }
 
 /** Save a protobuf from a file, return true for success */
@@ -1398,9 +1579,17 @@ bool NodeDB::saveNodeDatabaseToDisk()
     FSCom.mkdir("/prefs");
     spiLock->unlock();
 #endif
+    // Usually only a few nodes changed, then we just append those to the journal
+    if (nodeJournal.append(*meshNodes, numMeshNodes))
+        return true;
+
     size_t nodeDatabaseSize;
     pb_get_encoded_size(&nodeDatabaseSize, meshtastic_NodeDatabase_fields, &nodeDatabase);
-    return saveProto(nodeDatabaseFileName, nodeDatabaseSize, &meshtastic_NodeDatabase_msg, &nodeDatabase, false);
+    if (!saveProto(nodeDatabaseFileName, nodeDatabaseSize, &meshtastic_NodeDatabase_msg, &nodeDatabase, false))
+        return false;
+    if (!nodeJournal.restart(*meshNodes, numMeshNodes))
+        LOG_WARN("Could not start %s, every save will rewrite %s", nodeDatabaseJournalFileName, nodeDatabaseFileName);
+    return true;
 }
 
 bool NodeDB::saveToDiskNoRetry(int saveWhat)
@@ -1482,7 +1671,7 @@ bool NodeDB::saveToDisk(int saveWhat)
 const meshtastic_NodeInfoLite *NodeDB::readNextMeshNode(uint32_t &readIndex)
 {
     if (readIndex < numMeshNodes)
-        return &meshNodes->at(readIndex++);
+        return getMeshNodeByIndex(readIndex++);
     else
         return NULL;
 }
@@ -1624,7 +1813,7 @@ void NodeDB::addFromContact(meshtastic_SharedContact contact)
         // Mark the node's key as manually verified to indicate trustworthiness.
         updateGUIforNode = info;
         // powerFSM.trigger(EVENT_NODEDB_UPDATED); This event has been retired
-        sortMeshDB();
+        resortMeshNode(info);
         notifyObservers(true); // Force an update whether or not our node counts have changed
     }
     saveNodeDatabaseToDisk();
@@ -1736,7 +1925,7 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
             info->has_hops_away = true;
             info->hops_away = mp.hop_start - mp.hop_limit;
         }
-        sortMeshDB();
+        resortMeshNode(info);
     }
 }
 
@@ -1745,7 +1934,7 @@ void NodeDB::set_favorite(bool is_favorite, uint32_t nodeId)
     meshtastic_NodeInfoLite *lite = getMeshNode(nodeId);
     if (lite && lite->is_favorite != is_favorite) {
         lite->is_favorite = is_favorite;
-        sortMeshDB();
+        resortMeshNode(lite);
         saveNodeDatabaseToDisk();
     }
 }
@@ -1753,36 +1942,78 @@ void NodeDB::set_favorite(bool is_favorite, uint32_t nodeId)
 void NodeDB::pause_sort(bool paused)
 {
     sortingIsPaused = paused;
+    if (!paused && sortPending)
+        sortMeshDB();
 }
 
 void NodeDB::sortMeshDB()
 {
-    if (!sortingIsPaused && (lastSort == 0 || !Throttle::isWithinTimespanMs(lastSort, 1000 * 5))) {
-        lastSort = millis();
-        bool changed = true;
-        while (changed) { // dumb reverse bubble sort, but probably not bad for what we're doing
-            changed = false;
-            for (int i = numMeshNodes - 1; i > 0; i--) { // lowest case this should examine is i == 1
-                if (meshNodes->at(i - 1).num == getNodeNum()) {
-                    // noop
-                } else if (meshNodes->at(i).num ==
-                           getNodeNum()) { // in the oddball case our own node num is not at location 0, put it there
-                    // TODO: Look for at(i-1) also matching own node num, and throw the DB in the trash
-                    std::swap(meshNodes->at(i), meshNodes->at(i - 1));
-                    changed = true;
-                } else if (meshNodes->at(i).is_favorite && !meshNodes->at(i - 1).is_favorite) {
-                    std::swap(meshNodes->at(i), meshNodes->at(i - 1));
-                    changed = true;
-                } else if (!meshNodes->at(i).is_favorite && meshNodes->at(i - 1).is_favorite) {
-                    // noop
-                } else if (meshNodes->at(i).last_heard > meshNodes->at(i - 1).last_heard) {
-                    std::swap(meshNodes->at(i), meshNodes->at(i - 1));
-                    changed = true;
-                }
-            }
-        }
-        LOG_INFO("Sort took %u milliseconds", millis() - lastSort);
+    uint32_t start = millis();
+    meshNodeOrder.resize(numMeshNodes);
+    for (pb_size_t i = 0; i < numMeshNodes; i++)
+        meshNodeOrder[i] = i;
+    std::stable_sort(meshNodeOrder.begin(), meshNodeOrder.end(),
+                     [this](pb_size_t a, pb_size_t b) { return meshNodeSortsBefore(a, b); });
+    updateMeshNodeRanks(0, numMeshNodes);
+    sortPending = false;
+    LOG_DEBUG("Sort took %u milliseconds", millis() - start);
+}
+
+void NodeDB::resortMeshNode(const meshtastic_NodeInfoLite *lite)
+{
+    if (sortingIsPaused) {
+        sortPending = true;
+        return;
     }
+
+    // Take the node out of the order, then binary search the rest (which is still sorted) for where it goes now
+    pb_size_t slot = lite - meshNodes->data();
+    size_t oldRank = meshNodeRank[slot];
+    meshNodeOrder.erase(meshNodeOrder.begin() + oldRank);
+    auto pos = std::upper_bound(meshNodeOrder.begin(), meshNodeOrder.end(), slot,
+                                [this](pb_size_t a, pb_size_t b) { return meshNodeSortsBefore(a, b); });
+    size_t newRank = pos - meshNodeOrder.begin();
+    meshNodeOrder.insert(pos, slot);
+
+    updateMeshNodeRanks(std::min(oldRank, newRank), std::max(oldRank, newRank) + 1);
+}
+
+bool NodeDB::meshNodeSortsBefore(pb_size_t a, pb_size_t b)
+{
+    const meshtastic_NodeInfoLite &x = meshNodes->at(a), &y = meshNodes->at(b);
+    if (x.num == getNodeNum() || y.num == getNodeNum())
+        return x.num == getNodeNum() && y.num != getNodeNum(); // We always come first
+    if (x.is_favorite != y.is_favorite)
+        return x.is_favorite;
+    return x.last_heard > y.last_heard;
+}
+
+void NodeDB::updateMeshNodeRanks(size_t from, size_t to)
+{
+    for (size_t i = from; i < to; i++)
+        meshNodeRank[meshNodeOrder[i]] = i;
+}
+
+void NodeDB::removeMeshNodeAt(pb_size_t slot)
+{
+    pb_size_t last = numMeshNodes - 1;
+    size_t rank = meshNodeRank[slot];
+    meshNodeOrder.erase(meshNodeOrder.begin() + rank);
+    unindexMeshNode(slot);
+
+    if (slot != last) {
+        // The last node moves into the hole: repoint its bucket and its place in the order
+        meshNodeIndex[meshNodeBucketOf(last)] = slot;
+        meshNodes->at(slot) = meshNodes->at(last);
+        size_t lastRank = meshNodeRank[last] > rank ? meshNodeRank[last] - 1 : meshNodeRank[last];
+        meshNodeOrder[lastRank] = slot;
+        meshNodeRank[slot] = lastRank;
+    }
+    meshNodes->at(last) = meshtastic_NodeInfoLite();
+    numMeshNodes--;
+
+    // Only the nodes after the removed one moved up in the order
+    updateMeshNodeRanks(rank, numMeshNodes);
 }
 
 uint8_t NodeDB::getMeshNodeChannel(NodeNum n)
@@ -1798,13 +2029,65 @@ uint8_t NodeDB::getMeshNodeChannel(NodeNum n)
 /// NOTE: This function might be called from an ISR
 meshtastic_NodeInfoLite *NodeDB::getMeshNode(NodeNum n)
 {
-    for (int i = 0; i < numMeshNodes; i++)
-        if (meshNodes->at(i).num == n)
+    if (meshNodeIndex.empty())
+        return NULL;
+
+    for (size_t bucket = meshNodeBucket(n); meshNodeIndex[bucket] != NO_MESH_NODE;
+         bucket = (bucket + 1) & (meshNodeIndex.size() - 1)) {
+        pb_size_t i = meshNodeIndex[bucket];
+        if (i < numMeshNodes && meshNodes->at(i).num == n)
             return &meshNodes->at(i);
+    }
 
     return NULL;
 }
 
+void NodeDB::indexMeshNode(pb_size_t i)
+{
+    size_t bucket = meshNodeBucket(meshNodes->at(i).num);
+    while (meshNodeIndex[bucket] != NO_MESH_NODE)
+        bucket = (bucket + 1) & (meshNodeIndex.size() - 1);
+    meshNodeIndex[bucket] = i;
+}
+
+size_t NodeDB::meshNodeBucketOf(pb_size_t i) const
+{
+    size_t bucket = meshNodeBucket(meshNodes->at(i).num);
+    while (meshNodeIndex[bucket] != i)
+        bucket = (bucket + 1) & (meshNodeIndex.size() - 1);
+    return bucket;
+}
+
+void NodeDB::unindexMeshNode(pb_size_t i)
+{
+    const size_t mask = meshNodeIndex.size() - 1;
+    size_t hole = meshNodeBucketOf(i);
+    for (size_t next = (hole + 1) & mask; meshNodeIndex[next] != NO_MESH_NODE; next = (next + 1) & mask) {
+        // An entry can fill the hole only if the hole lies between its home bucket and where it is now
+        size_t home = meshNodeBucket(meshNodes->at(meshNodeIndex[next]).num);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            meshNodeIndex[hole] = meshNodeIndex[next];
+            hole = next;
+        }
+    }
+    meshNodeIndex[hole] = NO_MESH_NODE;
+}
+
+void NodeDB::rebuildMeshNodeIndex()
+{
+    // Keep the load factor at or below 1/2 so probe sequences stay short
+    size_t buckets = 1;
+    while (buckets < (size_t)MAX_NUM_NODES * 2)
+        buckets <<= 1;
+    meshNodeIndex.assign(buckets, NO_MESH_NODE);
+
+    for (pb_size_t i = 0; i < numMeshNodes; i++)
+        indexMeshNode(i);
+
+    meshNodeRank.resize(meshNodes->size());
+}
+
+
 // returns true if the maximum number of nodes is reached or we are running low on memory
 bool NodeDB::isFull()
 {
@@ -1825,7 +2108,9 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
             uint32_t oldestBoring = UINT32_MAX;
             int oldestIndex = -1;
             int oldestBoringIndex = -1;
-            for (int i = 1; i < numMeshNodes; i++) {
+            for (int i = 0; i < numMeshNodes; i++) {
+                if (meshNodes->at(i).num == getNodeNum())
+                    continue; // Never evict ourselves
                 // Simply the oldest non-favorite, non-ignored, non-verified node
                 if (!meshNodes->at(i).is_favorite && !meshNodes->at(i).is_ignored &&
                     !(meshNodes->at(i).bitfield & NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK) &&
@@ -1846,11 +2131,7 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
             }
 
             if (oldestIndex != -1) {
-                // Shove the remaining nodes down the chain
-                for (int i = oldestIndex; i < numMeshNodes - 1; i++) {
-                    meshNodes->at(i) = meshNodes->at(i + 1);
-                }
-                (numMeshNodes)--;
+                removeMeshNodeAt(oldestIndex);
             }
         }
         // add the node at the end
@@ -1859,6 +2140,10 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
         // everything is missing except the nodenum
         memset(lite, 0, sizeof(*lite));
         lite->num = n;
+        indexMeshNode(numMeshNodes - 1);
+        meshNodeOrder.push_back(numMeshNodes - 1);
+        meshNodeRank[numMeshNodes - 1] = numMeshNodes - 1;
+        resortMeshNode(lite);
         LOG_INFO("Adding node to database with %i nodes and %u bytes free!", numMeshNodes, memGet.getFreeHeap());
     }
 
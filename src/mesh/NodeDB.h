@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "MeshTypes.h"
+#include "NodeDBJournal.h"
 #include "NodeStatus.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
@@ -97,6 +98,7 @@ extern meshtastic_Position localPosition;
 static constexpr const char *deviceStateFileName = "/prefs/device.proto";
 static constexpr const char *legacyPrefFileName = "/prefs/db.proto";
 static constexpr const char *nodeDatabaseFileName = "/prefs/nodes.proto";
+static constexpr const char *nodeDatabaseJournalFileName = "/prefs/nodes.journal";
 static constexpr const char *configFileName = "/prefs/config.proto";
 static constexpr const char *uiconfigFileName = "/prefs/uiconfig.proto";
 static constexpr const char *moduleConfigFileName = "/prefs/module.proto";
@@ -124,6 +126,15 @@ enum LoadFileResult {
 
 enum UserLicenseStatus { NotKnown, NotLicensed, Licensed };
 
+/// Bytes of nodes.proto we read at a time while loading it
+#ifndef NODEDB_LOAD_CHUNK_SIZE
+#ifdef ARCH_PORTDUINO
+#define NODEDB_LOAD_CHUNK_SIZE 4096
+#else
+#define NODEDB_LOAD_CHUNK_SIZE 256
+#endif
+#endif
+
 class NodeDB
 {
     // NodeNum provisionalNodeNum; // if we are trying to find a node num this is our current attempt
@@ -134,6 +145,7 @@ class NodeDB
     // Note: these two references just point into our static array we serialize to/from disk
 
   public:
+    /// Storage for the nodes, in no particular order - use getMeshNodeByIndex() / readNextMeshNode() for the sorted view
     std::vector<meshtastic_NodeInfoLite> *meshNodes;
     bool updateGUI = false; // we think the gui should definitely be redrawn, screen will clear this once handled
     meshtastic_NodeInfoLite *updateGUIforNode = NULL; // if currently showing this node, we think you should update the GUI
@@ -226,14 +238,19 @@ class NodeDB
 
     void installRoleDefaults(meshtastic_Config_DeviceConfig_Role role);
 
+    /// Iterate the nodes in sorted order (us first, then favorites, then most recently heard)
     const meshtastic_NodeInfoLite *readNextMeshNode(uint32_t &readIndex);
 
+    /// @return the node at position x of the sorted order (us first, then favorites, then most recently heard)
     meshtastic_NodeInfoLite *getMeshNodeByIndex(size_t x)
     {
         assert(x < numMeshNodes);
-        return &meshNodes->at(x);
+        return &meshNodes->at(meshNodeOrder[x]);
     }
 
+    /// Move a node to its place in the sorted order, call this after changing its last_heard or is_favorite in place
+    void resortMeshNode(const meshtastic_NodeInfoLite *lite);
+
     virtual meshtastic_NodeInfoLite *getMeshNode(NodeNum n);
     size_t getNumMeshNodes() { return numMeshNodes; }
 
@@ -286,7 +303,6 @@ class NodeDB
     bool duplicateWarned = false;
     uint32_t lastNodeDbSave = 0;    // when we last saved our db to flash
     uint32_t lastBackupAttempt = 0; // when we last tried a backup automatically or manually
-    uint32_t lastSort = 0;          // When last sorted the nodeDB
     /// Find a node in our DB, create an empty NodeInfoLite if missing
     meshtastic_NodeInfoLite *getOrCreateMeshNode(NodeNum n);
 
@@ -294,6 +310,7 @@ class NodeDB
      * Internal boolean to track sorting paused
      */
     bool sortingIsPaused = false;
+    bool sortPending = false; // a node changed position while sorting was paused
 
     /// pick a provisional nodenum we hope no one is using
     void pickNewNodeNum();
@@ -301,6 +318,9 @@ class NodeDB
     /// read our db from flash
     void loadFromDisk();
 
+    /// Stream nodes.proto into meshNodes, see the comment in NodeDB.cpp
+    LoadFileResult loadNodeDatabase();
+
     /// purge db entries without user info
     void cleanupMeshDB();
 
@@ -315,7 +335,52 @@ class NodeDB
     bool saveChannelsToDisk();
     bool saveDeviceStateToDisk();
     bool saveNodeDatabaseToDisk();
+
+    /// Changes to the nodes since nodes.proto was last written in full
+    NodeDBJournal nodeJournal{nodeDatabaseJournalFileName, nodeDatabaseFileName};
     void sortMeshDB();
+
+    /*
+     * Open addressing (linear probing) hash of NodeNum -> index in meshNodes, so getMeshNode() doesn't need to scan the
+     * whole DB.  Anything that adds, removes or moves entries in meshNodes must keep it up to date.
+     */
+    static constexpr pb_size_t NO_MESH_NODE = (pb_size_t)-1;
+    std::vector<pb_size_t> meshNodeIndex;
+
+    /// Bucket to start probing at for a given nodenum
+    size_t meshNodeBucket(NodeNum n) const { return (n * 0x9E3779B1u) & (meshNodeIndex.size() - 1); }
+
+    /// Index the node at position i of meshNodes
+    void indexMeshNode(pb_size_t i);
+
+    /// The bucket that points at position i of meshNodes (which must be indexed)
+    size_t meshNodeBucketOf(pb_size_t i) const;
+
+    /// Take the node at position i out of the index, shifting the rest of its probe run back so lookups don't stop early
+    void unindexMeshNode(pb_size_t i);
+
+    /// Rebuild the whole index, after entries were shifted around in meshNodes
+    void rebuildMeshNodeIndex();
+
+    /*
+     * The sorted order of the nodes, kept apart from meshNodes so that reordering only ever moves slot numbers around rather
+     * than whole NodeInfoLite structs.  meshNodeOrder[i] is the meshNodes slot of the i'th node in order, and
+     * meshNodeRank[slot] is the position of a slot in meshNodeOrder.
+     */
+    std::vector<pb_size_t> meshNodeOrder;
+    std::vector<pb_size_t> meshNodeRank;
+
+    /// @return true if the node in slot a sorts before the node in slot b
+    bool meshNodeSortsBefore(pb_size_t a, pb_size_t b);
+
+    /// Refresh meshNodeRank for positions [from, to) of meshNodeOrder
+    void updateMeshNodeRanks(size_t from, size_t to);
+
+    /// Remove the node in a slot, filling the hole with the last slot rather than shifting everything down
+    void removeMeshNodeAt(pb_size_t slot);
+
+    /// Keep the MAX_NUM_NODES of the loaded nodes getOrCreateMeshNode() would evict last, e.g. once the journal added some
+    void evictExcessMeshNodes();
 };
 
 extern NodeDB *nodeDB;
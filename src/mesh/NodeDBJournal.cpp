@@ -0,0 +1,278 @@
+#include "NodeDBJournal.h"
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "configuration.h"
+#include <ErriezCRC32.h>
+#include <algorithm>
+#include <unordered_map>
+
+#if defined(ARCH_NRF52) || defined(ARCH_STM32WL)
+#define FILE_O_APPEND FILE_O_WRITE // Adafruit LittleFS always writes at the end of an existing file
+#else
+#define FILE_O_APPEND "a"
+#endif
+
+/// Type, payload length and CRC around each record
+static constexpr size_t RECORD_OVERHEAD = 1 + 2 + 4;
+static constexpr size_t MAX_PAYLOAD = meshtastic_NodeInfoLite_size;
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/// FNV-1a, to notice which nodes changed
+static uint32_t fnv1a(const uint8_t *p, size_t len, uint32_t h = 0x811c9dc5)
+{
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x01000193;
+    }
+    return h;
+}
+
+#ifdef FSCom
+/// Digest and size of a whole file, call with spiLock held
+static bool digestFile(const char *filename, uint32_t &digest, size_t &size)
+{
+    auto f = FSCom.open(filename, FILE_O_READ);
+    if (!f)
+        return false;
+
+    uint8_t buf[256];
+    digest = 0x811c9dc5;
+    size = 0;
+    size_t n;
+    while ((n = f.read(buf, sizeof(buf))) > 0 && n <= sizeof(buf)) {
+        digest = fnv1a(buf, n, digest);
+        size += n;
+    }
+    f.close();
+    return true;
+}
+
+/// Read the next record, false if there is no complete and intact one
+static bool readRecord(File &f, uint8_t &type, const uint8_t *&payload, uint16_t &len, uint8_t *buf)
+{
+    if (f.read(buf, 3) != 3)
+        return false;
+    type = buf[0];
+    len = buf[1] | (buf[2] << 8);
+    if (len > MAX_PAYLOAD || f.read(buf + 3, len + 4) != (size_t)len + 4)
+        return false;
+    if (crc32Buffer(buf, 3 + len) != get32(buf + 3 + len))
+        return false;
+    payload = buf + 3;
+    return true;
+}
+#endif
+
+void NodeDBJournal::digestNodes(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count, std::vector<Written> &list)
+{
+    list.clear();
+    for (size_t i = 0; i < count && i < nodes.size(); i++) {
+        if (nodes[i].num != 0)
+            list.push_back({nodes[i].num, fnv1a((const uint8_t *)&nodes[i], sizeof(nodes[i])), (uint32_t)i});
+    }
+    std::sort(list.begin(), list.end(), [](const Written &a, const Written &b) { return a.num < b.num; });
+}
+
+void NodeDBJournal::addRecord(std::vector<uint8_t> &buf, RecordType type, const uint8_t *payload, uint16_t len)
+{
+    size_t start = buf.size();
+    buf.resize(start + RECORD_OVERHEAD + len);
+    uint8_t *p = buf.data() + start;
+    p[0] = type;
+    p[1] = len & 0xff;
+    p[2] = len >> 8;
+    memcpy(p + 3, payload, len);
+    put32(p + 3 + len, crc32Buffer(p, 3 + len));
+}
+
+bool NodeDBJournal::replay(std::vector<meshtastic_NodeInfoLite> &nodes)
+{
+    valid = false;
+    journalBytes = 0;
+    digestNodes(nodes, nodes.size(), written);
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+
+    uint32_t snapshotDigest;
+    if (!FSCom.exists(journalFile) || !digestFile(snapshotFile, snapshotDigest, snapshotBytes))
+        return false;
+
+    auto f = FSCom.open(journalFile, FILE_O_READ);
+    if (!f)
+        return false;
+    size_t fileSize = f.size();
+
+    uint8_t buf[RECORD_OVERHEAD + MAX_PAYLOAD];
+    uint8_t type;
+    const uint8_t *payload;
+    uint16_t len;
+    if (!readRecord(f, type, payload, len, buf) || type != RECORD_BASE || len != 8 || get32(payload) != snapshotDigest ||
+        get32(payload + 4) != snapshotBytes) {
+        LOG_WARN("%s does not belong to %s, ignore it", journalFile, snapshotFile);
+        f.close();
+        return false;
+    }
+    size_t pos = RECORD_OVERHEAD + len;
+
+    std::unordered_map<NodeNum, size_t> slots;
+    for (size_t i = 0; i < nodes.size(); i++)
+        if (nodes[i].num != 0)
+            slots[nodes[i].num] = i;
+
+    uint32_t puts = 0, removes = 0;
+    while (readRecord(f, type, payload, len, buf)) {
+        if (type == RECORD_PUT) {
+            meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_zero;
+            if (!pb_decode_from_bytes(payload, len, &meshtastic_NodeInfoLite_msg, &node) || node.num == 0)
+                break;
+            auto it = slots.find(node.num);
+            if (it != slots.end()) {
+                nodes[it->second] = node;
+            } else {
+                slots[node.num] = nodes.size();
+                nodes.push_back(node);
+            }
+            puts++;
+        } else if (type == RECORD_REMOVE && len == 4) {
+            auto it = slots.find(get32(payload));
+            if (it != slots.end()) {
+                // Fill the hole with the last node, the order is restored by sorting after load
+                size_t slot = it->second;
+                slots.erase(it);
+                if (slot != nodes.size() - 1) {
+                    nodes[slot] = nodes.back();
+                    slots[nodes[slot].num] = slot;
+                }
+                nodes.pop_back();
+            }
+            removes++;
+        } else {
+            break;
+        }
+        pos += RECORD_OVERHEAD + len;
+    }
+    f.close();
+
+    journalBytes = pos;
+    valid = pos == fileSize;
+    LOG_INFO("Replayed %s: %u changed and %u removed nodes", journalFile, puts, removes);
+    if (!valid)
+        LOG_WARN("%s is damaged after %u of %u bytes, rewrite %s on next save", journalFile, (unsigned)pos, (unsigned)fileSize,
+                 snapshotFile);
+#endif
+    digestNodes(nodes, nodes.size(), written);
+    return valid;
+}
+
+bool NodeDBJournal::append(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count)
+{
+#ifdef FSCom
+    if (!valid)
+        return false;
+
+    std::vector<Written> current;
+    digestNodes(nodes, count, current);
+
+    // Walk both lists in num order to find what changed
+    std::vector<uint8_t> records;
+    uint8_t payload[MAX_PAYLOAD];
+    uint32_t puts = 0, removes = 0;
+    auto was = written.begin();
+    for (auto &now : current) {
+        for (; was != written.end() && was->num < now.num; ++was) {
+            put32(payload, was->num);
+            addRecord(records, RECORD_REMOVE, payload, 4);
+            removes++;
+        }
+        bool same = was != written.end() && was->num == now.num && was->digest == now.digest;
+        if (was != written.end() && was->num == now.num)
+            ++was;
+        if (!same) {
+            size_t len = pb_encode_to_bytes(payload, sizeof(payload), &meshtastic_NodeInfoLite_msg, &nodes[now.index]);
+            addRecord(records, RECORD_PUT, payload, len);
+            puts++;
+        }
+    }
+    for (; was != written.end(); ++was) {
+        put32(payload, was->num);
+        addRecord(records, RECORD_REMOVE, payload, 4);
+        removes++;
+    }
+
+    if (records.empty()) {
+        LOG_DEBUG("No NodeDB changes to save");
+        return true;
+    }
+    if (journalBytes + records.size() > std::max(snapshotBytes, (size_t)NODEDB_JOURNAL_MIN_COMPACT)) {
+        LOG_INFO("%s outgrew %s, compact", journalFile, snapshotFile);
+        return false;
+    }
+
+    {
+        concurrency::LockGuard g(spiLock);
+        if (!FSCom.exists(journalFile))
+            return false;
+        auto f = FSCom.open(journalFile, FILE_O_APPEND);
+        if (!f)
+            return false;
+        size_t n = f.write((uint8_t const *)records.data(), records.size());
+        f.close();
+        if (n != records.size()) {
+            LOG_ERROR("Can't append to %s", journalFile);
+            valid = false; // Part of a record may be on disk now, never append after it
+            return false;
+        }
+    }
+
+    journalBytes += records.size();
+    written.swap(current);
+    LOG_INFO("Save %u changed and %u removed nodes to %s (%u bytes)", puts, removes, journalFile, (unsigned)journalBytes);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool NodeDBJournal::restart(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count)
+{
+    valid = false;
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+
+    uint32_t snapshotDigest;
+    FSCom.remove(journalFile);
+    if (!digestFile(snapshotFile, snapshotDigest, snapshotBytes))
+        return false;
+
+    uint8_t payload[8];
+    put32(payload, snapshotDigest);
+    put32(payload + 4, snapshotBytes);
+    std::vector<uint8_t> record;
+    addRecord(record, RECORD_BASE, payload, sizeof(payload));
+
+    auto f = FSCom.open(journalFile, FILE_O_WRITE);
+    if (!f)
+        return false;
+    size_t n = f.write((uint8_t const *)record.data(), record.size());
+    f.close();
+    if (n != record.size()) {
+        LOG_ERROR("Can't write %s", journalFile);
+        return false;
+    }
+
+    journalBytes = record.size();
+    valid = true;
+    digestNodes(nodes, count, written);
+#endif
+    return valid;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "mesh-pb-constants.h"
+#include <vector>
+
+/// Smallest journal we rewrite into a new snapshot, however small the snapshot itself is
+#ifndef NODEDB_JOURNAL_MIN_COMPACT
+#define NODEDB_JOURNAL_MIN_COMPACT 4096
+#endif
+
+/**
+ * An append-only log of changes to the NodeDB, on top of the last full snapshot in nodes.proto.
+ *
+ * Saving the NodeDB used to encode and rewrite (then read back) every node, however few of them changed.  Instead, append()
+ * writes one record per node that changed (or was removed) since the last save, and only once the journal has grown larger
+ * than the snapshot is the snapshot rewritten and the journal started over (restart()).  At boot, replay() applies the journal
+ * to the nodes loaded from the snapshot.
+ *
+ * Changes are found by comparing a digest of every node with the one it had when last written, so nodes modified in place
+ * (rather than through NodeDB) are caught as well.
+ *
+ * The file is a sequence of records: a type byte, a 16 bit payload length, the payload and a CRC32 of all of that.  The first
+ * record names the snapshot the journal applies to (by a digest of its contents), so a journal left over from before a
+ * snapshot was rewritten is ignored.  Replay stops at the first incomplete or damaged record, which is what a power loss in
+ * the middle of an append leaves behind, and the next save then rewrites the snapshot.
+ */
+class NodeDBJournal
+{
+  public:
+    enum RecordType : uint8_t {
+        RECORD_BASE = 1,   // digest and size of the snapshot this journal applies to
+        RECORD_PUT = 2,    // a NodeInfoLite, replacing any node with the same num
+        RECORD_REMOVE = 3, // the NodeNum of a removed node
+    };
+
+    NodeDBJournal(const char *journalFile, const char *snapshotFile) : journalFile(journalFile), snapshotFile(snapshotFile) {}
+
+    /**
+     * Apply the journal to the nodes just loaded from the snapshot.
+     *
+     * @return false if there is no usable journal, or it ends in a damaged record.  Either way, the next append() will ask for
+     * the snapshot to be rewritten.
+     */
+    bool replay(std::vector<meshtastic_NodeInfoLite> &nodes);
+
+    /**
+     * Write a record for every node that changed since the last append() or restart().
+     *
+     * @return false if the snapshot should be rewritten (followed by restart()) instead: the journal is missing, damaged or
+     * has grown too large, or could not be written.
+     */
+    bool append(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count);
+
+    /// Start an empty journal on top of the snapshot just written from these nodes
+    bool restart(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count);
+
+    /// Size of the journal, in bytes
+    size_t getBytes() const { return journalBytes; }
+
+  private:
+    struct Written {
+        NodeNum num;
+        uint32_t digest;
+        uint32_t index; // position in the nodes passed to append()
+    };
+
+    const char *journalFile;
+    const char *snapshotFile;
+
+    /// Digest of every node as it was last written, sorted by num
+    std::vector<Written> written;
+
+    size_t journalBytes = 0;
+    size_t snapshotBytes = 0;
+
+    /// We know the journal on disk is intact and applies to the current snapshot
+    bool valid = false;
+
+    /// Fill list with the num and digest of each of these nodes, sorted by num
+    static void digestNodes(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count, std::vector<Written> &list);
+
+    /// Add a framed record to buf
+    static void addRecord(std::vector<uint8_t> &buf, RecordType type, const uint8_t *payload, uint16_t len);
+};
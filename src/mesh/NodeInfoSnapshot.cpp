@@ -0,0 +1,60 @@
+#include "NodeInfoSnapshot.h"
+
+#if NODEINFO_SNAPSHOT
+#include "NodeDB.h"
+#include "TypeConversions.h"
+
+NodeInfoSnapshot nodeInfoSnapshot;
+
+/// FNV-1a over everything TypeConversions::ConvertToNodeInfo() looks at
+static uint64_t digestOf(const meshtastic_NodeInfoLite *node)
+{
+    const uint8_t *p = (const uint8_t *)node;
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < sizeof(*node); i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+size_t NodeInfoSnapshot::encode(const meshtastic_NodeInfoLite *node, uint8_t *buf)
+{
+    uint64_t digest = digestOf(node);
+    concurrency::LockGuard guard(&lock);
+
+    Entry &e = entries[node->num];
+    if (e.bytes.empty() || e.digest != digest) {
+        memset(&scratch, 0, sizeof(scratch));
+        scratch.which_payload_variant = meshtastic_FromRadio_node_info_tag;
+        scratch.node_info = TypeConversions::ConvertToNodeInfo(node);
+        e.bytes.resize(meshtastic_FromRadio_size);
+        e.bytes.resize(pb_encode_to_bytes(e.bytes.data(), e.bytes.size(), &meshtastic_FromRadio_msg, &scratch));
+        e.digest = digest;
+        misses++;
+
+        if (entries.size() > 2 * nodeDB->getNumMeshNodes() + 16)
+            prune();
+    } else {
+        hits++;
+    }
+
+    // e is still valid, prune() only erases nodes that are not in the DB
+    memcpy(buf, e.bytes.data(), e.bytes.size());
+    return e.bytes.size();
+}
+
+void NodeInfoSnapshot::prune()
+{
+    size_t before = entries.size();
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (nodeDB->getMeshNode(it->first))
+            ++it;
+        else
+            it = entries.erase(it);
+    }
+    LOG_DEBUG("NodeInfo snapshot dropped %u removed nodes, %u left", (unsigned)(before - entries.size()),
+              (unsigned)entries.size());
+}
+
+#endif
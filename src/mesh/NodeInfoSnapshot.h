@@ -0,0 +1,64 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "concurrency/LockGuard.h"
+#include "mesh-pb-constants.h"
+#include <unordered_map>
+#include <vector>
+
+/// Whether PhoneAPI sends other nodes' NodeInfos from a shared cache of encoded FromRadio packets (about one encoded NodeInfo
+/// of RAM per node in the DB)
+#ifndef NODEINFO_SNAPSHOT
+#ifdef ARCH_PORTDUINO
+#define NODEINFO_SNAPSHOT 1
+#else
+#define NODEINFO_SNAPSHOT 0
+#endif
+#endif
+
+#if NODEINFO_SNAPSHOT
+
+/**
+ * Encoded FromRadio node_info packets, shared by every PhoneAPI connection.
+ *
+ * Sending the NodeDB to a client used to convert and encode every node afresh, for every client and on every connect.  Here
+ * the encoding of each node is kept together with a digest of the NodeInfoLite it came from, so it is only redone for nodes
+ * that changed since they were last sent to anyone.  Keying on the node contents (rather than on NodeDB calls that change a
+ * node) also catches the places that modify a NodeInfoLite in place.
+ */
+class NodeInfoSnapshot
+{
+    struct Entry {
+        uint64_t digest = 0;
+        std::vector<uint8_t> bytes;
+    };
+
+    std::unordered_map<NodeNum, Entry> entries;
+    meshtastic_FromRadio scratch = meshtastic_FromRadio_init_zero;
+    uint32_t hits = 0, misses = 0;
+
+    /// PhoneAPI may run on the BLE task
+    concurrency::Lock lock;
+
+    /// Forget nodes that are no longer in the NodeDB
+    void prune();
+
+  public:
+    /**
+     * Encode the FromRadio packet carrying this node into buf (at least meshtastic_FromRadio_size bytes long), as PhoneAPI
+     * would without the snapshot.
+     *
+     * @return the number of bytes written
+     */
+    size_t encode(const meshtastic_NodeInfoLite *node, uint8_t *buf);
+
+    /// Number of nodes we could send without encoding them again, and the number we had to encode
+    uint32_t getHits() const { return hits; }
+    uint32_t getMisses() const { return misses; }
+
+    size_t size() const { return entries.size(); }
+};
+
+extern NodeInfoSnapshot nodeInfoSnapshot;
+
+#endif
@@ -23,18 +23,34 @@ PacketHistory::PacketHistory(uint32_t size) : recentPacketsCapacity(0), recentPa
         size = PACKETHISTORY_MAX; // Use default size if invalid
     }
 
-    // Allocate memory for the recent packets array
+    if (size >= NO_SLOT) {
+        LOG_WARN("Packet History - Size %d too large for slot index, using %d", size, NO_SLOT - 1);
+        size = NO_SLOT - 1;
+    }
+
+    uint32_t hashSize = 1;
+    while (hashSize < size * 2)
+        hashSize <<= 1;
+
+    // Allocate memory for the recent packets array and its index
     recentPacketsCapacity = size;
     recentPackets = new PacketRecord[recentPacketsCapacity];
-    if (!recentPackets) { // No logging here, console/log probably uninitialized yet.
+    recentPacketsHash = new SlotIndex[hashSize];
+    olderSlot = new SlotIndex[recentPacketsCapacity];
+    newerSlot = new SlotIndex[recentPacketsCapacity];
+    // No logging here, console/log probably uninitialized yet.
+    if (!recentPackets || !recentPacketsHash || !olderSlot || !newerSlot) {
         LOG_ERROR("Packet History - Memory allocation failed for size=%d entries / %d Bytes", size,
-                  sizeof(PacketRecord) * recentPacketsCapacity);
+                  (sizeof(PacketRecord) + 2 * sizeof(SlotIndex)) * recentPacketsCapacity + sizeof(SlotIndex) * hashSize);
         recentPacketsCapacity = 0; // mark allocation fail
         return;                    // return early
     }
 
-    // Initialize the recent packets array to zero
+    // Initialize the recent packets array to zero, and the index to empty
     memset(recentPackets, 0, sizeof(PacketRecord) * recentPacketsCapacity);
+    for (uint32_t i = 0; i < hashSize; i++)
+        recentPacketsHash[i] = NO_SLOT;
+    recentPacketsHashMask = hashSize - 1;
 }
 
 PacketHistory::~PacketHistory()
@@ -42,6 +58,12 @@ PacketHistory::~PacketHistory()
     recentPacketsCapacity = 0;
     delete[] recentPackets;
     recentPackets = NULL;
+    delete[] recentPacketsHash;
+    recentPacketsHash = NULL;
+    delete[] olderSlot;
+    olderSlot = NULL;
+    delete[] newerSlot;
+    newerSlot = NULL;
 }
 
 /** Update recentPackets and return true if we have already seen this packet */
@@ -161,15 +183,18 @@ PacketHistory::PacketRecord *PacketHistory::find(NodeNum sender, PacketId id)
         return NULL;
     }
 
-    PacketRecord *it = NULL;
-    for (it = recentPackets; it < (recentPackets + recentPacketsCapacity); ++it) {
+    for (uint32_t bucket = hashBucket(sender, id);; bucket = (bucket + 1) & recentPacketsHashMask) {
+        SlotIndex slot = recentPacketsHash[bucket];
+        if (slot == NO_SLOT)
+            break; // End of the probe sequence
+
+        PacketRecord *it = &recentPackets[slot];
         if (it->id == id && it->sender == sender) {
 #if VERBOSE_PACKET_HISTORY
             LOG_DEBUG("Packet History - find: s=%08x id=%08x FOUND nh=%02x rby=%02x %02x %02x age=%d slot=%d/%d", it->sender,
                       it->id, it->next_hop, it->relayed_by[0], it->relayed_by[1], it->relayed_by[2], millis() - (it->rxTimeMsec),
-                      it - recentPackets, recentPacketsCapacity);
+                      slot, recentPacketsCapacity);
 #endif
-            // only the first match is returned, so be careful not to create duplicate entries
             return it; // Return pointer to the found record
         }
     }
@@ -185,43 +210,26 @@ void PacketHistory::insert(const PacketRecord &r)
 {
     uint32_t now_millis = millis(); // Should not jump with time changes
     uint32_t OldtrxTimeMsec = 0;
-    PacketRecord *tu = NULL; // Will insert here.
-    PacketRecord *it = NULL;
+    PacketRecord *tu = find(r.sender, r.id); // Will insert here.
 
-    // Find a free, matching or oldest used slot in the recentPackets array
-    for (it = recentPackets; it < (recentPackets + recentPacketsCapacity); ++it) {
-        if (it->id == 0 && it->sender == 0 /*&& rxTimeMsec == 0*/) { // Record is empty
-            tu = it;                                                 // Remember the free slot
+    if (tu != NULL) { // Record matches the packet we want to insert
+        OldtrxTimeMsec = now_millis - tu->rxTimeMsec;
 #if VERBOSE_PACKET_HISTORY >= 2
-            LOG_DEBUG("Packet History - insert: Free slot@ %d/%d", tu - recentPackets, recentPacketsCapacity);
+        LOG_DEBUG("Packet History - insert: Matched slot@ %d/%d age=%d", tu - recentPackets, recentPacketsCapacity,
+                  OldtrxTimeMsec);
 #endif
-            // We have that, Exit the loop
-            it = (recentPackets + recentPacketsCapacity);
-        } else if (it->id == r.id && it->sender == r.sender) { // Record matches the packet we want to insert
-            tu = it;                                           // Remember the matching slot
-            OldtrxTimeMsec = now_millis - it->rxTimeMsec;      // ..and save current entry's age
+    } else if (recentPacketsUsed < recentPacketsCapacity) { // Take the next never used slot
+        tu = &recentPackets[recentPacketsUsed];
 #if VERBOSE_PACKET_HISTORY >= 2
-            LOG_DEBUG("Packet History - insert: Matched slot@ %d/%d age=%d", tu - recentPackets, recentPacketsCapacity,
-                      OldtrxTimeMsec);
+        LOG_DEBUG("Packet History - insert: Free slot@ %d/%d", tu - recentPackets, recentPacketsCapacity);
 #endif
-            // We have that, Exit the loop
-            it = (recentPackets + recentPacketsCapacity);
-        } else {
-            if (it->rxTimeMsec == 0) {
-                LOG_WARN(
-                    "Packet History - insert: Found packet s=%08x id=%08x with rxTimeMsec = 0, slot %d/%d. Should never happen!",
-                    it->sender, it->id, it - recentPackets, recentPacketsCapacity);
-            }
-            if ((now_millis - it->rxTimeMsec) > OldtrxTimeMsec) { // 49.7 days rollover friendly
-                OldtrxTimeMsec = now_millis - it->rxTimeMsec;
-                tu = it; // remember the oldest packet
+    } else if (oldestSlot != NO_SLOT) { // Reuse the oldest slot
+        tu = &recentPackets[oldestSlot];
+        OldtrxTimeMsec = now_millis - tu->rxTimeMsec; // 49.7 days rollover friendly
 #if VERBOSE_PACKET_HISTORY >= 2
-                LOG_DEBUG("Packet History - insert: Older slot@ %d/%d age=%d", tu - recentPackets, recentPacketsCapacity,
-                          OldtrxTimeMsec);
+        LOG_DEBUG("Packet History - insert: Older slot@ %d/%d age=%d", tu - recentPackets, recentPacketsCapacity,
+                  OldtrxTimeMsec);
 #endif
-            }
-            // keep looking for oldest till entire array is checked
-        }
     }
 
     if (tu == NULL) {
@@ -283,7 +291,21 @@ void PacketHistory::insert(const PacketRecord &r)
         return; // Return early if we can't update the history
     }
 
-    *tu = r; // store the packet
+    SlotIndex slot = tu - recentPackets;
+    if (slot == recentPacketsUsed) { // New slot
+        recentPacketsUsed++;
+        *tu = r;
+        hashInsert(slot);
+    } else if (tu->id == r.id && tu->sender == r.sender) { // Same key, the hash index stays valid
+        unlinkSlot(slot);
+        *tu = r;
+    } else { // Evicting the oldest packet
+        hashRemove(slot);
+        unlinkSlot(slot);
+        *tu = r;
+        hashInsert(slot);
+    }
+    appendSlot(slot); // Now the most recently seen
 
 #if VERBOSE_PACKET_HISTORY
     LOG_DEBUG("Packet History - insert: Store slot@ %d/%d s=%08x id=%08x nh=%02x rby=%02x %02x %02x rxT=%d AFTER",
@@ -386,3 +408,72 @@ void PacketHistory::removeRelayer(const uint8_t relayer, const uint32_t id, cons
               found->id, found->relayed_by[0], found->relayed_by[1], found->relayed_by[2], relayer, i != j);
 #endif
 }
+
+uint32_t PacketHistory::hashBucket(NodeNum sender, PacketId id) const
+{
+    // Packet ids are partially random but the low bits are a per sender counter, so mix both well
+    uint32_t h = sender * 0x9E3779B1u;
+    h ^= id + 0x7F4A7C15u + (h << 6) + (h >> 2);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h & recentPacketsHashMask;
+}
+
+void PacketHistory::hashInsert(SlotIndex slot)
+{
+    const PacketRecord &r = recentPackets[slot];
+    uint32_t bucket = hashBucket(r.sender, r.id);
+    while (recentPacketsHash[bucket] != NO_SLOT)
+        bucket = (bucket + 1) & recentPacketsHashMask;
+    recentPacketsHash[bucket] = slot;
+}
+
+void PacketHistory::hashRemove(SlotIndex slot)
+{
+    const PacketRecord &r = recentPackets[slot];
+    uint32_t bucket = hashBucket(r.sender, r.id);
+    while (recentPacketsHash[bucket] != slot) {
+        if (recentPacketsHash[bucket] == NO_SLOT)
+            return; // Not indexed, nothing to do
+        bucket = (bucket + 1) & recentPacketsHashMask;
+    }
+
+    // Backward shift deletion: pull later entries of the probe sequence into the hole, so we never need tombstones
+    uint32_t hole = bucket;
+    for (uint32_t next = (hole + 1) & recentPacketsHashMask; recentPacketsHash[next] != NO_SLOT;
+         next = (next + 1) & recentPacketsHashMask) {
+        const PacketRecord &moved = recentPackets[recentPacketsHash[next]];
+        uint32_t home = hashBucket(moved.sender, moved.id);
+        // The entry at next may only move into the hole if its home bucket is not cyclically within (hole, next]
+        if (((next - home) & recentPacketsHashMask) >= ((next - hole) & recentPacketsHashMask)) {
+            recentPacketsHash[hole] = recentPacketsHash[next];
+            hole = next;
+        }
+    }
+    recentPacketsHash[hole] = NO_SLOT;
+}
+
+void PacketHistory::unlinkSlot(SlotIndex slot)
+{
+    SlotIndex older = olderSlot[slot], newer = newerSlot[slot];
+    if (older != NO_SLOT)
+        newerSlot[older] = newer;
+    else
+        oldestSlot = newer;
+    if (newer != NO_SLOT)
+        olderSlot[newer] = older;
+    else
+        newestSlot = older;
+}
+
+void PacketHistory::appendSlot(SlotIndex slot)
+{
+    olderSlot[slot] = newestSlot;
+    newerSlot[slot] = NO_SLOT;
+    if (newestSlot != NO_SLOT)
+        newerSlot[newestSlot] = slot;
+    else
+        oldestSlot = slot;
+    newestSlot = slot;
+}
@@ -19,9 +19,44 @@ class PacketHistory
         uint8_t relayed_by[NUM_RELAYERS]; // Array of nodes that relayed this packet
     };                                    // 4B + 4B + 4B + 1B + 3B = 16B
 
+#ifdef ARCH_PORTDUINO
+    typedef uint32_t SlotIndex; // History can be sized from MaxNodes, so may need more than 64k slots
+#else
+    typedef uint16_t SlotIndex; // Keep the index overhead small on MCUs
+#endif
+    static constexpr SlotIndex NO_SLOT = (SlotIndex)-1;
+
     uint32_t recentPacketsCapacity =
         0; // Can be set in constructor, no need to recompile. Used to allocate memory for mx_recentPackets.
     PacketRecord *recentPackets = NULL; // Simple and fixed in size. Debloat.
+    uint32_t recentPacketsUsed = 0;     // Slots [0, recentPacketsUsed) are in use, the rest have never been filled
+
+    /* Open addressing (linear probing) hash of (sender, id) -> slot in recentPackets, NO_SLOT marks an empty bucket.
+     * Sized to a power of two at least twice recentPacketsCapacity, so probe sequences stay short. */
+    SlotIndex *recentPacketsHash = NULL;
+    uint32_t recentPacketsHashMask = 0;
+
+    /* Doubly linked list threading all used slots from oldest to newest rxTimeMsec, so the slot to reuse is always at hand.
+     * Kept in arrays parallel to recentPackets so PacketRecord stays 16 bytes. */
+    SlotIndex *olderSlot = NULL;
+    SlotIndex *newerSlot = NULL;
+    SlotIndex oldestSlot = NO_SLOT;
+    SlotIndex newestSlot = NO_SLOT;
+
+    /// Bucket to start probing at for a given sender/id
+    uint32_t hashBucket(NodeNum sender, PacketId id) const;
+
+    /// Add a used slot to the hash index
+    void hashInsert(SlotIndex slot);
+
+    /// Remove a used slot from the hash index
+    void hashRemove(SlotIndex slot);
+
+    /// Unlink a slot from the age list
+    void unlinkSlot(SlotIndex slot);
+
+    /// Append a slot to the age list as the newest entry
+    void appendSlot(SlotIndex slot);
 
     /** Find a packet record in history.
      * @param sender NodeNum
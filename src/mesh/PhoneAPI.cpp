@@ -8,6 +8,7 @@
 #include "FSCommon.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "NodeInfoSnapshot.h"
 #include "PacketHistory.h"
 #include "PhoneAPI.h"
 #include "PowerFSM.h"
@@ -50,6 +51,9 @@ void PhoneAPI::handleStartConfig()
     // Must be before setting state (because state is how we know !connected)
     if (!isConnected()) {
         onConnectionChanged(true);
+        phoneReader = service->attachPhone();
+        if (phoneReader < 0)
+            LOG_WARN("Too many phone connections, this one won't get mesh packets");
         observe(&service->fromNumChanged);
 #ifdef FSCom
         observe(&xModem.packetReady);
@@ -72,6 +76,7 @@ void PhoneAPI::handleStartConfig()
 
     LOG_INFO("Start API client config");
     nodeInfoForPhone.num = 0; // Don't keep returning old nodeinfos
+    nodeNumForPhone = 0;
     resetReadIndex();
 }
 
@@ -87,6 +92,8 @@ void PhoneAPI::close()
         unobserve(&xModem.packetReady);
 #endif
         releasePhonePacket(); // Don't leak phone packets on shutdown
+        service->detachPhone(phoneReader);
+        phoneReader = -1;
         releaseQueueStatusPhonePacket();
         releaseMqttClientProxyPhonePacket();
         releaseClientNotification();
@@ -94,6 +101,7 @@ void PhoneAPI::close()
         fromRadioScratch = {};
         toRadioScratch = {};
         nodeInfoForPhone = {};
+        nodeNumForPhone = 0;
         packetForPhone = NULL;
         filesManifest.clear();
         fromRadioNum = 0;
@@ -429,9 +437,23 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
 
     case STATE_SEND_OTHER_NODEINFOS: {
         LOG_DEBUG("Send known nodes");
+#if NODEINFO_SNAPSHOT
+        if (nodeNumForPhone != 0) {
+            const meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(nodeNumForPhone);
+            nodeNumForPhone = 0;
+            if (!node)
+                return getFromRadio(buf); // Removed since available() picked it, move on to the next one
+            LOG_DEBUG("nodeinfo: num=0x%x, lastseen=%u, name=%s", node->num, node->last_heard, node->user.long_name);
+            size_t numbytes = nodeInfoSnapshot.encode(node, buf);
+            // The snapshot only keeps the encoding, decode it for transports that send the struct itself
+            if (sendsFromRadioScratch() && !pb_decode_from_bytes(buf, numbytes, &meshtastic_FromRadio_msg, &fromRadioScratch))
+                LOG_ERROR("Can't decode nodeinfo 0x%x from the snapshot", node->num);
+            return numbytes;
+        }
+#endif
         if (nodeInfoForPhone.num != 0) {
-            LOG_INFO("nodeinfo: num=0x%x, lastseen=%u, id=%s, name=%s", nodeInfoForPhone.num, nodeInfoForPhone.last_heard,
-                     nodeInfoForPhone.user.id, nodeInfoForPhone.user.long_name);
+            LOG_DEBUG("nodeinfo: num=0x%x, lastseen=%u, id=%s, name=%s", nodeInfoForPhone.num, nodeInfoForPhone.last_heard,
+                      nodeInfoForPhone.user.id, nodeInfoForPhone.user.long_name);
             fromRadioScratch.which_payload_variant = meshtastic_FromRadio_node_info_tag;
             fromRadioScratch.node_info = nodeInfoForPhone;
             // Stay in current state until done sending nodeinfos
@@ -487,12 +509,13 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
             fromRadioScratch.which_payload_variant = meshtastic_FromRadio_clientNotification_tag;
             fromRadioScratch.clientNotification = *clientNotification;
             releaseClientNotification();
-        } else if (packetForPhone) {
-            printPacket("phone downloaded packet", packetForPhone);
+        } else if (packetForPhone || sharedPacketForPhone) {
+            const meshtastic_MeshPacket *p = packetForPhone ? packetForPhone : sharedPacketForPhone;
+            printPacket("phone downloaded packet", p);
 
             // Encapsulate as a FromRadio packet
             fromRadioScratch.which_payload_variant = meshtastic_FromRadio_packet_tag;
-            fromRadioScratch.packet = *packetForPhone;
+            fromRadioScratch.packet = *p;
             releasePhonePacket();
         }
         break;
@@ -525,12 +548,21 @@ void PhoneAPI::sendConfigComplete()
     pauseBluetoothLogging = false;
 }
 
+uint32_t PhoneAPI::getPacketsDropped()
+{
+    return service->getPhoneDrops(phoneReader);
+}
+
 void PhoneAPI::releasePhonePacket()
 {
     if (packetForPhone) {
         service->releaseToPool(packetForPhone); // we just copied the bytes, so don't need this buffer anymore
         packetForPhone = NULL;
     }
+    if (sharedPacketForPhone) {
+        service->releaseForPhone(phoneReader); // other phones might still need this one
+        sharedPacketForPhone = NULL;
+    }
 }
 
 void PhoneAPI::releaseQueueStatusPhonePacket()
@@ -577,11 +609,18 @@ bool PhoneAPI::available()
         return true;
 
     case STATE_SEND_OTHER_NODEINFOS:
-        if (nodeInfoForPhone.num == 0) {
+        if (nodeInfoForPhone.num == 0 && nodeNumForPhone == 0) {
             auto nextNode = nodeDB->readNextMeshNode(readIndex);
             if (nextNode) {
+                bool isUs = nextNode->num == nodeDB->getNodeNum();
+#if NODEINFO_SNAPSHOT
+                // Other nodes go out exactly as stored, so they can come from the snapshot
+                if (!isUs) {
+                    nodeNumForPhone = nextNode->num;
+                    return true;
+                }
+#endif
                 nodeInfoForPhone = TypeConversions::ConvertToNodeInfo(nextNode);
-                bool isUs = nodeInfoForPhone.num == nodeDB->getNodeNum();
                 nodeInfoForPhone.hops_away = isUs ? 0 : nodeInfoForPhone.hops_away;
                 nodeInfoForPhone.last_heard = isUs ? getValidTime(RTCQualityFromNet) : nodeInfoForPhone.last_heard;
                 nodeInfoForPhone.snr = isUs ? 0 : nodeInfoForPhone.snr;
@@ -618,9 +657,9 @@ bool PhoneAPI::available()
 #endif
 #endif
 
-        if (!packetForPhone)
-            packetForPhone = service->getForPhone();
-        hasPacket = !!packetForPhone;
+        if (!packetForPhone && !sharedPacketForPhone)
+            sharedPacketForPhone = service->getForPhone(phoneReader);
+        hasPacket = packetForPhone || sharedPacketForPhone;
         return hasPacket;
     }
     default:
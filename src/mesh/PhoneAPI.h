@@ -1,5 +1,6 @@
 #pragma once
 
+#include "MeshTypes.h"
 #include "Observer.h"
 #include "mesh-pb-constants.h"
 #include "meshtastic/portnums.pb.h"
@@ -65,6 +66,12 @@ class PhoneAPI
     /// downloads it
     meshtastic_MeshPacket *packetForPhone = NULL;
 
+    /// Like packetForPhone, but shared with the other connected phones (from MeshService::getForPhone()), so we just let go of it
+    const meshtastic_MeshPacket *sharedPacketForPhone = NULL;
+
+    /// Our reader in the MeshService phone packet queue while connected, -1 if none
+    int8_t phoneReader = -1;
+
     // file transfer packets destined for phone. Push it to the queue then free it.
     meshtastic_XModem xmodemPacketForPhone = meshtastic_XModem_init_zero;
 
@@ -80,6 +87,9 @@ class PhoneAPI
     /// We temporarily keep the nodeInfo here between the call to available and getFromRadio
     meshtastic_NodeInfo nodeInfoForPhone = meshtastic_NodeInfo_init_default;
 
+    /// Or just the number of the node, if getFromRadio should send it from the shared NodeInfoSnapshot
+    NodeNum nodeNumForPhone = 0;
+
     meshtastic_ToRadio toRadioScratch = {
         0}; // this is a static scratch object, any data must be copied elsewhere before returning
 
@@ -129,6 +139,9 @@ class PhoneAPI
 
     bool isConnected() { return state != STATE_SEND_NOTHING; }
 
+    /// Number of mesh packets this connection missed because it didn't keep up
+    uint32_t getPacketsDropped();
+
   protected:
     /// Our fromradio packet while it is being assembled
     meshtastic_FromRadio fromRadioScratch = {};
@@ -145,6 +158,9 @@ class PhoneAPI
     /// Check the current underlying physical link to see if the client is currently connected
     virtual bool checkIsConnected() = 0;
 
+    /// True for transports that send fromRadioScratch after getFromRadio(), rather than the bytes it put in buf
+    virtual bool sendsFromRadioScratch() { return false; }
+
     /**
      * Subclasses can use this as a hook to provide custom notifications for their transport (i.e. bluetooth notifies)
      */
@@ -0,0 +1,144 @@
+#include "PhonePacketRing.h"
+#include "configuration.h"
+#include <assert.h>
+
+PhonePacketRing::PhonePacketRing(Allocator<meshtastic_MeshPacket> &_pool, size_t capacity) : pool(_pool), slots(capacity)
+{
+    assert(capacity > 0);
+}
+
+PhonePacketRing::~PhonePacketRing()
+{
+    while (!empty())
+        retire();
+    for (auto &park : parked)
+        pool.release(park.p);
+}
+
+void PhonePacketRing::retire()
+{
+    Slot &s = slotFor(tail++);
+    if (s.holders)
+        parked.push_back({s.p, s.holders});
+    else
+        pool.release(s.p);
+    s = {};
+}
+
+void PhonePacketRing::trim()
+{
+    bool anyReader = false;
+    uint32_t oldest = head;
+    for (auto &r : readers) {
+        if (r.attached) {
+            anyReader = true;
+            if ((int32_t)(r.cursor - oldest) < 0)
+                oldest = r.cursor;
+        }
+    }
+
+    // With nobody attached we keep everything, for whoever connects next
+    if (anyReader)
+        while (tail != oldest)
+            retire();
+}
+
+void PhonePacketRing::push(meshtastic_MeshPacket *p)
+{
+    concurrency::LockGuard guard(&lock);
+
+    if (size() == slots.size()) {
+        // Whoever had not read the oldest packet yet loses it
+        for (auto &r : readers) {
+            if (r.attached && r.cursor == tail) {
+                r.cursor++;
+                r.dropped++;
+            }
+        }
+        LOG_WARN("ToPhone queue is full, discard oldest");
+        retire();
+    }
+    slotFor(head++) = {p, 0};
+}
+
+int8_t PhonePacketRing::attach()
+{
+    concurrency::LockGuard guard(&lock);
+
+    for (int8_t i = 0; i < MAX_PHONE_READERS; i++) {
+        if (!readers[i].attached) {
+            readers[i] = {};
+            readers[i].attached = true;
+            readers[i].cursor = tail;
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PhonePacketRing::detach(int8_t reader)
+{
+    if (reader < 0)
+        return;
+    concurrency::LockGuard guard(&lock);
+
+    unhold(readers[reader]);
+    readers[reader].attached = false;
+    trim();
+}
+
+const meshtastic_MeshPacket *PhonePacketRing::take(int8_t reader)
+{
+    if (reader < 0)
+        return NULL;
+    concurrency::LockGuard guard(&lock);
+
+    Reader &r = readers[reader];
+    if (!r.holding && r.cursor != head) {
+        Slot &s = slotFor(r.cursor);
+        s.holders++;
+        r.holding = s.p;
+        r.holdingSeq = r.cursor++;
+    }
+    return r.holding;
+}
+
+void PhonePacketRing::release(int8_t reader)
+{
+    if (reader < 0)
+        return;
+    concurrency::LockGuard guard(&lock);
+
+    unhold(readers[reader]);
+    trim();
+}
+
+void PhonePacketRing::unhold(Reader &r)
+{
+    if (!r.holding)
+        return;
+
+    if ((int32_t)(r.holdingSeq - tail) >= 0) {
+        slotFor(r.holdingSeq).holders--;
+    } else {
+        // The ring dropped it while we held it
+        for (auto it = parked.begin(); it != parked.end(); ++it) {
+            if (it->p == r.holding) {
+                if (--it->holders == 0) {
+                    pool.release(it->p);
+                    parked.erase(it);
+                }
+                break;
+            }
+        }
+    }
+    r.holding = NULL;
+}
+
+uint32_t PhonePacketRing::getDropped(int8_t reader)
+{
+    if (reader < 0)
+        return 0;
+    concurrency::LockGuard guard(&lock);
+    return readers[reader].dropped;
+}
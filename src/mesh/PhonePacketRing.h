@@ -0,0 +1,107 @@
+#pragma once
+
+#include "MemoryPool.h"
+#include "MeshTypes.h"
+#include "concurrency/LockGuard.h"
+#include <vector>
+
+/// Max number of PhoneAPI connections reading phone-bound packets at once
+#ifndef MAX_PHONE_READERS
+#ifdef ARCH_PORTDUINO
+#define MAX_PHONE_READERS 12
+#else
+#define MAX_PHONE_READERS 4
+#endif
+#endif
+
+/**
+ * Packets destined to the phone, delivered to every connected client.
+ *
+ * Each attached reader (one per PhoneAPI connection) has its own cursor into a ring of up to `capacity` packets.  A packet is
+ * given back to the pool once every cursor has moved past it, or while nobody is attached, once it is pushed out by newer
+ * packets (so a client connecting later still gets what arrived while nobody was listening).
+ *
+ * When the ring is full the oldest packet is dropped.  Readers that had not read it yet count that as a drop, so only the
+ * readers that fell behind lose packets.
+ *
+ * A reader may hold on to the packet it was last given until release(), even if the ring drops it in the meantime (BLE reads it
+ * from another task).  Such packets are parked until their last holder releases them.
+ */
+class PhonePacketRing
+{
+    struct Slot {
+        meshtastic_MeshPacket *p;
+        uint8_t holders; // readers currently holding this packet
+    };
+
+    struct Reader {
+        bool attached;
+        uint32_t cursor;  // sequence number of the next packet to give this reader
+        uint32_t dropped; // packets this reader never got, because it was too far behind
+        const meshtastic_MeshPacket *holding;
+        uint32_t holdingSeq;
+    };
+
+    /// Dropped packets that some reader is still holding
+    struct Parked {
+        meshtastic_MeshPacket *p;
+        uint8_t holders;
+    };
+
+    Allocator<meshtastic_MeshPacket> &pool;
+    std::vector<Slot> slots;
+    Reader readers[MAX_PHONE_READERS] = {};
+    std::vector<Parked> parked;
+
+    /// Sequence numbers of the oldest packet we still keep and of the next packet to be pushed
+    uint32_t tail = 0, head = 0;
+
+    concurrency::Lock lock;
+
+    Slot &slotFor(uint32_t seq) { return slots[seq % slots.size()]; }
+
+    /// Let go of the oldest packet
+    void retire();
+
+    /// Retire everything every attached reader has moved past
+    void trim();
+
+    /// Let go of the packet this reader holds (if any)
+    void unhold(Reader &r);
+
+  public:
+    PhonePacketRing(Allocator<meshtastic_MeshPacket> &pool, size_t capacity);
+    ~PhonePacketRing();
+
+    /// Add a packet (which must come from our pool), we now own it
+    void push(meshtastic_MeshPacket *p);
+
+    /// Start reading from the oldest packet we have, returns -1 if there are too many readers already
+    int8_t attach();
+
+    /// Stop reading, releases anything the reader holds
+    void detach(int8_t reader);
+
+    /**
+     * Return the next packet for this reader (or NULL if it has read everything).  It stays valid until release() or detach(),
+     * and a reader can only hold one packet at a time.
+     */
+    const meshtastic_MeshPacket *take(int8_t reader);
+
+    /// Done with the packet take() returned
+    void release(int8_t reader);
+
+    /// Number of packets this reader lost because it fell behind
+    uint32_t getDropped(int8_t reader);
+
+    size_t size() const { return head - tail; }
+    bool empty() const { return head == tail; }
+
+    /// Call f for every packet we still keep, oldest first
+    template <typename F> void forEach(F f)
+    {
+        concurrency::LockGuard guard(&lock);
+        for (uint32_t seq = tail; seq != head; seq++)
+            f(slotFor(seq).p);
+    }
+};
@@ -18,6 +18,14 @@ template <class T> class PointerQueue : public TypedQueue<T *>
         return this->dequeue(&p, maxWait) ? p : nullptr;
     }
 
+    // returns the oldest ptr, leaving it in the queue, or null if the queue is empty
+    T *peekPtr()
+    {
+        T *p;
+
+        return this->peek(&p) ? p : nullptr;
+    }
+
 #ifdef HAS_FREE_RTOS
     // returns a ptr or null if the queue was empty
     T *dequeuePtrFromISR(BaseType_t *higherPriWoken)
@@ -10,7 +10,7 @@
 #endif
 
 #if ARCH_PORTDUINO
-#define RF95_MAX_POWER settingsMap[rf95_max_power]
+#define RF95_MAX_POWER getSetting<rf95_max_power>()
 #endif
 #ifndef RF95_MAX_POWER
 #define RF95_MAX_POWER 20
@@ -94,16 +94,16 @@ void RF95Interface::setTransmitEnable(bool txon)
 #ifdef RF95_TXEN
     digitalWrite(RF95_TXEN, txon ? 1 : 0);
 #elif ARCH_PORTDUINO
-    if (settingsMap[txen_pin] != RADIOLIB_NC) {
-        digitalWrite(settingsMap[txen_pin], txon ? 1 : 0);
+    if (getSetting<txen_pin>() != RADIOLIB_NC) {
+        digitalWrite(getSetting<txen_pin>(), txon ? 1 : 0);
     }
 #endif
 
 #ifdef RF95_RXEN
     digitalWrite(RF95_RXEN, txon ? 0 : 1);
 #elif ARCH_PORTDUINO
-    if (settingsMap[rxen_pin] != RADIOLIB_NC) {
-        digitalWrite(settingsMap[rxen_pin], txon ? 0 : 1);
+    if (getSetting<rxen_pin>() != RADIOLIB_NC) {
+        digitalWrite(getSetting<rxen_pin>(), txon ? 0 : 1);
     }
 #endif
 }
@@ -164,13 +164,13 @@ bool RF95Interface::init()
     digitalWrite(RF95_RXEN, 1);
 #endif
 #if ARCH_PORTDUINO
-    if (settingsMap[txen_pin] != RADIOLIB_NC) {
-        pinMode(settingsMap[txen_pin], OUTPUT);
-        digitalWrite(settingsMap[txen_pin], 0);
+    if (getSetting<txen_pin>() != RADIOLIB_NC) {
+        pinMode(getSetting<txen_pin>(), OUTPUT);
+        digitalWrite(getSetting<txen_pin>(), 0);
     }
-    if (settingsMap[rxen_pin] != RADIOLIB_NC) {
-        pinMode(settingsMap[rxen_pin], OUTPUT);
-        digitalWrite(settingsMap[rxen_pin], 0);
+    if (getSetting<rxen_pin>() != RADIOLIB_NC) {
+        pinMode(getSetting<rxen_pin>(), OUTPUT);
+        digitalWrite(getSetting<rxen_pin>(), 0);
     }
 #endif
     setTransmitEnable(false);
@@ -7,7 +7,9 @@
 #include "airtime.h"
 #include "error.h"
 
+#ifndef MAX_TX_QUEUE
 #define MAX_TX_QUEUE 16 // max number of packets which can be waiting for transmission
+#endif
 
 #define MAX_LORA_PAYLOAD_LEN 255 // max length of 255 per Semtech's datasheets on SX12xx
 #define MESHTASTIC_HEADER_LENGTH 16
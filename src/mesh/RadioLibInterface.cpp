@@ -12,6 +12,7 @@
 #include <pb_encode.h>
 
 #if ARCH_PORTDUINO
+#include "FrameCapture.h"
 #include "PortduinoGlue.h"
 #include "meshUtils.h"
 #endif
@@ -417,7 +418,7 @@ void RadioLibInterface::handleReceiveInterrupt()
 
     int state = iface->readData((uint8_t *)&radioBuffer, length);
 #if ARCH_PORTDUINO
-    if (settingsMap[logoutputlevel] == level_trace) {
+    if (getSetting<logoutputlevel>() == level_trace) {
         printBytes("Raw incoming packet: ", (uint8_t *)&radioBuffer, length);
     }
 #endif
@@ -464,6 +465,10 @@ void RadioLibInterface::handleReceiveInterrupt()
             mp->relay_node = mp->hop_start == 0 ? NO_RELAY_NODE : radioBuffer.header.relay_node;
 
             addReceiveMetadata(mp);
+#if ARCH_PORTDUINO
+            if (frameCapture)
+                frameCapture->write((const uint8_t *)&radioBuffer, length, mp->rx_snr, mp->rx_rssi);
+#endif
 
             mp->which_payload_variant =
                 meshtastic_MeshPacket_encrypted_tag; // Mark that the payload is still encrypted at this point
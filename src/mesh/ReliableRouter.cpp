@@ -29,11 +29,7 @@ ErrorCode ReliableRouter::send(meshtastic_MeshPacket *p)
     /* If we have pending retransmissions, add the airtime of this packet to it, because during that time we cannot receive an
        (implicit) ACK. Otherwise, we might retransmit too early.
      */
-    for (auto i = pending.begin(); i != pending.end(); i++) {
-        if (i->first.id != p->id) {
-            i->second.nextTxMsec += iface->getPacketTime(p);
-        }
-    }
+    pending.delayAll(iface->getPacketTime(p), GlobalPacketId(getFrom(p), p->id));
 
     return isBroadcast(p->to) ? FloodingRouter::send(p) : NextHopRouter::send(p);
 }
@@ -69,9 +65,7 @@ bool ReliableRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
        because while receiving this packet, we could not have received an (implicit) ACK for it.
        If we don't add this, we will likely retransmit too early.
     */
-    for (auto i = pending.begin(); i != pending.end(); i++) {
-        i->second.nextTxMsec += iface->getPacketTime(p);
-    }
+    pending.delayAll(iface->getPacketTime(p));
 
     return isBroadcast(p->to) ? FloodingRouter::shouldFilterReceived(p) : NextHopRouter::shouldFilterReceived(p);
 }
@@ -130,9 +124,9 @@ void ReliableRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtas
         if (ackId || nakId) {
             LOG_DEBUG("Received a %s for 0x%x, stopping retransmissions", ackId ? "ACK" : "NAK", ackId);
             if (ackId) {
-                stopRetransmission(p->to, ackId);
+                stopRetransmission(p->to, ackId, RetransmissionEnd::ACKED);
             } else {
-                stopRetransmission(p->to, nakId);
+                stopRetransmission(p->to, nakId, RetransmissionEnd::NAKED);
             }
         }
     }
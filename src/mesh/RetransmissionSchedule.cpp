@@ -0,0 +1,102 @@
+#include "RetransmissionSchedule.h"
+
+PendingPacket::PendingPacket(meshtastic_MeshPacket *p, uint8_t numRetransmissions)
+{
+    packet = p;
+    this->numRetransmissions = numRetransmissions - 1; // We subtract one, because we assume the user just did the first send
+}
+
+void RetransmissionSchedule::place(size_t i, PendingPacket *p)
+{
+    heap[i] = p;
+    p->heapIndex = i;
+}
+
+void RetransmissionSchedule::siftUp(size_t i)
+{
+    PendingPacket *p = heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!dueBefore(p, heap[parent]))
+            break;
+        place(i, heap[parent]);
+        i = parent;
+    }
+    place(i, p);
+}
+
+void RetransmissionSchedule::siftDown(size_t i)
+{
+    PendingPacket *p = heap[i];
+    size_t n = heap.size();
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && dueBefore(heap[child + 1], heap[child]))
+            child++;
+        if (!dueBefore(heap[child], p))
+            break;
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, p);
+}
+
+PendingPacket *RetransmissionSchedule::find(GlobalPacketId key)
+{
+    auto old = pending.find(key);
+    return old != pending.end() ? &old->second : NULL;
+}
+
+PendingPacket *RetransmissionSchedule::add(GlobalPacketId key, const PendingPacket &rec, uint32_t nextTxMsec)
+{
+    remove(key);
+
+    // Records are never moved by the map, so the heap can point at them
+    PendingPacket *p = &(pending[key] = rec);
+    p->nextTxMsec = nextTxMsec - delay;
+    p->generation = nextGeneration++;
+    heap.push_back(p);
+    siftUp(heap.size() - 1);
+    return p;
+}
+
+bool RetransmissionSchedule::remove(GlobalPacketId key)
+{
+    auto old = pending.find(key);
+    if (old == pending.end())
+        return false;
+
+    size_t i = old->second.heapIndex;
+    PendingPacket *last = heap.back();
+    heap.pop_back();
+    if (i < heap.size()) {
+        place(i, last);
+        siftUp(i);
+        siftDown(last->heapIndex);
+    }
+    pending.erase(old);
+    return true;
+}
+
+void RetransmissionSchedule::reschedule(PendingPacket *p, uint32_t nextTxMsec)
+{
+    p->nextTxMsec = nextTxMsec - delay;
+    siftUp(p->heapIndex);
+    siftDown(p->heapIndex);
+}
+
+void RetransmissionSchedule::delayAll(uint32_t msec)
+{
+    delay += msec;
+}
+
+void RetransmissionSchedule::delayAll(uint32_t msec, GlobalPacketId except)
+{
+    PendingPacket *p = find(except);
+    uint32_t keep = p ? getNextTxMsec(p) : 0;
+    delay += msec;
+    if (p)
+        reschedule(p, keep);
+}
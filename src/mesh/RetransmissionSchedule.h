@@ -0,0 +1,107 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An identifier for a globally unique message - a pair of the sending nodenum and the packet id assigned
+ * to that message
+ */
+struct GlobalPacketId {
+    NodeNum node;
+    PacketId id;
+
+    bool operator==(const GlobalPacketId &p) const { return node == p.node && id == p.id; }
+
+    explicit GlobalPacketId(const meshtastic_MeshPacket *p)
+    {
+        node = getFrom(p);
+        id = p->id;
+    }
+
+    GlobalPacketId(NodeNum _from, PacketId _id)
+    {
+        node = _from;
+        id = _id;
+    }
+};
+
+/**
+ * A packet queued for retransmission
+ */
+struct PendingPacket {
+    meshtastic_MeshPacket *packet;
+
+    /** The next time we should try to retransmit this packet, relative to RetransmissionSchedule's delay, use
+     * RetransmissionSchedule::getNextTxMsec() to read it */
+    uint32_t nextTxMsec = 0;
+
+    /** Starts at NUM_RETRANSMISSIONS -1 and counts down.  Once zero it will be removed from the list */
+    uint8_t numRetransmissions = 0;
+
+    /** Our position in RetransmissionSchedule's heap */
+    uint32_t heapIndex = 0;
+
+    /** Different for every record RetransmissionSchedule::add() makes, a replacement may well reuse the same address */
+    uint32_t generation = 0;
+
+    PendingPacket() {}
+    explicit PendingPacket(meshtastic_MeshPacket *p, uint8_t numRetransmissions);
+};
+
+class GlobalPacketIdHashFunction
+{
+  public:
+    size_t operator()(const GlobalPacketId &p) const { return (std::hash<NodeNum>()(p.node)) ^ (std::hash<PacketId>()(p.id)); }
+};
+
+/**
+ * Pending retransmissions, findable by packet and ordered by when they are due.
+ *
+ * The records live in a map keyed by (from, id), and a binary heap over them keeps the earliest deadline on top, so only due
+ * records need to be looked at and the time until the next one is a peek.  Deadlines are millis() values compared by signed
+ * difference, so they keep working across the 49.7 day rollover.  Pushing every deadline back by the airtime of a packet (see
+ * ReliableRouter) keeps their order, so that is done with a single offset instead of touching every record.
+ */
+class RetransmissionSchedule
+{
+    std::unordered_map<GlobalPacketId, PendingPacket, GlobalPacketIdHashFunction> pending;
+    std::vector<PendingPacket *> heap;
+
+    /// Added to every PendingPacket::nextTxMsec, see delayAll()
+    uint32_t delay = 0;
+
+    /// Given to the next record added
+    uint32_t nextGeneration = 1;
+
+    static bool dueBefore(const PendingPacket *a, const PendingPacket *b) { return (int32_t)(a->nextTxMsec - b->nextTxMsec) < 0; }
+    void place(size_t i, PendingPacket *p);
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+
+  public:
+    /** Return the record for this packet, or NULL if we are not retransmitting it */
+    PendingPacket *find(GlobalPacketId key);
+
+    /** Add (or replace) the record for a packet, due at nextTxMsec */
+    PendingPacket *add(GlobalPacketId key, const PendingPacket &rec, uint32_t nextTxMsec);
+
+    /** Forget a record, return false if there was none */
+    bool remove(GlobalPacketId key);
+
+    /** Set when a record is next due */
+    void reschedule(PendingPacket *p, uint32_t nextTxMsec);
+
+    uint32_t getNextTxMsec(const PendingPacket *p) const { return p->nextTxMsec + delay; }
+
+    /** The record that is due first, or NULL if there are none */
+    PendingPacket *peek() const { return heap.empty() ? NULL : heap[0]; }
+
+    /** Push all deadlines back by msec, except for the record of the given packet (if any) */
+    void delayAll(uint32_t msec);
+    void delayAll(uint32_t msec, GlobalPacketId except);
+
+    size_t size() const { return pending.size(); }
+    bool empty() const { return pending.empty(); }
+};
@@ -20,6 +20,9 @@
 #endif
 #if ENABLE_JSON_LOGGING || ARCH_PORTDUINO
 #include "serialization/MeshPacketSerializer.h"
+
+/// Reused for every packet we trace as JSON
+static std::string jsonTrace;
 #endif
 
 #define MAX_RX_FROMRADIO                                                                                                         \
@@ -31,8 +34,19 @@
     (MAX_RX_TOPHONE + MAX_RX_FROMRADIO + 2 * MAX_TX_QUEUE +                                                                      \
      2) // max number of packets which can be in flight (either queued from reception or queued for sending)
 
-// static MemoryPool<MeshPacket> staticPool(MAX_PACKETS);
+#ifndef MESHTASTIC_PACKET_POOL_HEAP_FALLBACK
+#define MESHTASTIC_PACKET_POOL_HEAP_FALLBACK 1 // if the static pool runs dry, malloc rather than dropping packets
+#endif
+
+#if ARCH_PORTDUINO
+// The slab is sized from config.yaml, so it can only be allocated once Router is constructed (see below)
+static MemoryPool<meshtastic_MeshPacket> staticPool;
+#elif MESHTASTIC_STATIC_PACKET_POOL
+// Preallocate every packet we could ever need, so busy nodes don't fragment the heap over time
+static MemoryPool<meshtastic_MeshPacket> staticPool(MAX_PACKETS, MESHTASTIC_PACKET_POOL_HEAP_FALLBACK);
+#else
 static MemoryDynamic<meshtastic_MeshPacket> staticPool;
+#endif
 
 Allocator<meshtastic_MeshPacket> &packetPool = staticPool;
 
@@ -53,9 +67,14 @@ Router::Router() : concurrency::OSThread("Router"), fromRadioQueue(MAX_RX_FROMRA
 
     fromRadioQueue.setReader(this);
 
-    // init Lockguard for crypt operations
-    assert(!cryptLock);
-    cryptLock = new concurrency::Lock();
+#if ARCH_PORTDUINO
+    if (getSetting<packetPoolPrealloc>() && staticPool.begin(MAX_PACKETS, getSetting<packetPoolAllowHeapFallback>()))
+        LOG_INFO("Preallocated %d packets in packetPool", MAX_PACKETS);
+#endif
+
+    // init Lockguard for crypt operations, shared by every Router (the mesh simulator runs many in one process)
+    if (!cryptLock)
+        cryptLock = new concurrency::Lock();
 }
 
 /**
@@ -388,8 +407,9 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 
     // assert(p->which_payloadVariant == MeshPacket_encrypted_tag);
     if (!decrypted) {
-        // Try to find a channel that works with this hash
-        for (chIndex = 0; chIndex < channels.getNumChannels(); chIndex++) {
+        // Try to find a channel that works with this hash, only channels whose hash matches can possibly decode it
+        for (ChannelMask candidates = channels.getChannelsForHash(p->channel); candidates; candidates &= candidates - 1) {
+            chIndex = __builtin_ctz(candidates);
             // Try to use this hash/channel pair
             if (channels.decryptForHash(chIndex, p->channel)) {
                 // we have to copy into a scratch buffer, because these bytes are a union with the decoded protobuf. Create a
@@ -405,9 +425,12 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
                 memset(&decodedtmp, 0, sizeof(decodedtmp));
                 if (!pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &decodedtmp)) {
                     LOG_ERROR("Invalid protobufs in received mesh packet id=0x%08x (bad psk?)!", p->id);
+                    channels.recordDecode(chIndex, false);
                 } else if (decodedtmp.portnum == meshtastic_PortNum_UNKNOWN_APP) {
                     LOG_ERROR("Invalid portnum (bad psk?)!");
+                    channels.recordDecode(chIndex, false);
                 } else {
+                    channels.recordDecode(chIndex, true);
                     p->decoded = decodedtmp;
                     p->which_payload_variant = meshtastic_MeshPacket_decoded_tag; // change type to decoded
                     decrypted = true;
@@ -444,10 +467,12 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 
         printPacket("decoded message", p);
 #if ENABLE_JSON_LOGGING
-        LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
+        MeshPacketSerializer::JsonSerialize(p, jsonTrace, false);
+        LOG_TRACE("%s", jsonTrace.c_str());
 #elif ARCH_PORTDUINO
-        if (settingsStrings[traceFilename] != "" || settingsMap[logoutputlevel] == level_trace) {
-            LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
+        if (LOG_ENABLED(LOG_SEVERITY_TRACE)) {
+            MeshPacketSerializer::JsonSerialize(p, jsonTrace, false);
+            LOG_TRACE("%s", jsonTrace.c_str());
         }
 #endif
         return DecodeState::DECODE_SUCCESS;
@@ -611,7 +636,16 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     meshtastic_MeshPacket *p_encrypted = packetPool.allocCopy(*p);
 
     // Take those raw bytes and convert them back into a well structured protobuf we can understand
+#ifdef ARCH_PORTDUINO
+    const uint32_t decodeStart = micros();
+#endif
     auto decodedState = perhapsDecode(p);
+#ifdef ARCH_PORTDUINO
+    if (!firstReceived.handled)
+        firstReceived = {true, p->from, p->id, decodedState,
+                         decodedState == DecodeState::DECODE_SUCCESS ? p->decoded.portnum : meshtastic_PortNum_UNKNOWN_APP,
+                         micros() - decodeStart};
+#endif
     if (decodedState == DecodeState::DECODE_FATAL) {
         // Fatal decoding error, we can't do anything with this packet
         LOG_WARN("Fatal decode error, dropping packet");
@@ -682,12 +716,14 @@ void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
 #if ENABLE_JSON_LOGGING
     // Even ignored packets get logged in the trace
     p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
-    LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
+    MeshPacketSerializer::JsonSerializeEncrypted(p, jsonTrace);
+    LOG_TRACE("%s", jsonTrace.c_str());
 #elif ARCH_PORTDUINO
     // Even ignored packets get logged in the trace
-    if (settingsStrings[traceFilename] != "" || settingsMap[logoutputlevel] == level_trace) {
+    if (LOG_ENABLED(LOG_SEVERITY_TRACE)) {
         p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
-        LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
+        MeshPacketSerializer::JsonSerializeEncrypted(p, jsonTrace);
+        LOG_TRACE("%s", jsonTrace.c_str());
     }
 #endif
     // assert(radioConfig.has_preferences);
@@ -9,6 +9,8 @@
 #include "RadioInterface.h"
 #include "concurrency/OSThread.h"
 
+enum DecodeState { DECODE_SUCCESS, DECODE_FAILURE, DECODE_FATAL };
+
 /**
  * A mesh aware router that supports multiple interfaces.
  */
@@ -91,6 +93,21 @@ class Router : protected concurrency::OSThread, protected PacketHistory
         before us */
     uint32_t rxDupe = 0, txRelayCanceled = 0;
 
+#ifdef ARCH_PORTDUINO
+    /// What handleReceived() made of a packet, for meshtasticd --replay
+    struct ReceivedTrace {
+        bool handled; // false until handleReceived() has seen a packet, the rest is only set once it has
+        NodeNum from;
+        PacketId id;
+        DecodeState state;
+        meshtastic_PortNum portnum; // if it was decoded
+        uint32_t decodeUsec;        // time spent in perhapsDecode()
+    };
+
+    /// The first packet handleReceived() sees after this is cleared.  Packets it queues for us while handling it come later.
+    ReceivedTrace firstReceived = {};
+#endif
+
   protected:
     friend class RoutingModule;
 
@@ -140,8 +157,6 @@ class Router : protected concurrency::OSThread, protected PacketHistory
     void abortSendAndNak(meshtastic_Routing_Error err, meshtastic_MeshPacket *p);
 };
 
-enum DecodeState { DECODE_SUCCESS, DECODE_FAILURE, DECODE_FATAL };
-
 /** FIXME - move this into a mesh packet class
  * Remove any encryption and decode the protobufs inside this packet (if necessary).
  *
@@ -11,7 +11,7 @@
 
 // Particular boards might define a different max power based on what their hardware can do
 #if ARCH_PORTDUINO
-#define SX128X_MAX_POWER settingsMap[sx128x_max_power]
+#define SX128X_MAX_POWER getSetting<sx128x_max_power>()
 #endif
 #ifndef SX128X_MAX_POWER
 #define SX128X_MAX_POWER 13
@@ -41,13 +41,13 @@ template <typename T> bool SX128xInterface<T>::init()
 #endif
 
 #if ARCH_PORTDUINO
-    if (settingsMap[rxen_pin] != RADIOLIB_NC) {
-        pinMode(settingsMap[rxen_pin], OUTPUT);
-        digitalWrite(settingsMap[rxen_pin], LOW); // Set low before becoming an output
+    if (getSetting<rxen_pin>() != RADIOLIB_NC) {
+        pinMode(getSetting<rxen_pin>(), OUTPUT);
+        digitalWrite(getSetting<rxen_pin>(), LOW); // Set low before becoming an output
     }
-    if (settingsMap[txen_pin] != RADIOLIB_NC) {
-        pinMode(settingsMap[txen_pin], OUTPUT);
-        digitalWrite(settingsMap[txen_pin], LOW); // Set low before becoming an output
+    if (getSetting<txen_pin>() != RADIOLIB_NC) {
+        pinMode(getSetting<txen_pin>(), OUTPUT);
+        digitalWrite(getSetting<txen_pin>(), LOW); // Set low before becoming an output
     }
 #else
 #if defined(SX128X_RXEN) && (SX128X_RXEN != RADIOLIB_NC) // set not rx or tx mode
@@ -93,8 +93,8 @@ template <typename T> bool SX128xInterface<T>::init()
         lora.setRfSwitchPins(SX128X_RXEN, SX128X_TXEN);
     }
 #elif ARCH_PORTDUINO
-    if (res == RADIOLIB_ERR_NONE && settingsMap[rxen_pin] != RADIOLIB_NC && settingsMap[txen_pin] != RADIOLIB_NC) {
-        lora.setRfSwitchPins(settingsMap[rxen_pin], settingsMap[txen_pin]);
+    if (res == RADIOLIB_ERR_NONE && getSetting<rxen_pin>() != RADIOLIB_NC && getSetting<txen_pin>() != RADIOLIB_NC) {
+        lora.setRfSwitchPins(getSetting<rxen_pin>(), getSetting<txen_pin>());
     }
 #endif
 
@@ -174,11 +174,11 @@ template <typename T> void SX128xInterface<T>::setStandby()
         LOG_ERROR("SX128x standby %s%d", radioLibErr, err);
     assert(err == RADIOLIB_ERR_NONE);
 #if ARCH_PORTDUINO
-    if (settingsMap[rxen_pin] != RADIOLIB_NC) {
-        digitalWrite(settingsMap[rxen_pin], LOW);
+    if (getSetting<rxen_pin>() != RADIOLIB_NC) {
+        digitalWrite(getSetting<rxen_pin>(), LOW);
     }
-    if (settingsMap[txen_pin] != RADIOLIB_NC) {
-        digitalWrite(settingsMap[txen_pin], LOW);
+    if (getSetting<txen_pin>() != RADIOLIB_NC) {
+        digitalWrite(getSetting<txen_pin>(), LOW);
     }
 #else
 #if defined(SX128X_RXEN) && (SX128X_RXEN != RADIOLIB_NC) // we have RXEN/TXEN control - turn off RX and TX power
@@ -210,11 +210,11 @@ template <typename T> void SX128xInterface<T>::addReceiveMetadata(meshtastic_Mes
 template <typename T> void SX128xInterface<T>::configHardwareForSend()
 {
 #if ARCH_PORTDUINO
-    if (settingsMap[txen_pin] != RADIOLIB_NC) {
-        digitalWrite(settingsMap[txen_pin], HIGH);
+    if (getSetting<txen_pin>() != RADIOLIB_NC) {
+        digitalWrite(getSetting<txen_pin>(), HIGH);
     }
-    if (settingsMap[rxen_pin] != RADIOLIB_NC) {
-        digitalWrite(settingsMap[rxen_pin], LOW);
+    if (getSetting<rxen_pin>() != RADIOLIB_NC) {
+        digitalWrite(getSetting<rxen_pin>(), LOW);
     }
 
 #else
@@ -241,11 +241,11 @@ template <typename T> void SX128xInterface<T>::startReceive()
     setStandby();
 
 #if ARCH_PORTDUINO
-    if (settingsMap[rxen_pin] != RADIOLIB_NC) {
-        digitalWrite(settingsMap[rxen_pin], HIGH);
+    if (getSetting<rxen_pin>() != RADIOLIB_NC) {
+        digitalWrite(getSetting<rxen_pin>(), HIGH);
     }
-    if (settingsMap[txen_pin] != RADIOLIB_NC) {
-        digitalWrite(settingsMap[txen_pin], LOW);
+    if (getSetting<txen_pin>() != RADIOLIB_NC) {
+        digitalWrite(getSetting<txen_pin>(), LOW);
     }
 
 #else
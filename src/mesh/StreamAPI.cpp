@@ -47,12 +47,20 @@ int32_t StreamAPI::readStream(char *buf, uint16_t bufLen)
 void StreamAPI::writeStream()
 {
     if (canWrite) {
-        uint32_t len;
-        do {
-            // Send every packet we can
-            len = getFromRadio(txBuf + HEADER_LEN);
+#if STREAM_TX_BATCH_SIZE > 0
+        batching = !buffersOutput();
+#endif
+        // Send every packet we can (or as many as the link can currently take)
+        while (readyForMore()) {
+            uint32_t len = getFromRadio(txBuf + HEADER_LEN);
+            if (!len)
+                break;
             emitTxBuffer(len);
-        } while (len);
+        }
+#if STREAM_TX_BATCH_SIZE > 0
+        batching = false;
+#endif
+        flushTxBatch();
     }
 }
 
@@ -177,11 +185,47 @@ void StreamAPI::emitTxBuffer(size_t len)
         txBuf[3] = len & 0xff;
 
         auto totalLen = len + HEADER_LEN;
+#if STREAM_TX_BATCH_SIZE > 0
+        if (batching) {
+            if (txBatch.size() + totalLen > STREAM_TX_BATCH_SIZE)
+                flushTxBatch();
+            if (txBatch.empty()) {
+                txBatch.reserve(STREAM_TX_BATCH_SIZE);
+                txBatchStartMsec = millis();
+            }
+            txBatch.insert(txBatch.end(), txBuf, txBuf + totalLen);
+
+            // Don't sit on frames for long if producing the rest of the burst is slow
+            if (!Throttle::isWithinTimespanMs(txBatchStartMsec, STREAM_TX_FLUSH_MSEC))
+                flushTxBatch();
+            return;
+        }
+#endif
         stream->write(txBuf, totalLen);
         stream->flush();
     }
 }
 
+void StreamAPI::flushTxBatch()
+{
+#if STREAM_TX_BATCH_SIZE > 0
+    if (!txBatch.empty()) {
+        stream->write(txBatch.data(), txBatch.size());
+        stream->flush();
+        txBatch.clear();
+    }
+#endif
+}
+
+size_t StreamAPI::getTxBatchedBytes() const
+{
+#if STREAM_TX_BATCH_SIZE > 0
+    return txBatch.size();
+#else
+    return 0;
+#endif
+}
+
 void StreamAPI::emitRebooted()
 {
     // In case we send a FromRadio packet
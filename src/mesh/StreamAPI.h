@@ -4,10 +4,31 @@
 #include "Stream.h"
 #include "concurrency/OSThread.h"
 #include <cstdarg>
+#include <vector>
 
 // A To/FromRadio packet + our 32 bit header
 #define MAX_STREAM_BUF_SIZE (MAX_TO_FROM_RADIO_SIZE + sizeof(uint32_t))
 
+/// Bytes of framed FromRadio packets we collect before writing them to the stream in one go (0 writes each frame on its own)
+#ifndef STREAM_TX_BATCH_SIZE
+#if defined(ARCH_PORTDUINO)
+#define STREAM_TX_BATCH_SIZE (16 * 1024)
+#elif defined(ARCH_ESP32)
+#define STREAM_TX_BATCH_SIZE (4 * MAX_STREAM_BUF_SIZE)
+#else
+#define STREAM_TX_BATCH_SIZE 0
+#endif
+#endif
+
+/// Longest we keep collected frames while we are still producing more of them
+#ifndef STREAM_TX_FLUSH_MSEC
+#define STREAM_TX_FLUSH_MSEC 20
+#endif
+
+#if STREAM_TX_BATCH_SIZE > 0 && STREAM_TX_BATCH_SIZE < MAX_STREAM_BUF_SIZE
+#error "STREAM_TX_BATCH_SIZE must hold at least one frame"
+#endif
+
 /**
  * A version of our 'phone' API that talks over a Stream.  So therefore well suited to use with serial links
  * or TCP connections.
@@ -42,6 +63,19 @@ class StreamAPI : public PhoneAPI
     /// time of last rx, used, to slow down our polling if we haven't heard from anyone
     uint32_t lastRxMsec = 0;
 
+#if STREAM_TX_BATCH_SIZE > 0
+    /// Frames collected by writeStream(), so a burst (e.g. the NodeDB during a config download) is a few large writes instead
+    /// of one small write per packet.  Allocated on first use, so streams that buffer their own output don't pay for it.
+    std::vector<uint8_t> txBatch;
+    uint32_t txBatchStartMsec = 0;
+
+    /// Set while writeStream() is running, emitTxBuffer() only collects frames then
+    bool batching = false;
+#endif
+
+    /// Write out whatever frames we have collected
+    void flushTxBatch();
+
   public:
     StreamAPI(Stream *_stream) : stream(_stream) {}
 
@@ -84,6 +118,18 @@ class StreamAPI : public PhoneAPI
     /// Are we allowed to write packets to our output stream (subclasses can turn this off - i.e. SerialConsole)
     bool canWrite = true;
 
+    /**
+     * Subclasses that buffer their output can return false to pause writeStream() until the link catches up (backpressure).
+     * Frames collected but not yet written (getTxBatchedBytes()) are on their way too and should be counted.
+     */
+    virtual bool readyForMore() { return true; }
+
+    /// Streams that collect what is written and send it in bulk themselves return true, so frames go straight to them
+    virtual bool buffersOutput() { return false; }
+
+    /// Bytes of frames collected by writeStream() and not yet written to the stream
+    size_t getTxBatchedBytes() const;
+
     /// Subclasses can use this scratch buffer if they wish
     uint8_t txBuf[MAX_STREAM_BUF_SIZE] = {0};
 
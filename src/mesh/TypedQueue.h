@@ -53,6 +53,9 @@ template <class T> class TypedQueue
 
     bool dequeueFromISR(T *p, BaseType_t *higherPriWoken) { return xQueueReceiveFromISR(h, p, higherPriWoken); }
 
+    /// Get the oldest element without removing it
+    bool peek(T *p) { return xQueuePeek(h, p, 0) == pdTRUE; }
+
     /**
      * Set a thread that is reading from this queue
      * If a message is pushed to this queue that thread will be scheduled to run ASAP.
@@ -119,6 +122,15 @@ template <class T> class TypedQueue
 
     // bool dequeueFromISR(T *p, BaseType_t *higherPriWoken) { return xQueueReceiveFromISR(h, p, higherPriWoken); }
 
+    /// Get the oldest element without removing it
+    bool peek(T *p)
+    {
+        if (isEmpty())
+            return false;
+        *p = q.front();
+        return true;
+    }
+
     void setReader(concurrency::OSThread *t) { reader = t; }
 };
 #endif
\ No newline at end of file
@@ -20,6 +20,7 @@ class PacketAPI : public PhoneAPI, public concurrency::OSThread
     PacketAPI(PacketServer *_server);
     // Check the current underlying physical queue to see if the client is fetching packets
     bool checkIsConnected() override;
+    bool sendsFromRadioScratch() override { return true; }
 
     void onNowHasData(uint32_t fromRadioNum) override {}
     void onConnectionChanged(bool connected) override {}
@@ -0,0 +1,340 @@
+#include "configuration.h"
+
+#ifdef ARCH_PORTDUINO
+#include "PortduinoServerAPI.h"
+#include <Arduino.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+PortduinoServerPort *portduinoApiPort;
+
+void initApiServer(int port)
+{
+    // Start API server on port 4403
+    if (!portduinoApiPort) {
+        portduinoApiPort = new PortduinoServerPort(port);
+        if (portduinoApiPort->init()) {
+            LOG_INFO("API server listen on TCP port %d", port);
+        } else {
+            delete portduinoApiPort;
+            portduinoApiPort = nullptr;
+        }
+    }
+}
+
+void deInitApiServer()
+{
+    if (portduinoApiPort) {
+        delete portduinoApiPort;
+        portduinoApiPort = nullptr;
+    }
+}
+
+size_t SocketOutput::write(const uint8_t *buffer, size_t size)
+{
+    buf.insert(buf.end(), buffer, buffer + size);
+    return size;
+}
+
+bool SocketOutput::send(int fd)
+{
+    while (sent < buf.size()) {
+        ssize_t n = ::send(fd, buf.data() + sent, buf.size() - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n >= 0)
+            sent += n;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        else if (errno != EINTR)
+            return false;
+    }
+
+    // Drop what was sent, but only move the rest down once it is worth it
+    if (sent == buf.size()) {
+        buf.clear();
+        sent = 0;
+    } else if (sent > buf.size() / 2) {
+        buf.erase(buf.begin(), buf.begin() + sent);
+        sent = 0;
+    }
+    return true;
+}
+
+PortduinoServerAPI::PortduinoServerAPI(PortduinoServerPort &_port, int _fd, uint64_t _id)
+    : StreamAPI(&output), port(_port), fd(_fd), id(_id), lastHeardMsec(millis())
+{
+}
+
+PortduinoServerAPI::~PortduinoServerAPI()
+{
+    ::close(fd);
+}
+
+bool PortduinoServerAPI::service()
+{
+    char buf[1024];
+
+    // Bounded, so one chatty client can't starve the main loop.  If there is more, epoll reports the socket again once re-armed
+    for (int reads = 0; reads < 16; reads++) {
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            lastHeardMsec = millis();
+            runOncePart(buf, n);
+            if (!output.send(fd))
+                return false;
+        } else if (n == 0) {
+            return false; // Orderly shutdown by the client
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    // Keep feeding the client (e.g. through a config download) until its socket is full or we have nothing left for it
+    for (int passes = 0; passes < 16; passes++) {
+        runOncePart(buf, 0);
+        if (!output.send(fd))
+            return false;
+        if (output.queued() > 0 || !available())
+            return true; // Either EPOLLOUT or new data will bring us back
+    }
+
+    // Used up our passes with more to send, come back on the next loop
+    port.hasDataFor(this);
+    return true;
+}
+
+void PortduinoServerAPI::onNowHasData(uint32_t fromRadioNum)
+{
+    port.hasDataFor(this);
+}
+
+uint32_t PortduinoServerAPI::msecUntilIdle(uint32_t now) const
+{
+    uint32_t silent = now - lastHeardMsec;
+    return silent >= API_CLIENT_IDLE_TIMEOUT_MSEC ? 0 : API_CLIENT_IDLE_TIMEOUT_MSEC - silent;
+}
+
+bool PortduinoServerAPI::readyForMore()
+{
+    const size_t queued = output.queued() + getTxBatchedBytes();
+    bool full = queued >= MAX_API_CLIENT_QUEUE;
+    if (full != backlogged) {
+        backlogged = full;
+        if (full)
+            LOG_DEBUG("API client %u not keeping up, hold packets with %u bytes queued", (uint32_t)id, (unsigned)queued);
+    }
+    return !full;
+}
+
+PortduinoServerPort::PortduinoServerPort(int port) : concurrency::OSThread("ApiServer"), portNum(port) {}
+
+PortduinoServerPort::~PortduinoServerPort()
+{
+    if (watcher.joinable()) {
+        uint64_t one = 1;
+        if (::write(wakeFd, &one, sizeof(one)) != sizeof(one))
+            LOG_WARN("Could not stop API watcher thread: %s", strerror(errno));
+        else
+            watcher.join();
+    }
+    while (!clients.empty())
+        closeClient(clients.begin()->second);
+
+    for (int fd : {listenFd, epollFd, wakeFd})
+        if (fd >= 0)
+            ::close(fd);
+}
+
+bool PortduinoServerPort::init()
+{
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listenFd < 0 || epollFd < 0 || wakeFd < 0) {
+        LOG_ERROR("Could not create API server sockets: %s", strerror(errno));
+        return false;
+    }
+
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(portNum);
+    if (bind(listenFd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd, MAX_API_CLIENTS) != 0) {
+        LOG_ERROR("Could not listen on TCP port %d: %s", portNum, strerror(errno));
+        return false;
+    }
+
+    arm(wakeFd, WAKE_ID, EPOLLIN, true);
+    arm(listenFd, LISTEN_ID, EPOLLIN, true);
+    watcher = std::thread([this] { watch(); });
+    return true;
+}
+
+/**
+ * The watcher thread: wait for sockets to become ready, note which and wake the main loop.  Nothing else happens here.
+ */
+void PortduinoServerPort::watch()
+{
+    epoll_event events[16];
+    while (true) {
+        int n = epoll_wait(epollFd, events, 16, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(readyLock);
+            for (int i = 0; i < n; i++) {
+                if (events[i].data.u64 == WAKE_ID)
+                    return;
+                ready.push_back(events[i].data.u64);
+            }
+            setInterval(0); // Run ASAP, under the lock so runOnce() can't put us back to sleep after this
+        }
+        concurrency::mainDelay.interrupt();
+    }
+}
+
+void PortduinoServerPort::arm(int fd, uint64_t id, uint32_t events, bool add)
+{
+    epoll_event ev = {};
+    ev.events = events | EPOLLONESHOT;
+    ev.data.u64 = id;
+    if (epoll_ctl(epollFd, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) != 0)
+        LOG_WARN("Could not watch API socket %d: %s", fd, strerror(errno));
+}
+
+void PortduinoServerPort::acceptClients()
+{
+    while (true) {
+        sockaddr_in addr = {};
+        socklen_t addrLen = sizeof(addr);
+        int fd = accept4(listenFd, (sockaddr *)&addr, &addrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                LOG_WARN("API accept failed: %s", strerror(errno));
+            return;
+        }
+
+        char host[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &addr.sin_addr, host, sizeof(host));
+        if (clients.size() >= MAX_API_CLIENTS) {
+            LOG_WARN("Refuse API connection from %s, already serving %u clients", host, (unsigned)clients.size());
+            ::close(fd);
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto client = new PortduinoServerAPI(*this, fd, nextId++);
+        clients[client->getId()] = client;
+        arm(fd, client->getId(), EPOLLIN | EPOLLRDHUP, true);
+        LOG_INFO("Incoming API connection from %s, %u clients", host, (unsigned)clients.size());
+    }
+}
+
+void PortduinoServerPort::closeClient(PortduinoServerAPI *client)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, client->getFd(), NULL);
+    clients.erase(client->getId());
+    delete client;
+    LOG_INFO("API client disconnected, %u clients", (unsigned)clients.size());
+}
+
+void PortduinoServerPort::hasDataFor(PortduinoServerAPI *client)
+{
+    dirty.push_back(client->getId());
+    setIntervalFromNow(0);
+}
+
+int32_t PortduinoServerPort::runOnce()
+{
+    work.clear();
+    {
+        std::lock_guard<std::mutex> guard(readyLock);
+        work.swap(ready);
+    }
+    work.insert(work.end(), dirty.begin(), dirty.end());
+    dirty.clear();
+    std::sort(work.begin(), work.end());
+    work.erase(std::unique(work.begin(), work.end()), work.end());
+
+    for (uint64_t id : work) {
+        if (id == LISTEN_ID) {
+            acceptClients();
+            arm(listenFd, LISTEN_ID, EPOLLIN);
+            continue;
+        }
+
+        auto it = clients.find(id);
+        if (it == clients.end())
+            continue; // Already closed
+        PortduinoServerAPI *client = it->second;
+        if (client->service())
+            arm(client->getFd(), id, EPOLLIN | EPOLLRDHUP | (client->getQueuedBytes() ? (uint32_t)EPOLLOUT : 0));
+        else
+            closeClient(client);
+    }
+
+    uint32_t untilIdle = closeIdleClients();
+
+    // Nothing to do until a socket is ready, a client has new data or times out.  Decided under readyLock: either the watcher
+    // queued a socket before we look, or its setInterval(0) lands after ours.
+    std::lock_guard<std::mutex> guard(readyLock);
+    if (!ready.empty() || !dirty.empty())
+        return 0;
+    setInterval(std::min<uint32_t>(untilIdle, INT32_MAX));
+    return RUN_SAME;
+}
+
+uint32_t PortduinoServerPort::closeIdleClients()
+{
+    uint32_t now = millis();
+    uint32_t next = UINT32_MAX;
+    for (auto it = clients.begin(); it != clients.end();) {
+        PortduinoServerAPI *client = (it++)->second;
+        uint32_t left = client->msecUntilIdle(now);
+        if (left == 0) {
+            LOG_INFO("API client %u silent for %u s, disconnect", (uint32_t)client->getId(), API_CLIENT_IDLE_TIMEOUT_MSEC / 1000);
+            closeClient(client);
+        } else {
+            next = std::min(next, left);
+        }
+    }
+    return next;
+}
+
+std::vector<size_t> PortduinoServerPort::getQueueDepths() const
+{
+    std::vector<size_t> depths;
+    for (auto &c : clients)
+        depths.push_back(c.second->getQueuedBytes());
+    return depths;
+}
+
+void PortduinoServerPort::logStats() const
+{
+    LOG_INFO("API server: %u clients", (unsigned)clients.size());
+    for (auto &c : clients)
+        LOG_INFO("  client %u: %u bytes queued, %u packets dropped", (uint32_t)c.first, (unsigned)c.second->getQueuedBytes(),
+                 c.second->getPacketsDropped());
+}
+
+#endif
@@ -0,0 +1,174 @@
+#pragma once
+
+#ifdef ARCH_PORTDUINO
+
+#include "StreamAPI.h"
+#include "concurrency/OSThread.h"
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// Max number of API clients connected at once, further connections are refused
+#ifndef MAX_API_CLIENTS
+#define MAX_API_CLIENTS 8
+#endif
+
+/// Bytes we will queue towards one client before we stop feeding it FromRadio packets until it catches up
+#ifndef MAX_API_CLIENT_QUEUE
+#define MAX_API_CLIENT_QUEUE (16 * 1024)
+#endif
+
+/// Clients we haven't heard from in this long are disconnected, so a peer that vanished without closing doesn't stay registered
+#ifndef API_CLIENT_IDLE_TIMEOUT_MSEC
+#define API_CLIENT_IDLE_TIMEOUT_MSEC (15 * 60 * 1000)
+#endif
+
+class PortduinoServerPort;
+
+/**
+ * The outgoing side of a client socket: StreamAPI writes framed packets into a buffer, which is sent whenever the socket can
+ * take it.  Reads are done directly on the socket, so this stream never has input.
+ */
+class SocketOutput : public Stream
+{
+    std::vector<uint8_t> buf;
+    size_t sent = 0;
+
+  public:
+    /// Bytes written but not yet accepted by the socket
+    size_t queued() const { return buf.size() - sent; }
+
+    /// Send as much as the socket takes without blocking, return false if the connection failed
+    bool send(int fd);
+
+    virtual int available() override { return 0; }
+    virtual int read() override { return -1; }
+    virtual int peek() override { return -1; }
+    virtual size_t write(uint8_t c) override { return write(&c, 1); }
+    virtual size_t write(const uint8_t *buffer, size_t size) override;
+    virtual void flush() override {}
+};
+
+/**
+ * One TCP API client.  Unlike ServerAPI this is not an OSThread polling its socket, PortduinoServerPort services it when the
+ * socket is ready or when the mesh has new data for it.
+ */
+class PortduinoServerAPI : public StreamAPI
+{
+    PortduinoServerPort &port;
+    SocketOutput output;
+    int fd;
+    uint64_t id;
+
+    /// Set while we are holding back packets because the client doesn't read fast enough, so we only log it once
+    bool backlogged = false;
+
+    /// When the client last sent us anything
+    uint32_t lastHeardMsec;
+
+  public:
+    PortduinoServerAPI(PortduinoServerPort &port, int fd, uint64_t id);
+
+    virtual ~PortduinoServerAPI();
+
+    /**
+     * Handle whatever the client sent and send it whatever we have, as far as the socket allows
+     *
+     * @return false if the client is gone
+     */
+    bool service();
+
+    int getFd() const { return fd; }
+    uint64_t getId() const { return id; }
+
+    /// Bytes queued towards this client
+    size_t getQueuedBytes() const { return output.queued(); }
+
+    /// Msecs until this client counts as gone if it stays silent, 0 if it already does
+    uint32_t msecUntilIdle(uint32_t now) const;
+
+  protected:
+    /// Like ServerAPI, network clients don't change the power state
+    virtual void onConnectionChanged(bool connected) override {}
+
+    /// Closed connections are noticed (and the client deleted) by service()
+    virtual bool checkIsConnected() override { return true; }
+
+    virtual void onNowHasData(uint32_t fromRadioNum) override;
+
+    virtual bool readyForMore() override;
+
+    /// SocketOutput already collects everything for one send(), batching in StreamAPI would only copy it twice
+    virtual bool buffersOutput() override { return true; }
+};
+
+/**
+ * Listens for API connections and serves any number of them (up to MAX_API_CLIENTS) from the main loop.
+ *
+ * A watcher thread blocks in epoll_wait() on the listening socket and every client socket, and only wakes the main loop when
+ * one of them is ready.  All sockets are registered EPOLLONESHOT, so a socket is reported once and then re-armed by the main
+ * loop after it has been serviced; the watcher thread never touches the clients themselves.  Clients are identified to the
+ * watcher by an id that is never reused, so a late report for a closed client is simply ignored.
+ *
+ * The watcher wakes us and runOnce() decides to sleep both under readyLock, so a socket reported while we run is never missed.
+ */
+class PortduinoServerPort : private concurrency::OSThread
+{
+    int portNum;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1; // written to stop the watcher thread
+    std::thread watcher;
+
+    /// Ids of sockets the watcher saw ready, guarded by readyLock
+    std::vector<uint64_t> ready;
+    std::mutex readyLock;
+
+    /// Clients that have new data to send, main loop only
+    std::vector<uint64_t> dirty;
+
+    /// Scratch list of clients to service in runOnce()
+    std::vector<uint64_t> work;
+
+    std::unordered_map<uint64_t, PortduinoServerAPI *> clients;
+
+    static constexpr uint64_t LISTEN_ID = 0;
+    static constexpr uint64_t WAKE_ID = 1;
+    uint64_t nextId = WAKE_ID + 1;
+
+    void watch();
+    void arm(int fd, uint64_t id, uint32_t events, bool add = false);
+    void acceptClients();
+    void closeClient(PortduinoServerAPI *client);
+
+    /// Disconnect silent clients, return msecs until the next one could time out
+    uint32_t closeIdleClients();
+
+  public:
+    explicit PortduinoServerPort(int port);
+
+    virtual ~PortduinoServerPort();
+
+    /// Start listening, return false if the port could not be opened
+    bool init();
+
+    /// Service this client from the main loop soon
+    void hasDataFor(PortduinoServerAPI *client);
+
+    size_t getNumClients() const { return clients.size(); }
+
+    /// Bytes queued towards each connected client
+    std::vector<size_t> getQueueDepths() const;
+
+    /// Print the number of clients, their queue depths and how many mesh packets each missed to the log
+    void logStats() const;
+
+  protected:
+    int32_t runOnce() override;
+};
+
+/// The API server, if it is running
+extern PortduinoServerPort *portduinoApiPort;
+
+#endif
@@ -4,6 +4,7 @@
 #if HAS_WIFI
 #include "WiFiServerAPI.h"
 
+#ifndef ARCH_PORTDUINO // Portduino serves any number of clients, see PortduinoServerAPI
 static WiFiServerPort *apiPort;
 
 void initApiServer(int port)
@@ -22,6 +23,7 @@ void deInitApiServer()
         apiPort = nullptr;
     }
 }
+#endif
 
 WiFiServerAPI::WiFiServerAPI(WiFiClient &_client) : ServerAPI(_client)
 {
@@ -3,6 +3,7 @@
 #include "PowerFSM.h"
 #include "RadioLibInterface.h"
 #include "airtime.h"
+#include "concurrency/OSThread.h"
 #include "main.h"
 #include "mesh/http/ContentHelper.h"
 #include "mesh/http/WebServer.h"
@@ -677,6 +678,22 @@ void handleReport(HTTPRequest *req, HTTPResponse *res)
     jsonObjRadio["frequency"] = new JSONValue(RadioLibInterface::instance->getFreq());
     jsonObjRadio["lora_channel"] = new JSONValue((int)RadioLibInterface::instance->getChannelNum() + 1);
 
+    // data->threads
+    JSONArray threadValues;
+    for (size_t i = 0; i < concurrency::threadProfiler.size(); i++) {
+        const concurrency::ThreadProfile &p = concurrency::threadProfiler.get(i);
+        if (!p.thread)
+            continue;
+        JSONObject jsonObjThread;
+        jsonObjThread["name"] = new JSONValue(p.thread->ThreadName.c_str());
+        jsonObjThread["runs"] = new JSONValue((unsigned int)p.runs);
+        jsonObjThread["cpu_ms"] = new JSONValue((unsigned int)(p.totalUsec / 1000));
+        jsonObjThread["max_run_us"] = new JSONValue((unsigned int)p.maxUsec);
+        jsonObjThread["avg_late_ms"] = new JSONValue((unsigned int)(p.runs ? p.totalLateMsec / p.runs : 0));
+        jsonObjThread["max_late_ms"] = new JSONValue((unsigned int)p.maxLateMsec);
+        threadValues.push_back(new JSONValue(jsonObjThread));
+    }
+
     // collect data to inner data object
     JSONObject jsonObjInner;
     jsonObjInner["airtime"] = new JSONValue(jsonObjAirtime);
@@ -685,6 +702,7 @@ void handleReport(HTTPRequest *req, HTTPResponse *res)
     jsonObjInner["power"] = new JSONValue(jsonObjPower);
     jsonObjInner["device"] = new JSONValue(jsonObjDevice);
     jsonObjInner["radio"] = new JSONValue(jsonObjRadio);
+    jsonObjInner["threads"] = new JSONValue(threadValues);
 
     // create json output structure
     JSONObject jsonObjOuter;
@@ -60,6 +60,8 @@ char *strnstr(const char *s, const char *find, size_t slen)
 
 void printBytes(const char *label, const uint8_t *p, size_t numbytes)
 {
+    if (!LOG_ENABLED(LOG_SEVERITY_DEBUG))
+        return;
     int labelSize = strlen(label);
     char *messageBuffer = new char[labelSize + (numbytes * 3) + 2];
     strncpy(messageBuffer, label, labelSize);
@@ -29,11 +29,13 @@
 #include "serialization/MeshPacketSerializer.h"
 #endif
 #include <Throttle.h>
+#include <algorithm>
 #include <assert.h>
 #include <utility>
 
 #include <IPAddress.h>
 #if defined(ARCH_PORTDUINO)
+#include "platform/portduino/PortduinoGlue.h"
 #include <netinet/in.h>
 #elif !defined(ntohl)
 #include <machine/endian.h>
@@ -421,6 +423,17 @@ MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
             pubSub.setCallback(mqttCallback);
 #endif
 
+#ifdef ARCH_PORTDUINO
+        if (getSettingString<mqttSpool_directory>() != "") {
+            spool.reset(
+                new MQTTSpool(getSettingString<mqttSpool_directory>(), (size_t)getSetting<mqttSpool_maxSize>() * 1024 * 1024));
+            if (!spool->open()) {
+                LOG_ERROR("MQTT spool unusable, queue in memory instead");
+                spool.reset();
+            }
+        }
+#endif
+
         if (moduleConfig.mqtt.proxy_to_client_enabled) {
             LOG_INFO("MQTT configured to use client proxy");
             enabled = true;
@@ -568,6 +581,10 @@ int32_t MQTT::runOnce()
     bool wantConnection = wantsLink();
 
     perhapsReportToMap();
+#ifdef ARCH_PORTDUINO
+    if (spool)
+        spool->maybeSync();
+#endif
 
     // If connected poll rapidly, otherwise only occasionally check for a wifi connection change and ability to contact server
     if (moduleConfig.mqtt.proxy_to_client_enabled) {
@@ -577,22 +594,25 @@ int32_t MQTT::runOnce()
 #if HAS_NETWORKING
     else if (!pubSub.loop()) {
         if (!wantConnection)
-            return 5000; // If we don't want connection now, check again in 5 secs
+            return untilSpoolSync(5000); // If we don't want connection now, check again in 5 secs
         else {
             reconnect();
-            // If we succeeded, empty the queue one by one and start reading rapidly, else try again in 30 seconds (TCP
+            // If we succeeded, start emptying the queue and reading rapidly, else try again in 30 seconds (TCP
             // connections are EXPENSIVE so try rarely)
             if (isConnectedDirectly()) {
                 publishQueuedMessages();
                 return 200;
             } else
-                return 30000;
+                return untilSpoolSync(30000);
         }
     } else {
         // we are connected to server, check often for new requests on the TCP port
         if (!wantConnection) {
             LOG_INFO("MQTT link not needed, drop");
             pubSub.disconnect();
+        } else {
+            // Keep draining whatever is left from while we were offline, a burst per run
+            publishQueuedMessages();
         }
 
         powerFSM.trigger(EVENT_CONTACT_FROM_PHONE); // Suppress entering light sleep (because that would turn off bluetooth)
@@ -600,7 +620,7 @@ int32_t MQTT::runOnce()
     }
 #else
     // No networking available, return default interval
-    return 30000;
+    return untilSpoolSync(30000);
 #endif
 }
 
@@ -665,39 +685,136 @@ void MQTT::publishNodeInfo()
 }
 void MQTT::publishQueuedMessages()
 {
+#ifdef ARCH_PORTDUINO
+    if (spool) {
+        publishSpooledMessages();
+        return;
+    }
+#endif
     if (mqttQueue.isEmpty())
         return;
 
-    LOG_DEBUG("Publish enqueued MQTT message");
-    const std::unique_ptr<QueueEntry> entry(mqttQueue.dequeuePtr(0));
-    LOG_INFO("publish %s, %u bytes from queue", entry->topic.c_str(), entry->envBytes.size());
-    publish(entry->topic.c_str(), entry->envBytes.data(), entry->envBytes.size(), false);
+    const uint32_t start = millis();
+    size_t bytesPublished = 0;
+    uint32_t numPublished = 0;
+    // Always publish at least one message, then keep going while this burst is within its budget
+    while (QueueEntry *next = mqttQueue.peekPtr()) {
+        if (numPublished > 0 && (bytesPublished + next->envBytes.size() + next->json.size() > MQTT_QUEUE_DRAIN_BYTES ||
+                                 millis() - start >= MQTT_QUEUE_DRAIN_MSEC))
+            break;
+        if (!publish(next->topic.c_str(), next->envBytes.data(), next->envBytes.size(), false)) {
+            // Leave it at the head of the queue, we'll try again on the next run
+            LOG_WARN("Publish %s from queue failed, %u messages left", next->topic.c_str(), mqttQueue.numUsed());
+            queueFailed++;
+            break;
+        }
+        const std::unique_ptr<QueueEntry> entry(mqttQueue.dequeuePtr(0));
+        bytesPublished += entry->envBytes.size();
+        numPublished++;
+        queuePublished++;
 
 #if !defined(ARCH_NRF52) ||                                                                                                      \
     defined(NRF52_USE_JSON) // JSON is not supported on nRF52, see issue #2804 ### Fixed by using ArduinoJson ###
-    if (!moduleConfig.mqtt.json_enabled)
-        return;
+        // handle json topic
+        if (moduleConfig.mqtt.json_enabled && !entry->json.empty()) {
+            LOG_DEBUG("JSON publish message to %s, %u bytes from queue", entry->topicJson.c_str(),
+                      (unsigned)entry->json.size());
+            publish(entry->topicJson.c_str(), entry->json.c_str(), false);
+            bytesPublished += entry->json.size();
+        }
+#endif // ARCH_NRF52 NRF52_USE_JSON
+    }
+    LOG_INFO("Published %u messages, %u bytes from queue in %u ms, %u left", numPublished, (unsigned)bytesPublished,
+             millis() - start, mqttQueue.numUsed());
+}
 
-    // handle json topic
-    const DecodedServiceEnvelope env(entry->envBytes.data(), entry->envBytes.size());
-    if (!env.validDecode || env.packet == NULL || env.channel_id == NULL)
+#ifdef ARCH_PORTDUINO
+void MQTT::publishSpooledMessages()
+{
+    if (spool->getCount() == 0)
         return;
 
-    auto jsonString = MeshPacketSerializer::JsonSerialize(env.packet);
-    if (jsonString.length() == 0)
-        return;
+    const uint32_t start = millis();
+    size_t bytesPublished = 0;
+    uint32_t numPublished = 0;
+    MQTTSpool::Message m;
+    // Always publish at least one message, then keep going while this burst is within its budget
+    while (spool->peek(m)) {
+        if (numPublished > 0 && (bytesPublished + m.envBytes.size() + m.json.size() > MQTT_QUEUE_DRAIN_BYTES ||
+                                 millis() - start >= MQTT_QUEUE_DRAIN_MSEC))
+            break;
+        if (!publish(m.topic.c_str(), m.envBytes.data(), m.envBytes.size(), false)) {
+            // Leave it in the spool, we'll try again on the next run
+            LOG_WARN("Publish %s from spool failed, %u messages left", m.topic.c_str(), spool->getCount());
+            queueFailed++;
+            break;
+        }
+        spool->pop();
+        bytesPublished += m.envBytes.size();
+        numPublished++;
+        queuePublished++;
+
+        if (moduleConfig.mqtt.json_enabled && !m.json.empty()) {
+            publish(m.topicJson.c_str(), m.json.c_str(), false);
+            bytesPublished += m.json.size();
+        }
+    }
+    LOG_INFO("Published %u messages, %u bytes from spool in %u ms, %u left", numPublished, (unsigned)bytesPublished,
+             millis() - start, spool->getCount());
+}
+#endif
 
-    std::string topicJson;
-    if (env.packet->pki_encrypted) {
-        topicJson = jsonTopic + "PKI/" + owner.id;
-    } else {
-        topicJson = jsonTopic + env.channel_id + "/" + owner.id;
+int32_t MQTT::untilSpoolSync(int32_t msec) const
+{
+#ifdef ARCH_PORTDUINO
+    if (spool)
+        return std::min(msec, spool->msecUntilSync());
+#endif
+    return msec;
+}
+
+void MQTT::queueJson(const meshtastic_MeshPacket &mp_decoded, const char *channelId, std::string &topicJson, std::string &json)
+{
+    topicJson.clear();
+    json.clear();
+#if !defined(ARCH_NRF52) ||                                                                                                      \
+    defined(NRF52_USE_JSON) // JSON is not supported on nRF52, see issue #2804 ### Fixed by using ArduinoJson ###
+    // Render the JSON now, while we still have the decoded packet, so draining the queue needn't decode the envelope again
+    if (moduleConfig.mqtt.json_enabled) {
+        MeshPacketSerializer::JsonSerialize(&mp_decoded, json);
+        if (!json.empty())
+            topicJson = jsonTopic + channelId + "/" + owner.id;
     }
-    LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonString.length(), jsonString.c_str());
-    publish(topicJson.c_str(), jsonString.c_str(), false);
 #endif // ARCH_NRF52 NRF52_USE_JSON
 }
 
+MQTT::QueueStats MQTT::getQueueStats()
+{
+#ifdef ARCH_PORTDUINO
+    if (spool) {
+        const uint32_t oldest = spool->getOldestSpooledAt();
+        return QueueStats{.depth = spool->getCount(),
+                          .oldestAgeMsec = oldest ? (uint32_t)(time(nullptr) - oldest) * 1000 : 0,
+                          .published = queuePublished,
+                          .dropped = spool->getDropped(),
+                          .failed = queueFailed};
+    }
+#endif
+    const QueueEntry *oldest = mqttQueue.peekPtr();
+    return QueueStats{.depth = (uint32_t)mqttQueue.numUsed(),
+                      .oldestAgeMsec = oldest ? millis() - oldest->queuedAt : 0,
+                      .published = queuePublished,
+                      .dropped = queueDropped,
+                      .failed = queueFailed};
+}
+
+void MQTT::logStats()
+{
+    const QueueStats stats = getQueueStats();
+    LOG_INFO("MQTT queue: %u messages, oldest %u ms, %u published, %u dropped, %u failed", stats.depth, stats.oldestAgeMsec,
+             stats.published, stats.dropped, stats.failed);
+}
+
 void MQTT::onSend(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_MeshPacket &mp_decoded, ChannelIndex chIndex)
 {
     if (mp_encrypted.via_mqtt)
@@ -763,24 +880,40 @@ void MQTT::onSend(const meshtastic_MeshPacket &mp_encrypted, const meshtastic_Me
         if (!moduleConfig.mqtt.json_enabled)
             return;
         // handle json topic
-        auto jsonString = MeshPacketSerializer::JsonSerialize(&mp_decoded);
-        if (jsonString.length() == 0)
+        MeshPacketSerializer::JsonSerialize(&mp_decoded, jsonBuffer);
+        if (jsonBuffer.length() == 0)
             return;
         std::string topicJson = jsonTopic + channelId + "/" + owner.id;
-        LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonString.length(), jsonString.c_str());
-        publish(topicJson.c_str(), jsonString.c_str(), false);
+        LOG_INFO("JSON publish message to %s, %u bytes: %s", topicJson.c_str(), jsonBuffer.length(), jsonBuffer.c_str());
+        publish(topicJson.c_str(), jsonBuffer.c_str(), false);
 #endif // ARCH_NRF52 NRF52_USE_JSON
     } else {
+#ifdef ARCH_PORTDUINO
+        if (spool) {
+            LOG_INFO("MQTT not connected, spool packet");
+            std::string topicJson;
+            queueJson(mp_decoded, channelId, topicJson, jsonBuffer);
+            if (!spool->append(topic, bytes, numBytes, topicJson, jsonBuffer))
+                LOG_ERROR("Failed to add a message to the MQTT spool!");
+            // We may be sleeping between reconnect attempts, come back in time to sync it
+            if ((int32_t)interval > spool->msecUntilSync())
+                setIntervalFromNow(spool->msecUntilSync());
+            return;
+        }
+#endif
         LOG_INFO("MQTT not connected, queue packet");
         QueueEntry *entry;
         if (mqttQueue.numFree() == 0) {
             LOG_WARN("MQTT queue is full, discard oldest");
             entry = mqttQueue.dequeuePtr(0);
+            queueDropped++;
         } else {
             entry = new QueueEntry;
         }
         entry->topic = std::move(topic);
         entry->envBytes.assign(bytes, numBytes);
+        entry->queuedAt = millis();
+        queueJson(mp_decoded, channelId, entry->topicJson, entry->json);
         if (mqttQueue.enqueue(entry, 0) == false) {
             LOG_CRIT("Failed to add a message to mqttQueue!");
             abort();
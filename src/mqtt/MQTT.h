@@ -23,8 +23,32 @@
 #include <PubSubClient.h>
 #include <memory>
 #endif
+#ifdef ARCH_PORTDUINO
+#include "MQTTSpool.h"
+#endif
 
+/// Messages to keep while the server can't be reached, the oldest are discarded beyond that
+#ifndef MAX_MQTT_QUEUE
+#ifdef ARCH_PORTDUINO
+#define MAX_MQTT_QUEUE 256
+#else
 #define MAX_MQTT_QUEUE 16
+#endif
+#endif
+
+/// Most bytes to publish from the queue per run of the MQTT thread (at least one message is always published)
+#ifndef MQTT_QUEUE_DRAIN_BYTES
+#ifdef ARCH_PORTDUINO
+#define MQTT_QUEUE_DRAIN_BYTES 65536
+#else
+#define MQTT_QUEUE_DRAIN_BYTES 8192
+#endif
+#endif
+
+/// Most time to spend publishing from the queue per run of the MQTT thread
+#ifndef MQTT_QUEUE_DRAIN_MSEC
+#define MQTT_QUEUE_DRAIN_MSEC 50
+#endif
 
 /**
  * Our wrapper/singleton for sending/receiving MQTT "udp" packets.  This object isolates the MQTT protocol implementation from
@@ -64,12 +88,33 @@ class MQTT : private concurrency::OSThread
     /// Validate the meshtastic_ModuleConfig_MQTTConfig.
     static bool isValidConfig(const meshtastic_ModuleConfig_MQTTConfig &config) { return isValidConfig(config, nullptr); }
 
+    struct QueueStats {
+        uint32_t depth;         // messages waiting for the server
+        uint32_t oldestAgeMsec; // how long the oldest of them has been waiting
+        uint32_t published;     // messages published from the queue
+        uint32_t dropped;       // messages discarded because the queue was full
+        uint32_t failed;        // messages from the queue the server (or client proxy) would not take
+    };
+
+    /// How the queue of messages for when we are offline is doing
+    QueueStats getQueueStats();
+
+    void logStats();
+
   protected:
     struct QueueEntry {
         std::string topic;
         std::basic_string<uint8_t> envBytes; // binary/pb_encode_to_bytes ServiceEnvelope
+        std::string topicJson;               // empty if there is no JSON to publish
+        std::string json;                    // rendered when queued, so draining needn't decode envBytes again
+        uint32_t queuedAt;                   // millis() when queued
     };
     PointerQueue<QueueEntry> mqttQueue;
+    uint32_t queuePublished = 0, queueDropped = 0, queueFailed = 0;
+#ifdef ARCH_PORTDUINO
+    /// Used instead of mqttQueue when meshtasticd is configured with a MQTT SpoolDirectory
+    std::unique_ptr<MQTTSpool> spool;
+#endif
 
     int reconnectCount = 0;
     bool isConfiguredForDefaultServer = true;
@@ -105,6 +150,8 @@ class MQTT : private concurrency::OSThread
     std::string jsonTopic = "/2/json/"; // msh/2/json/CHANNELID/NODEID
     std::string mapTopic = "/2/map/";   // For protobuf-encoded MapReport messages
 
+    std::string jsonBuffer; // Reused for every JSON message, so serializing one needn't allocate
+
     // For map reporting (only applies when enabled)
     const uint32_t default_map_position_precision = 14; // defaults to max. offset of ~1459m
     uint32_t last_report_to_map = 0;
@@ -127,8 +174,20 @@ class MQTT : private concurrency::OSThread
     /// Called when a new publish arrives from the MQTT server
     void onReceive(char *topic, byte *payload, size_t length);
 
+    /// Publish a burst of queued messages, within MQTT_QUEUE_DRAIN_BYTES and MQTT_QUEUE_DRAIN_MSEC
     void publishQueuedMessages();
 
+#ifdef ARCH_PORTDUINO
+    /// Same as publishQueuedMessages(), from the spool
+    void publishSpooledMessages();
+#endif
+
+    /// msec, or less if that would leave spooled messages unsynced for longer than MQTT_SPOOL_SYNC_MSEC
+    int32_t untilSpoolSync(int32_t msec) const;
+
+    /// Render the JSON to publish for a packet we are queueing, leaving both strings empty if there is none
+    void queueJson(const meshtastic_MeshPacket &mp_decoded, const char *channelId, std::string &topicJson, std::string &json);
+
     void publishNodeInfo();
 
     // Check if we should report unencrypted information about our node for consumption by a map
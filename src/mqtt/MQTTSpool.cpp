@@ -0,0 +1,447 @@
+#include "configuration.h"
+
+#ifdef ARCH_PORTDUINO
+#include "MQTTSpool.h"
+#include <Arduino.h>
+#include <ErriezCRC32.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <time.h>
+#include <unistd.h>
+
+/// Length and CRC32 in front of each record
+static constexpr size_t RECORD_HEADER = 4 + 4;
+/// Far bigger than any message we spool, so a damaged length isn't believed
+static constexpr uint32_t MAX_RECORD = 256 * 1024;
+static constexpr const char *cursorFileName = "/cursor";
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool writeAll(int fd, const uint8_t *p, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = ::write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, uint8_t *p, size_t len, size_t offset)
+{
+    while (len > 0) {
+        ssize_t n = ::pread(fd, p, len, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+/// Fill m from a record body, false if the lengths inside it don't add up
+static bool decodeBody(const uint8_t *p, size_t len, MQTTSpool::Message &m)
+{
+    const uint8_t *end = p + len;
+    size_t n;
+    if (end - p < 4 + 2)
+        return false;
+    m.spooledAt = get32(p);
+    n = get16(p + 4);
+    p += 4 + 2;
+    if ((size_t)(end - p) < n + 4)
+        return false;
+    m.topic.assign((const char *)p, n);
+    p += n;
+    n = get32(p);
+    p += 4;
+    if ((size_t)(end - p) < n + 2)
+        return false;
+    m.envBytes.assign(p, n);
+    p += n;
+    n = get16(p);
+    p += 2;
+    if ((size_t)(end - p) < n + 4)
+        return false;
+    m.topicJson.assign((const char *)p, n);
+    p += n;
+    n = get32(p);
+    p += 4;
+    if ((size_t)(end - p) != n)
+        return false;
+    m.json.assign((const char *)p, n);
+    return true;
+}
+
+MQTTSpool::MQTTSpool(const std::string &directory, size_t maxBytes, size_t segmentBytes)
+    : directory(directory), maxBytes(maxBytes), segmentBytes(std::min(segmentBytes, std::max<size_t>(maxBytes / 4, 4096)))
+{
+}
+
+MQTTSpool::~MQTTSpool()
+{
+    if (writeFd >= 0) {
+        sync();
+        ::close(writeFd);
+    }
+    if (readFd >= 0)
+        ::close(readFd);
+}
+
+std::string MQTTSpool::segmentPath(uint32_t seq) const
+{
+    char name[20];
+    snprintf(name, sizeof(name), "/%010u.seg", seq);
+    return directory + name;
+}
+
+long MQTTSpool::readRecord(int fd, size_t offset)
+{
+    uint8_t header[RECORD_HEADER];
+    if (!readAll(fd, header, sizeof(header), offset))
+        return -1;
+    const uint32_t len = get32(header);
+    if (len > MAX_RECORD)
+        return -1;
+    buf.resize(len);
+    if (!readAll(fd, buf.data(), len, offset + RECORD_HEADER) || crc32Buffer(buf.data(), len) != get32(header + 4))
+        return -1;
+    return len;
+}
+
+bool MQTTSpool::scanSegment(Segment &seg, size_t cursorOffset, uint32_t &cursorIndex)
+{
+    bool found = cursorOffset == 0;
+    cursorIndex = 0;
+    seg.bytes = 0;
+    seg.count = 0;
+    seg.firstSpooledAt = 0;
+
+    int fd = ::open(segmentPath(seg.seq).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return found;
+    long len;
+    while ((len = readRecord(fd, seg.bytes)) >= 0) {
+        if (seg.count == 0 && len >= 4)
+            seg.firstSpooledAt = get32(buf.data());
+        seg.bytes += RECORD_HEADER + len;
+        seg.count++;
+        if (seg.bytes == cursorOffset) {
+            found = true;
+            cursorIndex = seg.count;
+        }
+    }
+    ::close(fd);
+    return found;
+}
+
+bool MQTTSpool::open()
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        LOG_ERROR("MQTT spool: can't create %s: %s", directory.c_str(), ec.message().c_str());
+        return false;
+    }
+
+    // Segments left from before, oldest first, with their size on disk
+    std::vector<std::pair<uint32_t, size_t>> found;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() == 14 && name.compare(10, 4, ".seg") == 0)
+            found.emplace_back((uint32_t)strtoul(name.c_str(), nullptr, 10), entry.file_size(ec));
+    }
+    std::sort(found.begin(), found.end());
+
+    // Where replay had got to: the segment and the offset in it
+    uint32_t cursorSeq = 0, cursorOffset = 0;
+    int fd = ::open((directory + cursorFileName).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        uint8_t cursor[12];
+        if (readAll(fd, cursor, sizeof(cursor), 0) && crc32Buffer(cursor, 8) == get32(cursor + 8)) {
+            cursorSeq = get32(cursor);
+            cursorOffset = get32(cursor + 4);
+        }
+        ::close(fd);
+    }
+
+    for (const auto &[seq, fileBytes] : found) {
+        if (seq < cursorSeq) {
+            // Everything in it was published, we just hadn't deleted it yet
+            ::unlink(segmentPath(seq).c_str());
+            continue;
+        }
+        Segment seg = {seq, 0, 0, 0};
+        uint32_t cursorIndex;
+        const bool atCursor = scanSegment(seg, seq == cursorSeq ? cursorOffset : 0, cursorIndex);
+        if (seg.bytes < fileBytes)
+            LOG_WARN("MQTT spool: %s is damaged after %u of %u bytes", segmentPath(seq).c_str(), (unsigned)seg.bytes,
+                     (unsigned)fileBytes);
+        if (segments.empty() && seq == cursorSeq) {
+            if (atCursor) {
+                readOffset = cursorOffset;
+                readIndex = cursorIndex;
+            } else {
+                LOG_WARN("MQTT spool: lost our place in %s, replaying all of it", segmentPath(seq).c_str());
+            }
+        }
+        segments.push_back(seg);
+        totalBytes += seg.bytes;
+        pending += seg.count;
+    }
+    pending -= readIndex;
+
+    if (segments.empty() || segments.back().bytes >= segmentBytes) {
+        if (!startSegment(std::max(segments.empty() ? 0 : segments.back().seq, cursorSeq) + 1))
+            return false;
+    } else {
+        // Append to the last segment, after its last intact record
+        writeFd = ::open(segmentPath(segments.back().seq).c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (writeFd < 0 || ::ftruncate(writeFd, segments.back().bytes) != 0) {
+            LOG_ERROR("MQTT spool: can't append to %s: %s", segmentPath(segments.back().seq).c_str(), strerror(errno));
+            return false;
+        }
+    }
+    lastSync = millis();
+
+    // Read the first message to publish now, so getOldestSpooledAt() is right from the start
+    Message first;
+    peek(first);
+
+    LOG_INFO("MQTT spool %s: %u messages to publish, %u bytes in %u segments", directory.c_str(), pending,
+             (unsigned)totalBytes, (unsigned)segments.size());
+    return true;
+}
+
+bool MQTTSpool::startSegment(uint32_t seq)
+{
+    const std::string path = segmentPath(seq);
+    writeFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (writeFd < 0) {
+        LOG_ERROR("MQTT spool: can't create %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    segments.push_back({seq, 0, 0, 0});
+
+    // Make sure the new file itself survives a power loss
+    int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+}
+
+bool MQTTSpool::append(const std::string &topic, const uint8_t *envBytes, size_t envLen, const std::string &topicJson,
+                       const std::string &json)
+{
+    if (writeFd < 0)
+        return false;
+    const size_t bodyLen = 4 + 2 + topic.size() + 4 + envLen + 2 + topicJson.size() + 4 + json.size();
+    if (bodyLen > MAX_RECORD || topic.size() > UINT16_MAX || topicJson.size() > UINT16_MAX)
+        return false;
+
+    const uint32_t now = time(nullptr);
+    buf.resize(RECORD_HEADER + bodyLen);
+    uint8_t *body = buf.data() + RECORD_HEADER;
+    uint8_t *p = body;
+    put32(p, now);
+    put16(p + 4, topic.size());
+    p += 4 + 2;
+    memcpy(p, topic.data(), topic.size());
+    p += topic.size();
+    put32(p, envLen);
+    p += 4;
+    memcpy(p, envBytes, envLen);
+    p += envLen;
+    put16(p, topicJson.size());
+    p += 2;
+    memcpy(p, topicJson.data(), topicJson.size());
+    p += topicJson.size();
+    put32(p, json.size());
+    p += 4;
+    memcpy(p, json.data(), json.size());
+    put32(buf.data(), bodyLen);
+    put32(buf.data() + 4, crc32Buffer(body, bodyLen));
+
+    if (segments.back().bytes >= segmentBytes) {
+        ::fdatasync(writeFd);
+        ::close(writeFd);
+        unsyncedBytes = 0;
+        if (!startSegment(segments.back().seq + 1))
+            return false;
+    }
+
+    Segment &seg = segments.back();
+    if (!writeAll(writeFd, buf.data(), buf.size())) {
+        LOG_ERROR("MQTT spool: write to %s failed: %s", segmentPath(seg.seq).c_str(), strerror(errno));
+        // Don't leave half a record for the next one to be appended after
+        if (::ftruncate(writeFd, seg.bytes) != 0)
+            LOG_ERROR("MQTT spool: can't truncate %s: %s", segmentPath(seg.seq).c_str(), strerror(errno));
+        return false;
+    }
+    if (seg.count == 0)
+        seg.firstSpooledAt = now;
+    if (pending == 0)
+        oldestSpooledAt = now;
+    seg.bytes += buf.size();
+    seg.count++;
+    totalBytes += buf.size();
+    unsyncedBytes += buf.size();
+    pending++;
+
+    while (totalBytes > maxBytes && segments.size() > 1) {
+        LOG_WARN("MQTT spool is over %u bytes, discard oldest segment", (unsigned)maxBytes);
+        removeHead();
+    }
+    maybeSync();
+    return true;
+}
+
+bool MQTTSpool::peek(Message &m)
+{
+    while (pending > 0) {
+        Segment &head = segments.front();
+        if (readOffset >= head.bytes) {
+            if (segments.size() == 1)
+                return false;
+            removeHead();
+            continue;
+        }
+        if (readFd < 0)
+            readFd = ::open(segmentPath(head.seq).c_str(), O_RDONLY | O_CLOEXEC);
+        const long len = readFd >= 0 ? readRecord(readFd, readOffset) : -1;
+        if (len < 0 || !decodeBody(buf.data(), len, m)) {
+            LOG_ERROR("MQTT spool: can't read %s at %u, skip the rest of it", segmentPath(head.seq).c_str(),
+                      (unsigned)readOffset);
+            dropped += head.count - readIndex;
+            pending -= head.count - readIndex;
+            readIndex = head.count;
+            readOffset = head.bytes;
+            continue;
+        }
+        peekedEnd = readOffset + RECORD_HEADER + len;
+        oldestSpooledAt = m.spooledAt;
+        return true;
+    }
+    if (pending == 0)
+        oldestSpooledAt = 0;
+    return false;
+}
+
+void MQTTSpool::pop()
+{
+    if (peekedEnd == 0)
+        return;
+    readOffset = peekedEnd;
+    peekedEnd = 0;
+    readIndex++;
+    pending--;
+    cursorDirty = true;
+    if (pending == 0)
+        oldestSpooledAt = 0;
+    if (readOffset >= segments.front().bytes && segments.size() > 1)
+        removeHead();
+    maybeSync();
+}
+
+void MQTTSpool::removeHead()
+{
+    const Segment &head = segments.front();
+    const uint32_t unpublished = head.count - readIndex;
+    pending -= unpublished;
+    dropped += unpublished;
+    totalBytes -= head.bytes;
+    if (readFd >= 0) {
+        ::close(readFd);
+        readFd = -1;
+    }
+    ::unlink(segmentPath(head.seq).c_str());
+    segments.pop_front();
+    oldestSpooledAt = pending > 0 ? segments.front().firstSpooledAt : 0;
+    readOffset = 0;
+    readIndex = 0;
+    peekedEnd = 0;
+    cursorDirty = true;
+}
+
+void MQTTSpool::writeCursor()
+{
+    uint8_t cursor[12];
+    put32(cursor, segments.front().seq);
+    put32(cursor + 4, readOffset);
+    put32(cursor + 8, crc32Buffer(cursor, 8));
+
+    // Write a new cursor and rename it over the old one, so there is always an intact one
+    const std::string path = directory + cursorFileName;
+    const std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("MQTT spool: can't write %s: %s", tmpPath.c_str(), strerror(errno));
+        return;
+    }
+    const bool ok = writeAll(fd, cursor, sizeof(cursor)) && ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("MQTT spool: can't write %s: %s", path.c_str(), strerror(errno));
+        return;
+    }
+    cursorDirty = false;
+}
+
+void MQTTSpool::sync()
+{
+    if (unsyncedBytes > 0 && writeFd >= 0)
+        ::fdatasync(writeFd);
+    unsyncedBytes = 0;
+    if (cursorDirty && !segments.empty())
+        writeCursor();
+    lastSync = millis();
+}
+
+int32_t MQTTSpool::msecUntilSync() const
+{
+    if (unsyncedBytes == 0 && !cursorDirty)
+        return INT32_MAX;
+    const uint32_t since = millis() - lastSync;
+    return since >= MQTT_SPOOL_SYNC_MSEC ? 0 : MQTT_SPOOL_SYNC_MSEC - since;
+}
+
+void MQTTSpool::maybeSync()
+{
+    if (unsyncedBytes >= MQTT_SPOOL_SYNC_BYTES ||
+        ((unsyncedBytes > 0 || cursorDirty) && millis() - lastSync >= MQTT_SPOOL_SYNC_MSEC))
+        sync();
+}
+
+#endif
@@ -0,0 +1,147 @@
+#pragma once
+
+#ifdef ARCH_PORTDUINO
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/// Size at which we start a new segment file
+#ifndef MQTT_SPOOL_SEGMENT_BYTES
+#define MQTT_SPOOL_SEGMENT_BYTES (1024 * 1024)
+#endif
+
+/// Bytes appended before we fsync(), however recently we last did
+#ifndef MQTT_SPOOL_SYNC_BYTES
+#define MQTT_SPOOL_SYNC_BYTES (64 * 1024)
+#endif
+
+/// Longest we leave appended messages (or the replay position) unsynced
+#ifndef MQTT_SPOOL_SYNC_MSEC
+#define MQTT_SPOOL_SYNC_MSEC 1000
+#endif
+
+/**
+ * An on-disk queue of MQTT messages for meshtasticd, used instead of MQTT::mqttQueue while the server can't be reached.
+ *
+ * Messages are appended to numbered segment files in a directory (0000000001.seg, 0000000002.seg...), starting a new one
+ * every MQTT_SPOOL_SEGMENT_BYTES.  They are replayed in order with peek() and pop(), and a segment is deleted once all of its
+ * messages have been published.  The replay position is kept in a cursor file, so after a restart replay resumes where it
+ * left off.  Once the segments add up to more than the size cap, the oldest segment is discarded whole.
+ *
+ * Appends and the cursor are fsync()ed in batches (MQTT_SPOOL_SYNC_BYTES, MQTT_SPOOL_SYNC_MSEC), so delivery is at least
+ * once: messages published since the cursor was last synced are published again after a crash.  A message torn by a crash
+ * in the middle of an append is dropped (with anything after it in that segment) when the spool is next opened.
+ *
+ * Each record is the length and CRC32 of its body, then the body: the time it was spooled, then the topic, ServiceEnvelope,
+ * JSON topic and JSON, each preceded by its length.
+ */
+class MQTTSpool
+{
+  public:
+    struct Message {
+        std::string topic;
+        std::basic_string<uint8_t> envBytes;
+        std::string topicJson; // empty if there is no JSON to publish
+        std::string json;
+        uint32_t spooledAt; // seconds since the epoch
+    };
+
+    MQTTSpool(const std::string &directory, size_t maxBytes, size_t segmentBytes = MQTT_SPOOL_SEGMENT_BYTES);
+    ~MQTTSpool();
+
+    /// Find the segments and replay position left by an earlier run, return false if the directory can't be used
+    bool open();
+
+    /// Add a message at the end, return false if it could not be written
+    bool append(const std::string &topic, const uint8_t *envBytes, size_t envLen, const std::string &topicJson,
+                const std::string &json);
+
+    /// Get the oldest message not yet published, false if there is none
+    bool peek(Message &m);
+
+    /// Mark the message returned by the last peek() as published
+    void pop();
+
+    /// fsync() whatever has been appended, and write the replay position
+    void sync();
+
+    /// sync() if MQTT_SPOOL_SYNC_BYTES or MQTT_SPOOL_SYNC_MSEC has been reached
+    void maybeSync();
+
+    /// How long until maybeSync() has something to sync, INT32_MAX if nothing is waiting
+    int32_t msecUntilSync() const;
+
+    /// Messages waiting to be published
+    uint32_t getCount() const { return pending; }
+
+    /// Bytes on disk, including messages published from segments not yet deleted
+    size_t getBytes() const { return totalBytes; }
+
+    /// Messages discarded because the spool grew past its size cap, or were damaged
+    uint32_t getDropped() const { return dropped; }
+
+    /**
+     * When the oldest message waiting was spooled (seconds since the epoch), 0 if there is none.  Kept in memory, so this
+     * doesn't touch the disk.  Between a pop() and the next peek() it is when the message just published was spooled, which
+     * can only make the oldest look a little older than it is.
+     */
+    uint32_t getOldestSpooledAt() const { return oldestSpooledAt; }
+
+  private:
+    struct Segment {
+        uint32_t seq;
+        size_t bytes;            // up to the end of the last intact record
+        uint32_t count;          // records in it
+        uint32_t firstSpooledAt; // when its first record was spooled, 0 if it has none
+    };
+
+    std::string directory;
+    size_t maxBytes;
+    size_t segmentBytes;
+
+    /// Oldest first, the last one is being appended to
+    std::deque<Segment> segments;
+    int writeFd = -1;
+    int readFd = -1; // on segments.front()
+
+    /// Position of the next message to publish, within segments.front()
+    size_t readOffset = 0;
+    uint32_t readIndex = 0;
+    /// Offset just past the message returned by peek(), 0 if there is none
+    size_t peekedEnd = 0;
+
+    size_t totalBytes = 0;
+    uint32_t pending = 0;
+    uint32_t dropped = 0;
+    uint32_t oldestSpooledAt = 0;
+
+    size_t unsyncedBytes = 0;
+    bool cursorDirty = false;
+    uint32_t lastSync = 0;
+
+    std::vector<uint8_t> buf; // for encoding and decoding records
+
+    std::string segmentPath(uint32_t seq) const;
+
+    /**
+     * Find how many intact records seg has, and where the last of them ends.
+     *
+     * @return true if cursorOffset is the start of one of them (or the end of the last), with cursorIndex set to the number of
+     * records before it
+     */
+    bool scanSegment(Segment &seg, size_t cursorOffset, uint32_t &cursorIndex);
+
+    /// Read the record at offset of segment fd into buf, return the body length or -1 if it is missing or damaged
+    long readRecord(int fd, size_t offset);
+
+    bool startSegment(uint32_t seq);
+
+    /// Delete the oldest segment, counting any of its messages not yet published as dropped
+    void removeHead();
+
+    void writeCursor();
+};
+
+#endif
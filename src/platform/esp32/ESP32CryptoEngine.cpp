@@ -5,13 +5,48 @@
 
 class ESP32CryptoEngine : public CryptoEngine
 {
+    /// One expanded mbedtls key per recently used channel key, see CryptoEngine::CipherContext
+    struct AesContext {
+        CryptoKey key;
+        mbedtls_aes_context aes;
+        uint32_t lastUsed; // 0 means empty
+    };
+    AesContext aesContexts[AES_CONTEXT_CACHE_SIZE];
+    uint32_t aesContextClock = 0;
 
-    mbedtls_aes_context aes;
+    mbedtls_aes_context *getAesContext(const CryptoKey &k)
+    {
+        AesContext *victim = &aesContexts[0];
+        for (auto &c : aesContexts) {
+            if (c.lastUsed && c.key.length == k.length && memcmp(c.key.bytes, k.bytes, k.length) == 0) {
+                c.lastUsed = ++aesContextClock;
+                cipherCacheHits++;
+                return &c.aes;
+            }
+            if (c.lastUsed < victim->lastUsed)
+                victim = &c;
+        }
+        cipherCacheMisses++;
+        mbedtls_aes_setkey_enc(&victim->aes, k.bytes, k.length * 8);
+        victim->key = k;
+        victim->lastUsed = ++aesContextClock;
+        return &victim->aes;
+    }
 
   public:
-    ESP32CryptoEngine() { mbedtls_aes_init(&aes); }
+    ESP32CryptoEngine()
+    {
+        for (auto &c : aesContexts) {
+            mbedtls_aes_init(&c.aes);
+            c.lastUsed = 0;
+        }
+    }
 
-    ~ESP32CryptoEngine() { mbedtls_aes_free(&aes); }
+    ~ESP32CryptoEngine()
+    {
+        for (auto &c : aesContexts)
+            mbedtls_aes_free(&c.aes); // Also wipes the key schedule
+    }
 
     /**
      * Encrypt a packet
@@ -23,14 +58,14 @@ class ESP32CryptoEngine : public CryptoEngine
     {
         if (_key.length > 0) {
             if (numBytes <= MAX_BLOCKSIZE) {
-                mbedtls_aes_setkey_enc(&aes, _key.bytes, _key.length * 8);
+                mbedtls_aes_context *aes = getAesContext(_key);
                 static uint8_t scratch[MAX_BLOCKSIZE];
                 uint8_t stream_block[16];
                 size_t nc_off = 0;
                 memcpy(scratch, bytes, numBytes);
                 memset(scratch + numBytes, 0,
                        sizeof(scratch) - numBytes); // Fill rest of buffer with zero (in case cypher looks at it)
-                mbedtls_aes_crypt_ctr(&aes, numBytes, &nc_off, _nonce, stream_block, scratch, bytes);
+                mbedtls_aes_crypt_ctr(aes, numBytes, &nc_off, _nonce, stream_block, scratch, bytes);
             } else {
                 LOG_ERROR("Packet too large for crypto engine: %d. noop encryption!", numBytes);
             }
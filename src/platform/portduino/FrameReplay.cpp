@@ -0,0 +1,158 @@
+#include "FrameReplay.h"
+#include "configuration.h"
+#include "mesh/MeshService.h"
+#include "mesh/Router.h"
+#include <algorithm>
+#include <fstream>
+#include <time.h>
+
+/// Frames replayed per runOnce() when going as fast as we can, so the other threads still get to run
+#define REPLAY_BATCH 32
+
+static uint64_t nowNsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+FrameReplay::FrameReplay(const std::string &filename, bool realtime, const std::string &outcomeFile,
+                         const std::string &baselineFile)
+    : concurrency::OSThread("FrameReplay"), realtime(realtime), outcomeFile(outcomeFile), baselineFile(baselineFile)
+{
+    if (!reader.open(filename)) {
+        LOG_ERROR("Replay: can't read capture %s", filename.c_str());
+        exit(EXIT_FAILURE);
+    }
+    LOG_INFO("Replay: %s %s", filename.c_str(), realtime ? "in real time" : "as fast as possible");
+}
+
+int32_t FrameReplay::runOnce()
+{
+    for (int i = 0; i < REPLAY_BATCH; i++) {
+        if (!pending && !(pending = reader.next())) {
+            finish();
+            return disable();
+        }
+        if (!startNsec) {
+            firstUsec = pending->usec;
+            startNsec = nowNsec();
+        }
+        if (realtime) {
+            const int64_t dueNsec = (int64_t)(pending->usec - firstUsec) * 1000 - (int64_t)(nowNsec() - startNsec);
+            if (dueNsec > 0)
+                return std::max<int32_t>(1, dueNsec / 1000000);
+        }
+        replay(*pending);
+        pending = nullptr;
+    }
+    return 0;
+}
+
+void FrameReplay::replayAll()
+{
+    for (; pending || (pending = reader.next()); pending = nullptr)
+        replay(*pending);
+}
+
+void FrameReplay::replay(const FrameRecord &r)
+{
+    const uint64_t t0 = nowNsec();
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    if (!frameToPacket(r, *p)) {
+        packetPool.release(p);
+        invalid++;
+        outcomes.push_back("invalid");
+        return;
+    }
+    p->transport_mechanism = meshtastic_MeshPacket_TransportMechanism_TRANSPORT_LORA;
+    const NodeNum from = p->from;
+    const PacketId id = p->id;
+    const uint64_t t1 = nowNsec();
+
+    // Route the frame just as the radio would have delivered it, the router says how it decoded it
+    router->firstReceived = {};
+    const uint32_t dupesBefore = router->rxDupe;
+    const meshtastic_QueueStatus queueBefore = router->getQueueStatus();
+    router->enqueueReceivedMessage(p);
+    router->runOnce();
+    const uint64_t t2 = nowNsec();
+
+    // Dropped before being decoded (e.g. as a duplicate) unless the router handled this very packet
+    const Router::ReceivedTrace &trace = router->firstReceived;
+    const bool handled = trace.handled && trace.from == from && trace.id == id;
+    const uint64_t decodeNsec = handled ? std::min<uint64_t>(trace.decodeUsec * 1000, t2 - t1) : 0;
+    parse.nsec.push_back(t1 - t0);
+    if (handled)
+        decode.nsec.push_back(decodeNsec);
+    route.nsec.push_back(t2 - t1 - decodeNsec);
+
+    char outcome[80];
+    char held[16];
+    if (!handled)
+        snprintf(held, sizeof(held), "dropped");
+    else if (trace.state == DecodeState::DECODE_SUCCESS)
+        snprintf(held, sizeof(held), "port=%d", trace.portnum);
+    else
+        snprintf(held, sizeof(held), "%s", trace.state == DecodeState::DECODE_FATAL ? "fatal" : "undecoded");
+    snprintf(outcome, sizeof(outcome), "from=0x%08x id=0x%08x %s dupe=%u sent=%d", from, id, held, router->rxDupe - dupesBefore,
+             (int)queueBefore.free - (int)router->getQueueStatus().free);
+    outcomes.push_back(outcome);
+}
+
+void FrameReplay::Stage::log()
+{
+    if (nsec.empty())
+        return;
+    std::sort(nsec.begin(), nsec.end());
+    uint64_t total = 0;
+    for (uint32_t n : nsec)
+        total += n;
+    LOG_INFO("Replay: %-6s mean %6u us, p50 %6u us, p99 %6u us, max %6u us", name, (unsigned)(total / nsec.size() / 1000),
+             nsec[nsec.size() / 2] / 1000, nsec[nsec.size() * 99 / 100] / 1000, nsec.back() / 1000);
+}
+
+void FrameReplay::finish()
+{
+    const double seconds = startNsec ? (nowNsec() - startNsec) / 1e9 : 0;
+    LOG_INFO("Replay: %u frames (%u invalid) in %.3f s, %.0f packets/s", (unsigned)outcomes.size(), invalid, seconds,
+             seconds > 0 ? outcomes.size() / seconds : 0);
+    parse.log();
+    decode.log();
+    route.log();
+
+    if (!outcomeFile.empty()) {
+        std::ofstream out(outcomeFile);
+        for (const std::string &o : outcomes)
+            out << o << '\n';
+        if (!out)
+            LOG_ERROR("Replay: can't write %s", outcomeFile.c_str());
+    }
+
+    uint32_t differences = 0;
+    if (!baselineFile.empty()) {
+        std::ifstream in(baselineFile);
+        if (!in) {
+            LOG_ERROR("Replay: can't read baseline %s", baselineFile.c_str());
+            exit(EXIT_FAILURE);
+        }
+        differences = diffBaseline(in);
+        LOG_INFO("Replay: %u frames handled differently from %s", differences, baselineFile.c_str());
+    }
+    exit(differences ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+uint32_t FrameReplay::diffBaseline(std::istream &baseline) const
+{
+    uint32_t differences = 0;
+    std::string line;
+    size_t i = 0;
+    for (; std::getline(baseline, line); i++) {
+        const std::string now = i < outcomes.size() ? outcomes[i] : "(missing)";
+        if (line != now && differences++ < 20)
+            LOG_WARN("Replay: frame %u was '%s', now '%s'", (unsigned)i, line.c_str(), now.c_str());
+    }
+    if (i < outcomes.size())
+        differences += outcomes.size() - i;
+    return differences;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "concurrency/OSThread.h"
+#include "mesh/FrameCapture.h"
+#include <istream>
+#include <string>
+#include <vector>
+
+/**
+ * Feeds a frame capture back through Router::enqueueReceivedMessage(), for meshtasticd --replay.
+ *
+ * Frames go in as fast as the router takes them, or with the gaps they were captured with.  When the capture is done we log
+ * the packet rate and how long each stage took, write one line per frame saying what the router did with it, and exit.  Given
+ * those lines from another build, we report every frame handled differently and exit with a failure.
+ */
+class FrameReplay : private concurrency::OSThread
+{
+  public:
+    FrameReplay(const std::string &filename, bool realtime, const std::string &outcomeFile, const std::string &baselineFile);
+
+    /// Replay every frame left at once, without logging or exiting.  For tests, meshtasticd lets the thread do it.
+    void replayAll();
+
+    /// What the router did with each frame replayed so far, one line per frame
+    const std::vector<std::string> &getOutcomes() const { return outcomes; }
+
+    /// Log how the outcomes differ from the lines of a baseline.  @return the number of frames handled differently
+    uint32_t diffBaseline(std::istream &baseline) const;
+
+  protected:
+    virtual int32_t runOnce() override;
+
+  private:
+    /// Time taken by one stage of handling a frame, for every frame
+    struct Stage {
+        const char *name;
+        std::vector<uint32_t> nsec;
+
+        void log();
+    };
+
+    FrameCaptureReader reader;
+    bool realtime;
+    std::string outcomeFile, baselineFile;
+
+    const FrameRecord *pending = nullptr; // read but not yet replayed
+    uint64_t firstUsec = 0;               // capture time of the first frame
+    uint64_t startNsec = 0;               // when we replayed it
+
+    Stage parse = {"parse"}, decode = {"decode"}, route = {"route"};
+    std::vector<std::string> outcomes;
+    uint32_t invalid = 0;
+
+    void replay(const FrameRecord &r);
+    void finish();
+};
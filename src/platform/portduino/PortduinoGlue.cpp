@@ -8,6 +8,7 @@
 #include "PortduinoGlue.h"
 #include "api/ServerAPI.h"
 #include "linux/gpio/LinuxGPIOPin.h"
+#include "mesh/FrameCapture.h"
 #include "meshUtils.h"
 #include "yaml-cpp/yaml.h"
 #include <ErriezCRC32.h>
@@ -19,8 +20,11 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <vector>
 
 #ifdef PORTDUINO_LINUX_HARDWARE
 #include <cxxabi.h>
@@ -28,8 +32,13 @@
 
 #include "platform/portduino/USBHal.h"
 
-std::map<configNames, int> settingsMap;
-std::map<configNames, std::string> settingsStrings;
+static const PortduinoSettings defaultSettings;
+std::atomic<const PortduinoSettings *> currentSettings(&defaultSettings);
+static std::mutex publishLock;
+// Snapshots replaced by a newer one, meshtasticd only publishes a few times while starting up
+static std::vector<std::unique_ptr<const PortduinoSettings>> retiredSettings;
+// What loadConfig() fills in, until portduinoSetup() publishes it
+static PortduinoSettings staged;
 portduino_config_struct portduino_config;
 std::ofstream traceFile;
 Ch341Hal *ch341Hal = nullptr;
@@ -54,6 +63,9 @@ void updateBatteryLevel(uint8_t level) NOT_IMPLEMENTED("updateBatteryLevel");
 
 int TCPPort = SERVER_API_DEFAULT_PORT;
 
+// Keys of the options that only have a long name
+enum { OPT_REPLAY = 0x100, OPT_REPLAY_REALTIME, OPT_REPLAY_OUTCOME, OPT_REPLAY_BASELINE };
+
 static error_t parse_opt(int key, char *arg, struct argp_state *state)
 {
     switch (key) {
@@ -75,6 +87,19 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state)
     case 'v':
         verboseEnabled = true;
         break;
+    case OPT_REPLAY:
+        portduino_config.replay_file = arg;
+        portduino_config.force_simradio = true; // Only the replayed frames should reach the router
+        break;
+    case OPT_REPLAY_REALTIME:
+        portduino_config.replay_realtime = true;
+        break;
+    case OPT_REPLAY_OUTCOME:
+        portduino_config.replay_outcome_file = arg;
+        break;
+    case OPT_REPLAY_BASELINE:
+        portduino_config.replay_baseline_file = arg;
+        break;
     case ARGP_KEY_ARG:
         return 0;
     default:
@@ -90,6 +115,12 @@ void portduinoCustomInit()
                                            {"hwid", 'h', "HWID", 0, "The mac address to assign to this virtual machine"},
                                            {"sim", 's', 0, 0, "Run in Simulated radio mode"},
                                            {"verbose", 'v', 0, 0, "Set log level to full debug"},
+                                           {"replay", OPT_REPLAY, "CAPTURE", 0, "Feed a frame capture to the router, then exit"},
+                                           {"replay-realtime", OPT_REPLAY_REALTIME, 0, 0, "Replay frames as spaced as captured"},
+                                           {"replay-outcome", OPT_REPLAY_OUTCOME, "FILE", 0,
+                                            "Write what the router did with each replayed frame"},
+                                           {"replay-baseline", OPT_REPLAY_BASELINE, "FILE", 0,
+                                            "Report frames handled differently than in this --replay-outcome file"},
                                            {0}};
     static void *childArguments;
     static char doc[] = "Meshtastic native build.";
@@ -115,8 +146,8 @@ void getMacAddr(uint8_t *dmac)
             dmac[4] = hwId >> 8;
             dmac[5] = hwId & 0xff;
         }
-    } else if (settingsStrings[mac_address].length() > 11) {
-        MAC_from_string(settingsStrings[mac_address], dmac);
+    } else if (getSettingString<mac_address>().length() > 11) {
+        MAC_from_string(getSettingString<mac_address>(), dmac);
         exit;
     } else {
 
@@ -172,26 +203,28 @@ void portduinoSetup()
                                       tbPressPin};
 
     std::string gpioChipName = "gpiochip";
-    settingsStrings[i2cdev] = "";
-    settingsStrings[keyboardDevice] = "";
-    settingsStrings[pointerDevice] = "";
-    settingsStrings[webserverrootpath] = "";
-    settingsStrings[spidev] = "";
-    settingsStrings[displayspidev] = "";
-    settingsMap[spiSpeed] = 2000000;
-    settingsMap[ascii_logs] = !isatty(1);
-    settingsMap[displayPanel] = no_screen;
-    settingsMap[touchscreenModule] = no_touchscreen;
-    settingsMap[tbUpPin] = RADIOLIB_NC;
-    settingsMap[tbDownPin] = RADIOLIB_NC;
-    settingsMap[tbLeftPin] = RADIOLIB_NC;
-    settingsMap[tbRightPin] = RADIOLIB_NC;
-    settingsMap[tbPressPin] = RADIOLIB_NC;
+    staged = getSettings(); // Keep anything set before we started
+    staged.strings[i2cdev] = "";
+    staged.strings[keyboardDevice] = "";
+    staged.strings[pointerDevice] = "";
+    staged.strings[webserverrootpath] = "";
+    staged.strings[spidev] = "";
+    staged.strings[displayspidev] = "";
+    staged.values[spiSpeed] = 2000000;
+    staged.values[ascii_logs] = !isatty(1);
+    staged.values[displayPanel] = no_screen;
+    staged.values[touchscreenModule] = no_touchscreen;
+    staged.values[userButtonPin] = RADIOLIB_NC;
+    staged.values[tbUpPin] = RADIOLIB_NC;
+    staged.values[tbDownPin] = RADIOLIB_NC;
+    staged.values[tbLeftPin] = RADIOLIB_NC;
+    staged.values[tbRightPin] = RADIOLIB_NC;
+    staged.values[tbPressPin] = RADIOLIB_NC;
 
     YAML::Node yamlConfig;
 
     if (portduino_config.force_simradio == true) {
-        settingsMap[use_simradio] = true;
+        staged.values[use_simradio] = true;
     } else if (configPath != nullptr) {
         if (loadConfig(configPath)) {
             std::cout << "Using " << configPath << " as config file" << std::endl;
@@ -215,22 +248,23 @@ void portduinoSetup()
         }
     } else {
         std::cout << "No 'config.yaml' found..." << std::endl;
-        settingsMap[use_simradio] = true;
+        staged.values[use_simradio] = true;
     }
 
-    if (settingsMap[use_simradio] == true) {
+    if (staged.values[use_simradio] == true) {
         std::cout << "Running in simulated mode." << std::endl;
-        settingsMap[maxnodes] = 200;               // Default to 200 nodes
-        settingsMap[logoutputlevel] = level_debug; // Default to debug
+        staged.values[maxnodes] = 200;               // Default to 200 nodes
+        staged.values[logoutputlevel] = level_debug; // Default to debug
         // Set the random seed equal to TCPPort to have a different seed per instance
         randomSeed(TCPPort);
+        publishSettings(staged);
         return;
     }
 
-    if (settingsStrings[config_directory] != "") {
+    if (staged.strings[config_directory] != "") {
         std::string filetype = ".yaml";
         for (const std::filesystem::directory_entry &entry :
-             std::filesystem::directory_iterator{settingsStrings[config_directory]}) {
+             std::filesystem::directory_iterator{staged.strings[config_directory]}) {
             if (ends_with(entry.path().string(), ".yaml")) {
                 std::cout << "Also using " << entry << " as additional config file" << std::endl;
                 loadConfig(entry.path().c_str());
@@ -240,13 +274,13 @@ void portduinoSetup()
 
     // If LoRa `Module: auto` (default in config.yaml),
     // attempt to auto config based on Product Strings
-    if (settingsMap[use_autoconf] == true) {
+    if (staged.values[use_autoconf] == true) {
         char autoconf_product[96] = {0};
         // Try CH341
         try {
             std::cout << "autoconf: Looking for CH341 device..." << std::endl;
             ch341Hal =
-                new Ch341Hal(0, settingsStrings[lora_usb_serial_num], settingsMap[lora_usb_vid], settingsMap[lora_usb_pid]);
+                new Ch341Hal(0, staged.strings[lora_usb_serial_num], staged.values[lora_usb_vid], staged.values[lora_usb_pid]);
             ch341Hal->getProductString(autoconf_product, 95);
             delete ch341Hal;
             std::cout << "autoconf: Found CH341 device " << autoconf_product << std::endl;
@@ -323,7 +357,7 @@ void portduinoSetup()
                         if (mac_start != nullptr) {
                             std::cout << "autoconf: Found mac data " << mac_start << std::endl;
                             if (strlen(mac_start) == 12)
-                                settingsStrings[mac_address] = std::string(mac_start);
+                                staged.strings[mac_address] = std::string(mac_start);
                         }
                         if (devID_start != nullptr) {
                             std::cout << "autoconf: Found deviceid data " << devID_start << std::endl;
@@ -354,7 +388,7 @@ void portduinoSetup()
                 std::cerr << "autoconf: Unable to find config for " << autoconf_product << std::endl;
                 exit(EXIT_FAILURE);
             }
-            if (loadConfig((settingsStrings[available_directory] + product_config).c_str())) {
+            if (loadConfig((staged.strings[available_directory] + product_config).c_str())) {
                 std::cout << "autoconf: Using " << product_config << " as config file for " << autoconf_product << std::endl;
             } else {
                 std::cerr << "autoconf: Unable to use " << product_config << " as config file for " << autoconf_product
@@ -368,10 +402,10 @@ void portduinoSetup()
 
     // if we're using a usermode driver, we need to initialize it here, to get a serial number back for mac address
     uint8_t dmac[6] = {0};
-    if (settingsStrings[spidev] == "ch341") {
+    if (staged.strings[spidev] == "ch341") {
         try {
             ch341Hal =
-                new Ch341Hal(0, settingsStrings[lora_usb_serial_num], settingsMap[lora_usb_vid], settingsMap[lora_usb_pid]);
+                new Ch341Hal(0, staged.strings[lora_usb_serial_num], staged.values[lora_usb_vid], staged.values[lora_usb_pid]);
         } catch (std::exception &e) {
             std::cerr << e.what() << std::endl;
             std::cerr << "Could not initialize CH341 device!" << std::endl;
@@ -383,7 +417,7 @@ void portduinoSetup()
         char product_string[96] = {0};
         ch341Hal->getProductString(product_string, 95);
         std::cout << "CH341 Product " << product_string << std::endl;
-        if (strlen(serial) == 8 && settingsStrings[mac_address].length() < 12) {
+        if (strlen(serial) == 8 && staged.strings[mac_address].length() < 12) {
             uint8_t hash[32] = {0};
             memcpy(hash, serial, 8);
             crypto->hash(hash, 8);
@@ -395,10 +429,11 @@ void portduinoSetup()
             dmac[5] = hash[5];
             char macBuf[13] = {0};
             sprintf(macBuf, "%02X%02X%02X%02X%02X%02X", dmac[0], dmac[1], dmac[2], dmac[3], dmac[4], dmac[5]);
-            settingsStrings[mac_address] = macBuf;
+            staged.strings[mac_address] = macBuf;
         }
     }
 
+    publishSettings(staged); // getMacAddr() reads the MAC address from it
     getMacAddr(dmac);
     if (dmac[0] == 0 && dmac[1] == 0 && dmac[2] == 0 && dmac[3] == 0 && dmac[4] == 0 && dmac[5] == 0) {
         std::cout << "*** Blank MAC Address not allowed!" << std::endl;
@@ -409,66 +444,66 @@ void portduinoSetup()
     // Rather important to set this, if not running simulated.
     randomSeed(time(NULL));
 
-    std::string defaultGpioChipName = gpioChipName + std::to_string(settingsMap[default_gpiochip]);
+    std::string defaultGpioChipName = gpioChipName + std::to_string(staged.values[default_gpiochip]);
 
     for (configNames i : GPIO_lines) {
-        if (settingsMap.count(i) && settingsMap[i] > max_GPIO)
-            max_GPIO = settingsMap[i];
+        if (staged.values[i] > max_GPIO)
+            max_GPIO = staged.values[i];
     }
 
     gpioInit(max_GPIO + 1); // Done here so we can inform Portduino how many GPIOs we need.
 
     // Need to bind all the configured GPIO pins so they're not simulated
     // TODO: If one of these fails, we should log and terminate
-    if (settingsMap.count(userButtonPin) > 0 && settingsMap[userButtonPin] != RADIOLIB_NC) {
-        if (initGPIOPin(settingsMap[userButtonPin], defaultGpioChipName, settingsMap[userButtonPin]) != ERRNO_OK) {
-            settingsMap[userButtonPin] = RADIOLIB_NC;
+    if (staged.values[userButtonPin] != RADIOLIB_NC) {
+        if (initGPIOPin(staged.values[userButtonPin], defaultGpioChipName, staged.values[userButtonPin]) != ERRNO_OK) {
+            staged.values[userButtonPin] = RADIOLIB_NC;
         }
     }
-    if (settingsMap.count(tbUpPin) > 0 && settingsMap[tbUpPin] != RADIOLIB_NC) {
-        if (initGPIOPin(settingsMap[tbUpPin], defaultGpioChipName, settingsMap[tbUpPin]) != ERRNO_OK) {
-            settingsMap[tbUpPin] = RADIOLIB_NC;
+    if (staged.values[tbUpPin] != RADIOLIB_NC) {
+        if (initGPIOPin(staged.values[tbUpPin], defaultGpioChipName, staged.values[tbUpPin]) != ERRNO_OK) {
+            staged.values[tbUpPin] = RADIOLIB_NC;
         }
     }
-    if (settingsMap.count(tbDownPin) > 0 && settingsMap[tbDownPin] != RADIOLIB_NC) {
-        if (initGPIOPin(settingsMap[tbDownPin], defaultGpioChipName, settingsMap[tbDownPin]) != ERRNO_OK) {
-            settingsMap[tbDownPin] = RADIOLIB_NC;
+    if (staged.values[tbDownPin] != RADIOLIB_NC) {
+        if (initGPIOPin(staged.values[tbDownPin], defaultGpioChipName, staged.values[tbDownPin]) != ERRNO_OK) {
+            staged.values[tbDownPin] = RADIOLIB_NC;
         }
     }
-    if (settingsMap.count(tbLeftPin) > 0 && settingsMap[tbLeftPin] != RADIOLIB_NC) {
-        if (initGPIOPin(settingsMap[tbLeftPin], defaultGpioChipName, settingsMap[tbLeftPin]) != ERRNO_OK) {
-            settingsMap[tbLeftPin] = RADIOLIB_NC;
+    if (staged.values[tbLeftPin] != RADIOLIB_NC) {
+        if (initGPIOPin(staged.values[tbLeftPin], defaultGpioChipName, staged.values[tbLeftPin]) != ERRNO_OK) {
+            staged.values[tbLeftPin] = RADIOLIB_NC;
         }
     }
-    if (settingsMap.count(tbRightPin) > 0 && settingsMap[tbRightPin] != RADIOLIB_NC) {
-        if (initGPIOPin(settingsMap[tbRightPin], defaultGpioChipName, settingsMap[tbRightPin]) != ERRNO_OK) {
-            settingsMap[tbRightPin] = RADIOLIB_NC;
+    if (staged.values[tbRightPin] != RADIOLIB_NC) {
+        if (initGPIOPin(staged.values[tbRightPin], defaultGpioChipName, staged.values[tbRightPin]) != ERRNO_OK) {
+            staged.values[tbRightPin] = RADIOLIB_NC;
         }
     }
-    if (settingsMap.count(tbPressPin) > 0 && settingsMap[tbPressPin] != RADIOLIB_NC) {
-        if (initGPIOPin(settingsMap[tbPressPin], defaultGpioChipName, settingsMap[tbPressPin]) != ERRNO_OK) {
-            settingsMap[tbPressPin] = RADIOLIB_NC;
+    if (staged.values[tbPressPin] != RADIOLIB_NC) {
+        if (initGPIOPin(staged.values[tbPressPin], defaultGpioChipName, staged.values[tbPressPin]) != ERRNO_OK) {
+            staged.values[tbPressPin] = RADIOLIB_NC;
         }
     }
-    if (settingsMap[displayPanel] != no_screen) {
-        if (settingsMap[displayCS] > 0)
-            initGPIOPin(settingsMap[displayCS], defaultGpioChipName, settingsMap[displayCS]);
-        if (settingsMap[displayDC] > 0)
-            initGPIOPin(settingsMap[displayDC], defaultGpioChipName, settingsMap[displayDC]);
-        if (settingsMap[displayBacklight] > 0)
-            initGPIOPin(settingsMap[displayBacklight], defaultGpioChipName, settingsMap[displayBacklight]);
-        if (settingsMap[displayReset] > 0)
-            initGPIOPin(settingsMap[displayReset], defaultGpioChipName, settingsMap[displayReset]);
+    if (staged.values[displayPanel] != no_screen) {
+        if (staged.values[displayCS] > 0)
+            initGPIOPin(staged.values[displayCS], defaultGpioChipName, staged.values[displayCS]);
+        if (staged.values[displayDC] > 0)
+            initGPIOPin(staged.values[displayDC], defaultGpioChipName, staged.values[displayDC]);
+        if (staged.values[displayBacklight] > 0)
+            initGPIOPin(staged.values[displayBacklight], defaultGpioChipName, staged.values[displayBacklight]);
+        if (staged.values[displayReset] > 0)
+            initGPIOPin(staged.values[displayReset], defaultGpioChipName, staged.values[displayReset]);
     }
-    if (settingsMap[touchscreenModule] != no_touchscreen) {
-        if (settingsMap[touchscreenCS] > 0)
-            initGPIOPin(settingsMap[touchscreenCS], defaultGpioChipName, settingsMap[touchscreenCS]);
-        if (settingsMap[touchscreenIRQ] > 0)
-            initGPIOPin(settingsMap[touchscreenIRQ], defaultGpioChipName, settingsMap[touchscreenIRQ]);
+    if (staged.values[touchscreenModule] != no_touchscreen) {
+        if (staged.values[touchscreenCS] > 0)
+            initGPIOPin(staged.values[touchscreenCS], defaultGpioChipName, staged.values[touchscreenCS]);
+        if (staged.values[touchscreenIRQ] > 0)
+            initGPIOPin(staged.values[touchscreenIRQ], defaultGpioChipName, staged.values[touchscreenIRQ]);
     }
 
     // Only initialize the radio pins when dealing with real, kernel controlled SPI hardware
-    if (settingsStrings[spidev] != "" && settingsStrings[spidev] != "ch341") {
+    if (staged.strings[spidev] != "" && staged.strings[spidev] != "ch341") {
         const struct {
             configNames pin;
             configNames gpiochip;
@@ -481,29 +516,36 @@ void portduinoSetup()
                            {txen_pin, txen_gpiochip, txen_line},
                            {sx126x_ant_sw_pin, sx126x_ant_sw_gpiochip, sx126x_ant_sw_line}};
         for (auto &pinMap : pinMappings) {
-            auto setMapIter = settingsMap.find(pinMap.pin);
-            if (setMapIter != settingsMap.end() && setMapIter->second != RADIOLIB_NC) {
-                if (initGPIOPin(setMapIter->second, gpioChipName + std::to_string(settingsMap[pinMap.gpiochip]),
-                                settingsMap[pinMap.line]) != ERRNO_OK) {
+            if (staged.values[pinMap.pin] != RADIOLIB_NC) {
+                if (initGPIOPin(staged.values[pinMap.pin], gpioChipName + std::to_string(staged.values[pinMap.gpiochip]),
+                                staged.values[pinMap.line]) != ERRNO_OK) {
                     printf("Error setting pin number %d. It may not exist, or may already be in use.\n",
-                           settingsMap[pinMap.line]);
+                           staged.values[pinMap.line]);
                     exit(EXIT_FAILURE);
                 }
             }
         }
-        SPI.begin(settingsStrings[spidev].c_str());
+        SPI.begin(staged.strings[spidev].c_str());
     }
-    if (settingsStrings[traceFilename] != "") {
+    if (staged.strings[traceFilename] != "") {
         try {
-            traceFile.open(settingsStrings[traceFilename], std::ios::out | std::ios::app);
+            traceFile.open(staged.strings[traceFilename], std::ios::out | std::ios::app);
         } catch (std::ofstream::failure &e) {
             std::cout << "*** traceFile Exception " << e.what() << std::endl;
             exit(EXIT_FAILURE);
         }
     }
-    if (verboseEnabled && settingsMap[logoutputlevel] != level_trace) {
-        settingsMap[logoutputlevel] = level_debug;
+    if (staged.strings[frameCaptureFilename] != "") {
+        frameCapture = new FrameCapture(staged.strings[frameCaptureFilename]);
+        if (!frameCapture->open()) {
+            std::cout << "*** Can't capture frames to " << staged.strings[frameCaptureFilename] << std::endl;
+            exit(EXIT_FAILURE);
+        }
     }
+    if (verboseEnabled && staged.values[logoutputlevel] != level_trace) {
+        staged.values[logoutputlevel] = level_debug;
+    }
+    publishSettings(staged);
 
     return;
 }
@@ -537,20 +579,21 @@ bool loadConfig(const char *configPath)
         yamlConfig = YAML::LoadFile(configPath);
         if (yamlConfig["Logging"]) {
             if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "trace") {
-                settingsMap[logoutputlevel] = level_trace;
+                staged.values[logoutputlevel] = level_trace;
             } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "debug") {
-                settingsMap[logoutputlevel] = level_debug;
+                staged.values[logoutputlevel] = level_debug;
             } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "info") {
-                settingsMap[logoutputlevel] = level_info;
+                staged.values[logoutputlevel] = level_info;
             } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "warn") {
-                settingsMap[logoutputlevel] = level_warn;
+                staged.values[logoutputlevel] = level_warn;
             } else if (yamlConfig["Logging"]["LogLevel"].as<std::string>("info") == "error") {
-                settingsMap[logoutputlevel] = level_error;
+                staged.values[logoutputlevel] = level_error;
             }
-            settingsStrings[traceFilename] = yamlConfig["Logging"]["TraceFile"].as<std::string>("");
+            staged.strings[traceFilename] = yamlConfig["Logging"]["TraceFile"].as<std::string>("");
+            staged.strings[frameCaptureFilename] = yamlConfig["Logging"]["FrameCaptureFile"].as<std::string>("");
             if (yamlConfig["Logging"]["AsciiLogs"]) {
                 // Default is !isatty(1) but can be set explicitly in config.yaml
-                settingsMap[ascii_logs] = yamlConfig["Logging"]["AsciiLogs"].as<bool>();
+                staged.values[ascii_logs] = yamlConfig["Logging"]["AsciiLogs"].as<bool>();
             }
         }
         if (yamlConfig["Lora"]) {
@@ -561,31 +604,31 @@ bool loadConfig(const char *configPath)
                                {use_sx1268, "sx1268"}, {use_sx1280, "sx1280"}, {use_lr1110, "lr1110"}, {use_lr1120, "lr1120"},
                                {use_lr1121, "lr1121"}, {use_llcc68, "LLCC68"}};
             for (auto &loraModule : loraModules) {
-                settingsMap[loraModule.cfgName] = false;
+                staged.values[loraModule.cfgName] = false;
             }
             if (yamlConfig["Lora"]["Module"]) {
                 for (auto &loraModule : loraModules) {
                     if (yamlConfig["Lora"]["Module"].as<std::string>("") == loraModule.strName) {
-                        settingsMap[loraModule.cfgName] = true;
+                        staged.values[loraModule.cfgName] = true;
                         break;
                     }
                 }
             }
 
-            settingsMap[sx126x_max_power] = yamlConfig["Lora"]["SX126X_MAX_POWER"].as<int>(22);
-            settingsMap[sx128x_max_power] = yamlConfig["Lora"]["SX128X_MAX_POWER"].as<int>(13);
-            settingsMap[lr1110_max_power] = yamlConfig["Lora"]["LR1110_MAX_POWER"].as<int>(22);
-            settingsMap[lr1120_max_power] = yamlConfig["Lora"]["LR1120_MAX_POWER"].as<int>(13);
-            settingsMap[rf95_max_power] = yamlConfig["Lora"]["RF95_MAX_POWER"].as<int>(20);
+            staged.values[sx126x_max_power] = yamlConfig["Lora"]["SX126X_MAX_POWER"].as<int>(22);
+            staged.values[sx128x_max_power] = yamlConfig["Lora"]["SX128X_MAX_POWER"].as<int>(13);
+            staged.values[lr1110_max_power] = yamlConfig["Lora"]["LR1110_MAX_POWER"].as<int>(22);
+            staged.values[lr1120_max_power] = yamlConfig["Lora"]["LR1120_MAX_POWER"].as<int>(13);
+            staged.values[rf95_max_power] = yamlConfig["Lora"]["RF95_MAX_POWER"].as<int>(20);
 
-            settingsMap[dio2_as_rf_switch] = yamlConfig["Lora"]["DIO2_AS_RF_SWITCH"].as<bool>(false);
-            settingsMap[dio3_tcxo_voltage] = yamlConfig["Lora"]["DIO3_TCXO_VOLTAGE"].as<float>(0) * 1000;
-            if (settingsMap[dio3_tcxo_voltage] == 0 && yamlConfig["Lora"]["DIO3_TCXO_VOLTAGE"].as<bool>(false)) {
-                settingsMap[dio3_tcxo_voltage] = 1800; // default millivolts for "true"
+            staged.values[dio2_as_rf_switch] = yamlConfig["Lora"]["DIO2_AS_RF_SWITCH"].as<bool>(false);
+            staged.values[dio3_tcxo_voltage] = yamlConfig["Lora"]["DIO3_TCXO_VOLTAGE"].as<float>(0) * 1000;
+            if (staged.values[dio3_tcxo_voltage] == 0 && yamlConfig["Lora"]["DIO3_TCXO_VOLTAGE"].as<bool>(false)) {
+                staged.values[dio3_tcxo_voltage] = 1800; // default millivolts for "true"
             }
 
             // backwards API compatibility and to globally set gpiochip once
-            int defaultGpioChip = settingsMap[default_gpiochip] = yamlConfig["Lora"]["gpiochip"].as<int>(0);
+            int defaultGpioChip = staged.values[default_gpiochip] = yamlConfig["Lora"]["gpiochip"].as<int>(0);
 
             const struct {
                 configNames pin;
@@ -603,33 +646,33 @@ bool loadConfig(const char *configPath)
             };
             for (auto &pinMap : pinMappings) {
                 if (yamlConfig["Lora"][pinMap.strName].IsMap()) {
-                    settingsMap[pinMap.pin] = yamlConfig["Lora"][pinMap.strName]["pin"].as<int>(RADIOLIB_NC);
-                    settingsMap[pinMap.line] = yamlConfig["Lora"][pinMap.strName]["line"].as<int>(settingsMap[pinMap.pin]);
-                    settingsMap[pinMap.gpiochip] = yamlConfig["Lora"][pinMap.strName]["gpiochip"].as<int>(defaultGpioChip);
+                    staged.values[pinMap.pin] = yamlConfig["Lora"][pinMap.strName]["pin"].as<int>(RADIOLIB_NC);
+                    staged.values[pinMap.line] = yamlConfig["Lora"][pinMap.strName]["line"].as<int>(staged.values[pinMap.pin]);
+                    staged.values[pinMap.gpiochip] = yamlConfig["Lora"][pinMap.strName]["gpiochip"].as<int>(defaultGpioChip);
                 } else { // backwards API compatibility
-                    settingsMap[pinMap.pin] = yamlConfig["Lora"][pinMap.strName].as<int>(RADIOLIB_NC);
-                    settingsMap[pinMap.line] = settingsMap[pinMap.pin];
-                    settingsMap[pinMap.gpiochip] = defaultGpioChip;
+                    staged.values[pinMap.pin] = yamlConfig["Lora"][pinMap.strName].as<int>(RADIOLIB_NC);
+                    staged.values[pinMap.line] = staged.values[pinMap.pin];
+                    staged.values[pinMap.gpiochip] = defaultGpioChip;
                 }
             }
 
-            settingsMap[spiSpeed] = yamlConfig["Lora"]["spiSpeed"].as<int>(2000000);
-            settingsStrings[lora_usb_serial_num] = yamlConfig["Lora"]["USB_Serialnum"].as<std::string>("");
-            settingsMap[lora_usb_pid] = yamlConfig["Lora"]["USB_PID"].as<int>(0x5512);
-            settingsMap[lora_usb_vid] = yamlConfig["Lora"]["USB_VID"].as<int>(0x1A86);
-
-            settingsStrings[spidev] = yamlConfig["Lora"]["spidev"].as<std::string>("spidev0.0");
-            if (settingsStrings[spidev] != "ch341") {
-                settingsStrings[spidev] = "/dev/" + settingsStrings[spidev];
-                if (settingsStrings[spidev].length() == 14) {
-                    int x = settingsStrings[spidev].at(11) - '0';
-                    int y = settingsStrings[spidev].at(13) - '0';
+            staged.values[spiSpeed] = yamlConfig["Lora"]["spiSpeed"].as<int>(2000000);
+            staged.strings[lora_usb_serial_num] = yamlConfig["Lora"]["USB_Serialnum"].as<std::string>("");
+            staged.values[lora_usb_pid] = yamlConfig["Lora"]["USB_PID"].as<int>(0x5512);
+            staged.values[lora_usb_vid] = yamlConfig["Lora"]["USB_VID"].as<int>(0x1A86);
+
+            staged.strings[spidev] = yamlConfig["Lora"]["spidev"].as<std::string>("spidev0.0");
+            if (staged.strings[spidev] != "ch341") {
+                staged.strings[spidev] = "/dev/" + staged.strings[spidev];
+                if (staged.strings[spidev].length() == 14) {
+                    int x = staged.strings[spidev].at(11) - '0';
+                    int y = staged.strings[spidev].at(13) - '0';
                     // Pretty sure this is always true
                     if (x >= 0 && x < 10 && y >= 0 && y < 10) {
                         // I believe this bit of weirdness is specifically for the new GUI
-                        settingsMap[spidev] = x + y << 4;
-                        settingsMap[displayspidev] = settingsMap[spidev];
-                        settingsMap[touchscreenspidev] = settingsMap[spidev];
+                        staged.values[spidev] = x + y << 4;
+                        staged.values[displayspidev] = staged.values[spidev];
+                        staged.values[touchscreenspidev] = staged.values[spidev];
                     }
                 }
             }
@@ -677,162 +720,169 @@ bool loadConfig(const char *configPath)
             }
         }
         if (yamlConfig["GPIO"]) {
-            settingsMap[userButtonPin] = yamlConfig["GPIO"]["User"].as<int>(RADIOLIB_NC);
+            staged.values[userButtonPin] = yamlConfig["GPIO"]["User"].as<int>(RADIOLIB_NC);
         }
         if (yamlConfig["GPS"]) {
             std::string serialPath = yamlConfig["GPS"]["SerialPath"].as<std::string>("");
             if (serialPath != "") {
                 Serial1.setPath(serialPath);
-                settingsMap[has_gps] = 1;
+                staged.values[has_gps] = 1;
             }
         }
         if (yamlConfig["I2C"]) {
-            settingsStrings[i2cdev] = yamlConfig["I2C"]["I2CDevice"].as<std::string>("");
+            staged.strings[i2cdev] = yamlConfig["I2C"]["I2CDevice"].as<std::string>("");
         }
         if (yamlConfig["Display"]) {
             if (yamlConfig["Display"]["Panel"].as<std::string>("") == "ST7789")
-                settingsMap[displayPanel] = st7789;
+                staged.values[displayPanel] = st7789;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "ST7735")
-                settingsMap[displayPanel] = st7735;
+                staged.values[displayPanel] = st7735;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "ST7735S")
-                settingsMap[displayPanel] = st7735s;
+                staged.values[displayPanel] = st7735s;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "ST7796")
-                settingsMap[displayPanel] = st7796;
+                staged.values[displayPanel] = st7796;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "ILI9341")
-                settingsMap[displayPanel] = ili9341;
+                staged.values[displayPanel] = ili9341;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "ILI9342")
-                settingsMap[displayPanel] = ili9342;
+                staged.values[displayPanel] = ili9342;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "ILI9486")
-                settingsMap[displayPanel] = ili9486;
+                staged.values[displayPanel] = ili9486;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "ILI9488")
-                settingsMap[displayPanel] = ili9488;
+                staged.values[displayPanel] = ili9488;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "HX8357D")
-                settingsMap[displayPanel] = hx8357d;
+                staged.values[displayPanel] = hx8357d;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "X11")
-                settingsMap[displayPanel] = x11;
+                staged.values[displayPanel] = x11;
             else if (yamlConfig["Display"]["Panel"].as<std::string>("") == "FB")
-                settingsMap[displayPanel] = fb;
-            settingsMap[displayHeight] = yamlConfig["Display"]["Height"].as<int>(0);
-            settingsMap[displayWidth] = yamlConfig["Display"]["Width"].as<int>(0);
-            settingsMap[displayDC] = yamlConfig["Display"]["DC"].as<int>(-1);
-            settingsMap[displayCS] = yamlConfig["Display"]["CS"].as<int>(-1);
-            settingsMap[displayRGBOrder] = yamlConfig["Display"]["RGBOrder"].as<bool>(false);
-            settingsMap[displayBacklight] = yamlConfig["Display"]["Backlight"].as<int>(-1);
-            settingsMap[displayBacklightInvert] = yamlConfig["Display"]["BacklightInvert"].as<bool>(false);
-            settingsMap[displayBacklightPWMChannel] = yamlConfig["Display"]["BacklightPWMChannel"].as<int>(-1);
-            settingsMap[displayReset] = yamlConfig["Display"]["Reset"].as<int>(-1);
-            settingsMap[displayOffsetX] = yamlConfig["Display"]["OffsetX"].as<int>(0);
-            settingsMap[displayOffsetY] = yamlConfig["Display"]["OffsetY"].as<int>(0);
-            settingsMap[displayRotate] = yamlConfig["Display"]["Rotate"].as<bool>(false);
-            settingsMap[displayOffsetRotate] = yamlConfig["Display"]["OffsetRotate"].as<int>(1);
-            settingsMap[displayInvert] = yamlConfig["Display"]["Invert"].as<bool>(false);
-            settingsMap[displayBusFrequency] = yamlConfig["Display"]["BusFrequency"].as<int>(40000000);
+                staged.values[displayPanel] = fb;
+            staged.values[displayHeight] = yamlConfig["Display"]["Height"].as<int>(0);
+            staged.values[displayWidth] = yamlConfig["Display"]["Width"].as<int>(0);
+            staged.values[displayDC] = yamlConfig["Display"]["DC"].as<int>(-1);
+            staged.values[displayCS] = yamlConfig["Display"]["CS"].as<int>(-1);
+            staged.values[displayRGBOrder] = yamlConfig["Display"]["RGBOrder"].as<bool>(false);
+            staged.values[displayBacklight] = yamlConfig["Display"]["Backlight"].as<int>(-1);
+            staged.values[displayBacklightInvert] = yamlConfig["Display"]["BacklightInvert"].as<bool>(false);
+            staged.values[displayBacklightPWMChannel] = yamlConfig["Display"]["BacklightPWMChannel"].as<int>(-1);
+            staged.values[displayReset] = yamlConfig["Display"]["Reset"].as<int>(-1);
+            staged.values[displayOffsetX] = yamlConfig["Display"]["OffsetX"].as<int>(0);
+            staged.values[displayOffsetY] = yamlConfig["Display"]["OffsetY"].as<int>(0);
+            staged.values[displayRotate] = yamlConfig["Display"]["Rotate"].as<bool>(false);
+            staged.values[displayOffsetRotate] = yamlConfig["Display"]["OffsetRotate"].as<int>(1);
+            staged.values[displayInvert] = yamlConfig["Display"]["Invert"].as<bool>(false);
+            staged.values[displayBusFrequency] = yamlConfig["Display"]["BusFrequency"].as<int>(40000000);
             if (yamlConfig["Display"]["spidev"]) {
-                settingsStrings[displayspidev] = "/dev/" + yamlConfig["Display"]["spidev"].as<std::string>("spidev0.1");
-                if (settingsStrings[displayspidev].length() == 14) {
-                    int x = settingsStrings[displayspidev].at(11) - '0';
-                    int y = settingsStrings[displayspidev].at(13) - '0';
+                staged.strings[displayspidev] = "/dev/" + yamlConfig["Display"]["spidev"].as<std::string>("spidev0.1");
+                if (staged.strings[displayspidev].length() == 14) {
+                    int x = staged.strings[displayspidev].at(11) - '0';
+                    int y = staged.strings[displayspidev].at(13) - '0';
                     if (x >= 0 && x < 10 && y >= 0 && y < 10) {
-                        settingsMap[displayspidev] = x + y << 4;
-                        settingsMap[touchscreenspidev] = settingsMap[displayspidev];
+                        staged.values[displayspidev] = x + y << 4;
+                        staged.values[touchscreenspidev] = staged.values[displayspidev];
                     }
                 }
             }
         }
         if (yamlConfig["Touchscreen"]) {
             if (yamlConfig["Touchscreen"]["Module"].as<std::string>("") == "XPT2046")
-                settingsMap[touchscreenModule] = xpt2046;
+                staged.values[touchscreenModule] = xpt2046;
             else if (yamlConfig["Touchscreen"]["Module"].as<std::string>("") == "STMPE610")
-                settingsMap[touchscreenModule] = stmpe610;
+                staged.values[touchscreenModule] = stmpe610;
             else if (yamlConfig["Touchscreen"]["Module"].as<std::string>("") == "GT911")
-                settingsMap[touchscreenModule] = gt911;
+                staged.values[touchscreenModule] = gt911;
             else if (yamlConfig["Touchscreen"]["Module"].as<std::string>("") == "FT5x06")
-                settingsMap[touchscreenModule] = ft5x06;
-            settingsMap[touchscreenCS] = yamlConfig["Touchscreen"]["CS"].as<int>(-1);
-            settingsMap[touchscreenIRQ] = yamlConfig["Touchscreen"]["IRQ"].as<int>(-1);
-            settingsMap[touchscreenBusFrequency] = yamlConfig["Touchscreen"]["BusFrequency"].as<int>(1000000);
-            settingsMap[touchscreenRotate] = yamlConfig["Touchscreen"]["Rotate"].as<int>(-1);
-            settingsMap[touchscreenI2CAddr] = yamlConfig["Touchscreen"]["I2CAddr"].as<int>(-1);
+                staged.values[touchscreenModule] = ft5x06;
+            staged.values[touchscreenCS] = yamlConfig["Touchscreen"]["CS"].as<int>(-1);
+            staged.values[touchscreenIRQ] = yamlConfig["Touchscreen"]["IRQ"].as<int>(-1);
+            staged.values[touchscreenBusFrequency] = yamlConfig["Touchscreen"]["BusFrequency"].as<int>(1000000);
+            staged.values[touchscreenRotate] = yamlConfig["Touchscreen"]["Rotate"].as<int>(-1);
+            staged.values[touchscreenI2CAddr] = yamlConfig["Touchscreen"]["I2CAddr"].as<int>(-1);
             if (yamlConfig["Touchscreen"]["spidev"]) {
-                settingsStrings[touchscreenspidev] = "/dev/" + yamlConfig["Touchscreen"]["spidev"].as<std::string>("");
-                if (settingsStrings[touchscreenspidev].length() == 14) {
-                    int x = settingsStrings[touchscreenspidev].at(11) - '0';
-                    int y = settingsStrings[touchscreenspidev].at(13) - '0';
+                staged.strings[touchscreenspidev] = "/dev/" + yamlConfig["Touchscreen"]["spidev"].as<std::string>("");
+                if (staged.strings[touchscreenspidev].length() == 14) {
+                    int x = staged.strings[touchscreenspidev].at(11) - '0';
+                    int y = staged.strings[touchscreenspidev].at(13) - '0';
                     if (x >= 0 && x < 10 && y >= 0 && y < 10) {
-                        settingsMap[touchscreenspidev] = x + y << 4;
+                        staged.values[touchscreenspidev] = x + y << 4;
                     }
                 }
             }
         }
         if (yamlConfig["Input"]) {
-            settingsStrings[keyboardDevice] = (yamlConfig["Input"]["KeyboardDevice"]).as<std::string>("");
-            settingsStrings[pointerDevice] = (yamlConfig["Input"]["PointerDevice"]).as<std::string>("");
-            settingsMap[userButtonPin] = yamlConfig["Input"]["User"].as<int>(RADIOLIB_NC);
-            settingsMap[tbUpPin] = yamlConfig["Input"]["TrackballUp"].as<int>(RADIOLIB_NC);
-            settingsMap[tbDownPin] = yamlConfig["Input"]["TrackballDown"].as<int>(RADIOLIB_NC);
-            settingsMap[tbLeftPin] = yamlConfig["Input"]["TrackballLeft"].as<int>(RADIOLIB_NC);
-            settingsMap[tbRightPin] = yamlConfig["Input"]["TrackballRight"].as<int>(RADIOLIB_NC);
-            settingsMap[tbPressPin] = yamlConfig["Input"]["TrackballPress"].as<int>(RADIOLIB_NC);
+            staged.strings[keyboardDevice] = (yamlConfig["Input"]["KeyboardDevice"]).as<std::string>("");
+            staged.strings[pointerDevice] = (yamlConfig["Input"]["PointerDevice"]).as<std::string>("");
+            staged.values[userButtonPin] = yamlConfig["Input"]["User"].as<int>(RADIOLIB_NC);
+            staged.values[tbUpPin] = yamlConfig["Input"]["TrackballUp"].as<int>(RADIOLIB_NC);
+            staged.values[tbDownPin] = yamlConfig["Input"]["TrackballDown"].as<int>(RADIOLIB_NC);
+            staged.values[tbLeftPin] = yamlConfig["Input"]["TrackballLeft"].as<int>(RADIOLIB_NC);
+            staged.values[tbRightPin] = yamlConfig["Input"]["TrackballRight"].as<int>(RADIOLIB_NC);
+            staged.values[tbPressPin] = yamlConfig["Input"]["TrackballPress"].as<int>(RADIOLIB_NC);
             if (yamlConfig["Input"]["TrackballDirection"].as<std::string>("RISING") == "RISING") {
-                settingsMap[tbDirection] = 4;
+                staged.values[tbDirection] = 4;
             } else if (yamlConfig["Input"]["TrackballDirection"].as<std::string>("RISING") == "FALLING") {
-                settingsMap[tbDirection] = 3;
+                staged.values[tbDirection] = 3;
             }
         }
 
         if (yamlConfig["Webserver"]) {
-            settingsMap[webserverport] = (yamlConfig["Webserver"]["Port"]).as<int>(-1);
-            settingsStrings[webserverrootpath] =
+            staged.values[webserverport] = (yamlConfig["Webserver"]["Port"]).as<int>(-1);
+            staged.strings[webserverrootpath] =
                 (yamlConfig["Webserver"]["RootPath"]).as<std::string>("/usr/share/meshtasticd/web");
-            settingsStrings[websslkeypath] =
+            staged.strings[websslkeypath] =
                 (yamlConfig["Webserver"]["SSLKey"]).as<std::string>("/etc/meshtasticd/ssl/private_key.pem");
-            settingsStrings[websslcertpath] =
+            staged.strings[websslcertpath] =
                 (yamlConfig["Webserver"]["SSLCert"]).as<std::string>("/etc/meshtasticd/ssl/certificate.pem");
         }
 
         if (yamlConfig["HostMetrics"]) {
-            settingsMap[hostMetrics_channel] = (yamlConfig["HostMetrics"]["Channel"]).as<int>(0);
-            settingsMap[hostMetrics_interval] = (yamlConfig["HostMetrics"]["ReportInterval"]).as<int>(0);
-            settingsStrings[hostMetrics_user_command] = (yamlConfig["HostMetrics"]["UserStringCommand"]).as<std::string>("");
+            staged.values[hostMetrics_channel] = (yamlConfig["HostMetrics"]["Channel"]).as<int>(0);
+            staged.values[hostMetrics_interval] = (yamlConfig["HostMetrics"]["ReportInterval"]).as<int>(0);
+            staged.strings[hostMetrics_user_command] = (yamlConfig["HostMetrics"]["UserStringCommand"]).as<std::string>("");
+        }
+
+        if (yamlConfig["MQTT"]) {
+            staged.strings[mqttSpool_directory] = (yamlConfig["MQTT"]["SpoolDirectory"]).as<std::string>("");
+            staged.values[mqttSpool_maxSize] = (yamlConfig["MQTT"]["SpoolMaxSize"]).as<int>(64);
         }
 
         if (yamlConfig["Config"]) {
             if (yamlConfig["Config"]["DisplayMode"]) {
-                settingsMap[has_configDisplayMode] = true;
+                staged.values[has_configDisplayMode] = true;
                 if ((yamlConfig["Config"]["DisplayMode"]).as<std::string>("") == "TWOCOLOR") {
-                    settingsMap[configDisplayMode] = meshtastic_Config_DisplayConfig_DisplayMode_TWOCOLOR;
+                    staged.values[configDisplayMode] = meshtastic_Config_DisplayConfig_DisplayMode_TWOCOLOR;
                 } else if ((yamlConfig["Config"]["DisplayMode"]).as<std::string>("") == "INVERTED") {
-                    settingsMap[configDisplayMode] = meshtastic_Config_DisplayConfig_DisplayMode_INVERTED;
+                    staged.values[configDisplayMode] = meshtastic_Config_DisplayConfig_DisplayMode_INVERTED;
                 } else if ((yamlConfig["Config"]["DisplayMode"]).as<std::string>("") == "COLOR") {
-                    settingsMap[configDisplayMode] = meshtastic_Config_DisplayConfig_DisplayMode_COLOR;
+                    staged.values[configDisplayMode] = meshtastic_Config_DisplayConfig_DisplayMode_COLOR;
                 } else {
-                    settingsMap[configDisplayMode] = meshtastic_Config_DisplayConfig_DisplayMode_DEFAULT;
+                    staged.values[configDisplayMode] = meshtastic_Config_DisplayConfig_DisplayMode_DEFAULT;
                 }
             }
         }
 
         if (yamlConfig["General"]) {
-            settingsMap[maxnodes] = (yamlConfig["General"]["MaxNodes"]).as<int>(200);
-            settingsMap[maxtophone] = (yamlConfig["General"]["MaxMessageQueue"]).as<int>(100);
-            settingsStrings[config_directory] = (yamlConfig["General"]["ConfigDirectory"]).as<std::string>("");
-            settingsStrings[available_directory] =
+            staged.values[maxnodes] = (yamlConfig["General"]["MaxNodes"]).as<int>(200);
+            staged.values[maxtophone] = (yamlConfig["General"]["MaxMessageQueue"]).as<int>(100);
+            staged.values[packetPoolPrealloc] = (yamlConfig["General"]["PacketPool"]).as<bool>(false);
+            staged.values[packetPoolAllowHeapFallback] = (yamlConfig["General"]["PacketPoolHeapFallback"]).as<bool>(true);
+            staged.strings[config_directory] = (yamlConfig["General"]["ConfigDirectory"]).as<std::string>("");
+            staged.strings[available_directory] =
                 (yamlConfig["General"]["AvailableDirectory"]).as<std::string>("/etc/meshtasticd/available.d/");
             if ((yamlConfig["General"]["MACAddress"]).as<std::string>("") != "" &&
                 (yamlConfig["General"]["MACAddressSource"]).as<std::string>("") != "") {
                 std::cout << "Cannot set both MACAddress and MACAddressSource!" << std::endl;
                 exit(EXIT_FAILURE);
             }
-            settingsStrings[mac_address] = (yamlConfig["General"]["MACAddress"]).as<std::string>("");
+            staged.strings[mac_address] = (yamlConfig["General"]["MACAddress"]).as<std::string>("");
             if ((yamlConfig["General"]["MACAddressSource"]).as<std::string>("") != "") {
                 std::ifstream infile("/sys/class/net/" + (yamlConfig["General"]["MACAddressSource"]).as<std::string>("") +
                                      "/address");
-                std::getline(infile, settingsStrings[mac_address]);
+                std::getline(infile, staged.strings[mac_address]);
             }
 
             // https://stackoverflow.com/a/20326454
-            settingsStrings[mac_address].erase(
-                std::remove(settingsStrings[mac_address].begin(), settingsStrings[mac_address].end(), ':'),
-                settingsStrings[mac_address].end());
+            staged.strings[mac_address].erase(
+                std::remove(staged.strings[mac_address].begin(), staged.strings[mac_address].end(), ':'),
+                staged.strings[mac_address].end());
         }
     } catch (YAML::Exception &e) {
         std::cout << "*** Exception " << e.what() << std::endl;
@@ -841,6 +891,57 @@ bool loadConfig(const char *configPath)
     return true;
 }
 
+/// Let the console know, so LOG_* calls the log level now filters out stop evaluating their arguments
+static void settingsChanged()
+{
+    if (console)
+        console->updateLogLevels();
+}
+
+/// Make s current, with publishLock held
+static void swapInSettings(const PortduinoSettings *s)
+{
+    const PortduinoSettings *old = currentSettings.exchange(s, std::memory_order_acq_rel);
+    if (old != &defaultSettings)
+        retiredSettings.emplace_back(old);
+}
+
+void publishSettings(const PortduinoSettings &s)
+{
+    {
+        std::lock_guard<std::mutex> guard(publishLock);
+        swapInSettings(new PortduinoSettings(s));
+    }
+    settingsChanged();
+}
+
+void updateSettings(const std::function<void(PortduinoSettings &)> &change)
+{
+    {
+        std::lock_guard<std::mutex> guard(publishLock);
+        PortduinoSettings *s = new PortduinoSettings(getSettings());
+        change(*s);
+        swapInSettings(s);
+    }
+    settingsChanged();
+}
+
+void setSetting(configNames name, int value)
+{
+    updateSettings([name, value](PortduinoSettings &s) { s.values[name] = value; });
+}
+
+void setSettingString(configNames name, const std::string &value)
+{
+    updateSettings([name, &value](PortduinoSettings &s) { s.strings[name] = value; });
+}
+
+void freeRetiredSettings()
+{
+    std::lock_guard<std::mutex> guard(publishLock);
+    retiredSettings.clear();
+}
+
 // https://stackoverflow.com/questions/874134/find-out-if-string-ends-with-another-string-in-c
 static bool ends_with(std::string_view str, std::string_view suffix)
 {
@@ -851,12 +952,12 @@ bool MAC_from_string(std::string mac_str, uint8_t *dmac)
 {
     mac_str.erase(std::remove(mac_str.begin(), mac_str.end(), ':'), mac_str.end());
     if (mac_str.length() == 12) {
-        dmac[0] = std::stoi(settingsStrings[mac_address].substr(0, 2), nullptr, 16);
-        dmac[1] = std::stoi(settingsStrings[mac_address].substr(2, 2), nullptr, 16);
-        dmac[2] = std::stoi(settingsStrings[mac_address].substr(4, 2), nullptr, 16);
-        dmac[3] = std::stoi(settingsStrings[mac_address].substr(6, 2), nullptr, 16);
-        dmac[4] = std::stoi(settingsStrings[mac_address].substr(8, 2), nullptr, 16);
-        dmac[5] = std::stoi(settingsStrings[mac_address].substr(10, 2), nullptr, 16);
+        dmac[0] = std::stoi(mac_str.substr(0, 2), nullptr, 16);
+        dmac[1] = std::stoi(mac_str.substr(2, 2), nullptr, 16);
+        dmac[2] = std::stoi(mac_str.substr(4, 2), nullptr, 16);
+        dmac[3] = std::stoi(mac_str.substr(6, 2), nullptr, 16);
+        dmac[4] = std::stoi(mac_str.substr(8, 2), nullptr, 16);
+        dmac[5] = std::stoi(mac_str.substr(10, 2), nullptr, 16);
         return true;
     } else {
         return false;
@@ -1,6 +1,9 @@
 #pragma once
+#include <atomic>
 #include <fstream>
+#include <functional>
 #include <map>
+#include <string>
 #include <unordered_map>
 
 #include "LR11x0Interface.h"
@@ -108,6 +111,8 @@ enum configNames {
     websslcertpath,
     maxtophone,
     maxnodes,
+    packetPoolPrealloc,
+    packetPoolAllowHeapFallback,
     ascii_logs,
     config_directory,
     available_directory,
@@ -115,15 +120,99 @@ enum configNames {
     hostMetrics_interval,
     hostMetrics_channel,
     hostMetrics_user_command,
+    mqttSpool_directory,
+    mqttSpool_maxSize,
+    frameCaptureFilename,
     configDisplayMode,
-    has_configDisplayMode
+    has_configDisplayMode,
+    configNamesCount
 };
 enum { no_screen, x11, fb, st7789, st7735, st7735s, st7796, ili9341, ili9342, ili9486, ili9488, hx8357d };
 enum { no_touchscreen, xpt2046, stmpe610, gt911, ft5x06 };
 enum { level_error, level_warn, level_info, level_debug, level_trace };
 
-extern std::map<configNames, int> settingsMap;
-extern std::map<configNames, std::string> settingsStrings;
+/// The settings that are text.  The spidev ones are also numbers: the bus the path names.
+constexpr bool hasStringValue(configNames name)
+{
+    switch (name) {
+    case spidev:
+    case displayspidev:
+    case touchscreenspidev:
+    case lora_usb_serial_num:
+    case i2cdev:
+    case keyboardDevice:
+    case pointerDevice:
+    case traceFilename:
+    case frameCaptureFilename:
+    case webserverrootpath:
+    case websslkeypath:
+    case websslcertpath:
+    case config_directory:
+    case available_directory:
+    case mac_address:
+    case hostMetrics_user_command:
+    case mqttSpool_directory:
+        return true;
+    default:
+        return false;
+    }
+}
+
+constexpr bool hasIntValue(configNames name)
+{
+    return !hasStringValue(name) || name == spidev || name == displayspidev || name == touchscreenspidev;
+}
+
+/**
+ * Everything read from config.yaml, with a slot for every setting.  loadConfig() fills one in and portduinoSetup() publishes
+ * it; a published snapshot is never changed again, so it is read without locks.  Settings that weren't given are 0 or "".
+ */
+struct PortduinoSettings {
+    int values[configNamesCount] = {};
+    std::string strings[configNamesCount];
+};
+
+extern std::atomic<const PortduinoSettings *> currentSettings;
+
+/// Make s the settings everyone reads.  The old snapshot is retired, not freed, as a reader may still be looking at it.
+void publishSettings(const PortduinoSettings &s);
+
+/// Publish a copy of the current settings with every change made to it, e.g. updateSettings([](auto &s) {...})
+void updateSettings(const std::function<void(PortduinoSettings &)> &change);
+
+/// Publish a copy of the current settings with one changed.  Use updateSettings() to change several at once.
+void setSetting(configNames name, int value);
+void setSettingString(configNames name, const std::string &value);
+
+/// Free every retired snapshot.  Only for tests between cases, when nothing can still hold a reference into one.
+void freeRetiredSettings();
+
+/// The settings as of now.  Hold on to the reference to read several settings from the same snapshot.
+inline const PortduinoSettings &getSettings()
+{
+    return *currentSettings.load(std::memory_order_acquire);
+}
+
+/// A numeric setting, e.g. getSetting<maxnodes>()
+template <configNames name> inline int getSetting()
+{
+    static_assert(hasIntValue(name), "This setting is text, use getSettingString()");
+    return getSettings().values[name];
+}
+
+/// A text setting, e.g. getSettingString<spidev>()
+template <configNames name> inline const std::string &getSettingString()
+{
+    static_assert(hasStringValue(name), "This setting is a number, use getSetting()");
+    return getSettings().strings[name];
+}
+
+/// For settings only known at run time, such as the entries of a table of radio modules
+inline int getSetting(configNames name)
+{
+    return getSettings().values[name];
+}
+
 extern std::ofstream traceFile;
 extern Ch341Hal *ch341Hal;
 int initGPIOPin(int pinNum, std::string gpioChipname, int line);
@@ -140,4 +229,8 @@ extern struct portduino_config_struct {
     bool force_simradio = false;
     bool has_device_id = false;
     uint8_t device_id[16] = {0};
+    std::string replay_file; // --replay: feed this frame capture to the router instead of listening to a radio
+    bool replay_realtime = false;
+    std::string replay_outcome_file;
+    std::string replay_baseline_file;
 } portduino_config;
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "MeshTypes.h"
+
+class SimRadio;
+
+/**
+ * A simulated RF medium that SimRadios can transmit into, so that many nodes can share one process.
+ *
+ * A SimRadio attached to a medium (see SimRadio::setMedium()) no longer loops its packets back to an external simulator
+ * through the phone API, and takes all of its timing (transmit delays, airtime) from the medium's clock rather than from
+ * millis().  The medium decides who hears each transmission and delivers the packets that arrive intact with
+ * SimRadio::receiveFromMedium().
+ */
+class SimMedium
+{
+  public:
+    virtual ~SimMedium() {}
+
+    /// radio starts transmitting p, which will be on the air for airtimeMsec
+    virtual void transmit(SimRadio *radio, const meshtastic_MeshPacket &p, uint32_t airtimeMsec) = 0;
+
+    /// Call radio->onMediumTimer(notification) after msec of simulated time
+    virtual void schedule(SimRadio *radio, uint32_t msec, uint32_t notification) = 0;
+
+    /// Is radio hearing a transmission right now (the equivalent of CAD)
+    virtual bool isChannelActive(SimRadio *radio) = 0;
+};
@@ -1,6 +1,7 @@
 #include "SimRadio.h"
 #include "MeshService.h"
 #include "Router.h"
+#include "mesh/FrameCapture.h"
 
 SimRadio::SimRadio() : NotifiedWorkerThread("SimRadio")
 {
@@ -53,7 +54,7 @@ void SimRadio::startTransmitTimer(bool withDelay)
     if (!txQueue.empty()) {
         uint32_t delayMsec = !withDelay ? 1 : getTxDelayMsec();
         // LOG_DEBUG("xmit timer %d", delay);
-        notifyLater(delayMsec, TRANSMIT_DELAY_COMPLETED, false);
+        notifyAfter(delayMsec, TRANSMIT_DELAY_COMPLETED);
     }
 }
 
@@ -63,7 +64,7 @@ void SimRadio::startTransmitTimerSNR(float snr)
     if (!txQueue.empty()) {
         uint32_t delayMsec = getTxDelayMsecWeighted(snr);
         // LOG_DEBUG("xmit timer %d", delay);
-        notifyLater(delayMsec, TRANSMIT_DELAY_COMPLETED, false);
+        notifyAfter(delayMsec, TRANSMIT_DELAY_COMPLETED);
     }
 }
 
@@ -119,12 +120,28 @@ bool SimRadio::canSendImmediately()
 
 bool SimRadio::isActivelyReceiving()
 {
-    return receivingPacket != nullptr;
+    return receivingPacket != nullptr || (medium && medium->isChannelActive(this));
 }
 
 bool SimRadio::isChannelActive()
 {
-    return receivingPacket != nullptr;
+    return receivingPacket != nullptr || (medium && medium->isChannelActive(this));
+}
+
+void SimRadio::notifyAfter(uint32_t msec, uint32_t notification)
+{
+    if (!medium) {
+        notifyLater(msec, notification, false);
+    } else if (mediumNotification == 0) {
+        mediumNotification = notification;
+        medium->schedule(this, msec, notification);
+    }
+}
+
+void SimRadio::onMediumTimer(uint32_t notification)
+{
+    mediumNotification = 0;
+    onNotify(notification);
 }
 
 /** Attempt to cancel a previously sent packet.  Returns true if a packet was found we could cancel */
@@ -185,7 +202,7 @@ void SimRadio::onNotify(uint32_t notification)
                     uint32_t xmitMsec = getPacketTime(txp);
                     airTime->logAirtime(TX_LOG, xmitMsec);
 
-                    notifyLater(xmitMsec, ISR_TX, false); // Model the time it is busy sending
+                    notifyAfter(xmitMsec, ISR_TX); // Model the time it is busy sending
                 }
             }
         } else {
@@ -203,6 +220,10 @@ void SimRadio::startSend(meshtastic_MeshPacket *txp)
     printPacket("Start low level send", txp);
     isReceiving = false;
     size_t numbytes = beginSending(txp);
+    if (medium) {
+        medium->transmit(this, *txp, getPacketTime(txp));
+        return;
+    }
     meshtastic_MeshPacket *p = packetPool.allocCopy(*txp);
     perhapsDecode(p);
     meshtastic_Compressed c = meshtastic_Compressed_init_default;
@@ -280,6 +301,17 @@ void SimRadio::startReceive(meshtastic_MeshPacket *p)
 #endif
 }
 
+void SimRadio::receiveFromMedium(const meshtastic_MeshPacket &p, float snr, int32_t rssi)
+{
+    // The medium only delivers what arrived intact, after its airtime, so there is nothing left to model here
+    isReceiving = true;
+    receivingPacket = packetPool.allocCopy(p);
+    receivingPacket->rx_snr = snr;
+    receivingPacket->rx_rssi = rssi;
+    handleReceiveInterrupt();
+    startTransmitTimer();
+}
+
 meshtastic_QueueStatus SimRadio::getQueueStatus()
 {
     meshtastic_QueueStatus qs;
@@ -309,6 +341,9 @@ void SimRadio::handleReceiveInterrupt()
     packetPool.release(receivingPacket);                                // release the original
     receivingPacket = nullptr;
 
+    if (frameCapture)
+        frameCapture->write(*mp);
+
     printPacket("Lora RX", mp);
 
     airTime->logAirtime(RX_LOG, getPacketTime(mp));
@@ -318,6 +353,8 @@ void SimRadio::handleReceiveInterrupt()
 
 size_t SimRadio::getPacketLength(meshtastic_MeshPacket *mp)
 {
+    if (mp->which_payload_variant == meshtastic_MeshPacket_encrypted_tag)
+        return (size_t)mp->encrypted.size + sizeof(PacketHeader);
     auto &p = mp->decoded;
     return (size_t)p.payload.size + sizeof(PacketHeader);
 }
@@ -2,6 +2,7 @@
 
 #include "MeshPacketQueue.h"
 #include "RadioInterface.h"
+#include "SimMedium.h"
 #include "api/WiFiServerAPI.h"
 #include "concurrency/NotifiedWorkerThread.h"
 
@@ -48,6 +49,15 @@ class SimRadio : public RadioInterface, protected concurrency::NotifiedWorkerThr
     // Convert Compressed_msg to normal msg and receive it
     void unpackAndReceive(meshtastic_MeshPacket &p);
 
+    /// Transmit into this medium (and run on its clock), rather than back to the simulator through the phone API
+    void setMedium(SimMedium *m) { medium = m; }
+
+    /// The medium delivering a packet that reached us intact
+    void receiveFromMedium(const meshtastic_MeshPacket &p, float snr, int32_t rssi);
+
+    /// The medium firing a timer we set with SimMedium::schedule()
+    void onMediumTimer(uint32_t notification);
+
     /**
      * Debugging counts
      */
@@ -81,6 +91,12 @@ class SimRadio : public RadioInterface, protected concurrency::NotifiedWorkerThr
 
     meshtastic_MeshPacket *receivingPacket = nullptr; // The packet we are currently receiving
 
+    SimMedium *medium = nullptr;
+    uint32_t mediumNotification = 0; // pending timer set through the medium, 0 if none
+
+    /// notifyLater() without overwriting, through the medium's clock if we have one
+    void notifyAfter(uint32_t msec, uint32_t notification);
+
   protected:
     /** Could we send right now (i.e. either not actively receiving or transmitting)? */
     virtual bool canSendImmediately();
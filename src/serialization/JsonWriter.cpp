@@ -0,0 +1,155 @@
+#include "JsonWriter.h"
+#include <math.h>
+#include <stdio.h>
+
+void JsonWriter::next(const char *key)
+{
+    if (!first)
+        out += ',';
+    first = false;
+    if (key) {
+        addString(key, strlen(key));
+        out += ':';
+    }
+}
+
+void JsonWriter::beginObject(const char *key)
+{
+    next(key);
+    out += '{';
+    first = true;
+}
+
+void JsonWriter::endObject()
+{
+    out += '}';
+    first = false;
+}
+
+void JsonWriter::beginArray(const char *key)
+{
+    next(key);
+    out += '[';
+    first = true;
+}
+
+void JsonWriter::endArray()
+{
+    out += ']';
+    first = false;
+}
+
+void JsonWriter::add(const char *key, const char *value, size_t len)
+{
+    next(key);
+    addString(value, len);
+}
+
+void JsonWriter::add(const char *key, int value)
+{
+    next(key);
+    if (value < 0)
+        out += '-';
+    addDigits(value < 0 ? 0u - (unsigned int)value : (unsigned int)value);
+}
+
+void JsonWriter::add(const char *key, unsigned int value)
+{
+    next(key);
+    addDigits(value);
+}
+
+void JsonWriter::add(const char *key, double value)
+{
+    next(key);
+    if (isinf(value) || isnan(value)) {
+        out += "null";
+    } else {
+        // What a std::stringstream with precision(15) makes of it
+        char buf[32];
+        int n = snprintf(buf, sizeof(buf), "%.15g", value);
+        out.append(buf, n);
+    }
+}
+
+void JsonWriter::add(const char *key, bool value)
+{
+    next(key);
+    out += value ? "true" : "false";
+}
+
+void JsonWriter::addHex(const char *key, const uint8_t *bytes, size_t len)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    next(key);
+    out += '"';
+    for (size_t i = 0; i < len; i++) {
+        out += hex[bytes[i] >> 4];
+        out += hex[bytes[i] & 0x0F];
+    }
+    out += '"';
+}
+
+void JsonWriter::addRaw(const char *key, const std::string &json)
+{
+    next(key);
+    out += json;
+}
+
+/// Every 32 bit integer is exact in a double, which %.15g prints as plain digits
+void JsonWriter::addDigits(unsigned int value)
+{
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n)
+        out += digits[--n];
+}
+
+/// The same escaping as JSONValue::StringifyString(), including its treatment of a (signed) char
+void JsonWriter::addString(const char *str, size_t len)
+{
+    out += '"';
+    const char *end = str + len;
+    for (const char *p = str; p != end; ++p) {
+        char chr = *p;
+
+        if (chr == '"' || chr == '\\' || chr == '/') {
+            out += '\\';
+            out += chr;
+        } else if (chr == '\b') {
+            out += "\\b";
+        } else if (chr == '\f') {
+            out += "\\f";
+        } else if (chr == '\n') {
+            out += "\\n";
+        } else if (chr == '\r') {
+            out += "\\r";
+        } else if (chr == '\t') {
+            out += "\\t";
+        } else if (chr < 0x20 || chr == 0x7F) {
+            char buf[7];
+            snprintf(buf, sizeof(buf), "\\u%04x", chr);
+            out += buf;
+        } else if (chr < 0x80) {
+            out += chr;
+        } else {
+            // Copy a whole UTF-8 sequence, if it is complete
+            out += chr;
+            size_t remain = end - p - 1;
+            size_t more = 0;
+            if ((chr & 0xE0) == 0xC0 && remain >= 1)
+                more = 1;
+            else if ((chr & 0xF0) == 0xE0 && remain >= 2)
+                more = 2;
+            else if ((chr & 0xF8) == 0xF0 && remain >= 3)
+                more = 3;
+            out.append(p + 1, more);
+            p += more;
+        }
+    }
+    out += '"';
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+/**
+ * Writes compact JSON straight into a caller supplied string, one field at a time.
+ *
+ * This produces exactly what building a JSONObject tree and calling JSONValue::Stringify() would (same escaping and number
+ * formatting), without allocating a JSONValue per field.  Unlike a JSONObject, it does not sort the keys: to get the same output
+ * the caller has to add them in the order a std::map would have them.
+ *
+ * The string is appended to, so clearing and reusing one across messages means no allocations once it has grown large enough.
+ */
+class JsonWriter
+{
+  public:
+    explicit JsonWriter(std::string &out) : out(out) {}
+
+    /// Start an object, as a field of the enclosing object (or at the top level / in an array if key is NULL)
+    void beginObject(const char *key = NULL);
+    void endObject();
+
+    void beginArray(const char *key = NULL);
+    void endArray();
+
+    void add(const char *key, const char *value) { add(key, value, strlen(value)); }
+    void add(const char *key, const char *value, size_t len);
+    void add(const char *key, int value);
+    void add(const char *key, unsigned int value);
+    void add(const char *key, double value);
+    void add(const char *key, bool value);
+
+    /// Add bytes as a string of uppercase hex digits
+    void addHex(const char *key, const uint8_t *bytes, size_t len);
+
+    /// Add a value that is already JSON
+    void addRaw(const char *key, const std::string &json);
+
+  private:
+    std::string &out;
+
+    /// Nothing has been written to the current object or array yet
+    bool first = true;
+
+    /// Separator and key before the next value
+    void next(const char *key);
+
+    void addDigits(unsigned int value);
+    void addString(const char *str, size_t len);
+};
@@ -9,6 +9,10 @@ class MeshPacketSerializer
     static std::string JsonSerialize(const meshtastic_MeshPacket *mp, bool shouldLog = true);
     static std::string JsonSerializeEncrypted(const meshtastic_MeshPacket *mp);
 
+    /// Serialize into out (replacing its contents), reusing its buffer from earlier messages
+    static void JsonSerialize(const meshtastic_MeshPacket *mp, std::string &out, bool shouldLog = true);
+    static void JsonSerializeEncrypted(const meshtastic_MeshPacket *mp, std::string &out);
+
   private:
     static std::string bytesToHex(const uint8_t *bytes, int len)
     {
@@ -407,4 +407,14 @@ std::string MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPa
 
     return jsonStr;
 }
+
+void MeshPacketSerializer::JsonSerialize(const meshtastic_MeshPacket *mp, std::string &out, bool shouldLog)
+{
+    out = JsonSerialize(mp, shouldLog);
+}
+
+void MeshPacketSerializer::JsonSerializeEncrypted(const meshtastic_MeshPacket *mp, std::string &out)
+{
+    out = JsonSerializeEncrypted(mp);
+}
 #endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/Channels.h"
+#include "mesh/NodeDB.h"
+
+namespace
+{
+/// The hash a channel has once its (possibly changed) settings go through a full onConfigChanged()
+int16_t rebuiltHash(ChannelIndex chIndex)
+{
+    channels.onConfigChanged();
+    return channels.setActiveByIndex(chIndex);
+}
+} // namespace
+
+void setUp(void)
+{
+    owner.is_licensed = false;
+    channels.initDefaults();
+    channels.onConfigChanged();
+}
+
+void tearDown(void)
+{
+    owner.is_licensed = false;
+}
+
+// Licensed mode clears the PSKs through setChannel(), which must not leave the old key cached for encrypting
+void test_licensedModeDropsCachedKey(void)
+{
+    const int16_t encryptedHash = channels.setActiveByIndex(0);
+    TEST_ASSERT_TRUE(encryptedHash >= 0);
+
+    owner.is_licensed = true;
+    TEST_ASSERT_TRUE(channels.ensureLicensedOperation());
+    TEST_ASSERT_EQUAL_UINT32(0, channels.getByIndex(0).settings.psk.size);
+
+    const int16_t clearHash = channels.setActiveByIndex(0);
+    TEST_ASSERT_NOT_EQUAL(encryptedHash, clearHash);
+    TEST_ASSERT_BITS_HIGH(1 << 0, channels.getChannelsForHash(clearHash));
+    TEST_ASSERT_BITS_LOW(1 << 0, channels.getChannelsForHash(encryptedHash));
+    TEST_ASSERT_EQUAL_INT16(rebuiltHash(0), clearHash);
+}
+
+// A secondary without a PSK borrows the primary's key, so changing the primary must refresh the secondary too
+void test_setChannelRefreshesSecondaries(void)
+{
+    meshtastic_Channel secondary = channels.getByIndex(1);
+    secondary.role = meshtastic_Channel_Role_SECONDARY;
+    secondary.has_settings = true;
+    secondary.settings.psk.size = 0;
+    strncpy(secondary.settings.name, "other", sizeof(secondary.settings.name));
+    channels.setChannel(secondary);
+    const int16_t before = channels.setActiveByIndex(1);
+    TEST_ASSERT_EQUAL_INT16(rebuiltHash(1), before);
+
+    meshtastic_Channel primary = channels.getByIndex(0);
+    primary.settings.psk.bytes[0] = 2; // the second of the well known short PSKs
+    primary.settings.psk.size = 1;
+    channels.setChannel(primary);
+
+    const int16_t after = channels.setActiveByIndex(1);
+    TEST_ASSERT_NOT_EQUAL(before, after);
+    TEST_ASSERT_EQUAL_INT16(rebuiltHash(1), after);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_licensedModeDropsCachedKey);
+    RUN_TEST(test_setChannelRefreshesSecondaries);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
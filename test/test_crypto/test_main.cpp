@@ -152,6 +152,64 @@ void test_PKC(void)
     TEST_ASSERT_EQUAL_MEMORY(expected_decrypted, decrypted, 10);
 }
 
+void test_PKC_shared_key_cache(void)
+{
+    uint8_t private_key[32];
+    meshtastic_UserLite_public_key_t public_key;
+    uint8_t expected_shared[32];
+    uint8_t expected_decrypted[32];
+    uint8_t radioBytes[128] __attribute__((__aligned__));
+    uint8_t decrypted[128] __attribute__((__aligned__));
+
+    uint32_t fromNode = 0x0929;
+    uint64_t packetNum = 0x13b2d662;
+    HexToBytes(public_key.bytes, "db18fc50eea47f00251cb784819a3cf5fc361882597f589f0d7ff820e8064457");
+    public_key.size = 32;
+    HexToBytes(private_key, "a00330633e63522f8a4d81ec6d9d1e6617f6c8ffd3a4c698229537d44e522277");
+    HexToBytes(expected_shared, "777b1545c9d6f9a2");
+    HexToBytes(expected_decrypted, "08011204746573744800");
+    HexToBytes(radioBytes, "8c646d7a2909000062d6b2136b00000040df24abfcc30a17a3d9046726099e796a1c036a792b");
+    crypto->setDHPrivateKey(private_key);
+
+    // First use derives the key, the second one must come from the cache and give the same result
+    uint32_t hits = crypto->sharedKeyCacheHits;
+    uint32_t misses = crypto->sharedKeyCacheMisses;
+    TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_UINT32(misses + 1, crypto->sharedKeyCacheMisses);
+    memset(crypto->shared_key, 0, sizeof(crypto->shared_key));
+    TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_UINT32(hits + 1, crypto->sharedKeyCacheHits);
+    TEST_ASSERT_EQUAL_MEMORY(expected_shared, crypto->shared_key, 8);
+    TEST_ASSERT_EQUAL_MEMORY(expected_decrypted, decrypted, 10);
+
+    // Changing our private key must flush every cached key
+    crypto->setDHPrivateKey(private_key);
+    misses = crypto->sharedKeyCacheMisses;
+    TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    TEST_ASSERT_EQUAL_UINT32(misses + 1, crypto->sharedKeyCacheMisses);
+    TEST_ASSERT_EQUAL_MEMORY(expected_decrypted, decrypted, 10);
+
+    // Compare the per packet cost with and without a cached key
+    const int rounds = 50;
+    uint32_t start = micros();
+    for (int i = 0; i < rounds; i++) {
+        crypto->setDHPrivateKey(private_key); // flush, so every packet pays for the X25519 derivation
+        TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    }
+    uint32_t uncachedUs = micros() - start;
+    start = micros();
+    for (int i = 0; i < rounds; i++) {
+        TEST_ASSERT(crypto->decryptCurve25519(fromNode, public_key, packetNum, 22, radioBytes + 16, decrypted));
+    }
+    uint32_t cachedUs = micros() - start;
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "PKI decrypt: %u us/packet uncached, %u us/packet cached", (unsigned)(uncachedUs / rounds),
+             (unsigned)(cachedUs / rounds));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_THAN_UINT32(uncachedUs, cachedUs);
+}
+
 void test_AES_CTR(void)
 {
     uint8_t expected[32];
@@ -178,6 +236,53 @@ void test_AES_CTR(void)
     TEST_ASSERT_EQUAL_MEMORY(expected, plain, 16);
 }
 
+void test_AES_CTR_cipher_cache(void)
+{
+    CryptoKey keys[2];
+    uint8_t nonces[2][16];
+    uint8_t expected[2][16];
+    uint8_t plain[16];
+
+    // Alternate between the two RFC 3686 vectors above, like a node switching between two channels
+    keys[0].length = 32;
+    HexToBytes(keys[0].bytes, "776BEFF2851DB06F4C8A0542C8696F6C6A81AF1EEC96B4D37FC1D689E6C1C104");
+    HexToBytes(nonces[0], "00000060DB5672C97AA8F0B200000001");
+    HexToBytes(expected[0], "145AD01DBF824EC7560863DC71E3E0C0");
+    keys[1].length = 16;
+    HexToBytes(keys[1].bytes, "AE6852F8121067CC4BF7A5765577F39E");
+    HexToBytes(nonces[1], "00000030000000000000000000000001");
+    HexToBytes(expected[1], "E4095D4FB7A7B3792D6175A3261311B8");
+
+    crypto->clearCipherCache();
+    uint32_t misses = crypto->cipherCacheMisses;
+    for (int i = 0; i < 4; i++) {
+        memcpy(plain, "Single block msg", 16);
+        crypto->encryptAESCtr(keys[i % 2], nonces[i % 2], 16, plain);
+        TEST_ASSERT_EQUAL_MEMORY(expected[i % 2], plain, 16);
+    }
+    TEST_ASSERT_EQUAL_UINT32(misses + 2, crypto->cipherCacheMisses); // Only the first use of each key expands it
+
+    const int rounds = 2000;
+    uint32_t start = micros();
+    for (int i = 0; i < rounds; i++) {
+        crypto->clearCipherCache(); // Every packet pays for the key schedule, like before the cache
+        crypto->encryptAESCtr(keys[i % 2], nonces[i % 2], 16, plain);
+    }
+    uint32_t uncachedUs = micros() - start;
+    start = micros();
+    for (int i = 0; i < rounds; i++) {
+        crypto->encryptAESCtr(keys[i % 2], nonces[i % 2], 16, plain);
+    }
+    uint32_t cachedUs = micros() - start;
+
+    unsigned uncachedRate = rounds * 1000000ULL / (uncachedUs ? uncachedUs : 1);
+    unsigned cachedRate = rounds * 1000000ULL / (cachedUs ? cachedUs : 1);
+    char msg[96];
+    snprintf(msg, sizeof(msg), "AES-CTR: %u packets/s rekeying every packet, %u packets/s with cached keys", uncachedRate,
+             cachedRate);
+    TEST_MESSAGE(msg);
+}
+
 void setup()
 {
     // NOTE!!! Wait for >2 secs
@@ -191,7 +296,9 @@ void setup()
     RUN_TEST(test_ECB_AES256);
     RUN_TEST(test_DH25519);
     RUN_TEST(test_AES_CTR);
+    RUN_TEST(test_AES_CTR_cipher_cache);
     RUN_TEST(test_PKC);
+    RUN_TEST(test_PKC_shared_key_cache);
     exit(UNITY_END()); // stop unit testing
 }
 
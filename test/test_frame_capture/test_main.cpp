@@ -0,0 +1,354 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "SPILock.h"
+#include "mesh/Channels.h"
+#include "mesh/FrameCapture.h"
+#include "mesh/NextHopRouter.h"
+#include "mesh/NodeDB.h"
+#include "mesh/RadioInterface.h"
+#include "platform/portduino/FrameReplay.h"
+
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <unistd.h>
+
+namespace
+{
+std::string captureFile;
+
+meshtastic_MeshPacket encryptedPacket(PacketId id, size_t payloadLen)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x11223344;
+    p.to = NODENUM_BROADCAST;
+    p.id = id;
+    p.channel = 8;
+    p.hop_limit = 2;
+    p.hop_start = 3;
+    p.want_ack = true;
+    p.next_hop = 0x55;
+    p.relay_node = 0x44;
+    p.rx_snr = -7.25;
+    p.rx_rssi = -118;
+    p.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+    for (size_t i = 0; i < payloadLen; i++)
+        p.encrypted.bytes[i] = (uint8_t)(id + i);
+    p.encrypted.size = payloadLen;
+    return p;
+}
+
+void assertSameOnAir(const meshtastic_MeshPacket &expected, const meshtastic_MeshPacket &actual)
+{
+    TEST_ASSERT_EQUAL_HEX32(expected.from, actual.from);
+    TEST_ASSERT_EQUAL_HEX32(expected.to, actual.to);
+    TEST_ASSERT_EQUAL_HEX32(expected.id, actual.id);
+    TEST_ASSERT_EQUAL(expected.channel, actual.channel);
+    TEST_ASSERT_EQUAL(expected.hop_limit, actual.hop_limit);
+    TEST_ASSERT_EQUAL(expected.hop_start, actual.hop_start);
+    TEST_ASSERT_EQUAL(expected.want_ack, actual.want_ack);
+    TEST_ASSERT_EQUAL(expected.next_hop, actual.next_hop);
+    TEST_ASSERT_EQUAL(expected.relay_node, actual.relay_node);
+    TEST_ASSERT_EQUAL_FLOAT(expected.rx_snr, actual.rx_snr);
+    TEST_ASSERT_EQUAL(expected.rx_rssi, actual.rx_rssi);
+    TEST_ASSERT_EQUAL(expected.which_payload_variant, actual.which_payload_variant);
+}
+
+/// A text message from another node, sealed with the default channel key as it would be on air
+meshtastic_MeshPacket sealedText(PacketId id, const char *text)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x11223344;
+    p.to = NODENUM_BROADCAST;
+    p.id = id;
+    p.hop_limit = 0; // so nothing is relayed, there is no radio to relay it with
+    p.hop_start = 3;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    p.decoded.payload.size = snprintf((char *)p.decoded.payload.bytes, sizeof(p.decoded.payload.bytes), "%s", text);
+    TEST_ASSERT_EQUAL(meshtastic_Routing_Error_NONE, perhapsEncode(&p));
+    TEST_ASSERT_EQUAL(meshtastic_MeshPacket_encrypted_tag, p.which_payload_variant);
+    return p;
+}
+
+/// A node of our own to replay through, with the default channels
+struct ReplayNode {
+    const std::unique_ptr<NodeDB> testNodeDB;
+    const std::unique_ptr<Router> testRouter;
+
+    ReplayNode() : testNodeDB((nodeDB = new NodeDB())), testRouter((router = new NextHopRouter()))
+    {
+        channels.initDefaults();
+        channels.onConfigChanged();
+    }
+
+    ~ReplayNode()
+    {
+        router = nullptr;
+        nodeDB = nullptr;
+    }
+};
+} // namespace
+
+void setUp(void)
+{
+    captureFile = std::filesystem::temp_directory_path() / ("test_frame_capture." + std::to_string(getpid()));
+    std::filesystem::remove(captureFile);
+}
+
+void tearDown(void)
+{
+    std::filesystem::remove(captureFile);
+}
+
+// What we capture comes back as the packet the radio delivered, every payload size keeping the records aligned
+void test_replaysWhatWasCaptured(void)
+{
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        for (PacketId id = 1; id <= 200; id++)
+            capture.write(encryptedPacket(id, id % (MAX_LORA_PAYLOAD_LEN + 1 - sizeof(PacketHeader))));
+        TEST_ASSERT_EQUAL(200, capture.getCount());
+    }
+
+    FrameCaptureReader reader;
+    TEST_ASSERT_TRUE(reader.open(captureFile));
+    const FrameRecord *r;
+    PacketId id = 1;
+    uint64_t lastUsec = 0;
+    while ((r = reader.next())) {
+        TEST_ASSERT_EQUAL(0, (uintptr_t)r % 8);
+        TEST_ASSERT_TRUE(r->usec >= lastUsec);
+        lastUsec = r->usec;
+
+        const meshtastic_MeshPacket expected = encryptedPacket(id, id % (MAX_LORA_PAYLOAD_LEN + 1 - sizeof(PacketHeader)));
+        meshtastic_MeshPacket p;
+        TEST_ASSERT_TRUE(frameToPacket(*r, p));
+        assertSameOnAir(expected, p);
+        TEST_ASSERT_EQUAL(expected.encrypted.size, p.encrypted.size);
+        TEST_ASSERT_EQUAL_MEMORY(expected.encrypted.bytes, p.encrypted.bytes, p.encrypted.size);
+        id++;
+    }
+    TEST_ASSERT_EQUAL(201, id);
+}
+
+// Packets from the simulator arrive decoded, and are captured as their encoded Data
+void test_keepsDecodedPackets(void)
+{
+    meshtastic_MeshPacket sent = encryptedPacket(42, 0);
+    sent.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    sent.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    sent.decoded.payload.size = snprintf((char *)sent.decoded.payload.bytes, sizeof(sent.decoded.payload.bytes), "hello");
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        capture.write(sent);
+    }
+
+    FrameCaptureReader reader;
+    TEST_ASSERT_TRUE(reader.open(captureFile));
+    const FrameRecord *r = reader.next();
+    TEST_ASSERT_NOT_NULL(r);
+    TEST_ASSERT_EQUAL(FRAME_FLAG_DECODED, r->flags);
+    meshtastic_MeshPacket p;
+    TEST_ASSERT_TRUE(frameToPacket(*r, p));
+    assertSameOnAir(sent, p);
+    TEST_ASSERT_EQUAL(meshtastic_PortNum_TEXT_MESSAGE_APP, p.decoded.portnum);
+    TEST_ASSERT_EQUAL(5, p.decoded.payload.size);
+    TEST_ASSERT_EQUAL_MEMORY("hello", p.decoded.payload.bytes, 5);
+    TEST_ASSERT_NULL(reader.next());
+}
+
+// A record cut short by a crash is dropped, and capturing carries on after the last whole one
+void test_dropsTornRecord(void)
+{
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        for (PacketId id = 1; id <= 3; id++)
+            capture.write(encryptedPacket(id, 30));
+    }
+    std::filesystem::resize_file(captureFile, std::filesystem::file_size(captureFile) - 10);
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        TEST_ASSERT_EQUAL(2, capture.getCount());
+        capture.write(encryptedPacket(4, 30));
+    }
+
+    FrameCaptureReader reader;
+    TEST_ASSERT_TRUE(reader.open(captureFile));
+    const PacketId expected[] = {1, 2, 4};
+    for (PacketId id : expected) {
+        const FrameRecord *r = reader.next();
+        TEST_ASSERT_NOT_NULL(r);
+        meshtastic_MeshPacket p;
+        TEST_ASSERT_TRUE(frameToPacket(*r, p));
+        TEST_ASSERT_EQUAL_HEX32(id, p.id);
+    }
+    TEST_ASSERT_NULL(reader.next());
+}
+
+// The radio drops frames without a sender, so replay does too
+void test_rejectsFrameWithoutSender(void)
+{
+    meshtastic_MeshPacket p = encryptedPacket(7, 10);
+    p.from = 0;
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        capture.write(p);
+    }
+    FrameCaptureReader reader;
+    TEST_ASSERT_TRUE(reader.open(captureFile));
+    const FrameRecord *r = reader.next();
+    TEST_ASSERT_NOT_NULL(r);
+    TEST_ASSERT_FALSE(frameToPacket(*r, p));
+}
+
+void test_refusesOtherFiles(void)
+{
+    FILE *f = fopen(captureFile.c_str(), "w");
+    fputs("not a frame capture at all", f);
+    fclose(f);
+
+    FrameCaptureReader reader;
+    TEST_ASSERT_FALSE(reader.open(captureFile));
+    FrameCapture capture(captureFile);
+    TEST_ASSERT_FALSE(capture.open());
+}
+
+// Frames reach the router still encrypted, it decodes them once and drops the ones it has already seen undecoded
+void test_routesRawFrames(void)
+{
+    ReplayNode node;
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        const meshtastic_MeshPacket text = sealedText(0x100, "hello");
+        capture.write(text);
+        capture.write(text);
+        meshtastic_MeshPacket foreign = encryptedPacket(0x101, 20);
+        foreign.channel = text.channel ^ 0xff; // no channel of ours has this hash
+        foreign.hop_limit = 0;
+        foreign.want_ack = false;
+        foreign.next_hop = NO_NEXT_HOP_PREFERENCE;
+        capture.write(foreign);
+    }
+
+    FrameReplay replay(captureFile, false, "", "");
+    replay.replayAll();
+    const std::vector<std::string> &outcomes = replay.getOutcomes();
+    TEST_ASSERT_EQUAL(3, outcomes.size());
+    TEST_ASSERT_EQUAL_STRING("from=0x11223344 id=0x00000100 port=1 dupe=0 sent=0", outcomes[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("from=0x11223344 id=0x00000100 dropped dupe=1 sent=0", outcomes[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("from=0x11223344 id=0x00000101 undecoded dupe=0 sent=0", outcomes[2].c_str());
+}
+
+// Every frame whose line differs from the baseline counts, as do frames one side has and the other doesn't
+void test_diffsBaseline(void)
+{
+    ReplayNode node;
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        capture.write(sealedText(0x200, "one"));
+        capture.write(sealedText(0x201, "two"));
+    }
+    FrameReplay replay(captureFile, false, "", "");
+    replay.replayAll();
+    const std::vector<std::string> &outcomes = replay.getOutcomes();
+    TEST_ASSERT_EQUAL(2, outcomes.size());
+
+    std::istringstream same(outcomes[0] + "\n" + outcomes[1] + "\n");
+    TEST_ASSERT_EQUAL(0, replay.diffBaseline(same));
+    std::istringstream changed(outcomes[0] + "\nfrom=0x11223344 id=0x00000201 undecoded dupe=0 sent=0\n");
+    TEST_ASSERT_EQUAL(1, replay.diffBaseline(changed));
+    std::istringstream shorter(outcomes[0] + "\n");
+    TEST_ASSERT_EQUAL(1, replay.diffBaseline(shorter));
+    std::istringstream longer(outcomes[0] + "\n" + outcomes[1] + "\nextra\nextra\n");
+    TEST_ASSERT_EQUAL(2, replay.diffBaseline(longer));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    if (!spiLock)
+        initSPI(); // NodeDB saves and loads under it
+
+    UNITY_BEGIN();
+    RUN_TEST(test_replaysWhatWasCaptured);
+    RUN_TEST(test_keepsDecodedPackets);
+    RUN_TEST(test_dropsTornRecord);
+    RUN_TEST(test_rejectsFrameWithoutSender);
+    RUN_TEST(test_refusesOtherFiles);
+    RUN_TEST(test_routesRawFrames);
+    RUN_TEST(test_diffsBaseline);
+    exit(UNITY_END());
+}
+#else
+// Frames reach the router still encrypted, it decodes them once and drops the ones it has already seen undecoded
+void test_routesRawFrames(void)
+{
+    ReplayNode node;
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        const meshtastic_MeshPacket text = sealedText(0x100, "hello");
+        capture.write(text);
+        capture.write(text);
+        meshtastic_MeshPacket foreign = encryptedPacket(0x101, 20);
+        foreign.channel = text.channel ^ 0xff; // no channel of ours has this hash
+        foreign.hop_limit = 0;
+        foreign.want_ack = false;
+        foreign.next_hop = NO_NEXT_HOP_PREFERENCE;
+        capture.write(foreign);
+    }
+
+    FrameReplay replay(captureFile, false, "", "");
+    replay.replayAll();
+    const std::vector<std::string> &outcomes = replay.getOutcomes();
+    TEST_ASSERT_EQUAL(3, outcomes.size());
+    TEST_ASSERT_EQUAL_STRING("from=0x11223344 id=0x00000100 port=1 dupe=0 sent=0", outcomes[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("from=0x11223344 id=0x00000100 dropped dupe=1 sent=0", outcomes[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("from=0x11223344 id=0x00000101 undecoded dupe=0 sent=0", outcomes[2].c_str());
+}
+
+// Every frame whose line differs from the baseline counts, as do frames one side has and the other doesn't
+void test_diffsBaseline(void)
+{
+    ReplayNode node;
+    {
+        FrameCapture capture(captureFile);
+        TEST_ASSERT_TRUE(capture.open());
+        capture.write(sealedText(0x200, "one"));
+        capture.write(sealedText(0x201, "two"));
+    }
+    FrameReplay replay(captureFile, false, "", "");
+    replay.replayAll();
+    const std::vector<std::string> &outcomes = replay.getOutcomes();
+    TEST_ASSERT_EQUAL(2, outcomes.size());
+
+    std::istringstream same(outcomes[0] + "\n" + outcomes[1] + "\n");
+    TEST_ASSERT_EQUAL(0, replay.diffBaseline(same));
+    std::istringstream changed(outcomes[0] + "\nfrom=0x11223344 id=0x00000201 undecoded dupe=0 sent=0\n");
+    TEST_ASSERT_EQUAL(1, replay.diffBaseline(changed));
+    std::istringstream shorter(outcomes[0] + "\n");
+    TEST_ASSERT_EQUAL(1, replay.diffBaseline(shorter));
+    std::istringstream longer(outcomes[0] + "\n" + outcomes[1] + "\nextra\nextra\n");
+    TEST_ASSERT_EQUAL(2, replay.diffBaseline(longer));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
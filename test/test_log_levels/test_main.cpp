@@ -0,0 +1,107 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+
+namespace
+{
+int evaluated;
+
+int count()
+{
+    return ++evaluated;
+}
+} // namespace
+
+void setUp(void)
+{
+    evaluated = 0;
+    updateSettings([](PortduinoSettings &s) {
+        s.strings[traceFilename] = "";
+        s.values[logoutputlevel] = level_debug;
+    });
+}
+
+void tearDown(void)
+{
+    freeRetiredSettings();
+}
+
+// The log level setting decides which severities the console wants, as soon as it is set
+void test_followsLogLevel(void)
+{
+    setSetting(logoutputlevel, level_warn);
+    TEST_ASSERT_FALSE(console->wants(LOG_SEVERITY_TRACE));
+    TEST_ASSERT_FALSE(console->wants(LOG_SEVERITY_DEBUG));
+    TEST_ASSERT_FALSE(console->wants(LOG_SEVERITY_INFO));
+    TEST_ASSERT_TRUE(console->wants(LOG_SEVERITY_WARN));
+    TEST_ASSERT_TRUE(console->wants(LOG_SEVERITY_ERROR));
+    TEST_ASSERT_TRUE(console->wants(LOG_SEVERITY_CRIT));
+
+    setSetting(logoutputlevel, level_debug);
+    TEST_ASSERT_FALSE(console->wants(LOG_SEVERITY_TRACE));
+    TEST_ASSERT_TRUE(console->wants(LOG_SEVERITY_DEBUG));
+    TEST_ASSERT_TRUE(console->wants(LOG_SEVERITY_INFO));
+
+    setSetting(logoutputlevel, level_trace);
+    TEST_ASSERT_TRUE(console->wants(LOG_SEVERITY_TRACE));
+}
+
+// Trace goes to the trace file whatever the log level
+void test_traceFileWantsTrace(void)
+{
+    setSetting(logoutputlevel, level_error);
+    setSettingString(traceFilename, "/tmp/test_log_levels.trace");
+    TEST_ASSERT_TRUE(console->wants(LOG_SEVERITY_TRACE));
+    TEST_ASSERT_FALSE(console->wants(LOG_SEVERITY_DEBUG));
+    setSettingString(traceFilename, "");
+}
+
+// Arguments of a filtered out call are never evaluated
+void test_skipsArguments(void)
+{
+    setSetting(logoutputlevel, level_info);
+    LOG_DEBUG("%d", count());
+    LOG_TRACE("%d", count());
+    TEST_ASSERT_EQUAL(0, evaluated);
+
+    LOG_INFO("%d", count());
+    LOG_WARN("%d", count());
+    TEST_ASSERT_EQUAL(2, evaluated);
+}
+
+// Still usable as the body of an if/else
+void test_statementForm(void)
+{
+    setSetting(logoutputlevel, level_debug);
+    bool flag = evaluated == 0;
+    if (flag)
+        LOG_DEBUG("%d", count());
+    else
+        LOG_DEBUG("%d", count() + 100);
+    TEST_ASSERT_EQUAL(1, evaluated);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_followsLogLevel);
+    RUN_TEST(test_traceFileWantsTrace);
+    RUN_TEST(test_skipsArguments);
+    RUN_TEST(test_statementForm);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -0,0 +1,204 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "LogRing.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+LogRing *ring;
+
+bool push(const char *format, ...)
+{
+    va_list arg;
+    va_start(arg, format);
+    bool queued = ring->push(MESHTASTIC_LOG_LEVEL_DEBUG, LOG_FLAG_OUTPUT, format, arg);
+    va_end(arg);
+    return queued;
+}
+
+bool pop(LogMessage &m)
+{
+    TEST_ASSERT_TRUE(ring->tryLockConsumer());
+    bool popped = ring->pop(m);
+    ring->unlockConsumer();
+    return popped;
+}
+
+/// What is written later must be what vsnprintf would have made of it at the time
+void assertFormatsLater(const char *format, ...)
+{
+    char expected[512];
+    va_list arg;
+    va_start(arg, format);
+    vsnprintf(expected, sizeof(expected) - 1, format, arg);
+    va_end(arg);
+    strcat(expected, "\n");
+
+    va_start(arg, format);
+    bool queued = ring->push(MESHTASTIC_LOG_LEVEL_DEBUG, LOG_FLAG_OUTPUT, format, arg);
+    va_end(arg);
+    TEST_ASSERT_TRUE_MESSAGE(queued, format);
+
+    static LogMessage m;
+    TEST_ASSERT_TRUE(pop(m));
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected, m.text, format);
+    TEST_ASSERT_EQUAL(strlen(expected), m.length);
+    TEST_ASSERT_EQUAL_STRING(MESHTASTIC_LOG_LEVEL_DEBUG, m.level);
+}
+} // namespace
+
+void setUp(void)
+{
+    ring = new LogRing();
+}
+
+void tearDown(void)
+{
+    delete ring;
+}
+
+void test_formatsLikePrintf(void)
+{
+    assertFormatsLater("plain text");
+    assertFormatsLater("100%% of %d", 5);
+    assertFormatsLater("%d %u 0x%08x %X %-5d| %+d %o", -3, 4000000000u, 0xdeadbeef, 0xbeef, 7, 9, 8);
+    assertFormatsLater("%ld %lu %lld %llu %zu %hhd %hu", -5L, 6UL, -7LL, 8ULL, (size_t)9, 300, 70000);
+    assertFormatsLater("%s, %.3s, %10s|%-10s|", "hello", "abcdef", "right", "left");
+    assertFormatsLater("%f %.2f %e %g %5.1f", 1.5, 3.14159, 12345.678, 0.0001, 2.25);
+    assertFormatsLater("%c%c %p", 'o', 'k', (void *)0x1234);
+    assertFormatsLater("%*d|%-*.*f|%.*s", 6, 42, 8, 2, 3.14159, 2, "xyz");
+}
+
+// Strings are copied when the message is queued, the caller's buffer can go away
+void test_copiesStrings(void)
+{
+    char name[] = "before";
+    std::string format = "name=%s";
+    TEST_ASSERT_TRUE(push(format.c_str(), name));
+    strcpy(name, "after!");
+    format = "clobbered";
+
+    LogMessage m;
+    TEST_ASSERT_TRUE(pop(m));
+    TEST_ASSERT_EQUAL_STRING("name=before\n", m.text);
+}
+
+// A precision bounds what is read, payloads are logged with %.*s and aren't NUL terminated
+void test_stringPrecisionStopsReading(void)
+{
+    char payload[LOG_RING_SLOT_SIZE * 2];
+    memset(payload, 'x', sizeof(payload)); // no NUL anywhere, strlen() would run off the end
+    memcpy(payload, "hello", 5);
+
+    TEST_ASSERT_TRUE(push("msg='%.*s' fixed='%.3s'", 5, payload, payload));
+    LogMessage m;
+    TEST_ASSERT_TRUE(pop(m));
+    TEST_ASSERT_EQUAL_STRING("msg='hello' fixed='hel'\n", m.text);
+
+    // A negative precision means there is none
+    assertFormatsLater("%.*s|", -1, "whole");
+}
+
+// The caller has to write these itself, and they leave nothing behind in the ring
+void test_refusesWhatItCantDefer(void)
+{
+    int n;
+    TEST_ASSERT_FALSE(push("%n", &n));
+    std::string huge(LOG_RING_SLOT_SIZE, 'x');
+    TEST_ASSERT_FALSE(push("%s", huge.c_str()));
+    TEST_ASSERT_FALSE(push("%Lf", (long double)1));
+
+    LogMessage m;
+    TEST_ASSERT_FALSE(pop(m));
+    TEST_ASSERT_TRUE(ring->isEmpty());
+}
+
+// A full ring drops what doesn't fit and counts it, keeping what it has in order
+void test_countsDropped(void)
+{
+    for (int i = 0; i < LOG_RING_SLOTS + 5; i++)
+        TEST_ASSERT_TRUE(push("message %d", i));
+    TEST_ASSERT_EQUAL(5, ring->takeDropped());
+    TEST_ASSERT_EQUAL(0, ring->takeDropped());
+
+    LogMessage m;
+    char expected[32];
+    for (int i = 0; i < LOG_RING_SLOTS; i++) {
+        TEST_ASSERT_TRUE(pop(m));
+        snprintf(expected, sizeof(expected), "message %d\n", i);
+        TEST_ASSERT_EQUAL_STRING(expected, m.text);
+    }
+    TEST_ASSERT_FALSE(pop(m));
+}
+
+// Only one consumer at a time
+void test_consumerLock(void)
+{
+    TEST_ASSERT_TRUE(ring->tryLockConsumer());
+    TEST_ASSERT_FALSE(ring->tryLockConsumer());
+    ring->unlockConsumer();
+    TEST_ASSERT_TRUE(ring->tryLockConsumer());
+    ring->unlockConsumer();
+}
+
+// Producers on several threads, nothing is lost without being counted and each thread's messages stay in order
+void test_concurrentProducers(void)
+{
+    const int threads = 4, perThread = 20000;
+    std::atomic<int> finished(0);
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threads; t++)
+        producers.emplace_back([t, &finished] {
+            for (int i = 0; i < perThread; i++)
+                push("%d %d", t, i);
+            finished++;
+        });
+
+    static LogMessage m;
+    int last[threads] = {-1, -1, -1, -1};
+    long popped = 0;
+    while (finished < threads || !ring->isEmpty()) {
+        while (pop(m)) {
+            int t, i;
+            TEST_ASSERT_EQUAL(2, sscanf(m.text, "%d %d", &t, &i));
+            TEST_ASSERT_GREATER_THAN(last[t], i);
+            last[t] = i;
+            popped++;
+        }
+    }
+    for (auto &p : producers)
+        p.join();
+    TEST_ASSERT_EQUAL(threads * perThread, popped + ring->takeDropped());
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_formatsLikePrintf);
+    RUN_TEST(test_copiesStrings);
+    RUN_TEST(test_stringPrecisionStopsReading);
+    RUN_TEST(test_refusesWhatItCantDefer);
+    RUN_TEST(test_countsDropped);
+    RUN_TEST(test_consumerLock);
+    RUN_TEST(test_concurrentProducers);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
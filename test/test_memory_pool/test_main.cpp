@@ -0,0 +1,146 @@
+#include "MemoryPool.h"
+#include "mesh/generated/meshtastic/mesh.pb.h"
+
+#include "TestUtil.h"
+#include <unity.h>
+
+#define POOL_SIZE 8
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_alloc_from_slab(void)
+{
+    MemoryPool<meshtastic_MeshPacket> pool(POOL_SIZE, false);
+    meshtastic_MeshPacket *p[POOL_SIZE];
+
+    for (int i = 0; i < POOL_SIZE; i++) {
+        p[i] = pool.allocZeroed(0);
+        TEST_ASSERT_NOT_NULL(p[i]);
+        for (int j = 0; j < i; j++)
+            TEST_ASSERT_TRUE(p[i] != p[j]);
+    }
+    TEST_ASSERT_EQUAL(POOL_SIZE, pool.getNumInUse());
+    TEST_ASSERT_EQUAL(POOL_SIZE, pool.getHighWaterMark());
+    TEST_ASSERT_EQUAL(0, pool.getNumHeapAllocs());
+
+    for (int i = 0; i < POOL_SIZE; i++)
+        pool.release(p[i]);
+    TEST_ASSERT_EQUAL(0, pool.getNumInUse());
+    TEST_ASSERT_EQUAL(POOL_SIZE, pool.getHighWaterMark());
+}
+
+void test_exhausted_without_fallback(void)
+{
+    MemoryPool<meshtastic_MeshPacket> pool(POOL_SIZE, false);
+    meshtastic_MeshPacket *p[POOL_SIZE];
+
+    for (int i = 0; i < POOL_SIZE; i++)
+        p[i] = pool.allocZeroed(0);
+    TEST_ASSERT_NULL(pool.allocZeroed(0));
+    TEST_ASSERT_EQUAL(1, pool.getNumExhausted());
+
+    // A released slot must be handed out again
+    pool.release(p[3]);
+    TEST_ASSERT_EQUAL_PTR(p[3], pool.allocZeroed(0));
+
+    for (int i = 0; i < POOL_SIZE; i++)
+        pool.release(p[i]);
+}
+
+void test_exhausted_with_fallback(void)
+{
+    MemoryPool<meshtastic_MeshPacket> pool(POOL_SIZE, true);
+    meshtastic_MeshPacket *p[POOL_SIZE];
+
+    for (int i = 0; i < POOL_SIZE; i++)
+        p[i] = pool.allocZeroed(0);
+    meshtastic_MeshPacket *extra = pool.allocZeroed(0);
+    TEST_ASSERT_NOT_NULL(extra);
+    TEST_ASSERT_EQUAL(1, pool.getNumExhausted());
+    TEST_ASSERT_EQUAL(1, pool.getNumHeapAllocs());
+
+    // Heap allocations must go back to the heap, not into the slab
+    pool.release(extra);
+    TEST_ASSERT_EQUAL(POOL_SIZE, pool.getNumInUse());
+
+    for (int i = 0; i < POOL_SIZE; i++)
+        pool.release(p[i]);
+    TEST_ASSERT_EQUAL(0, pool.getNumInUse());
+}
+
+void test_alloc_before_begin(void)
+{
+    MemoryPool<meshtastic_MeshPacket> pool;
+
+    meshtastic_MeshPacket *early = pool.allocZeroed(0);
+    TEST_ASSERT_NOT_NULL(early);
+    TEST_ASSERT_EQUAL(1, pool.getNumHeapAllocs());
+
+    TEST_ASSERT_TRUE(pool.begin(POOL_SIZE, false));
+    meshtastic_MeshPacket *late = pool.allocZeroed(0);
+    TEST_ASSERT_EQUAL(1, pool.getNumInUse());
+
+    pool.release(early);
+    pool.release(late);
+    TEST_ASSERT_EQUAL(0, pool.getNumInUse());
+}
+
+// Alloc/release in bursts the size of a busy router's working set, returns allocations per second
+static double measureThroughput(Allocator<meshtastic_MeshPacket> &pool)
+{
+    const int rounds = 20000;
+    meshtastic_MeshPacket *p[POOL_SIZE];
+
+    uint32_t start = millis();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < POOL_SIZE; i++)
+            p[i] = pool.allocZeroed(0);
+        for (int i = POOL_SIZE - 1; i >= 0; i--)
+            pool.release(p[i]);
+    }
+    uint32_t elapsed = millis() - start;
+    if (elapsed == 0)
+        elapsed = 1;
+    return (double)rounds * POOL_SIZE * 1000 / elapsed;
+}
+
+void test_throughput(void)
+{
+    MemoryDynamic<meshtastic_MeshPacket> dynamicPool;
+    MemoryPool<meshtastic_MeshPacket> staticPool(POOL_SIZE, false);
+
+    double dynamicRate = measureThroughput(dynamicPool);
+    double staticRate = measureThroughput(staticPool);
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "MemoryDynamic %.0f allocs/s, MemoryPool %.0f allocs/s", dynamicRate, staticRate);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_EQUAL(0, staticPool.getNumHeapAllocs());
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_alloc_from_slab);
+    RUN_TEST(test_exhausted_without_fallback);
+    RUN_TEST(test_exhausted_with_fallback);
+    RUN_TEST(test_alloc_before_begin);
+    RUN_TEST(test_throughput);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,312 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/MeshPacketQueue.h"
+#include "mesh/NodeDB.h"
+#include "mesh/RadioInterface.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+// The sorted vector MeshPacketQueue used before the heaps, kept as the reference behaviour
+class SortedPacketQueue
+{
+    std::vector<meshtastic_MeshPacket> queue;
+    size_t maxLen;
+
+    static bool sendsBefore(const meshtastic_MeshPacket &p1, const meshtastic_MeshPacket &p2)
+    {
+        if ((bool)p1.tx_after != (bool)p2.tx_after)
+            return !p1.tx_after;
+        if (p1.priority != p2.priority)
+            return p1.priority > p2.priority;
+        return !isFromUs(&p1) && isFromUs(&p2);
+    }
+
+    void insert(const meshtastic_MeshPacket &p) { queue.insert(std::upper_bound(queue.begin(), queue.end(), p, sendsBefore), p); }
+
+  public:
+    explicit SortedPacketQueue(size_t maxLen) : maxLen(maxLen) {}
+
+    bool enqueue(const meshtastic_MeshPacket &p)
+    {
+        if (queue.size() < maxLen) {
+            insert(p);
+            return true;
+        }
+        // Evict the last on-time packet, if it has a lower priority
+        for (auto it = queue.end(); it != queue.begin();) {
+            if ((--it)->tx_after)
+                continue;
+            if (it->priority >= p.priority)
+                return false;
+            queue.erase(it);
+            insert(p);
+            return true;
+        }
+        return false;
+    }
+
+    const meshtastic_MeshPacket *getFront() const { return queue.empty() ? NULL : &queue.front(); }
+
+    void dequeue() { queue.erase(queue.begin()); }
+
+    bool remove(NodeNum from, PacketId id, bool tx_normal, bool tx_late)
+    {
+        for (auto it = queue.begin(); it != queue.end(); it++) {
+            if (getFrom(&*it) == from && it->id == id && ((tx_normal && !it->tx_after) || (tx_late && it->tx_after))) {
+                queue.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool find(NodeNum from, PacketId id) const
+    {
+        for (auto &p : queue)
+            if (getFrom(&p) == from && p.id == id)
+                return true;
+        return false;
+    }
+};
+
+meshtastic_MeshPacket *makePacket(NodeNum from, PacketId id, meshtastic_MeshPacket_Priority priority, uint32_t txAfter = 0)
+{
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    p->from = from;
+    p->id = id;
+    p->priority = priority;
+    p->tx_after = txAfter;
+    return p;
+}
+
+/// Dequeue a packet, check it is the one expected and free it
+void assertDequeues(MeshPacketQueue &q, NodeNum from, PacketId id)
+{
+    meshtastic_MeshPacket *p = q.dequeue();
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_UINT32(from, p->from);
+    TEST_ASSERT_EQUAL_UINT32(id, p->id);
+    packetPool.release(p);
+}
+
+void assertSame(const meshtastic_MeshPacket *expected, const meshtastic_MeshPacket *actual)
+{
+    if (!expected) {
+        TEST_ASSERT_NULL(actual);
+        return;
+    }
+    TEST_ASSERT_NOT_NULL(actual);
+    TEST_ASSERT_EQUAL_UINT32(expected->from, actual->from);
+    TEST_ASSERT_EQUAL_UINT32(expected->id, actual->id);
+    TEST_ASSERT_EQUAL(expected->priority, actual->priority);
+    TEST_ASSERT_EQUAL_UINT32(expected->tx_after, actual->tx_after);
+}
+
+// Run random operations against both queues.  Senders and ids come from small ranges so that remove() and find() often hit,
+// including packets queued more than once, and the queue is full often enough to evict.
+void replayOps(size_t maxLen, uint32_t numOps, uint32_t seed)
+{
+    static const meshtastic_MeshPacket_Priority priorities[] = {
+        meshtastic_MeshPacket_Priority_BACKGROUND, meshtastic_MeshPacket_Priority_DEFAULT,
+        meshtastic_MeshPacket_Priority_RELIABLE,   meshtastic_MeshPacket_Priority_RESPONSE,
+        meshtastic_MeshPacket_Priority_HIGH,       meshtastic_MeshPacket_Priority_ACK};
+    const NodeNum senders[] = {0, nodeDB->getNodeNum(), 0x1001, 0x1002, 0x1003};
+
+    MeshPacketQueue q(maxLen);
+    SortedPacketQueue reference(maxLen);
+    std::mt19937 rng(seed);
+
+    for (uint32_t i = 0; i < numOps; i++) {
+        NodeNum from = senders[rng() % 5];
+        PacketId id = 1 + rng() % 16;
+        switch (rng() % 8) {
+        case 0:
+        case 1:
+        case 2: {
+            meshtastic_MeshPacket *p = makePacket(from, id, priorities[rng() % 6], rng() % 4 ? 0 : 1 + rng() % 1000);
+            bool expected = reference.enqueue(*p);
+            TEST_ASSERT_EQUAL(expected, q.enqueue(p));
+            if (!expected)
+                packetPool.release(p);
+            break;
+        }
+        case 3: {
+            const meshtastic_MeshPacket *expected = reference.getFront();
+            meshtastic_MeshPacket *p = q.dequeue();
+            assertSame(expected, p);
+            if (p) {
+                reference.dequeue();
+                packetPool.release(p);
+            }
+            break;
+        }
+        case 4:
+        case 5: {
+            bool normal = rng() % 2, late = rng() % 2;
+            bool expected = reference.remove(from, id, normal, late);
+            meshtastic_MeshPacket *p = q.remove(from, id, normal, late);
+            TEST_ASSERT_EQUAL(expected, p != NULL);
+            if (p)
+                packetPool.release(p);
+            break;
+        }
+        case 6:
+            TEST_ASSERT_EQUAL(reference.find(from, id), q.find(from, id));
+            break;
+        default:
+            assertSame(reference.getFront(), q.getFront());
+            break;
+        }
+    }
+
+    while (meshtastic_MeshPacket *p = q.dequeue()) {
+        assertSame(reference.getFront(), p);
+        reference.dequeue();
+        packetPool.release(p);
+    }
+    TEST_ASSERT_NULL(reference.getFront());
+}
+} // namespace
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Higher priorities go first, and packets in the late transmit window go after everything else
+void test_priorityOrder(void)
+{
+    MeshPacketQueue q(8);
+    q.enqueue(makePacket(0x1001, 1, meshtastic_MeshPacket_Priority_BACKGROUND));
+    q.enqueue(makePacket(0x1001, 2, meshtastic_MeshPacket_Priority_ACK, 1000));
+    q.enqueue(makePacket(0x1001, 3, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0x1001, 4, meshtastic_MeshPacket_Priority_ACK));
+    q.enqueue(makePacket(0x1001, 5, meshtastic_MeshPacket_Priority_HIGH));
+    TEST_ASSERT_EQUAL(3, q.getFree());
+
+    TEST_ASSERT_EQUAL_UINT32(4, q.getFront()->id);
+    for (PacketId id : {4, 5, 3, 1, 2})
+        assertDequeues(q, 0x1001, id);
+    TEST_ASSERT_TRUE(q.empty());
+    TEST_ASSERT_NULL(q.dequeue());
+}
+
+// Equal priorities go out first come first served, after packets from other nodes
+void test_fifoWithinPriority(void)
+{
+    MeshPacketQueue q(8);
+    NodeNum us = nodeDB->getNodeNum();
+    q.enqueue(makePacket(us, 1, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0x1001, 2, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(us, 3, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0x1002, 4, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0x1001, 5, meshtastic_MeshPacket_Priority_DEFAULT));
+
+    assertDequeues(q, 0x1001, 2);
+    assertDequeues(q, 0x1002, 4);
+    assertDequeues(q, 0x1001, 5);
+    assertDequeues(q, us, 1);
+    assertDequeues(q, us, 3);
+}
+
+// When full, the newest of the lowest priority on-time packets makes room, late packets are never dropped
+void test_evictsWhenFull(void)
+{
+    MeshPacketQueue q(4);
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(0x1001, 1, meshtastic_MeshPacket_Priority_BACKGROUND, 1000)));
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(0x1001, 2, meshtastic_MeshPacket_Priority_DEFAULT)));
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(0x1001, 3, meshtastic_MeshPacket_Priority_DEFAULT)));
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(0x1001, 4, meshtastic_MeshPacket_Priority_HIGH)));
+    TEST_ASSERT_EQUAL(0, q.getFree());
+
+    // Nothing lower than DEFAULT on time, so another DEFAULT is turned away
+    meshtastic_MeshPacket *refused = makePacket(0x1001, 5, meshtastic_MeshPacket_Priority_DEFAULT);
+    TEST_ASSERT_FALSE(q.enqueue(refused));
+    packetPool.release(refused);
+
+    // The late BACKGROUND packet stays, the newer DEFAULT goes
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(0x1001, 6, meshtastic_MeshPacket_Priority_ACK)));
+    TEST_ASSERT_FALSE(q.find(0x1001, 3));
+    TEST_ASSERT_TRUE(q.find(0x1001, 1));
+    TEST_ASSERT_TRUE(q.enqueue(makePacket(0x1001, 7, meshtastic_MeshPacket_Priority_ACK)));
+    TEST_ASSERT_FALSE(q.find(0x1001, 2));
+
+    // Only late and higher priority packets left
+    meshtastic_MeshPacket *stillRefused = makePacket(0x1001, 8, meshtastic_MeshPacket_Priority_DEFAULT);
+    TEST_ASSERT_FALSE(q.enqueue(stillRefused));
+    packetPool.release(stillRefused);
+
+    for (PacketId id : {6, 7, 4, 1})
+        assertDequeues(q, 0x1001, id);
+}
+
+// remove() and find() go by sender and id, and from == 0 means us
+void test_removeAndFind(void)
+{
+    MeshPacketQueue q(8);
+    NodeNum us = nodeDB->getNodeNum();
+    q.enqueue(makePacket(0x1001, 7, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0x1002, 7, meshtastic_MeshPacket_Priority_DEFAULT));
+    q.enqueue(makePacket(0, 9, meshtastic_MeshPacket_Priority_DEFAULT, 1000));
+
+    TEST_ASSERT_TRUE(q.find(0x1002, 7));
+    TEST_ASSERT_FALSE(q.find(0x1003, 7));
+    TEST_ASSERT_FALSE(q.find(0x1001, 8));
+    TEST_ASSERT_TRUE(q.find(us, 9));
+
+    // Only the packets in the window asked for
+    TEST_ASSERT_NULL(q.remove(us, 9, true, false));
+    meshtastic_MeshPacket *p = q.remove(us, 9, false, true);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_UINT32(0, p->from);
+    packetPool.release(p);
+    TEST_ASSERT_FALSE(q.find(us, 9));
+
+    p = q.remove(0x1001, 7);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL_UINT32(0x1001, p->from);
+    packetPool.release(p);
+    TEST_ASSERT_NULL(q.remove(0x1001, 7));
+    TEST_ASSERT_EQUAL(7, q.getFree());
+    assertDequeues(q, 0x1002, 7);
+}
+
+// Random operations give the same results as the sorted vector did
+void test_matchesSortedQueue(void)
+{
+    replayOps(4, 20000, 1);
+    replayOps(16, 50000, 2);
+    replayOps(MAX_TX_QUEUE, 50000, 3);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    const std::unique_ptr<NodeDB> testNodeDB(new NodeDB());
+    nodeDB = testNodeDB.get();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_priorityOrder);
+    RUN_TEST(test_fifoWithinPriority);
+    RUN_TEST(test_evictsWhenFull);
+    RUN_TEST(test_removeAndFind);
+    RUN_TEST(test_matchesSortedQueue);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -0,0 +1,554 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "airtime.h"
+#include "mesh/Channels.h"
+#include "mesh/MeshRadio.h"
+#include "mesh/NextHopRouter.h"
+#include "mesh/NodeDB.h"
+#include "mesh/SinglePortModule.h"
+#include "platform/portduino/PortduinoGlue.h"
+#include "platform/portduino/SimRadio.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+
+/// Nodes in the routing-at-scale run
+#ifndef MESH_SIM_NODES
+#define MESH_SIM_NODES 100
+#endif
+
+/// Least share of the nodes within hop_limit relays of a sender that its message has to reach in the routing-at-scale run
+#ifndef MESH_SIM_MIN_DELIVERY
+#define MESH_SIM_MIN_DELIVERY 0.75
+#endif
+
+namespace
+{
+/// How radio signals get from one node to another
+struct MediumConfig {
+    float txPowerDbm = 20;
+    float refLossDb = 40; // path loss at 1m
+    float pathLossExponent = 3.5;
+    float noiseFloorDbm = -115; // for the 250kHz of LongFast
+    float minSnr = -17.5;       // what SF11 can still demodulate
+    float captureDb = 6;        // of two overlapping packets, one this much stronger survives
+
+    /// Furthest a packet can be heard
+    double range() const
+    {
+        return pow(10, (txPowerDbm - noiseFloorDbm - minSnr - refLossDb) / (10 * pathLossExponent));
+    }
+};
+
+struct Transmission;
+
+/// A transmission that is reaching a node
+struct Reception {
+    std::shared_ptr<Transmission> tx;
+    float rssi, snr;
+    bool corrupted;
+    bool deaf; // corrupted because the node transmitted during it
+};
+
+/**
+ * One simulated device.  The firmware keeps its state in globals, so a node only has its own NodeDB, Router (with its
+ * PacketHistory), radio and airtime counters, plus the parts of devicestate that say who it is.  The globals are switched
+ * to a node whenever it runs.
+ */
+struct SimNode {
+    double x, y; // metres
+    NodeNum num;
+
+    NodeDB *nodeDB = nullptr;
+    NextHopRouter *router = nullptr;
+    SimRadio *radio = nullptr;
+    AirTime *airTime = nullptr;
+    meshtastic_MyNodeInfo myNodeInfo;
+    meshtastic_User owner;
+
+    /// State of the medium around us
+    std::vector<Reception> hearing;
+    bool transmitting = false;
+
+    uint32_t txPackets = 0;
+    uint64_t txMsec = 0;
+    uint32_t delivered = 0; // text messages handed to our modules
+    uint64_t cpuNsec = 0;
+};
+
+struct Transmission {
+    SimNode *from;
+    meshtastic_MeshPacket wire; // only what is actually sent over the air
+    std::vector<SimNode *> receivers;
+};
+
+class VirtualMesh;
+VirtualMesh *simMesh;
+SimNode *currentNode;
+
+uint64_t threadCpuNsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/// Make n the node the firmware globals belong to
+void enter(SimNode &n)
+{
+    if (currentNode == &n)
+        return;
+    if (currentNode) {
+        currentNode->myNodeInfo = myNodeInfo;
+        currentNode->owner = owner;
+    }
+    myNodeInfo = n.myNodeInfo;
+    owner = n.owner;
+    nodeDB = n.nodeDB;
+    router = n.router;
+    airTime = n.airTime;
+    currentNode = &n;
+}
+
+/**
+ * Nodes joined by a virtual RF medium, run on a discrete-event clock.
+ *
+ * Signal strength falls off with log-distance path loss.  A node hears everything above the demodulation limit, and loses
+ * a packet if it was transmitting itself at any point during it (half duplex), or if another packet overlapped it and was
+ * not at least captureDb weaker.  Every transmission takes RadioInterface::getPacketTime() of simulated time.
+ */
+class VirtualMesh : public SimMedium
+{
+  public:
+    VirtualMesh(const std::vector<std::pair<double, double>> &positions, const MediumConfig &medium = MediumConfig())
+        : medium(medium)
+    {
+        simMesh = this;
+        setSetting(maxnodes, std::max<size_t>(100, positions.size()));
+
+        for (size_t i = 0; i < positions.size(); i++) {
+            SimNode &n = *nodes.emplace_back(new SimNode());
+            n.x = positions[i].first;
+            n.y = positions[i].second;
+            n.num = 0x10000 + i;
+
+            // Every NodeDB starts from a factory reset, and takes its node number from our MAC
+            char mac[13];
+            snprintf(mac, sizeof(mac), "0200%08X", n.num);
+            setSettingString(mac_address, mac);
+            rmDir("/prefs");
+            myNodeInfo.my_node_num = 0;
+            n.nodeDB = nodeDB = new NodeDB();
+            TEST_ASSERT_EQUAL_UINT32(n.num, nodeDB->getNodeNum());
+            n.myNodeInfo = myNodeInfo;
+            n.owner = owner;
+
+            n.airTime = new AirTime();
+            n.radio = new SimRadio();
+            n.radio->setMedium(this);
+            n.router = new NextHopRouter();
+            n.router->addInterface(n.radio);
+            byRadio[n.radio] = &n;
+        }
+
+        // All nodes share the config and the channels
+        channels.initDefaults();
+        config.lora.region = meshtastic_Config_LoRaConfig_RegionCode_US;
+        config.lora.use_preset = true;
+        config.lora.modem_preset = meshtastic_Config_LoRaConfig_ModemPreset_LONG_FAST;
+        config.lora.hop_limit = 3;
+        config.lora.tx_enabled = true;
+        config.device.role = meshtastic_Config_DeviceConfig_Role_CLIENT;
+        config.device.rebroadcast_mode = meshtastic_Config_DeviceConfig_RebroadcastMode_ALL;
+        channels.onConfigChanged();
+        initRegion();
+        for (auto &n : nodes)
+            n->radio->reconfigure();
+    }
+
+    ~VirtualMesh()
+    {
+        currentNode = nullptr;
+        for (auto &n : nodes) {
+            delete n->router;
+            delete n->radio;
+            delete n->airTime;
+            delete n->nodeDB;
+        }
+        router = nullptr;
+        nodeDB = nullptr;
+        airTime = nullptr;
+        simMesh = nullptr;
+    }
+
+    SimNode &node(size_t i) { return *nodes[i]; }
+    size_t size() const { return nodes.size(); }
+
+    /// Have node i broadcast a text message at simulated time atMsec
+    void sendText(size_t i, uint64_t atMsec)
+    {
+        SimNode &n = *nodes[i];
+        at(atMsec, [this, &n]() {
+            run(n, [this]() {
+                meshtastic_MeshPacket *p = router->allocForSending();
+                p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+                p->decoded.payload.size = snprintf((char *)p->decoded.payload.bytes, sizeof(p->decoded.payload.bytes),
+                                                   "message %u", (unsigned)messages.size());
+                messages.insert(p->id);
+                router->sendLocal(p, RX_SRC_LOCAL);
+            });
+        });
+    }
+
+    /// Process events until nothing is left to happen
+    void runUntilIdle()
+    {
+        while (!events.empty()) {
+            Event e = events.top();
+            events.pop();
+            now = e.at;
+            e.fn();
+        }
+    }
+
+    /// A text message reached the modules of the node running now
+    void onDelivered(const meshtastic_MeshPacket &p)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(deliveries.insert({currentNode->num, p.id}).second, "Delivered twice to the same node");
+        currentNode->delivered++;
+    }
+
+    bool delivered(size_t i, PacketId id) const { return deliveries.count({nodes[i]->num, id}) > 0; }
+
+    /// Nodes at most maxHops hops from node i, those a flood from it can reach without collisions getting in the way
+    size_t reachableFrom(size_t i, unsigned maxHops) const
+    {
+        std::vector<unsigned> hops(nodes.size(), UINT_MAX);
+        std::vector<size_t> frontier = {i};
+        hops[i] = 0;
+        for (size_t f = 0; f < frontier.size(); f++) {
+            const size_t from = frontier[f];
+            if (hops[from] == maxHops)
+                continue;
+            for (size_t to = 0; to < nodes.size(); to++) {
+                if (hops[to] == UINT_MAX && inRange(*nodes[from], *nodes[to])) {
+                    hops[to] = hops[from] + 1;
+                    frontier.push_back(to);
+                }
+            }
+        }
+        return frontier.size() - 1;
+    }
+
+    /// Print what it took to flood the messages sent
+    void report(const char *name) const
+    {
+        uint32_t txPackets = 0, relays = 0, dupes = 0, delivered = 0;
+        uint64_t txMsec = 0, cpuNsec = 0, maxCpuNsec = 0;
+        for (auto &n : nodes) {
+            txPackets += n->txPackets;
+            relays += n->radio->txRelay;
+            dupes += n->router->rxDupe;
+            delivered += n->delivered;
+            txMsec += n->txMsec;
+            cpuNsec += n->cpuNsec;
+            maxCpuNsec = std::max(maxCpuNsec, n->cpuNsec);
+        }
+        const size_t possible = messages.size() * (nodes.size() - 1);
+
+        char msg[200];
+        snprintf(msg, sizeof(msg), "%s: %u nodes, %u messages over %u s simulated", name, (unsigned)nodes.size(),
+                 (unsigned)messages.size(), (unsigned)(now / 1000));
+        TEST_MESSAGE(msg);
+        snprintf(msg, sizeof(msg), "  delivery ratio %.3f (%u of %u), %u packets sent of which %u relays",
+                 (double)delivered / possible, delivered, (unsigned)possible, txPackets, relays);
+        TEST_MESSAGE(msg);
+        snprintf(msg, sizeof(msg), "  %u duplicates received, %u packets lost to collisions, %u to half duplex", dupes,
+                 collisions, halfDuplex);
+        TEST_MESSAGE(msg);
+        snprintf(msg, sizeof(msg), "  airtime %.1f s total, %.2f s per message", txMsec / 1000.0,
+                 messages.empty() ? 0 : txMsec / 1000.0 / messages.size());
+        TEST_MESSAGE(msg);
+        snprintf(msg, sizeof(msg), "  CPU %.1f ms per node, %.1f ms at most", cpuNsec / 1e6 / nodes.size(), maxCpuNsec / 1e6);
+        TEST_MESSAGE(msg);
+    }
+
+    std::set<PacketId> messages;
+    uint32_t collisions = 0, halfDuplex = 0;
+
+    // SimMedium
+
+    void transmit(SimRadio *radio, const meshtastic_MeshPacket &p, uint32_t airtimeMsec) override
+    {
+        SimNode &from = *byRadio.at(radio);
+        from.transmitting = true;
+        from.txPackets++;
+        from.txMsec += airtimeMsec;
+        // We can't hear anything while we transmit
+        for (auto &r : from.hearing)
+            r.corrupted = r.deaf = true;
+
+        auto tx = std::make_shared<Transmission>();
+        tx->from = &from;
+        tx->wire = wireCopy(p);
+        for (auto &to : nodes) {
+            if (to.get() == &from)
+                continue;
+            const float rssi = rssiBetween(from, *to);
+            const float snr = rssi - medium.noiseFloorDbm;
+            if (snr < medium.minSnr)
+                continue;
+
+            Reception r = {tx, rssi, snr, to->transmitting, to->transmitting};
+            for (auto &other : to->hearing) {
+                if (rssi < other.rssi + medium.captureDb)
+                    r.corrupted = true;
+                if (other.rssi < rssi + medium.captureDb)
+                    other.corrupted = true;
+            }
+            to->hearing.push_back(r);
+            tx->receivers.push_back(to.get());
+        }
+        at(now + airtimeMsec, [this, tx]() { endTransmission(tx); });
+    }
+
+    void schedule(SimRadio *radio, uint32_t msec, uint32_t notification) override
+    {
+        SimNode &n = *byRadio.at(radio);
+        at(now + msec, [this, &n, notification]() { run(n, [&n, notification]() { n.radio->onMediumTimer(notification); }); });
+    }
+
+    bool isChannelActive(SimRadio *radio) override { return !byRadio.at(radio)->hearing.empty(); }
+
+  private:
+    struct Event {
+        uint64_t at;
+        uint64_t seq; // so events at the same time happen in the order they were scheduled
+        std::function<void()> fn;
+
+        bool operator>(const Event &o) const { return at != o.at ? at > o.at : seq > o.seq; }
+    };
+
+    MediumConfig medium;
+    std::vector<std::unique_ptr<SimNode>> nodes;
+    std::unordered_map<SimRadio *, SimNode *> byRadio;
+    std::set<std::pair<NodeNum, PacketId>> deliveries;
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    uint64_t now = 0, nextSeq = 0;
+
+    void at(uint64_t when, std::function<void()> fn) { events.push({when, nextSeq++, std::move(fn)}); }
+
+    /// Run f as node n, then let its router handle anything the radio received, charging the CPU time to n
+    template <typename F> void run(SimNode &n, F f)
+    {
+        enter(n);
+        const uint64_t start = threadCpuNsec();
+        f();
+        n.router->runOnce();
+        n.cpuNsec += threadCpuNsec() - start;
+    }
+
+    float rssiBetween(const SimNode &a, const SimNode &b) const
+    {
+        const double d = std::max(1.0, std::hypot(a.x - b.x, a.y - b.y));
+        return medium.txPowerDbm - medium.refLossDb - 10 * medium.pathLossExponent * log10(d);
+    }
+
+    /// b can demodulate what a sends, when nothing else is on the air
+    bool inRange(const SimNode &a, const SimNode &b) const { return rssiBetween(a, b) - medium.noiseFloorDbm >= medium.minSnr; }
+
+    /// The header fields and encrypted payload, as RadioLibInterface would rebuild them from a received frame
+    static meshtastic_MeshPacket wireCopy(const meshtastic_MeshPacket &p)
+    {
+        meshtastic_MeshPacket w = meshtastic_MeshPacket_init_zero;
+        w.from = p.from;
+        w.to = p.to;
+        w.id = p.id;
+        w.channel = p.channel;
+        w.hop_limit = p.hop_limit;
+        w.hop_start = p.hop_start;
+        w.want_ack = p.want_ack;
+        w.via_mqtt = p.via_mqtt;
+        w.next_hop = p.hop_start == 0 ? NO_NEXT_HOP_PREFERENCE : p.next_hop;
+        w.relay_node = p.hop_start == 0 ? NO_RELAY_NODE : p.relay_node;
+        w.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+        w.encrypted = p.encrypted;
+        return w;
+    }
+
+    void endTransmission(const std::shared_ptr<Transmission> &tx)
+    {
+        tx->from->transmitting = false;
+        for (SimNode *to : tx->receivers) {
+            auto r = std::find_if(to->hearing.begin(), to->hearing.end(), [&](const Reception &r) { return r.tx == tx; });
+            const Reception rx = *r;
+            to->hearing.erase(r);
+            if (rx.deaf) {
+                halfDuplex++;
+                continue;
+            }
+            if (rx.corrupted) {
+                collisions++;
+                continue;
+            }
+            run(*to, [&]() { to->radio->receiveFromMedium(tx->wire, rx.snr, (int32_t)rx.rssi); });
+        }
+    }
+};
+
+/// Counts the text messages that reach each node
+class SinkModule : public SinglePortModule
+{
+  public:
+    SinkModule() : SinglePortModule("sink", meshtastic_PortNum_TEXT_MESSAGE_APP) {}
+
+  protected:
+    ProcessMessage handleReceived(const meshtastic_MeshPacket &mp) override
+    {
+        if (simMesh)
+            simMesh->onDelivered(mp);
+        return ProcessMessage::CONTINUE;
+    }
+};
+
+std::vector<std::pair<double, double>> line(size_t count, double spacing)
+{
+    std::vector<std::pair<double, double>> positions;
+    for (size_t i = 0; i < count; i++)
+        positions.push_back({i * spacing, 0});
+    return positions;
+}
+
+/// count nodes spread evenly over a square sized so each one is in range of about `neighbours` others
+std::vector<std::pair<double, double>> scatter(size_t count, double neighbours, const MediumConfig &medium, uint32_t seed)
+{
+    const double range = medium.range();
+    const double side = sqrt(count * M_PI * range * range / neighbours);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> coord(0, side);
+    std::vector<std::pair<double, double>> positions;
+    for (size_t i = 0; i < count; i++)
+        positions.push_back({coord(rng), coord(rng)});
+    return positions;
+}
+} // namespace
+
+void setUp(void)
+{
+    randomSeed(1);
+}
+
+void tearDown(void)
+{
+    freeRetiredSettings(); // every node took its MAC address from a snapshot of its own
+}
+
+// Along a line where each node only hears its neighbours, a broadcast floods exactly hop_limit relays out
+void test_lineFloodsToHopLimit(void)
+{
+    MediumConfig medium;
+    VirtualMesh m(line(6, medium.range() * 0.7), medium);
+    m.sendText(0, 1000);
+    m.runUntilIdle();
+
+    TEST_ASSERT_EQUAL(1, m.messages.size());
+    const PacketId id = *m.messages.begin();
+    TEST_ASSERT_FALSE(m.delivered(0, id)); // Our own broadcast isn't handed back to us
+    for (size_t i = 1; i <= 4; i++)
+        TEST_ASSERT_TRUE(m.delivered(i, id));
+    TEST_ASSERT_FALSE(m.delivered(5, id)); // One hop past the hop limit
+
+    // The sender, then nodes 1 to 3 relaying, and node 4 receiving it with no hops left
+    TEST_ASSERT_EQUAL(1, m.node(0).txPackets);
+    for (size_t i = 1; i <= 3; i++) {
+        TEST_ASSERT_EQUAL(1, m.node(i).txPackets);
+        TEST_ASSERT_EQUAL(1, m.node(i).radio->txRelay);
+    }
+    TEST_ASSERT_EQUAL(0, m.node(4).txPackets);
+    TEST_ASSERT_EQUAL(0, m.collisions + m.halfDuplex);
+    m.report("line");
+}
+
+// Two nodes that can't hear each other sending at once to the node between them: neither gets through
+void test_hiddenTerminalsCollide(void)
+{
+    MediumConfig medium;
+    VirtualMesh m(line(3, medium.range() * 0.7), medium);
+    config.lora.hop_limit = 0; // Nothing relayed, so nothing gets through later
+    m.sendText(0, 1000);
+    m.sendText(2, 1000);
+    m.runUntilIdle();
+
+    TEST_ASSERT_EQUAL(0, m.node(1).delivered);
+    TEST_ASSERT_EQUAL(2, m.collisions);
+}
+
+// Flood one message from every node of a random mesh, and report how the routers coped
+void test_floodAtScale(void)
+{
+    MediumConfig medium;
+    VirtualMesh m(scatter(MESH_SIM_NODES, 8, medium, 42), medium);
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < m.size(); i++)
+        m.sendText(i, rng() % (30 * 60 * 1000));
+    m.runUntilIdle();
+
+    TEST_ASSERT_EQUAL(m.size(), m.messages.size());
+    uint32_t delivered = 0, received = 0, dupes = 0;
+    size_t reachable = 0;
+    for (size_t i = 0; i < m.size(); i++) {
+        delivered += m.node(i).delivered;
+        received += m.node(i).radio->rxGood;
+        dupes += m.node(i).router->rxDupe;
+        reachable += m.reachableFrom(i, config.lora.hop_limit + 1);
+    }
+    m.report("flood at scale");
+
+    // Only collisions keep a message from a node within the hop limit, and it never gets further
+    TEST_ASSERT_TRUE(delivered <= reachable);
+    TEST_ASSERT_TRUE_MESSAGE(delivered >= reachable * MESH_SIM_MIN_DELIVERY, "Delivery ratio below MESH_SIM_MIN_DELIVERY");
+
+    // Every copy a node heard after its first (and any of its own message) was suppressed as a duplicate
+    TEST_ASSERT_TRUE(dupes > 0);
+    TEST_ASSERT_EQUAL_UINT32(received - delivered, dupes);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    if (!spiLock)
+        initSPI();
+    setSetting(logoutputlevel, level_warn); // Thousands of packets would otherwise each log a dozen lines
+    SinkModule sink;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_lineFloodsToHopLimit);
+    RUN_TEST(test_hiddenTerminalsCollide);
+    RUN_TEST(test_floodAtScale);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
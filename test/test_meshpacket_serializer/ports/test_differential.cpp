@@ -0,0 +1,283 @@
+#include "../reference_serializer.h"
+#include "../test_helpers.h"
+#include "mesh/NodeDB.h"
+#include <algorithm>
+#include <meshtastic/remote_hardware.pb.h>
+#include <pb_common.h>
+#include <random>
+#if defined(ARCH_ESP32)
+#include <meshtastic/paxcount.pb.h>
+#endif
+
+/// Random packets test_serializer_matches_reference() compares
+#ifndef SERIALIZER_DIFF_PACKETS
+#define SERIALIZER_DIFF_PACKETS 200000
+#endif
+
+static std::mt19937 rng;
+
+static uint32_t randomUpTo(uint32_t max)
+{
+    return std::uniform_int_distribution<uint32_t>(0, max)(rng);
+}
+
+/// Text that JSON has to escape: quotes, backslashes, slashes, control characters and UTF-8
+static void randomText(char *out, size_t maxLen)
+{
+    static const char *const pieces[] = {"a", "Z", "0", " ", "\"", "\\", "/", "\n", "\t", "\x01", "\x1f", "\x7f", "\xc3\xa9",
+                                         "\xe2\x82\xac", "\xf0\x9f\x93\xa1", "{", "}", "[", "]", ":", ","};
+    size_t len = 0, want = randomUpTo(maxLen);
+    while (len < want) {
+        const char *piece = pieces[randomUpTo(sizeof(pieces) / sizeof(pieces[0]) - 1)];
+        size_t n = strlen(piece);
+        if (len + n > want)
+            break;
+        memcpy(out + len, piece, n);
+        len += n;
+    }
+    out[len] = 0;
+}
+
+/// A text message, half the time one that JSON::Parse accepts
+static size_t randomTextPayload(uint8_t *out, size_t size)
+{
+    static const char *const json[] = {"{\"temperature\": 21.5}",
+                                       " {\"b\": [1, 2.50, -3e2], \"a\": true, \"c\": null} ",
+                                       "[\"x\", {\"nested\": {\"deep\": [false]}}]",
+                                       "\"just a string \\u00e9\\n\"",
+                                       "123456789012",
+                                       "-0.000001",
+                                       "{\"unterminated\": ",
+                                       "{}"};
+    if (randomUpTo(1)) {
+        const char *s = json[randomUpTo(sizeof(json) / sizeof(json[0]) - 1)];
+        size_t n = std::min(strlen(s), size);
+        memcpy(out, s, n);
+        return n;
+    }
+    char text[meshtastic_Constants_DATA_PAYLOAD_LEN + 1];
+    randomText(text, std::min(size, sizeof(text) - 1));
+    size_t n = strlen(text);
+    if (n && randomUpTo(19) == 0)
+        text[randomUpTo(n - 1)] = 0; // what follows a NUL is never seen
+    memcpy(out, text, n);
+    return n;
+}
+
+static void randomField(pb_field_iter_t &field, void *data);
+
+/// Fill a nanopb struct with a random subset of its fields, each set to random values
+static void randomMessage(const pb_msgdesc_t *desc, void *message)
+{
+    pb_field_iter_t field;
+    if (!pb_field_iter_begin(&field, desc, message))
+        return;
+    do {
+        if (PB_ATYPE(field.type) != PB_ATYPE_STATIC)
+            continue;
+        switch (PB_HTYPE(field.type)) {
+        case PB_HTYPE_ONEOF:
+            // Every member of a oneof shares the union, only the first one picked is filled in
+            if (*(pb_size_t *)field.pSize == 0 && randomUpTo(2) == 0) {
+                *(pb_size_t *)field.pSize = field.tag;
+                randomField(field, field.pData);
+            }
+            break;
+        case PB_HTYPE_REPEATED: {
+            pb_size_t count = field.array_size;
+            if (field.pSize != &field.array_size) {
+                count = randomUpTo(3) ? randomUpTo(std::min<pb_size_t>(field.array_size, 4)) : randomUpTo(field.array_size);
+                *(pb_size_t *)field.pSize = count;
+            }
+            for (pb_size_t i = 0; i < count; i++)
+                randomField(field, (char *)field.pData + i * field.data_size);
+            break;
+        }
+        case PB_HTYPE_OPTIONAL:
+            if (field.pSize && randomUpTo(1)) {
+                *(bool *)field.pSize = true;
+                randomField(field, field.pData);
+            }
+            break;
+        default:
+            if (randomUpTo(2) == 0)
+                randomField(field, field.pData);
+            break;
+        }
+    } while (pb_field_iter_next(&field));
+}
+
+static void randomField(pb_field_iter_t &field, void *data)
+{
+    switch (PB_LTYPE(field.type)) {
+    case PB_LTYPE_BOOL:
+        *(bool *)data = randomUpTo(1);
+        break;
+    case PB_LTYPE_STRING:
+        randomText((char *)data, std::min<size_t>(field.data_size - 1, 40));
+        break;
+    case PB_LTYPE_BYTES: {
+        pb_bytes_array_t *bytes = (pb_bytes_array_t *)data;
+        bytes->size = randomUpTo(std::min<size_t>(field.data_size - offsetof(pb_bytes_array_t, bytes), 40));
+        for (pb_size_t i = 0; i < bytes->size; i++)
+            bytes->bytes[i] = rng();
+        break;
+    }
+    case PB_LTYPE_FIXED_LENGTH_BYTES:
+        for (pb_size_t i = 0; i < field.data_size; i++)
+            ((uint8_t *)data)[i] = rng();
+        break;
+    case PB_LTYPE_SUBMESSAGE:
+    case PB_LTYPE_SUBMSG_W_CB:
+        randomMessage(field.submsg_desc, data);
+        break;
+    default: {
+        // Integers, enums and floats alike: small values, extremes, and any bit pattern (so NaN and infinities too)
+        uint64_t value;
+        switch (randomUpTo(3)) {
+        case 0:
+            value = randomUpTo(10);
+            break;
+        case 1:
+            value = randomUpTo(1) ? UINT64_MAX : (uint64_t)1 << (8 * field.data_size - 1);
+            break;
+        default:
+            value = ((uint64_t)rng() << 32) | rng();
+            break;
+        }
+        memcpy(data, &value, std::min<size_t>(field.data_size, sizeof(value))); // little endian, so the low bytes
+        break;
+    }
+    }
+}
+
+/// Encode a random message into the payload, @return false if none that fits came up
+static bool randomProtobufPayload(meshtastic_Data &decoded, const pb_msgdesc_t *desc, size_t structSize)
+{
+    static union {
+        meshtastic_Telemetry telemetry;
+        meshtastic_User user;
+        meshtastic_Position position;
+        meshtastic_Waypoint waypoint;
+        meshtastic_NeighborInfo neighborInfo;
+        meshtastic_RouteDiscovery routeDiscovery;
+        meshtastic_HardwareMessage hardwareMessage;
+#if defined(ARCH_ESP32)
+        meshtastic_Paxcount paxcount;
+#endif
+    } message;
+    TEST_ASSERT_TRUE(structSize <= sizeof(message));
+
+    for (int attempt = 0; attempt < 10; attempt++) {
+        memset(&message, 0, sizeof(message));
+        randomMessage(desc, &message);
+        pb_ostream_t stream = pb_ostream_from_buffer(decoded.payload.bytes, sizeof(decoded.payload.bytes));
+        if (pb_encode(&stream, desc, &message)) {
+            decoded.payload.size = stream.bytes_written;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// A packet with random header fields and a payload for a random port, now and then one that doesn't decode
+static meshtastic_MeshPacket randomPacket()
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.id = rng();
+    p.from = rng();
+    p.to = randomUpTo(3) ? rng() : NODENUM_BROADCAST;
+    p.channel = randomUpTo(3) ? randomUpTo(7) : randomUpTo(255);
+    p.rx_time = rng();
+    p.rx_rssi = randomUpTo(3) ? -(int32_t)randomUpTo(140) : 0;
+    p.rx_snr = randomUpTo(3) ? (float)((int32_t)randomUpTo(160) - 80) / 4 : 0;
+    p.hop_start = randomUpTo(7);
+    p.hop_limit = randomUpTo(7);
+    p.want_ack = randomUpTo(1);
+
+    if (randomUpTo(9) == 0) {
+        p.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+        p.encrypted.size = randomUpTo(sizeof(p.encrypted.bytes));
+        for (pb_size_t i = 0; i < p.encrypted.size; i++)
+            p.encrypted.bytes[i] = rng();
+        return p;
+    }
+
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    meshtastic_Data &d = p.decoded;
+    static const struct {
+        meshtastic_PortNum port;
+        const pb_msgdesc_t *desc;
+        size_t structSize;
+    } protobufPorts[] = {
+        {meshtastic_PortNum_TELEMETRY_APP, &meshtastic_Telemetry_msg, sizeof(meshtastic_Telemetry)},
+        {meshtastic_PortNum_NODEINFO_APP, &meshtastic_User_msg, sizeof(meshtastic_User)},
+        {meshtastic_PortNum_POSITION_APP, &meshtastic_Position_msg, sizeof(meshtastic_Position)},
+        {meshtastic_PortNum_WAYPOINT_APP, &meshtastic_Waypoint_msg, sizeof(meshtastic_Waypoint)},
+        {meshtastic_PortNum_NEIGHBORINFO_APP, &meshtastic_NeighborInfo_msg, sizeof(meshtastic_NeighborInfo)},
+        {meshtastic_PortNum_TRACEROUTE_APP, &meshtastic_RouteDiscovery_msg, sizeof(meshtastic_RouteDiscovery)},
+        {meshtastic_PortNum_REMOTE_HARDWARE_APP, &meshtastic_HardwareMessage_msg, sizeof(meshtastic_HardwareMessage)},
+#if defined(ARCH_ESP32)
+        {meshtastic_PortNum_PAXCOUNTER_APP, &meshtastic_Paxcount_msg, sizeof(meshtastic_Paxcount)},
+#endif
+    };
+    const uint32_t numPorts = sizeof(protobufPorts) / sizeof(protobufPorts[0]);
+
+    uint32_t pick = randomUpTo(numPorts + 3);
+    if (pick < numPorts) {
+        d.portnum = protobufPorts[pick].port;
+        if (randomUpTo(19) == 0 || !randomProtobufPayload(d, protobufPorts[pick].desc, protobufPorts[pick].structSize)) {
+            d.payload.size = randomUpTo(sizeof(d.payload.bytes)); // most likely fails to decode
+            for (pb_size_t i = 0; i < d.payload.size; i++)
+                d.payload.bytes[i] = rng();
+        }
+    } else if (pick == numPorts) {
+        d.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+        d.payload.size = randomTextPayload(d.payload.bytes, sizeof(d.payload.bytes));
+    } else if (pick == numPorts + 1) {
+        d.portnum = meshtastic_PortNum_DETECTION_SENSOR_APP;
+        d.payload.size = randomTextPayload(d.payload.bytes, sizeof(d.payload.bytes));
+    } else {
+        d.portnum = (meshtastic_PortNum)randomUpTo(meshtastic_PortNum_MAX);
+    }
+
+    // Traceroute responses name each hop from the NodeDB, without one only requests (which have no payload) are compared
+    d.request_id = (nodeDB && randomUpTo(1)) ? rng() : 0;
+    return p;
+}
+
+/// Everything JsonSerializeEncrypted() wrote, but the time it was written at
+static std::string withoutTime(std::string json)
+{
+    size_t start = json.find("\"time_ms\":");
+    if (start != std::string::npos)
+        json.erase(start, json.find(',', start) + 1 - start);
+    return json;
+}
+
+// The JsonWriter serializer writes exactly what the JSONValue tree did, for random packets of every port
+void test_serializer_matches_reference()
+{
+    rng.seed(1);
+    std::string out;
+    uint32_t differences = 0;
+    for (uint32_t i = 0; i < SERIALIZER_DIFF_PACKETS; i++) {
+        const meshtastic_MeshPacket p = randomPacket();
+        const std::string expected = ReferenceSerializer::JsonSerialize(&p, false);
+        MeshPacketSerializer::JsonSerialize(&p, out, false);
+        if (out != expected && differences++ < 5) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "packet %u, port %d", i, p.decoded.portnum);
+            TEST_MESSAGE(msg);
+            TEST_MESSAGE(("expected " + expected).c_str());
+            TEST_MESSAGE(("got      " + out).c_str());
+        }
+
+        if (p.which_payload_variant == meshtastic_MeshPacket_encrypted_tag) {
+            MeshPacketSerializer::JsonSerializeEncrypted(&p, out);
+            if (withoutTime(out) != withoutTime(ReferenceSerializer::JsonSerializeEncrypted(&p)) && differences++ < 5)
+                TEST_MESSAGE(("encrypted " + out).c_str());
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, differences);
+}
@@ -0,0 +1,77 @@
+#include "../test_helpers.h"
+#include "mesh/NodeDB.h"
+
+static meshtastic_MeshPacket create_text_packet(const char *text)
+{
+    return create_test_packet(meshtastic_PortNum_TEXT_MESSAGE_APP, (const uint8_t *)text, strlen(text));
+}
+
+static meshtastic_MeshPacket create_telemetry_packet()
+{
+    meshtastic_Telemetry telemetry = meshtastic_Telemetry_init_zero;
+    telemetry.which_variant = meshtastic_Telemetry_device_metrics_tag;
+    telemetry.variant.device_metrics.has_battery_level = true;
+    telemetry.variant.device_metrics.battery_level = 85;
+    telemetry.variant.device_metrics.voltage = 3.72f;
+    telemetry.variant.device_metrics.uptime_seconds = 12345;
+
+    uint8_t buffer[256];
+    pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+    pb_encode(&stream, &meshtastic_Telemetry_msg, &telemetry);
+    return create_test_packet(meshtastic_PortNum_TELEMETRY_APP, buffer, stream.bytes_written);
+}
+
+// Keys come out sorted and numbers formatted as the JSONValue tree did it, byte for byte
+void test_exact_output()
+{
+    meshtastic_MeshPacket packet = create_text_packet("Hi \"all\" / ok\n");
+
+    char expected[300];
+    snprintf(expected, sizeof(expected),
+             "{\"channel\":0,\"from\":287454020,\"hop_start\":3,\"hops_away\":0,\"id\":39321,"
+             "\"payload\":{\"text\":\"Hi \\\"all\\\" \\/ ok\\n\"},\"rssi\":-85,\"sender\":\"%s\",\"snr\":10.5,"
+             "\"timestamp\":1609459200,\"to\":1432778632,\"type\":\"text\"}",
+             owner.id);
+    TEST_ASSERT_EQUAL_STRING(expected, MeshPacketSerializer::JsonSerialize(&packet, false).c_str());
+
+    // A JSON text message is embedded as JSON, re-serialized
+    packet = create_text_packet(" {\"b\": [1, 2.50], \"a\": true} ");
+    std::string json = MeshPacketSerializer::JsonSerialize(&packet, false);
+    TEST_ASSERT_TRUE(json.find("\"payload\":{\"a\":true,\"b\":[1,2.5]},") != std::string::npos);
+}
+
+// Serializing into the same string gives the same output, and stops allocating once it is big enough
+void test_reused_buffer_serialization()
+{
+    meshtastic_MeshPacket packets[] = {create_text_packet("Hello Meshtastic!"), create_telemetry_packet(),
+                                       create_text_packet("{\"temperature\": 21.5}")};
+    std::string out;
+    out.reserve(512);
+    const char *data = out.data();
+
+    for (int round = 0; round < 3; round++) {
+        for (const meshtastic_MeshPacket &packet : packets) {
+            MeshPacketSerializer::JsonSerialize(&packet, out, false);
+            TEST_ASSERT_EQUAL_STRING(MeshPacketSerializer::JsonSerialize(&packet, false).c_str(), out.c_str());
+        }
+    }
+    TEST_ASSERT_TRUE(data == out.data());
+}
+
+void test_serialization_throughput()
+{
+    meshtastic_MeshPacket packets[] = {create_text_packet("Hello Meshtastic!"), create_telemetry_packet()};
+    std::string out;
+    const uint32_t count = 20000;
+
+    uint32_t start = millis();
+    for (uint32_t i = 0; i < count; i++)
+        MeshPacketSerializer::JsonSerialize(&packets[i % 2], out, false);
+    uint32_t elapsed = millis() - start;
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "%u packets serialized in %u ms (%u packets/s)", count, elapsed,
+             elapsed ? count * 1000 / elapsed : count * 1000);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(out.length() > 0);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <meshtastic/mesh.pb.h>
+#include <string>
+
+/// MeshPacketSerializer as it was when it built a JSONValue tree, which the JsonWriter version has to match byte for byte
+class ReferenceSerializer
+{
+  public:
+    static std::string JsonSerialize(const meshtastic_MeshPacket *mp, bool shouldLog = true);
+    static std::string JsonSerializeEncrypted(const meshtastic_MeshPacket *mp);
+
+  private:
+    static std::string bytesToHex(const uint8_t *bytes, int len)
+    {
+        static const char digits[] = "0123456789ABCDEF";
+        std::string result = "";
+        for (int i = 0; i < len; ++i) {
+            result += digits[(bytes[i] & 0xF0) >> 4];
+            result += digits[bytes[i] & 0x0F];
+        }
+        return result;
+    }
+};
@@ -14,6 +14,10 @@ void test_telemetry_environment_metrics_missing_fields();
 void test_telemetry_environment_metrics_complete_coverage();
 void test_telemetry_environment_metrics_unset_fields();
 void test_encrypted_packet_serialization();
+void test_exact_output();
+void test_reused_buffer_serialization();
+void test_serialization_throughput();
+void test_serializer_matches_reference();
 
 void setup()
 {
@@ -42,6 +46,12 @@ void setup()
     // Encrypted packet test
     RUN_TEST(test_encrypted_packet_serialization);
 
+    // Reusable output buffer tests
+    RUN_TEST(test_exact_output);
+    RUN_TEST(test_reused_buffer_serialization);
+    RUN_TEST(test_serialization_throughput);
+    RUN_TEST(test_serializer_matches_reference);
+
     UNITY_END();
 }
 
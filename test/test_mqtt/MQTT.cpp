@@ -237,7 +237,7 @@ bool loopUntil(std::function<bool()> conditionMet)
 {
     long start = millis();
     while (start + 4000 > millis()) {
-        long delayMsec = concurrency::mainController.runOrDelay();
+        long delayMsec = concurrency::mainScheduler.runOrDelay();
         if (conditionMet())
             return true;
         concurrency::mainDelay.delay(std::min(delayMsec, 5L));
@@ -503,6 +503,54 @@ void test_sendQueued(void)
     TEST_ASSERT_EQUAL(decoded.id, env.packet->id);
 }
 
+// Test that a backlog queued while disconnected is published in a burst after reconnecting.
+void test_sendQueuedBurst(void)
+{
+    pubsub->connected_ = false;
+    pubsub->refuseConnection_ = true;
+    TEST_ASSERT_TRUE(loopUntil([] { return !unitTest->getPubSub().connected(); }));
+
+    for (int i = 0; i < 10; i++)
+        mqtt->onSend(encrypted, decoded, 0);
+    TEST_ASSERT_EQUAL(10, unitTest->queueSize());
+    TEST_ASSERT_EQUAL(10, mqtt->getQueueStats().depth);
+
+    pubsub->refuseConnection_ = false;
+    TEST_ASSERT_TRUE(loopUntil([] { return !pubsub->published_.empty(); }));
+
+    // The whole backlog fits within one run's budget.
+    TEST_ASSERT_EQUAL(0, unitTest->queueSize());
+    const MQTT::QueueStats stats = mqtt->getQueueStats();
+    TEST_ASSERT_EQUAL(0, stats.depth);
+    TEST_ASSERT_EQUAL(0, stats.oldestAgeMsec);
+    TEST_ASSERT_EQUAL(10, stats.published);
+    TEST_ASSERT_EQUAL(0, stats.dropped);
+}
+
+// Test that the oldest queued message is discarded, and counted, when the queue is full.
+void test_sendQueuedFullDropsOldest(void)
+{
+    pubsub->connected_ = false;
+    pubsub->refuseConnection_ = true;
+    TEST_ASSERT_TRUE(loopUntil([] { return !unitTest->getPubSub().connected(); }));
+
+    for (int i = 0; i < MAX_MQTT_QUEUE + 2; i++) {
+        meshtastic_MeshPacket p = decoded;
+        p.id = i + 1;
+        mqtt->onSend(encrypted, p, 0);
+    }
+    TEST_ASSERT_EQUAL(MAX_MQTT_QUEUE, unitTest->queueSize());
+    TEST_ASSERT_EQUAL(2, mqtt->getQueueStats().dropped);
+
+    pubsub->refuseConnection_ = false;
+    TEST_ASSERT_TRUE(loopUntil([] { return unitTest->queueSize() == 0; }));
+
+    TEST_ASSERT_EQUAL(MAX_MQTT_QUEUE, mqtt->getQueueStats().published);
+    const DecodedServiceEnvelope &env = std::get<DecodedServiceEnvelope>(pubsub->published_.front().second);
+    TEST_ASSERT_TRUE(env.validDecode);
+    TEST_ASSERT_EQUAL(3, env.packet->id);
+}
+
 // Verify reconnecting with the proxy enabled does not reconnect to a MQTT server.
 void test_reconnectProxyDoesNotReconnectMqtt(void)
 {
@@ -886,6 +934,8 @@ void setup()
     RUN_TEST(test_noRangeTestAppOnDefaultServer);
     RUN_TEST(test_noDetectionSensorAppOnDefaultServer);
     RUN_TEST(test_sendQueued);
+    RUN_TEST(test_sendQueuedBurst);
+    RUN_TEST(test_sendQueuedFullDropsOldest);
     RUN_TEST(test_reconnectProxyDoesNotReconnectMqtt);
     RUN_TEST(test_receiveEmptyMeshPacket);
     RUN_TEST(test_receiveDecodedProto);
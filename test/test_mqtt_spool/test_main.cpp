@@ -0,0 +1,337 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mqtt/MQTTSpool.h"
+
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+std::string spoolDir;
+std::string brokerLog;
+
+/**
+ * Stands in for the MQTT server: every message it accepts is appended to a log file, so what it received survives the
+ * process that published it being killed.  After acceptLimit messages it stops accepting, like a server going away.
+ */
+class FakeBroker
+{
+  public:
+    explicit FakeBroker(size_t acceptLimit = SIZE_MAX) : acceptLimit(acceptLimit), log(brokerLog, std::ios::app) {}
+
+    bool publish(const MQTTSpool::Message &m)
+    {
+        if (accepted >= acceptLimit)
+            return false;
+        log << m.topic << ' ' << std::string((const char *)m.envBytes.data(), m.envBytes.size()) << std::endl;
+        accepted++;
+        return true;
+    }
+
+    /// Publish everything in the spool that we will accept
+    void drain(MQTTSpool &spool)
+    {
+        MQTTSpool::Message m;
+        while (spool.peek(m) && publish(m))
+            spool.pop();
+    }
+
+    /// The payloads received so far, by every broker, in order
+    static std::vector<std::string> received()
+    {
+        std::vector<std::string> payloads;
+        std::ifstream in(brokerLog);
+        std::string topic, payload;
+        while (in >> topic >> payload)
+            payloads.push_back(payload);
+        return payloads;
+    }
+
+  private:
+    size_t acceptLimit;
+    size_t accepted = 0;
+    std::ofstream log;
+};
+
+std::string payload(int i)
+{
+    return "message-" + std::to_string(i);
+}
+
+void append(MQTTSpool &spool, int i)
+{
+    const std::string p = payload(i);
+    TEST_ASSERT_TRUE(spool.append("msh/2/e/test/!12345678", (const uint8_t *)p.data(), p.size(), "", ""));
+}
+
+/// Run f in a child process that is then killed, without any chance to flush or clean up
+template <typename F> void runAndKill(F f)
+{
+    pid_t pid = fork();
+    TEST_ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+        f();
+        kill(getpid(), SIGKILL);
+    }
+    int status;
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    TEST_ASSERT_TRUE(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+}
+
+/// Check the broker received 0..count-1 in order, allowing messages to be published again after a restart
+void assertReceivedInOrder(int count)
+{
+    int next = 0;
+    for (const std::string &p : FakeBroker::received()) {
+        if (next < count && p == payload(next)) {
+            next++;
+            continue;
+        }
+        // A repeat of something already received
+        bool repeat = false;
+        for (int i = 0; i < next && !repeat; i++)
+            repeat = p == payload(i);
+        TEST_ASSERT_TRUE_MESSAGE(repeat, p.c_str());
+    }
+    TEST_ASSERT_EQUAL(count, next);
+}
+} // namespace
+
+void setUp(void)
+{
+    spoolDir = std::filesystem::temp_directory_path() / ("test_mqtt_spool." + std::to_string(getpid()));
+    brokerLog = spoolDir + ".broker";
+    std::filesystem::remove_all(spoolDir);
+    std::filesystem::remove(brokerLog);
+}
+
+void tearDown(void)
+{
+    std::filesystem::remove_all(spoolDir);
+    std::filesystem::remove(brokerLog);
+}
+
+void test_replaysInOrder(void)
+{
+    MQTTSpool spool(spoolDir, 1024 * 1024, 4096);
+    TEST_ASSERT_TRUE(spool.open());
+    for (int i = 0; i < 500; i++)
+        append(spool, i);
+    TEST_ASSERT_EQUAL(500, spool.getCount());
+
+    {
+        FakeBroker broker;
+        broker.drain(spool);
+    }
+    TEST_ASSERT_EQUAL(0, spool.getCount());
+    TEST_ASSERT_EQUAL(0, spool.getDropped());
+    assertReceivedInOrder(500);
+    // Published segments are deleted, all but the one being appended to
+    TEST_ASSERT_TRUE(spool.getBytes() <= 4096 + 100);
+}
+
+void test_resumesAfterRestart(void)
+{
+    {
+        MQTTSpool spool(spoolDir, 1024 * 1024, 4096);
+        TEST_ASSERT_TRUE(spool.open());
+        for (int i = 0; i < 300; i++)
+            append(spool, i);
+    }
+    {
+        MQTTSpool spool(spoolDir, 1024 * 1024, 4096);
+        TEST_ASSERT_TRUE(spool.open());
+        TEST_ASSERT_EQUAL(300, spool.getCount());
+        FakeBroker broker(120);
+        broker.drain(spool);
+        TEST_ASSERT_EQUAL(180, spool.getCount());
+    }
+    MQTTSpool spool(spoolDir, 1024 * 1024, 4096);
+    TEST_ASSERT_TRUE(spool.open());
+    TEST_ASSERT_EQUAL(180, spool.getCount());
+    append(spool, 300);
+    {
+        FakeBroker broker;
+        broker.drain(spool);
+    }
+    // A clean shutdown syncs the cursor, so nothing is published twice
+    TEST_ASSERT_EQUAL(301, FakeBroker::received().size());
+    assertReceivedInOrder(301);
+}
+
+// Neither spooling nor replay lose a message when the process is killed part way through
+void test_noLossAcrossKill(void)
+{
+    runAndKill([] {
+        MQTTSpool spool(spoolDir, 1024 * 1024, 4096);
+        spool.open();
+        for (int i = 0; i < 400; i++)
+            append(spool, i);
+    });
+    runAndKill([] {
+        MQTTSpool spool(spoolDir, 1024 * 1024, 4096);
+        spool.open();
+        FakeBroker broker(250);
+        broker.drain(spool);
+        for (int i = 400; i < 450; i++)
+            append(spool, i);
+    });
+
+    MQTTSpool spool(spoolDir, 1024 * 1024, 4096);
+    TEST_ASSERT_TRUE(spool.open());
+    TEST_ASSERT_TRUE(spool.getCount() >= 200);
+    {
+        FakeBroker broker;
+        broker.drain(spool);
+    }
+    TEST_ASSERT_EQUAL(0, spool.getCount());
+    assertReceivedInOrder(450);
+}
+
+// A record torn by a crash mid-append is dropped, and appending carries on after the last intact one
+void test_dropsTornRecord(void)
+{
+    {
+        MQTTSpool spool(spoolDir, 1024 * 1024);
+        TEST_ASSERT_TRUE(spool.open());
+        for (int i = 0; i < 10; i++)
+            append(spool, i);
+    }
+    std::string segment;
+    for (const auto &entry : std::filesystem::directory_iterator(spoolDir))
+        if (entry.path().extension() == ".seg")
+            segment = entry.path();
+    const auto size = std::filesystem::file_size(segment);
+    std::filesystem::resize_file(segment, size - 5);
+
+    {
+        MQTTSpool spool(spoolDir, 1024 * 1024);
+        TEST_ASSERT_TRUE(spool.open());
+        TEST_ASSERT_EQUAL(9, spool.getCount());
+        append(spool, 10);
+    }
+    MQTTSpool spool(spoolDir, 1024 * 1024);
+    TEST_ASSERT_TRUE(spool.open());
+    TEST_ASSERT_EQUAL(10, spool.getCount());
+    {
+        FakeBroker broker;
+        broker.drain(spool);
+    }
+    std::vector<std::string> received = FakeBroker::received();
+    TEST_ASSERT_EQUAL(10, received.size());
+    TEST_ASSERT_EQUAL_STRING(payload(8).c_str(), received[8].c_str());
+    TEST_ASSERT_EQUAL_STRING(payload(10).c_str(), received[9].c_str());
+}
+
+// Past its size cap the spool discards its oldest segments, and keeps the newest messages in order
+void test_capDiscardsOldest(void)
+{
+    MQTTSpool spool(spoolDir, 16 * 1024);
+    TEST_ASSERT_TRUE(spool.open());
+    for (int i = 0; i < 2000; i++)
+        append(spool, i);
+    TEST_ASSERT_TRUE(spool.getBytes() <= 16 * 1024);
+    TEST_ASSERT_EQUAL(2000, spool.getCount() + spool.getDropped());
+    const uint32_t first = spool.getDropped();
+
+    {
+        FakeBroker broker;
+        broker.drain(spool);
+    }
+    std::vector<std::string> received = FakeBroker::received();
+    TEST_ASSERT_EQUAL(2000 - first, received.size());
+    for (size_t i = 0; i < received.size(); i++)
+        TEST_ASSERT_EQUAL_STRING(payload(first + i).c_str(), received[i].c_str());
+}
+
+void test_keepsJson(void)
+{
+    {
+        MQTTSpool spool(spoolDir, 1024 * 1024);
+        TEST_ASSERT_TRUE(spool.open());
+        const uint8_t env[] = {0x0a, 0x00, 0xff};
+        TEST_ASSERT_TRUE(spool.append("msh/2/e/test/!12345678", env, sizeof(env), "msh/2/json/test/!12345678", "{\"id\":1}"));
+    }
+    MQTTSpool spool(spoolDir, 1024 * 1024);
+    TEST_ASSERT_TRUE(spool.open());
+    MQTTSpool::Message m;
+    TEST_ASSERT_TRUE(spool.peek(m));
+    TEST_ASSERT_EQUAL_STRING("msh/2/e/test/!12345678", m.topic.c_str());
+    TEST_ASSERT_EQUAL(3, m.envBytes.size());
+    TEST_ASSERT_EQUAL(0xff, m.envBytes[2]);
+    TEST_ASSERT_EQUAL_STRING("msh/2/json/test/!12345678", m.topicJson.c_str());
+    TEST_ASSERT_EQUAL_STRING("{\"id\":1}", m.json.c_str());
+    TEST_ASSERT_TRUE(m.spooledAt > 0);
+}
+
+// The oldest message's age and when to next sync are known without reading the disk
+void test_oldestAndSyncDeadline(void)
+{
+    uint32_t first;
+    {
+        MQTTSpool spool(spoolDir, 1024 * 1024);
+        TEST_ASSERT_TRUE(spool.open());
+        TEST_ASSERT_EQUAL(0, spool.getOldestSpooledAt());
+        TEST_ASSERT_EQUAL(INT32_MAX, spool.msecUntilSync());
+
+        const uint32_t before = time(nullptr);
+        append(spool, 0);
+        first = spool.getOldestSpooledAt();
+        TEST_ASSERT_TRUE(first >= before && first <= (uint32_t)time(nullptr));
+        TEST_ASSERT_TRUE(spool.msecUntilSync() <= MQTT_SPOOL_SYNC_MSEC);
+        spool.sync();
+        TEST_ASSERT_EQUAL(INT32_MAX, spool.msecUntilSync());
+
+        sleep(1);
+        append(spool, 1);
+        TEST_ASSERT_EQUAL(first, spool.getOldestSpooledAt());
+    }
+
+    // Read back when reopened, and moves on as messages are published
+    MQTTSpool spool(spoolDir, 1024 * 1024);
+    TEST_ASSERT_TRUE(spool.open());
+    TEST_ASSERT_EQUAL(first, spool.getOldestSpooledAt());
+    {
+        FakeBroker broker(1);
+        broker.drain(spool);
+    }
+    TEST_ASSERT_TRUE(spool.getOldestSpooledAt() > first);
+    TEST_ASSERT_TRUE(spool.msecUntilSync() <= MQTT_SPOOL_SYNC_MSEC); // the replay position moved
+    {
+        FakeBroker broker;
+        broker.drain(spool);
+    }
+    TEST_ASSERT_EQUAL(0, spool.getOldestSpooledAt());
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_replaysInOrder);
+    RUN_TEST(test_resumesAfterRestart);
+    RUN_TEST(test_noLossAcrossKill);
+    RUN_TEST(test_dropsTornRecord);
+    RUN_TEST(test_capDiscardsOldest);
+    RUN_TEST(test_keepsJson);
+    RUN_TEST(test_oldestAndSyncDeadline);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -0,0 +1,257 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "mesh/NodeDBJournal.h"
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+const char *snapshotFile = "/test_journal/nodes.proto";
+const char *journalFile = "/test_journal/nodes.journal";
+
+typedef std::vector<meshtastic_NodeInfoLite> Nodes;
+
+meshtastic_NodeInfoLite makeNode(NodeNum num, uint32_t version)
+{
+    meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_zero;
+    node.num = num;
+    node.last_heard = version;
+    node.has_user = true;
+    snprintf(node.user.long_name, sizeof(node.user.long_name), "Node %u v%u", num, version);
+    return node;
+}
+
+Nodes makeNodes(NodeNum count)
+{
+    Nodes nodes;
+    for (NodeNum n = 1; n <= count; n++)
+        nodes.push_back(makeNode(n, 0));
+    return nodes;
+}
+
+void writeFile(const char *filename, const std::vector<uint8_t> &bytes)
+{
+    FSCom.remove(filename);
+    auto f = FSCom.open(filename, FILE_O_WRITE);
+    TEST_ASSERT_TRUE(bool(f));
+    TEST_ASSERT_EQUAL(bytes.size(), f.write((uint8_t const *)bytes.data(), bytes.size()));
+    f.close();
+}
+
+std::vector<uint8_t> readFile(const char *filename)
+{
+    auto f = FSCom.open(filename, FILE_O_READ);
+    std::vector<uint8_t> bytes(f.size());
+    TEST_ASSERT_EQUAL(bytes.size(), f.read(bytes.data(), bytes.size()));
+    f.close();
+    return bytes;
+}
+
+void assertSameNodes(Nodes expected, Nodes actual)
+{
+    auto byNum = [](const meshtastic_NodeInfoLite &a, const meshtastic_NodeInfoLite &b) { return a.num < b.num; };
+    std::sort(expected.begin(), expected.end(), byNum);
+    std::sort(actual.begin(), actual.end(), byNum);
+    TEST_ASSERT_EQUAL(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i].num, actual[i].num);
+        TEST_ASSERT_EQUAL_UINT32(expected[i].last_heard, actual[i].last_heard);
+        TEST_ASSERT_EQUAL_STRING(expected[i].user.long_name, actual[i].user.long_name);
+    }
+}
+
+// Write a snapshot (its contents don't matter to the journal) and start a journal on top of it
+void startJournal(NodeDBJournal &journal, const Nodes &nodes, const char *snapshot = "snapshot")
+{
+    writeFile(snapshotFile, std::vector<uint8_t>(snapshot, snapshot + strlen(snapshot)));
+    TEST_ASSERT_TRUE(journal.restart(nodes, nodes.size()));
+}
+
+// Make one random change (update, add or remove a node), so each append writes exactly one record
+void mutate(Nodes &nodes, std::mt19937 &rng, uint32_t version)
+{
+    uint32_t what = rng() % 4;
+    if (what == 0 && nodes.size() > 1) {
+        nodes.erase(nodes.begin() + rng() % nodes.size());
+    } else if (what == 1) {
+        nodes.push_back(makeNode(1000 + version, version));
+    } else {
+        meshtastic_NodeInfoLite &node = nodes[rng() % nodes.size()];
+        node = makeNode(node.num, version);
+    }
+}
+} // namespace
+
+void setUp(void)
+{
+    FSCom.mkdir("/test_journal");
+    FSCom.remove(snapshotFile);
+    FSCom.remove(journalFile);
+}
+
+void tearDown(void) {}
+
+void test_replaysChanges(void)
+{
+    Nodes base = makeNodes(5), nodes = base;
+    NodeDBJournal journal(journalFile, snapshotFile);
+    startJournal(journal, nodes);
+
+    nodes[1] = makeNode(2, 7);
+    nodes.push_back(makeNode(6, 7));
+    nodes.erase(nodes.begin());
+    TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+
+    Nodes loaded = base;
+    NodeDBJournal reader(journalFile, snapshotFile);
+    TEST_ASSERT_TRUE(reader.replay(loaded));
+    assertSameNodes(nodes, loaded);
+}
+
+void test_onlyWritesChanges(void)
+{
+    Nodes nodes = makeNodes(50);
+    NodeDBJournal journal(journalFile, snapshotFile);
+    startJournal(journal, nodes);
+
+    size_t empty = journal.getBytes();
+    TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+    TEST_ASSERT_EQUAL(empty, journal.getBytes());
+
+    // Changed in place, one record for that node only
+    nodes[10].last_heard = 1234;
+    TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+    size_t one = journal.getBytes() - empty;
+    TEST_ASSERT_TRUE(one > 0 && one < 100);
+    TEST_ASSERT_EQUAL(journal.getBytes(), readFile(journalFile).size());
+}
+
+void test_ignoresJournalOfOtherSnapshot(void)
+{
+    Nodes base = makeNodes(5), nodes = base;
+    NodeDBJournal journal(journalFile, snapshotFile);
+    startJournal(journal, nodes);
+    nodes[0] = makeNode(1, 3);
+    TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+
+    // As if we lost power after rewriting the snapshot, but before starting the new journal
+    writeFile(snapshotFile, {'n', 'e', 'w'});
+    Nodes loaded = base;
+    NodeDBJournal reader(journalFile, snapshotFile);
+    TEST_ASSERT_FALSE(reader.replay(loaded));
+    assertSameNodes(base, loaded);
+    TEST_ASSERT_FALSE(reader.append(loaded, loaded.size())); // Must rewrite the snapshot first
+}
+
+void test_survivesTruncationAnywhere(void)
+{
+    std::mt19937 rng(1234);
+    Nodes base = makeNodes(20), nodes = base;
+    NodeDBJournal journal(journalFile, snapshotFile);
+    startJournal(journal, nodes);
+
+    // The state after each append, with the journal size it ended at
+    std::vector<std::pair<size_t, Nodes>> states = {{journal.getBytes(), nodes}};
+    for (uint32_t version = 1; version <= 40; version++) {
+        mutate(nodes, rng, version);
+        TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+        states.push_back({journal.getBytes(), nodes});
+    }
+    std::vector<uint8_t> full = readFile(journalFile);
+    TEST_ASSERT_EQUAL(states.back().first, full.size());
+
+    for (int i = 0; i < 300; i++) {
+        size_t cut = i == 0 ? full.size() : rng() % (full.size() + 1);
+        writeFile(journalFile, std::vector<uint8_t>(full.begin(), full.begin() + cut));
+
+        // We must get exactly the state of the last complete record
+        size_t s = 0;
+        while (s + 1 < states.size() && states[s + 1].first <= cut)
+            s++;
+        Nodes loaded = base;
+        NodeDBJournal reader(journalFile, snapshotFile);
+        bool clean = reader.replay(loaded);
+        TEST_ASSERT_EQUAL(cut == states[s].first, clean);
+        assertSameNodes(cut < states[0].first ? base : states[s].second, loaded);
+
+        // A damaged journal is never appended to
+        if (!clean)
+            TEST_ASSERT_FALSE(reader.append(loaded, loaded.size()));
+    }
+}
+
+void test_stopsAtDamagedRecord(void)
+{
+    Nodes base = makeNodes(5), nodes = base;
+    NodeDBJournal journal(journalFile, snapshotFile);
+    startJournal(journal, nodes);
+    nodes[0] = makeNode(1, 1);
+    TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+    Nodes first = nodes;
+    size_t firstEnd = journal.getBytes();
+    nodes[1] = makeNode(2, 2);
+    TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+    nodes[2] = makeNode(3, 3);
+    TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+
+    std::vector<uint8_t> bytes = readFile(journalFile);
+    bytes[firstEnd + 10] ^= 0x40;
+    writeFile(journalFile, bytes);
+
+    Nodes loaded = base;
+    NodeDBJournal reader(journalFile, snapshotFile);
+    TEST_ASSERT_FALSE(reader.replay(loaded));
+    assertSameNodes(first, loaded);
+}
+
+void test_asksForCompaction(void)
+{
+    Nodes nodes = makeNodes(10);
+    NodeDBJournal journal(journalFile, snapshotFile);
+    startJournal(journal, nodes);
+
+    uint32_t version = 0;
+    while (journal.append(nodes, nodes.size())) {
+        version++;
+        nodes[version % nodes.size()].last_heard = version;
+        TEST_ASSERT_TRUE(version < 10000);
+    }
+    TEST_ASSERT_TRUE(journal.getBytes() <= NODEDB_JOURNAL_MIN_COMPACT);
+
+    // Once the snapshot is rewritten we journal again
+    startJournal(journal, nodes, "compacted");
+    nodes[0].last_heard = 0;
+    TEST_ASSERT_TRUE(journal.append(nodes, nodes.size()));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    if (!spiLock)
+        initSPI();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_replaysChanges);
+    RUN_TEST(test_onlyWritesChanges);
+    RUN_TEST(test_ignoresJournalOfOtherSnapshot);
+    RUN_TEST(test_survivesTruncationAnywhere);
+    RUN_TEST(test_stopsAtDamagedRecord);
+    RUN_TEST(test_asksForCompaction);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
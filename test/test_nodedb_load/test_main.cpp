@@ -0,0 +1,170 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "mesh/NodeDB.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr NodeNum FIRST_NODE = 0x10000;
+
+// Hear node i, the higher i the more recently (every tenth a favorite)
+void addNode(int i)
+{
+    meshtastic_MeshPacket mp = meshtastic_MeshPacket_init_zero;
+    mp.from = FIRST_NODE + i;
+    mp.rx_time = 1000000 + i;
+    mp.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    nodeDB->updateFrom(mp);
+
+    meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(mp.from);
+    node->has_user = true;
+    node->is_favorite = i % 10 == 0;
+    snprintf(node->user.long_name, sizeof(node->user.long_name), "Node %d", i);
+}
+
+// Fill a DB of numNodes and save it as a full nodes.proto, without a journal on top
+void saveNodes(int numNodes)
+{
+    setSetting(maxnodes, numNodes);
+    nodeDB = new NodeDB();
+    nodeDB->resetNodes();
+
+    for (int i = 1; i < numNodes; i++)
+        addNode(i);
+    TEST_ASSERT_EQUAL(numNodes, nodeDB->getNumMeshNodes());
+
+    spiLock->lock();
+    FSCom.remove(nodeDatabaseJournalFileName); // So this save has to write the whole snapshot
+    spiLock->unlock();
+    TEST_ASSERT_TRUE(nodeDB->saveToDisk(SEGMENT_NODEDATABASE));
+
+    delete nodeDB;
+    nodeDB = NULL;
+}
+
+// Boot a new NodeDB with room for maxNodes, return how long it took
+uint32_t reload(int maxNodes)
+{
+    setSetting(maxnodes, maxNodes);
+    uint32_t start = millis();
+    nodeDB = new NodeDB();
+    return millis() - start;
+}
+} // namespace
+
+void setUp(void) {}
+
+void tearDown(void)
+{
+    delete nodeDB;
+    nodeDB = NULL;
+    freeRetiredSettings();
+}
+
+void test_reloadsEveryNode(void)
+{
+    saveNodes(200);
+    reload(200);
+
+    TEST_ASSERT_EQUAL(200, nodeDB->getNumMeshNodes());
+    for (int i = 1; i < 200; i++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(FIRST_NODE + i);
+        TEST_ASSERT_NOT_NULL(node);
+        char name[20];
+        snprintf(name, sizeof(name), "Node %d", i);
+        TEST_ASSERT_EQUAL_STRING(name, node->user.long_name);
+        TEST_ASSERT_EQUAL(i % 10 == 0, node->is_favorite);
+    }
+}
+
+void test_keepsTheBestWhenShrunk(void)
+{
+    saveNodes(200);
+    reload(50);
+    TEST_ASSERT_TRUE(nodeDB->getNumMeshNodes() <= 50);
+
+    // Every favorite survives, and of the rest only the most recently heard
+    uint32_t oldestKept = UINT32_MAX, newestDropped = 0;
+    for (int i = 1; i < 200; i++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(FIRST_NODE + i);
+        if (i % 10 == 0)
+            TEST_ASSERT_NOT_NULL(node);
+        else if (node)
+            oldestKept = std::min(oldestKept, node->last_heard);
+        else
+            newestDropped = std::max(newestDropped, (uint32_t)(1000000 + i));
+    }
+    TEST_ASSERT_TRUE(oldestKept > newestDropped);
+}
+
+// Nodes the journal adds on top of a full snapshot are held to the same limit, evicting the same nodes
+void test_boundsJournalReplay(void)
+{
+    saveNodes(100);
+    reload(200);
+    for (int i = 100; i < 120; i++)
+        addNode(i);
+    TEST_ASSERT_TRUE(nodeDB->saveToDisk(SEGMENT_NODEDATABASE));
+    delete nodeDB;
+    spiLock->lock();
+    auto journal = FSCom.open(nodeDatabaseJournalFileName, FILE_O_READ);
+    TEST_ASSERT_TRUE(journal && journal.size() > 20 * 10); // the new nodes went to the journal, not a new snapshot
+    journal.close();
+    spiLock->unlock();
+
+    reload(100);
+    TEST_ASSERT_TRUE(nodeDB->getNumMeshNodes() <= 100);
+    uint32_t oldestKept = UINT32_MAX, newestDropped = 0;
+    for (int i = 1; i < 120; i++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(FIRST_NODE + i);
+        if (i % 10 == 0 || i >= 100)
+            TEST_ASSERT_NOT_NULL(node);
+        else if (node)
+            oldestKept = std::min(oldestKept, node->last_heard);
+        else
+            newestDropped = std::max(newestDropped, (uint32_t)(1000000 + i));
+    }
+    TEST_ASSERT_TRUE(oldestKept > newestDropped);
+}
+
+void test_bootWithManyNodes(void)
+{
+    saveNodes(5000);
+    uint32_t elapsed = reload(5000);
+    TEST_ASSERT_EQUAL(5000, nodeDB->getNumMeshNodes());
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "5000 nodes: NodeDB boot took %u ms", elapsed);
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    if (!spiLock)
+        initSPI();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_reloadsEveryNode);
+    RUN_TEST(test_keepsTheBestWhenShrunk);
+    RUN_TEST(test_boundsJournalReplay);
+    RUN_TEST(test_bootWithManyNodes);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
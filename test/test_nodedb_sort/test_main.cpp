@@ -0,0 +1,162 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/NodeDB.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <random>
+#include <set>
+
+namespace
+{
+// Check that getMeshNodeByIndex() returns us first, then favorites, then nodes by last_heard, newest first
+void assertSorted()
+{
+    TEST_ASSERT_EQUAL_UINT32(nodeDB->getNodeNum(), nodeDB->getMeshNodeByIndex(0)->num);
+    for (size_t i = 2; i < nodeDB->getNumMeshNodes(); i++) {
+        const meshtastic_NodeInfoLite *a = nodeDB->getMeshNodeByIndex(i - 1), *b = nodeDB->getMeshNodeByIndex(i);
+        TEST_ASSERT_TRUE(a->is_favorite || !b->is_favorite);
+        if (a->is_favorite == b->is_favorite)
+            TEST_ASSERT_TRUE(a->last_heard >= b->last_heard);
+    }
+}
+
+void heardFrom(NodeNum from, uint32_t rxTime)
+{
+    meshtastic_MeshPacket mp = meshtastic_MeshPacket_init_zero;
+    mp.from = from;
+    mp.rx_time = rxTime;
+    mp.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    nodeDB->updateFrom(mp);
+}
+
+// Fill a DB of numNodes, then time updates from random nodes, which each move one node to the front
+void benchmarkSort(int numNodes)
+{
+    setSetting(maxnodes, numNodes);
+    nodeDB = new NodeDB();
+    nodeDB->resetNodes();
+
+    std::mt19937 rng(numNodes);
+    uint32_t rxTime = 1000000;
+    for (int i = 1; i < numNodes; i++)
+        heardFrom(0x10000 + i, rxTime - rng() % 100000);
+    TEST_ASSERT_EQUAL(numNodes, nodeDB->getNumMeshNodes());
+
+    // Some favorites, which must stay ahead of everything heard later
+    for (int i = 1; i < numNodes; i += 10) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(0x10000 + i);
+        node->is_favorite = true;
+        nodeDB->resortMeshNode(node);
+    }
+    assertSorted();
+
+    const int updates = 10000;
+    uint32_t start = millis();
+    for (int i = 0; i < updates; i++)
+        heardFrom(0x10000 + 1 + rng() % (numNodes - 1), ++rxTime);
+    uint32_t elapsed = millis() - start;
+    assertSorted();
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "%d nodes: %d updates took %u ms", numNodes, updates, elapsed);
+    TEST_MESSAGE(msg);
+
+    delete nodeDB;
+    nodeDB = NULL;
+}
+
+// Every node in the DB is found by getMeshNode() and sits exactly once in the order
+void assertIndexed()
+{
+    std::set<NodeNum> seen;
+    for (size_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
+        const meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
+        TEST_ASSERT_TRUE(seen.insert(node->num).second);
+        TEST_ASSERT_EQUAL_PTR(node, nodeDB->getMeshNode(node->num));
+    }
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    freeRetiredSettings();
+}
+
+void test_sort100(void)
+{
+    benchmarkSort(100);
+}
+
+void test_sort1000(void)
+{
+    benchmarkSort(1000);
+}
+
+void test_sort10000(void)
+{
+    benchmarkSort(10000);
+}
+
+// A full DB evicts one node for each new one, without losing track of the rest
+void test_evictionKeepsIndex(void)
+{
+    const int numNodes = 200;
+    setSetting(maxnodes, numNodes);
+    nodeDB = new NodeDB();
+    nodeDB->resetNodes();
+
+    std::mt19937 rng(1);
+    uint32_t rxTime = 1000000;
+    for (int i = 1; i < numNodes; i++)
+        heardFrom(0x10000 + i, rxTime - rng() % 100000);
+    TEST_ASSERT_EQUAL(numNodes, nodeDB->getNumMeshNodes());
+
+    for (int i = 0; i < 3 * numNodes; i++) {
+        NodeNum newcomer = 0x20000 + i;
+        heardFrom(newcomer, ++rxTime);
+        TEST_ASSERT_EQUAL(numNodes, nodeDB->getNumMeshNodes());
+        TEST_ASSERT_NOT_NULL(nodeDB->getMeshNode(newcomer));
+        if (i % 17 == 0) {
+            assertIndexed();
+            assertSorted();
+        }
+    }
+    assertIndexed();
+    assertSorted();
+    // Everything heard before the newcomers has been evicted by now
+    for (int i = 1; i < numNodes; i++)
+        TEST_ASSERT_NULL(nodeDB->getMeshNode(0x10000 + i));
+
+    delete nodeDB;
+    nodeDB = NULL;
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_sort100);
+    RUN_TEST(test_sort1000);
+    RUN_TEST(test_sort10000);
+    RUN_TEST(test_evictionKeepsIndex);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
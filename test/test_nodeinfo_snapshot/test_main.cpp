@@ -0,0 +1,197 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "SPILock.h"
+#include "mesh/MeshService.h"
+#include "mesh/NodeDB.h"
+#include "mesh/NodeInfoSnapshot.h"
+#include "mesh/PhoneAPI.h"
+#include "mesh/TypeConversions.h"
+
+#include <vector>
+
+namespace
+{
+constexpr NodeNum FIRST_NODE = 0x10000;
+
+meshtastic_NodeInfoLite *addNode(NodeNum num)
+{
+    meshtastic_MeshPacket mp = meshtastic_MeshPacket_init_zero;
+    mp.from = num;
+    mp.rx_time = 1000000 + num;
+    mp.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    nodeDB->updateFrom(mp);
+
+    meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(num);
+    node->has_user = true;
+    snprintf(node->user.long_name, sizeof(node->user.long_name), "Node %u", num);
+    return node;
+}
+
+// What PhoneAPI would send for this node without the snapshot
+size_t encodeDirectly(const meshtastic_NodeInfoLite *node, uint8_t *buf)
+{
+    meshtastic_FromRadio fr = meshtastic_FromRadio_init_zero;
+    fr.which_payload_variant = meshtastic_FromRadio_node_info_tag;
+    fr.node_info = TypeConversions::ConvertToNodeInfo(node);
+    return pb_encode_to_bytes(buf, meshtastic_FromRadio_size, &meshtastic_FromRadio_msg, &fr);
+}
+
+void assertSameAsDirect(const meshtastic_NodeInfoLite *node)
+{
+    uint8_t expected[meshtastic_FromRadio_size], actual[meshtastic_FromRadio_size];
+    size_t expectedLen = encodeDirectly(node, expected);
+    TEST_ASSERT_EQUAL(expectedLen, nodeInfoSnapshot.encode(node, actual));
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, expectedLen);
+}
+
+// Sends fromRadioScratch instead of the encoded bytes, as PacketAPI does on USE_PACKET_API builds
+class ScratchPhoneAPI : public PhoneAPI
+{
+  public:
+    std::vector<meshtastic_FromRadio> received;
+
+    // Ask for the NodeDB, as a client does with SPECIAL_NONCE_ONLY_NODES, and collect it up to config complete
+    void downloadNodes()
+    {
+        meshtastic_ToRadio request = meshtastic_ToRadio_init_zero;
+        request.which_payload_variant = meshtastic_ToRadio_want_config_id_tag;
+        request.want_config_id = SPECIAL_NONCE_ONLY_NODES;
+        uint8_t toRadio[meshtastic_ToRadio_size];
+        handleToRadio(toRadio, pb_encode_to_bytes(toRadio, sizeof(toRadio), &meshtastic_ToRadio_msg, &request));
+
+        uint8_t buf[meshtastic_FromRadio_size];
+
+        while (available() && getFromRadio(buf)) {
+            received.push_back(fromRadioScratch);
+            if (fromRadioScratch.which_payload_variant == meshtastic_FromRadio_config_complete_id_tag)
+                break;
+        }
+    }
+
+  protected:
+    bool checkIsConnected() override { return true; }
+    bool sendsFromRadioScratch() override { return true; }
+};
+} // namespace
+
+void setUp(void)
+{
+    setSetting(maxnodes, 200);
+    nodeDB = new NodeDB();
+    nodeDB->resetNodes();
+}
+
+void tearDown(void)
+{
+    delete nodeDB;
+    nodeDB = NULL;
+    freeRetiredSettings();
+}
+
+void test_matchesDirectEncoding(void)
+{
+    meshtastic_NodeInfoLite *node = addNode(FIRST_NODE);
+    node->has_position = true;
+    node->position.latitude_i = 473000000;
+    node->position.longitude_i = 85000000;
+    node->is_favorite = true;
+    assertSameAsDirect(node);
+    assertSameAsDirect(node); // And again from the cache
+}
+
+void test_reusesUnchangedNodes(void)
+{
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + 50; n++)
+        addNode(n);
+
+    uint8_t buf[meshtastic_FromRadio_size];
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + 50; n++)
+        nodeInfoSnapshot.encode(nodeDB->getMeshNode(n), buf);
+
+    // A second client gets the same nodes without encoding any of them
+    uint32_t misses = nodeInfoSnapshot.getMisses(), hits = nodeInfoSnapshot.getHits();
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + 50; n++)
+        nodeInfoSnapshot.encode(nodeDB->getMeshNode(n), buf);
+    TEST_ASSERT_EQUAL_UINT32(misses, nodeInfoSnapshot.getMisses());
+    TEST_ASSERT_EQUAL_UINT32(hits + 50, nodeInfoSnapshot.getHits());
+}
+
+void test_reencodesChangedNodes(void)
+{
+    meshtastic_NodeInfoLite *node = addNode(FIRST_NODE);
+    assertSameAsDirect(node);
+
+    // Changed in place, as modules do through getMeshNode()
+    uint32_t misses = nodeInfoSnapshot.getMisses();
+    strcpy(node->user.long_name, "Renamed");
+    node->snr = 7.5;
+    assertSameAsDirect(node);
+    TEST_ASSERT_EQUAL_UINT32(misses + 1, nodeInfoSnapshot.getMisses());
+}
+
+void test_forgetsRemovedNodes(void)
+{
+    uint8_t buf[meshtastic_FromRadio_size];
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + 100; n++)
+        nodeInfoSnapshot.encode(addNode(n), buf);
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + 100; n++)
+        nodeDB->removeNodeByNum(n);
+
+    // Encoding new nodes eventually drops the ones that are gone
+    for (NodeNum n = FIRST_NODE + 1000; n < FIRST_NODE + 1100; n++)
+        nodeInfoSnapshot.encode(addNode(n), buf);
+    TEST_ASSERT_TRUE(nodeInfoSnapshot.size() <= 2 * nodeDB->getNumMeshNodes() + 16);
+}
+
+// Every node must reach a client that sends the struct rather than the bytes, snapshot or not
+void test_scratchClientGetsNodes(void)
+{
+    for (NodeNum n = FIRST_NODE; n < FIRST_NODE + 20; n++)
+        addNode(n);
+    service = new MeshService();
+    {
+        ScratchPhoneAPI api;
+        api.downloadNodes();
+
+        TEST_ASSERT_EQUAL(nodeDB->getNumMeshNodes() + 1, api.received.size()); // Every node, then config complete
+        for (size_t i = 0; i + 1 < api.received.size(); i++) {
+            const meshtastic_FromRadio &fr = api.received[i];
+            TEST_ASSERT_EQUAL(meshtastic_FromRadio_node_info_tag, fr.which_payload_variant);
+            const meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(fr.node_info.num);
+            TEST_ASSERT_NOT_NULL(node);
+            if (node->num != nodeDB->getNodeNum())
+                TEST_ASSERT_EQUAL_STRING(node->user.long_name, fr.node_info.user.long_name);
+        }
+        TEST_ASSERT_EQUAL(meshtastic_FromRadio_config_complete_id_tag, api.received.back().which_payload_variant);
+    }
+    delete service;
+    service = NULL;
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    if (!spiLock)
+        initSPI();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_matchesDirectEncoding);
+    RUN_TEST(test_reusesUnchangedNodes);
+    RUN_TEST(test_reencodesChangedNodes);
+    RUN_TEST(test_forgetsRemovedNodes);
+    RUN_TEST(test_scratchClientGetsNodes);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
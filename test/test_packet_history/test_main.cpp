@@ -0,0 +1,205 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/NodeDB.h"
+#include "mesh/PacketHistory.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+// The linear scan PacketHistory used before the hash index, kept as the reference behaviour.  Ages are a sequence number
+// rather than millis() so that eviction order is well defined even when many packets arrive in the same millisecond.
+class LinearPacketHistory
+{
+    struct Record {
+        NodeNum sender;
+        PacketId id;
+        uint32_t seq; // 0 means empty
+        uint8_t relayed_by[NUM_RELAYERS];
+    };
+    std::vector<Record> records;
+    uint32_t seq = 0;
+
+    Record *find(NodeNum sender, PacketId id)
+    {
+        for (auto &r : records)
+            if (r.seq && r.sender == sender && r.id == id)
+                return &r;
+        return NULL;
+    }
+
+  public:
+    explicit LinearPacketHistory(size_t size) : records(size) {}
+
+    bool wasSeenRecently(const meshtastic_MeshPacket *p)
+    {
+        Record r = {getFrom(p), p->id, ++seq, {p->relay_node}};
+        Record *found = find(r.sender, r.id);
+        Record *tu = found;
+        if (found) {
+            for (uint8_t i = 0; i < (NUM_RELAYERS - 1); i++)
+                if (found->relayed_by[i] != 0)
+                    r.relayed_by[i + 1] = found->relayed_by[i];
+        } else {
+            for (auto &it : records)
+                if (!tu || it.seq < tu->seq)
+                    tu = &it;
+        }
+        *tu = r;
+        return found != NULL;
+    }
+
+    bool wasRelayer(uint8_t relayer, PacketId id, NodeNum sender)
+    {
+        Record *found = find(sender, id);
+        if (!found || relayer == 0)
+            return false;
+        for (uint8_t i = 0; i < NUM_RELAYERS; i++)
+            if (found->relayed_by[i] == relayer)
+                return true;
+        return false;
+    }
+
+    void removeRelayer(uint8_t relayer, PacketId id, NodeNum sender)
+    {
+        Record *found = find(sender, id);
+        if (!found)
+            return;
+        uint8_t j = 0;
+        for (uint8_t i = 0; i < NUM_RELAYERS; i++)
+            if (found->relayed_by[i] != relayer)
+                found->relayed_by[j++] = found->relayed_by[i];
+        for (; j < NUM_RELAYERS; j++)
+            found->relayed_by[j] = 0;
+    }
+};
+
+// Replay a synthetic trace of packets through both implementations.  Senders and ids are drawn from small ranges so that
+// duplicates (rebroadcasts heard again) are frequent and the history is constantly evicting.
+void replayTrace(uint32_t size, uint32_t numSenders, uint32_t numIds, uint32_t numPackets, uint32_t seed)
+{
+    PacketHistory history(size);
+    LinearPacketHistory reference(size);
+    std::mt19937 rng(seed);
+
+    TEST_ASSERT_TRUE(history.initOk());
+
+    for (uint32_t i = 0; i < numPackets; i++) {
+        meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+        p.from = 1 + rng() % numSenders;
+        p.id = 1 + rng() % numIds;
+        p.relay_node = rng() % 5;
+
+        TEST_ASSERT_EQUAL(reference.wasSeenRecently(&p), history.wasSeenRecently(&p));
+
+        uint8_t relayer = rng() % 5;
+        NodeNum sender = 1 + rng() % numSenders;
+        PacketId id = 1 + rng() % numIds;
+        TEST_ASSERT_EQUAL(reference.wasRelayer(relayer, id, sender), history.wasRelayer(relayer, id, sender));
+
+        if (rng() % 8 == 0) {
+            reference.removeRelayer(relayer, id, sender);
+            history.removeRelayer(relayer, id, sender);
+        }
+    }
+}
+} // namespace
+
+void setUp(void)
+{
+    // set stuff up here
+}
+
+void tearDown(void)
+{
+    // clean stuff up here
+}
+
+void test_seenRecently(void)
+{
+    PacketHistory history(16);
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x11223344;
+    p.id = 42;
+    p.relay_node = 0x44;
+
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p, false));
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&p));
+    TEST_ASSERT_TRUE(history.wasRelayer(0x44, 42, 0x11223344));
+
+    history.removeRelayer(0x44, 42, 0x11223344);
+    TEST_ASSERT_FALSE(history.wasRelayer(0x44, 42, 0x11223344));
+
+    p.id = 0; // Not a floodable message
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+}
+
+void test_evictsOldest(void)
+{
+    PacketHistory history(4);
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 1;
+
+    for (p.id = 1; p.id <= 4; p.id++)
+        history.wasSeenRecently(&p);
+
+    // Hearing id 1 again makes it the newest, so id 2 is the one to go
+    p.id = 1;
+    TEST_ASSERT_TRUE(history.wasSeenRecently(&p));
+    p.id = 5;
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p));
+
+    p.id = 2;
+    TEST_ASSERT_FALSE(history.wasSeenRecently(&p, false));
+    for (PacketId id : {1, 3, 4, 5}) {
+        p.id = id;
+        TEST_ASSERT_TRUE(history.wasSeenRecently(&p, false));
+    }
+}
+
+void test_replaySmallHistory(void)
+{
+    replayTrace(4, 3, 8, 20000, 1);
+}
+
+void test_replayHeavyEviction(void)
+{
+    replayTrace(64, 40, 80, 50000, 2);
+}
+
+void test_replayLargeHistory(void)
+{
+    replayTrace(100, 500, 1000, 50000, 3);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    const std::unique_ptr<NodeDB> testNodeDB(new NodeDB());
+    nodeDB = testNodeDB.get();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_seenRecently);
+    RUN_TEST(test_evictsOldest);
+    RUN_TEST(test_replaySmallHistory);
+    RUN_TEST(test_replayHeavyEviction);
+    RUN_TEST(test_replayLargeHistory);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -0,0 +1,188 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/PhonePacketRing.h"
+
+#include <set>
+
+namespace
+{
+// Hands out packets numbered by id and remembers which ones are still out
+class TrackingPool : public Allocator<meshtastic_MeshPacket>
+{
+  public:
+    std::set<uint32_t> live;
+
+    virtual void release(meshtastic_MeshPacket *p) override
+    {
+        TEST_ASSERT_EQUAL(1, live.erase(p->id));
+        delete p;
+    }
+
+    meshtastic_MeshPacket *make(uint32_t id)
+    {
+        meshtastic_MeshPacket *p = allocZeroed();
+        p->id = id;
+        live.insert(id);
+        return p;
+    }
+
+  protected:
+    virtual meshtastic_MeshPacket *alloc(TickType_t maxWait) override { return new meshtastic_MeshPacket(); }
+};
+
+// Take the next packet for a reader and return its id, 0 if there is none
+uint32_t next(PhonePacketRing &ring, int8_t reader)
+{
+    const meshtastic_MeshPacket *p = ring.take(reader);
+    if (!p)
+        return 0;
+    uint32_t id = p->id;
+    ring.release(reader);
+    return id;
+}
+} // namespace
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_singleReaderGetsAllInOrder(void)
+{
+    TrackingPool pool;
+    PhonePacketRing ring(pool, 4);
+    int8_t r = ring.attach();
+    for (uint32_t id = 1; id <= 3; id++)
+        ring.push(pool.make(id));
+
+    for (uint32_t id = 1; id <= 3; id++)
+        TEST_ASSERT_EQUAL_UINT32(id, next(ring, r));
+    TEST_ASSERT_EQUAL_UINT32(0, next(ring, r));
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_TRUE(pool.live.empty());
+}
+
+void test_everyReaderSeesEveryPacket(void)
+{
+    TrackingPool pool;
+    PhonePacketRing ring(pool, 4);
+    int8_t a = ring.attach(), b = ring.attach();
+    ring.push(pool.make(1));
+    ring.push(pool.make(2));
+
+    TEST_ASSERT_EQUAL_UINT32(1, next(ring, a));
+    TEST_ASSERT_EQUAL_UINT32(2, next(ring, a));
+    TEST_ASSERT_EQUAL(2, pool.live.size()); // b still needs them
+
+    TEST_ASSERT_EQUAL_UINT32(1, next(ring, b));
+    TEST_ASSERT_EQUAL(1, pool.live.size());
+    TEST_ASSERT_EQUAL_UINT32(2, next(ring, b));
+    TEST_ASSERT_TRUE(pool.live.empty());
+}
+
+void test_keepsPacketsWhileNobodyListens(void)
+{
+    TrackingPool pool;
+    PhonePacketRing ring(pool, 3);
+    for (uint32_t id = 1; id <= 5; id++)
+        ring.push(pool.make(id));
+    TEST_ASSERT_EQUAL(3, ring.size());
+    TEST_ASSERT_EQUAL(3, pool.live.size());
+
+    int8_t r = ring.attach();
+    for (uint32_t id = 3; id <= 5; id++)
+        TEST_ASSERT_EQUAL_UINT32(id, next(ring, r));
+    TEST_ASSERT_EQUAL_UINT32(0, ring.getDropped(r));
+    TEST_ASSERT_TRUE(pool.live.empty());
+}
+
+void test_slowReaderOnlyHurtsItself(void)
+{
+    TrackingPool pool;
+    PhonePacketRing ring(pool, 4);
+    int8_t fast = ring.attach(), slow = ring.attach();
+
+    for (uint32_t id = 1; id <= 10; id++) {
+        ring.push(pool.make(id));
+        TEST_ASSERT_EQUAL_UINT32(id, next(ring, fast));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ring.getDropped(fast));
+    TEST_ASSERT_EQUAL_UINT32(6, ring.getDropped(slow));
+
+    for (uint32_t id = 7; id <= 10; id++)
+        TEST_ASSERT_EQUAL_UINT32(id, next(ring, slow));
+    TEST_ASSERT_TRUE(pool.live.empty());
+}
+
+void test_heldPacketOutlivesTheRing(void)
+{
+    TrackingPool pool;
+    PhonePacketRing ring(pool, 2);
+    int8_t r = ring.attach();
+    ring.push(pool.make(1));
+
+    const meshtastic_MeshPacket *held = ring.take(r);
+    TEST_ASSERT_EQUAL_PTR(held, ring.take(r)); // Taking again gives the same packet until released
+    ring.push(pool.make(2));
+    ring.push(pool.make(3)); // Drops 1 from the ring, but we still hold it
+    TEST_ASSERT_EQUAL_UINT32(1, held->id);
+    TEST_ASSERT_EQUAL(3, pool.live.size());
+
+    ring.release(r);
+    TEST_ASSERT_EQUAL(0, pool.live.count(1));
+    TEST_ASSERT_EQUAL_UINT32(2, next(ring, r));
+    TEST_ASSERT_EQUAL_UINT32(3, next(ring, r));
+    TEST_ASSERT_TRUE(pool.live.empty());
+}
+
+void test_detachLetsGo(void)
+{
+    TrackingPool pool;
+    PhonePacketRing ring(pool, 4);
+    int8_t a = ring.attach(), b = ring.attach();
+    ring.push(pool.make(1));
+    ring.push(pool.make(2));
+    TEST_ASSERT_EQUAL_UINT32(1, next(ring, a));
+    TEST_ASSERT_EQUAL_UINT32(2, next(ring, a));
+
+    ring.take(b);
+    ring.detach(b); // b held 1 and never read 2, nobody needs either anymore
+    TEST_ASSERT_TRUE(pool.live.empty());
+}
+
+void test_limitsReaders(void)
+{
+    TrackingPool pool;
+    PhonePacketRing ring(pool, 4);
+    for (int i = 0; i < MAX_PHONE_READERS; i++)
+        TEST_ASSERT_TRUE(ring.attach() >= 0);
+    TEST_ASSERT_EQUAL_INT8(-1, ring.attach());
+    TEST_ASSERT_NULL(ring.take(-1));
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_singleReaderGetsAllInOrder);
+    RUN_TEST(test_everyReaderSeesEveryPacket);
+    RUN_TEST(test_keepsPacketsWhileNobodyListens);
+    RUN_TEST(test_slowReaderOnlyHurtsItself);
+    RUN_TEST(test_heldPacketOutlivesTheRing);
+    RUN_TEST(test_detachLetsGo);
+    RUN_TEST(test_limitsReaders);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -0,0 +1,196 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "mesh/RetransmissionSchedule.h"
+
+#include <map>
+#include <random>
+#include <utility>
+
+namespace
+{
+typedef std::pair<NodeNum, PacketId> Key;
+
+PendingPacket record(uint8_t tries)
+{
+    PendingPacket rec(NULL, tries);
+    return rec;
+}
+
+// A schedule together with a reference model: every in-flight packet with its absolute deadline
+struct ModelledSchedule {
+    RetransmissionSchedule schedule;
+    std::map<Key, uint32_t> deadlines;
+    std::map<const PendingPacket *, Key> keys;
+
+    void add(const Key &k, uint32_t due)
+    {
+        keys[schedule.add(GlobalPacketId(k.first, k.second), record(3), due)] = k;
+        deadlines[k] = due;
+    }
+
+    void remove(const Key &k)
+    {
+        keys.erase(schedule.find(GlobalPacketId(k.first, k.second)));
+        TEST_ASSERT_TRUE(schedule.remove(GlobalPacketId(k.first, k.second)));
+        deadlines.erase(k);
+    }
+
+    // The schedule must always offer one of the packets that are due first
+    void checkPeek(uint32_t now)
+    {
+        PendingPacket *p = schedule.peek();
+        TEST_ASSERT_EQUAL(deadlines.size(), schedule.size());
+        if (deadlines.empty()) {
+            TEST_ASSERT_NULL(p);
+            return;
+        }
+        TEST_ASSERT_NOT_NULL(p);
+        int32_t earliest = INT32_MAX;
+        for (auto &d : deadlines)
+            if ((int32_t)(d.second - now) < earliest)
+                earliest = d.second - now;
+        TEST_ASSERT_EQUAL_INT32(earliest, (int32_t)(schedule.getNextTxMsec(p) - now));
+        TEST_ASSERT_EQUAL_UINT32(deadlines[keys[p]], schedule.getNextTxMsec(p));
+    }
+};
+
+/**
+ * Keep `inFlight` reliable packets going while millis() runs over the 32 bit rollover.  Due packets are either retransmitted
+ * later or given up on, ACKs remove random packets, new ones keep arriving, and sending/receiving pushes everything back by
+ * some airtime.
+ */
+void drive(size_t inFlight, size_t steps, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    uint32_t now = 0xffffffff - 20000; // Roll over early in the run
+    PacketId nextId = 1;
+    ModelledSchedule m;
+
+    for (size_t i = 0; i < inFlight; i++)
+        m.add(Key(rng() % 50 + 1, nextId++), now + rng() % 8000);
+
+    size_t handled = 0;
+    for (size_t step = 0; step < steps; step++) {
+        now += rng() % 20;
+
+        // Handle everything that is due, earliest first
+        PendingPacket *p;
+        uint32_t lastDue = now - INT32_MAX;
+        while ((p = m.schedule.peek()) && (int32_t)(m.schedule.getNextTxMsec(p) - now) <= 0) {
+            uint32_t due = m.schedule.getNextTxMsec(p);
+            TEST_ASSERT_TRUE((int32_t)(due - lastDue) >= 0);
+            lastDue = due;
+
+            Key k = m.keys[p];
+            if (rng() % 3) {
+                uint32_t next = now + 1 + rng() % 8000;
+                m.schedule.reschedule(p, next);
+                m.deadlines[k] = next;
+            } else {
+                m.remove(k);
+                m.add(Key(rng() % 50 + 1, nextId++), now + rng() % 8000);
+            }
+            handled++;
+        }
+
+        // ACKs for random packets, and for a packet id that was never sent
+        if (!m.deadlines.empty() && rng() % 4 == 0) {
+            auto it = m.deadlines.begin();
+            std::advance(it, rng() % m.deadlines.size());
+            m.remove(it->first);
+            m.add(Key(rng() % 50 + 1, nextId++), now + rng() % 8000);
+        }
+        TEST_ASSERT_FALSE(m.schedule.remove(GlobalPacketId(0, nextId + 1000)));
+
+        // Airtime of a packet we heard or sent delays all pending retransmissions, except the one being sent
+        if (rng() % 5 == 0) {
+            uint32_t airtime = rng() % 50;
+            auto except = m.deadlines.end();
+            if (!m.deadlines.empty() && rng() % 2) {
+                except = m.deadlines.begin();
+                std::advance(except, rng() % m.deadlines.size());
+                m.schedule.delayAll(airtime, GlobalPacketId(except->first.first, except->first.second));
+            } else {
+                m.schedule.delayAll(airtime);
+            }
+            for (auto it = m.deadlines.begin(); it != m.deadlines.end(); it++)
+                if (it != except)
+                    it->second += airtime;
+        }
+
+        m.checkPeek(now);
+    }
+    TEST_ASSERT_TRUE(handled > inFlight); // Every packet came due at least once on average
+    TEST_ASSERT_TRUE(now < 0x80000000); // We really did roll over
+}
+} // namespace
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_emptySchedule(void)
+{
+    RetransmissionSchedule s;
+    TEST_ASSERT_NULL(s.peek());
+    TEST_ASSERT_NULL(s.find(GlobalPacketId(1, 2)));
+    TEST_ASSERT_FALSE(s.remove(GlobalPacketId(1, 2)));
+}
+
+void test_replaceKeepsOneRecord(void)
+{
+    RetransmissionSchedule s;
+    const uint32_t replaced = s.add(GlobalPacketId(1, 2), record(3), 1000)->generation;
+    PendingPacket *p = s.add(GlobalPacketId(1, 2), record(2), 500);
+    TEST_ASSERT_NOT_EQUAL(replaced, p->generation); // even if the map put it at the same address
+    TEST_ASSERT_EQUAL(1, s.size());
+    TEST_ASSERT_EQUAL_PTR(p, s.peek());
+    TEST_ASSERT_EQUAL_UINT32(500, s.getNextTxMsec(p));
+    TEST_ASSERT_EQUAL_UINT8(1, p->numRetransmissions);
+}
+
+void test_ordersAcrossRollover(void)
+{
+    RetransmissionSchedule s;
+    PendingPacket *late = s.add(GlobalPacketId(1, 1), record(3), 100);        // just after the rollover
+    PendingPacket *early = s.add(GlobalPacketId(1, 2), record(3), 0xfffffff0); // just before it
+    TEST_ASSERT_EQUAL_PTR(early, s.peek());
+    s.remove(GlobalPacketId(1, 2));
+    TEST_ASSERT_EQUAL_PTR(late, s.peek());
+}
+
+void test_thousandsInFlight(void)
+{
+    drive(2000, 3000, 1);
+}
+
+void test_fewInFlight(void)
+{
+    drive(3, 20000, 2);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_emptySchedule);
+    RUN_TEST(test_replaceKeepsOneRecord);
+    RUN_TEST(test_ordersAcrossRollover);
+    RUN_TEST(test_thousandsInFlight);
+    RUN_TEST(test_fewInFlight);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
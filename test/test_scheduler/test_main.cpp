@@ -0,0 +1,175 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "concurrency/OSThread.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using concurrency::mainScheduler;
+
+namespace
+{
+std::vector<std::string> order;
+
+/// Notes when it runs, then waits for someone to reschedule it
+class Recorder : public concurrency::OSThread
+{
+  public:
+    int runs = 0;
+
+    Recorder(const char *name, uint32_t period) : concurrency::OSThread(name, period) {}
+
+  protected:
+    int32_t runOnce() override
+    {
+        runs++;
+        order.push_back(ThreadName);
+        return INT32_MAX;
+    }
+};
+
+/// Run the main loop's scheduler for a while
+void runFor(uint32_t msec)
+{
+    uint32_t start = millis();
+    while (millis() - start < msec) {
+        mainScheduler.runOrDelay();
+        delay(1);
+    }
+}
+} // namespace
+
+void setUp(void)
+{
+    order.clear();
+}
+
+void tearDown(void) {}
+
+// Threads run in the order of their deadlines, not the order they were created in
+void test_runsInDeadlineOrder(void)
+{
+    Recorder c("c", 30), a("a", 10), b("b", 20);
+    TEST_ASSERT_LESS_OR_EQUAL(10, mainScheduler.runOrDelay());
+
+    runFor(60);
+    TEST_ASSERT_EQUAL(3, order.size());
+    TEST_ASSERT_EQUAL_STRING("a", order[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("b", order[1].c_str());
+    TEST_ASSERT_EQUAL_STRING("c", order[2].c_str());
+}
+
+// Threads with the same deadline all run in the same pass
+void test_equalDeadlines(void)
+{
+    Recorder x("x", INT32_MAX), y("y", INT32_MAX), z("z", INT32_MAX);
+    runFor(5);
+    TEST_ASSERT_EQUAL(0, order.size());
+
+    x.setInterval(0);
+    y.setInterval(0);
+    z.setInterval(0);
+    mainScheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, x.runs);
+    TEST_ASSERT_EQUAL(1, y.runs);
+    TEST_ASSERT_EQUAL(1, z.runs);
+}
+
+// Changing the interval of a thread already in the heap moves it, both earlier and later
+void test_rekeys(void)
+{
+    Recorder later("later", 10), sooner("sooner", 100000);
+    later.setIntervalFromNow(100000);
+    runFor(30);
+    TEST_ASSERT_EQUAL(0, later.runs);
+    TEST_ASSERT_EQUAL(0, sooner.runs);
+
+    sooner.setIntervalFromNow(0);
+    mainScheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, sooner.runs);
+    TEST_ASSERT_EQUAL(0, later.runs);
+
+    // Rescheduling the same thread twice before the scheduler looks only queues it once, the last interval wins
+    later.setIntervalFromNow(0);
+    later.setIntervalFromNow(100000);
+    runFor(20);
+    TEST_ASSERT_EQUAL(0, later.runs);
+}
+
+// A thread disabled after being woken doesn't run, and runs again once enabled
+void test_disableWhileQueued(void)
+{
+    Recorder t("t", 100000);
+    t.setIntervalFromNow(0);
+    t.disable();
+    runFor(20);
+    TEST_ASSERT_EQUAL(0, t.runs);
+
+    t.enabled = true;
+    t.setIntervalFromNow(0);
+    mainScheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, t.runs);
+
+    // Disabled by flipping the flag while due, then enabled the same way
+    Recorder u("u", 5);
+    u.enabled = false;
+    runFor(20);
+    TEST_ASSERT_EQUAL(0, u.runs);
+    u.enabled = true;
+    mainScheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, u.runs);
+}
+
+// A thread deleted while waiting to be re-keyed is forgotten
+void test_deleteWhileQueued(void)
+{
+    Recorder *gone = new Recorder("gone", 100000);
+    Recorder kept("kept", 100000);
+    kept.setIntervalFromNow(0);
+    gone->setIntervalFromNow(0);
+    delete gone;
+    mainScheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, kept.runs);
+    TEST_ASSERT_EQUAL(1, order.size());
+}
+
+// Wakeups from other tasks are picked up on the next pass
+void test_wakeFromOtherThread(void)
+{
+    Recorder t("t", 100000);
+    std::thread waker([&t] {
+        for (int i = 0; i < 1000; i++)
+            t.setInterval(0);
+    });
+    waker.join();
+    mainScheduler.runOrDelay();
+    TEST_ASSERT_EQUAL(1, t.runs);
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_runsInDeadlineOrder);
+    RUN_TEST(test_equalDeadlines);
+    RUN_TEST(test_rekeys);
+    RUN_TEST(test_disableWhileQueued);
+    RUN_TEST(test_deleteWhileQueued);
+    RUN_TEST(test_wakeFromOtherThread);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -0,0 +1,287 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "SPILock.h"
+#include "mesh/MeshService.h"
+#include "mesh/NodeDB.h"
+#include "mesh/StreamAPI.h"
+#include "platform/portduino/PortduinoGlue.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+// The sending end of a loopback TCP connection, counting how often it is written to
+class SocketStream : public Stream
+{
+  public:
+    int fd = -1;
+    size_t writes = 0;
+
+    virtual int available() override { return 0; }
+    virtual int read() override { return -1; }
+    virtual int peek() override { return -1; }
+    virtual size_t write(uint8_t c) override { return write(&c, 1); }
+    virtual size_t write(const uint8_t *buf, size_t len) override
+    {
+        writes++;
+        size_t done = 0;
+        while (done < len) {
+            ssize_t n = ::send(fd, buf + done, len - done, MSG_NOSIGNAL);
+            if (n <= 0)
+                break;
+            done += n;
+        }
+        return done;
+    }
+    virtual void flush() override {}
+};
+
+class TestStreamAPI : public StreamAPI
+{
+  public:
+    explicit TestStreamAPI(Stream *stream) : StreamAPI(stream) {}
+
+  protected:
+    virtual void onConnectionChanged(bool connected) override {}
+    virtual bool checkIsConnected() override { return true; }
+};
+
+// Collects everything written, like SocketOutput does, without sending it anywhere
+class BufferStream : public Stream
+{
+  public:
+    std::vector<uint8_t> data;
+    size_t writes = 0;
+
+    virtual int available() override { return 0; }
+    virtual int read() override { return -1; }
+    virtual int peek() override { return -1; }
+    virtual size_t write(uint8_t c) override { return write(&c, 1); }
+    virtual size_t write(const uint8_t *buf, size_t len) override
+    {
+        writes++;
+        data.insert(data.end(), buf, buf + len);
+        return len;
+    }
+    virtual void flush() override {}
+};
+
+// Takes packets until what it has written and what it has batched add up to limit
+class LimitedStreamAPI : public TestStreamAPI
+{
+    BufferStream &stream;
+    size_t limit;
+    bool buffered;
+
+  public:
+    LimitedStreamAPI(BufferStream &stream, size_t limit, bool buffered)
+        : TestStreamAPI(&stream), stream(stream), limit(limit), buffered(buffered)
+    {
+    }
+
+  protected:
+    virtual bool readyForMore() override { return stream.data.size() + getTxBatchedBytes() < limit; }
+    virtual bool buffersOutput() override { return buffered; }
+};
+
+// Ask for the NodeDB, as a client does with SPECIAL_NONCE_ONLY_NODES
+void requestNodes(StreamAPI &api)
+{
+    meshtastic_ToRadio request = meshtastic_ToRadio_init_zero;
+    request.which_payload_variant = meshtastic_ToRadio_want_config_id_tag;
+    request.want_config_id = SPECIAL_NONCE_ONLY_NODES;
+    uint8_t buf[meshtastic_ToRadio_size];
+    api.handleToRadio(buf, pb_encode_to_bytes(buf, sizeof(buf), &meshtastic_ToRadio_msg, &request));
+}
+
+// Connect two sockets over 127.0.0.1, returns false on failure
+bool loopback(int &client, int &server)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (listener < 0 || bind(listener, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0 ||
+        getsockname(listener, (sockaddr *)&addr, &len) != 0)
+        return false;
+
+    client = socket(AF_INET, SOCK_STREAM, 0);
+    if (client < 0 || connect(client, (sockaddr *)&addr, sizeof(addr)) != 0)
+        return false;
+    server = accept(listener, NULL, NULL);
+    close(listener);
+    return server >= 0;
+}
+
+void fillNodeDB(int numNodes)
+{
+    setSetting(maxnodes, numNodes);
+    nodeDB = new NodeDB();
+    nodeDB->resetNodes();
+
+    for (int i = 1; i < numNodes; i++) {
+        meshtastic_MeshPacket mp = meshtastic_MeshPacket_init_zero;
+        mp.from = 0x10000 + i;
+        mp.rx_time = 1000000 + i;
+        mp.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+        nodeDB->updateFrom(mp);
+
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(mp.from);
+        node->has_user = true;
+        snprintf(node->user.long_name, sizeof(node->user.long_name), "Benchmark node %d", i);
+        snprintf(node->user.short_name, sizeof(node->user.short_name), "%04x", i & 0xffff);
+    }
+    TEST_ASSERT_EQUAL(numNodes, nodeDB->getNumMeshNodes());
+}
+
+/**
+ * Download just the NodeDB (as a client does with SPECIAL_NONCE_ONLY_NODES) over a TCP connection, and check that we got every
+ * node and the config complete marker.
+ */
+void benchmarkNodeDownload(int numNodes)
+{
+    fillNodeDB(numNodes);
+    service = new MeshService();
+
+    int client, server;
+    TEST_ASSERT_TRUE(loopback(client, server));
+
+    // Read everything on the other end while we send
+    std::vector<uint8_t> received;
+    std::thread reader([&] {
+        uint8_t buf[4096];
+        ssize_t n;
+        while ((n = recv(client, buf, sizeof(buf), 0)) > 0)
+            received.insert(received.end(), buf, buf + n);
+    });
+
+    SocketStream stream;
+    stream.fd = server;
+    {
+        TestStreamAPI api(&stream);
+        requestNodes(api);
+
+        uint32_t start = millis();
+        api.runOncePart();
+        uint32_t elapsed = millis() - start;
+
+        shutdown(server, SHUT_WR);
+        reader.join();
+
+        // Unframe what the client got
+        size_t frames = 0;
+        meshtastic_FromRadio last = meshtastic_FromRadio_init_zero;
+        for (size_t pos = 0; pos + 4 <= received.size();) {
+            TEST_ASSERT_EQUAL_HEX8(0x94, received[pos]);
+            TEST_ASSERT_EQUAL_HEX8(0xc3, received[pos + 1]);
+            size_t len = (received[pos + 2] << 8) | received[pos + 3];
+            TEST_ASSERT_TRUE(pos + 4 + len <= received.size());
+            last = meshtastic_FromRadio_init_zero;
+            TEST_ASSERT_TRUE(pb_decode_from_bytes(&received[pos + 4], len, &meshtastic_FromRadio_msg, &last));
+            pos += 4 + len;
+            frames++;
+        }
+        TEST_ASSERT_EQUAL(numNodes + 1, frames); // Every node, then config complete
+        TEST_ASSERT_EQUAL(meshtastic_FromRadio_config_complete_id_tag, last.which_payload_variant);
+        TEST_ASSERT_EQUAL_UINT32(SPECIAL_NONCE_ONLY_NODES, last.config_complete_id);
+#if STREAM_TX_BATCH_SIZE > 0
+        TEST_ASSERT_TRUE(stream.writes * 10 < frames);
+#endif
+
+        char msg[120];
+        snprintf(msg, sizeof(msg), "%d nodes: %u frames, %u bytes in %u writes took %u ms", numNodes, (unsigned)frames,
+                 (unsigned)received.size(), (unsigned)stream.writes, elapsed);
+        TEST_MESSAGE(msg);
+    }
+
+    close(client);
+    close(server);
+    delete service;
+    service = NULL;
+    delete nodeDB;
+    nodeDB = NULL;
+}
+} // namespace
+
+void setUp(void) {}
+
+void tearDown(void)
+{
+    freeRetiredSettings();
+}
+
+void test_nodeDownload100(void)
+{
+    benchmarkNodeDownload(100);
+}
+
+void test_nodeDownload5000(void)
+{
+    benchmarkNodeDownload(5000);
+}
+
+// Frames waiting in the batch hold back more packets like written ones do, and streams that buffer their own output are
+// written each frame directly rather than through the batch
+void test_backpressureCountsBatch(void)
+{
+    fillNodeDB(500);
+    service = new MeshService();
+
+    for (bool buffered : {false, true}) {
+        BufferStream stream;
+        LimitedStreamAPI api(stream, 4096, buffered);
+        requestNodes(api);
+        api.runOncePart();
+
+        // Stopped as soon as the limit was reached
+        TEST_ASSERT_TRUE(stream.data.size() >= 4096);
+        TEST_ASSERT_TRUE(stream.data.size() < 4096 + MAX_STREAM_BUF_SIZE);
+
+        size_t frames = 0;
+        for (size_t pos = 0; pos + 4 <= stream.data.size(); pos += 4 + ((stream.data[pos + 2] << 8) | stream.data[pos + 3]))
+            frames++;
+        if (buffered)
+            TEST_ASSERT_EQUAL(frames, stream.writes);
+#if STREAM_TX_BATCH_SIZE > 0
+        else
+            TEST_ASSERT_TRUE(stream.writes * 10 < frames);
+#endif
+    }
+
+    delete service;
+    service = NULL;
+    delete nodeDB;
+    nodeDB = NULL;
+}
+
+void setup()
+{
+    initializeTestEnvironment();
+    if (!spiLock)
+        initSPI();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_nodeDownload100);
+    RUN_TEST(test_nodeDownload5000);
+    RUN_TEST(test_backpressureCountsBatch);
+    exit(UNITY_END());
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the ARCH_PORTDUINO variant");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+void loop() {}
@@ -3,8 +3,8 @@
 #endif
 #define CANNED_MESSAGE_MODULE_ENABLE 1
 #define HAS_GPS 1
-#define MAX_RX_TOPHONE settingsMap[maxtophone]
-#define MAX_NUM_NODES settingsMap[maxnodes]
+#define MAX_RX_TOPHONE getSetting<maxtophone>()
+#define MAX_NUM_NODES getSetting<maxnodes>()
 
 // RAK12002 RTC Module
 #define RV3028_RTC (uint8_t)0b1010010
\ No newline at end of file